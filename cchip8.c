@@ -1,4 +1,28 @@
 #include "include/cchip8.h"
+#include "include/cchip8_stats.h"
+#include "include/cchip8_hud.h"
+#include "include/cchip8_fusion.h"
+#include "include/cchip8_sdl.h"
+#include "include/cchip8_runahead.h"
+#include "include/cchip8_filter.h"
+
+static uint64_t m_emulate_frame(cchip8 *m_vm, enum cchip8_status *m_status);
+static const uint32_t *m_present_picture(cchip8 *m_vm, m_runahead *m_runahead, bool m_ran, bool *m_redraw);
+static void m_print_stats(const m_frametimes *m_frametimes, const m_runahead *m_runahead, const cchip8 *m_vm);
+static bool m_debugger_key(cchip8 *m_vm, SDL_Keycode m_key);
+static void m_print_registers(const cchip8 *m_vm);
+
+// What a keypad change has to reach: the machine, and run-ahead's latency measurement
+typedef struct chip8_keypath
+{
+	cchip8 *m_vm;
+	m_runahead *m_runahead;
+
+} m_keypath;
+
+static void m_key_event(void *m_user, uint8_t m_key, bool m_down);
+static void m_finish_capture(cchip8_capture *m_capture, const char *m_filename);
+static bool m_upload_picture(SDL_Texture *m_texture, m_filter *m_filter, const uint32_t *m_framebuffer, bool m_redraw, uint32_t m_frames);
 
 #ifdef __MINGW32__ || __MINGW64__
 /*
@@ -23,7 +47,21 @@ int main(int argc, char **argv)
 		printf("Usage: ./cchip8 [flags] [progname]\n");
 		printf("Command-line switches:\n");
 		printf("-[d or D] Enable the built-in debugger\n");
-		printf("-no-exit  Prevents sudden emulator closes (For example, on Unimplemented Opcode)\n");
+		printf("-no-exit  Keep the window open once the machine faults (For example, on an Unimplemented Opcode)\n");
+		printf("-vsync    Present on every display refresh, emulating at a fixed 60 Hz\n");
+		printf("-stats    Print frame-time and superinstruction statistics on exit\n");
+		printf("-no-fusion Disable the predecoded superinstruction interpreter\n");
+		printf("-quirks [cchip8|vip|chip48|schip|modern|auto] Quirk profile the ROM needs (Default: cchip8, auto detects it)\n");
+		printf("-font [path] TrueType font used by the performance HUD (Toggled with F1)\n");
+		printf("-runahead [frames] Present the picture this many frames ahead to hide input lag (Up to %d)\n", M_RUNAHEAD_MAX_FRAMES);
+		printf("-journal [KiB] Journal this much execution history so the debugger can step backwards\n");
+		printf("-control [path] Accept automation clients on the Unix domain socket path (See cchip8-server)\n");
+		printf("-capture [file] Record every picture change to file (.c8v, turn it into video with cchip8-convert)\n");
+		printf("-scale [pixels] Window pixels per CHIP-8 pixel (Default: 10)\n");
+		printf("-filter [nearest|scale2x|scale3x] Upscale on the CPU to the window size, scale2x/scale3x round off diagonals\n");
+		printf("-phosphor [0-255] Let erased pixels fade, keeping this much of their brightness every frame (Hides sprite flicker)\n");
+		printf("-scanlines Darken the bottom of every pixel row like a CRT\n");
+		printf("-shm [name] Export the framebuffer and machine state to the shared memory segment name (\"/cchip8\") for cchip8-monitor\n");
 		return EXIT_FAILURE;
 	}
 #endif
@@ -34,6 +72,51 @@ int main(int argc, char **argv)
 	// Implement a no-exit switch that deals with SDL closing routine
 	bool m_no_exit = false;
 
+	// Present through a vsync'd renderer and pace emulated frames against the display refresh
+	bool m_vsync = false;
+
+	// Print the collected frame-time statistics on exit
+	bool m_showstats = false;
+
+	// Predecode the ROM and fuse common instruction sequences
+	bool m_fusion = true;
+
+	// Quirk profile (Interpreter variant) used for this ROM, "auto" lets the static analyser pick it
+	const char *m_profile = "cchip8";
+
+	// Font used by the on-screen performance HUD
+	const char *m_hudfont = M_HUD_DEFAULT_FONT;
+
+	// Frames emulated ahead of the presented picture (0 disables run-ahead)
+	uint32_t m_runaheadframes = 0;
+
+	// Undo journal budget in KiB for reverse debugging (0 disables it)
+	uint32_t m_journalkib = 0;
+
+	// Shared memory segment other processes watch the machine through (NULL disables the export)
+	const char *m_shmname = NULL;
+	cchip8_export *m_export = NULL;
+
+	// Unix domain socket automation clients drive the machine through (NULL disables it)
+	const char *m_controlpath = NULL;
+	cchip8_control *m_control = NULL;
+
+	// Capture stream every picture change gets recorded to (NULL disables it)
+	const char *m_capturename = NULL;
+	cchip8_capture *m_capture = NULL;
+
+	// Window pixels per CHIP-8 pixel
+	uint32_t m_scale = 10;
+
+	/*
+		Presentation filters (See cchip8_filter.h), any of the three flags turns them on and the
+		texture becomes the window-sized filtered picture instead of the bare 64x32 display
+	*/
+	bool m_filtered = false;
+	m_scaler m_scaler = M_SCALER_NEAREST;
+	uint8_t m_persistence = 0;
+	bool m_scanlines = false;
+
 	// Declare a char pointer with the name of the filename to load
 	const char *m_filename = NULL;
 
@@ -48,6 +131,79 @@ int main(int argc, char **argv)
 		} else if (strcmp(argv[i], "-no-exit") == 0)
 		{
 			m_no_exit = true;
+		} else if (strcmp(argv[i], "-vsync") == 0)
+		{
+			m_vsync = true;
+		} else if (strcmp(argv[i], "-stats") == 0)
+		{
+			m_showstats = true;
+		} else if (strcmp(argv[i], "-no-fusion") == 0)
+		{
+			m_fusion = false;
+		} else if ((strcmp(argv[i], "-quirks") == 0) && ((i + 1) < argc))
+		{
+			m_profile = argv[++i];
+
+			if ((strcmp(m_profile, "auto") != 0) && (m_profile_from_name(m_profile) == M_PROFILE_COUNT))
+			{
+				printf("Unknown quirk profile: %s\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if ((strcmp(argv[i], "-font") == 0) && ((i + 1) < argc))
+		{
+			m_hudfont = argv[++i];
+		} else if ((strcmp(argv[i], "-runahead") == 0) && ((i + 1) < argc))
+		{
+			m_runaheadframes = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-journal") == 0) && ((i + 1) < argc))
+		{
+			m_journalkib = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-shm") == 0) && ((i + 1) < argc))
+		{
+			m_shmname = argv[++i];
+		} else if ((strcmp(argv[i], "-control") == 0) && ((i + 1) < argc))
+		{
+			m_controlpath = argv[++i];
+		} else if ((strcmp(argv[i], "-capture") == 0) && ((i + 1) < argc))
+		{
+			m_capturename = argv[++i];
+		} else if ((strcmp(argv[i], "-scale") == 0) && ((i + 1) < argc))
+		{
+			m_scale = (uint32_t) strtoul(argv[++i], NULL, 0);
+
+			if ((m_scale == 0) || (m_scale > 120))
+			{
+				printf("The scale goes from 1 to 120: %s\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if ((strcmp(argv[i], "-filter") == 0) && ((i + 1) < argc))
+		{
+			i++;
+			m_filtered = true;
+
+			if (strcmp(argv[i], "nearest") == 0)
+			{
+				m_scaler = M_SCALER_NEAREST;
+			} else if (strcmp(argv[i], "scale2x") == 0)
+			{
+				m_scaler = M_SCALER_SCALE2X;
+			} else if (strcmp(argv[i], "scale3x") == 0)
+			{
+				m_scaler = M_SCALER_SCALE3X;
+			} else {
+				printf("Unknown filter: %s\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if ((strcmp(argv[i], "-phosphor") == 0) && ((i + 1) < argc))
+		{
+			unsigned long m_value = strtoul(argv[++i], NULL, 0);
+
+			m_filtered = true;
+			m_persistence = (uint8_t) ((m_value > 255) ? 255 : m_value);
+		} else if (strcmp(argv[i], "-scanlines") == 0)
+		{
+			m_filtered = true;
+			m_scanlines = true;
 		} else if (m_foundrom != true)
 		{
 			if ((strstr(argv[i], ".ch8") != NULL) || (strstr(argv[i], ".rom") != NULL))
@@ -83,7 +239,12 @@ int main(int argc, char **argv)
 	
 	if (m_no_exit == true)
 	{
-		printf("CCHIP8 won't exit in case of Unimplemented Opcode!\n");
+		printf("CCHIP8 won't exit once the machine faults!\n");
+	}
+
+	if (m_vsync == true)
+	{
+		printf("VSync-paced presentation enabled!\n");
 	}
 #endif
 	
@@ -98,126 +259,91 @@ int main(int argc, char **argv)
 
 	printf("Loading %s...\n", m_filename);
 
-	// Use the FILE directive to access a file
-	FILE *m_prg;
+	// Declare the CHIP8 Interpreter through libcchip8 (Font installed, registers, memory and display cleared)
+	cchip8_options m_options;
+	cchip8_default_options(&m_options);
+	m_options.m_profile = m_profile;
+	m_options.m_fusion = m_fusion;
 
-	// Open the file in binary mode (And read-only)
-	m_prg = fopen(m_filename, "rb");
+	cchip8 *m_vm = cchip8_create(&m_options);
 
-	// Check if the file has been opened
-	if(m_prg == NULL)
+	if (m_vm == NULL)
 	{
-		printf("Could not open the program file, exiting...\n");
+		printf("Couldn't allocate the interpreter, exiting...\n");
 		return EXIT_FAILURE;
-	} else {
-		printf("Program file loaded successfully\n");
 	}
 
-	// Declare the CHIP8 Interpreter skeleton
-	m_chip8 chip8;
-
-	// Initialize the registers
-	memset(&chip8.m_registers, 0, sizeof(chip8.m_registers));
-
-	// Set the index register to 0
-	chip8.m_index = 0;
-
-	// Set the program counter to 0x200
-	chip8.m_programcounter = CHIP8_INITIAL_PC;
-
-	// Initialize the stack
-	memset(&chip8.m_stack, 0, sizeof(chip8.m_stack));
-
-	// Set stack pointer to 0
-	chip8.m_stackp = 0;
-
-	// Initialize the memory
-	memset(&chip8.m_memory, 0, sizeof(chip8.m_memory));
-
-	// Initialize the keyboard data
-	memset(&chip8.m_keyboard, 0, sizeof(chip8.m_keyboard));
-
-	// Initialize the displau
-	memset(&chip8.m_display, 0, sizeof(chip8.m_display));
-
-	// Initialize internal pixel display
-	memset(&chip8.m_pixels, 0, sizeof(chip8.m_pixels));
-
-	// Initialize the sound and delay timers
-	chip8.m_soundtmr = 0;
-	chip8.m_delaytmr = 0;
-
 #ifdef DEBUG
 	printf("Initialized the emulated interpreter succesfully\n");
 #endif
 
-	// Get file size in bytes
-	fseek(m_prg, 0, SEEK_END);
-	size_t m_prgsz = ftell(m_prg);
-	fseek(m_prg, 0, SEEK_SET);
-
-	// Allocate a buffer for the program
-	unsigned char *m_prg_buf;
-	m_prg_buf = (unsigned char*) malloc(sizeof(unsigned char) * m_prgsz);
-
-	// Error out on memory exhaustion
-	if (m_prg_buf == NULL)
+	// Read the program and copy it into the interpreter's memory in one go (Resets the machine)
+	if (cchip8_load_rom_from_file(m_vm, m_filename) == false)
 	{
-		printf("Couldn't allocate memory, exiting...\n");
+		printf("Could not load the program file, exiting...\n");
 		return EXIT_FAILURE;
 	}
 
-	// Load the file into host memory
-	fread(m_prg_buf, sizeof(unsigned char), m_prgsz, m_prg); 
+	printf("Program file loaded successfully\n");
 
-#ifdef DEBUG
-	printf("Program size: %d bytes\n", (unsigned int) m_prgsz);
-	printf("Program Memory Dump: \n");
-#endif
+	printf("Quirk profile: %s%s\n", cchip8_get_profile(m_vm), (strcmp(m_profile, "auto") == 0) ? " (Detected)" : "");
 
-	// Load the program from host memory into interpreter's memory
-	for (unsigned int i = 0; i < (unsigned int) m_prgsz; i++)
+	if (m_journalkib != 0)
 	{
-		chip8.m_memory[CHIP8_INITIAL_PC + i] = m_prg_buf[i];
+		if (cchip8_set_journal(m_vm, (size_t) m_journalkib * 1024) == false)
+		{
+			printf("Couldn't allocate the undo journal, exiting...\n");
+			return EXIT_FAILURE;
+		}
 
-#ifdef DEBUG
-		printf("0x%x ", chip8.m_memory[CHIP8_INITIAL_PC + i]);
+		printf("Journaling %u KiB of history: Backspace steps back, F4 sets the breakpoint, F5 runs back to it, F6 tells who last wrote RAM[I]\n", m_journalkib);
+	}
+
+	if (m_shmname != NULL)
+	{
+		m_export = cchip8_export_create(m_shmname);
 
-		if (i == (((unsigned int) m_prgsz) - 1))
+		if (m_export == NULL)
 		{
-			printf("\n");
+			printf("Couldn't export the machine to %s, exiting...\n", m_shmname);
+			return EXIT_FAILURE;
 		}
-#endif
+
+		cchip8_attach_export(m_vm, m_export);
+
+		printf("Exporting the machine to %s (Watch it with cchip8-monitor %s)\n", m_shmname, m_shmname);
 	}
 
-	// Free the buffer
-	free(m_prg_buf);
+	if (m_controlpath != NULL)
+	{
+		m_control = cchip8_control_create(m_vm, m_controlpath);
 
-	// Close the file pipe
-	fclose(m_prg);
+		if (m_control == NULL)
+		{
+			printf("Couldn't open the control socket %s, exiting...\n", m_controlpath);
+			return EXIT_FAILURE;
+		}
 
-#ifdef DEBUG
-	printf("Loading the font into memory...\n");
-	printf("Font Memory Map: \n");
-#endif
+		printf("Accepting control clients on %s\n", m_controlpath);
+	}
 
-	// Now load the font into the interpreter's memory
-	for (unsigned int i = 0; i < CHIP8_FONT_SIZE; i++)
+	if (m_capturename != NULL)
 	{
-		chip8.m_memory[i] = m_font[i];
+		m_capture = cchip8_capture_create(m_capturename);
 
-#ifdef DEBUG
-		printf("0x%x ", (unsigned int) chip8.m_memory[i]);
-		
-		if (i == (((unsigned int) CHIP8_FONT_SIZE) - 1))
+		if (m_capture == NULL)
 		{
-			printf("\n");
+			printf("Couldn't record to %s, exiting...\n", m_capturename);
+			return EXIT_FAILURE;
 		}
-#endif
+
+		cchip8_attach_capture(m_vm, m_capture);
+
+		printf("Recording to %s (Convert it with cchip8-convert %s -o video.y4m)\n", m_capturename, m_capturename);
 	}
 
-	// Set the opcode unimplemented flag to false
-	chip8.m_isUnimplemented = false;
+	// Why the last batch of instructions stopped
+	enum cchip8_status m_status = CCHIP8_OK;
 
 	// Declare both the window and Surface to use SDL2 abilities
 	SDL_Window   *m_window;
@@ -232,9 +358,9 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
 	}
 
-	// Create a 640 x 320 (px) window
+	// Create a 640 x 320 (px) window (Or whatever -scale asks for)
 	m_window = SDL_CreateWindow("CCHIP8 (SDL2)", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-							  (CHIP8_COLUMNS * 10), (CHIP8_ROWS * 10), SDL_WINDOW_SHOWN);
+							  (CHIP8_COLUMNS * m_scale), (CHIP8_ROWS * m_scale), SDL_WINDOW_SHOWN);
 
 	// Check if Window could be crafted
 	if (m_window == NULL)
@@ -243,8 +369,17 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-	// Set screen as a pointer to the window's surface
-	m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+	/*
+		Set screen as a pointer to the window's surface.
+		In VSync mode we ask for an accelerated renderer whose SDL_RenderPresent blocks until
+		the next display refresh, that's what paces the host loop.
+	*/
+	if (m_vsync == true)
+	{
+		m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+	} else {
+		m_renderer = SDL_CreateRenderer(m_window, -1, 0);
+	}
 
 	// Check if renderer could be crafted
 	if (m_renderer == NULL)
@@ -253,11 +388,27 @@ int main(int argc, char **argv)
         return EXIT_FAILURE;
     }
 
-	// Adjust the renderer size
+	// Adjust the renderer size (The HUD lays itself out in 640 x 320 whatever the window's size)
 	SDL_RenderSetLogicalSize(m_renderer, (CHIP8_COLUMNS * 10), (CHIP8_ROWS * 10));
+
+	// The filters' picture is already window-sized, the renderer copies it without stretching
+	m_filter m_filterstate;
+	m_filter *m_filter = NULL;
+
+	if (m_filtered == true)
+	{
+		if (m_filter_init(&m_filterstate, m_scaler, m_scale, m_persistence, m_scanlines) == false)
+		{
+			printf("Couldn't allocate the presentation filter buffers, exiting...\n");
+			return EXIT_FAILURE;
+		}
+
+		m_filter = &m_filterstate;
+	}
 	
 	// Setup the texture trick that'll enable us to display emulator output
-	m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, CHIP8_COLUMNS, CHIP8_ROWS);
+	m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+		(m_filter != NULL) ? (int) m_filter->m_width : CHIP8_COLUMNS, (m_filter != NULL) ? (int) m_filter->m_height : CHIP8_ROWS);
 
 	// Check if texture could not be made
 	if (m_texture == NULL)
@@ -282,35 +433,116 @@ int main(int argc, char **argv)
 	// Create an SDL2 event
 	SDL_Event m_event;
 
+	// Host frame-time statistics (Time between two consecutive presents)
+	m_frametimes m_frametimes;
+	m_frametimes_init(&m_frametimes);
+
+	// Performance counter ticks per second and per emulated (60 Hz) frame
+	const uint64_t m_perffreq = SDL_GetPerformanceFrequency();
+	const uint64_t m_frameticks = m_perffreq / CHIP8_FRAMERATE;
+
+	// Performance counter value of the last present and pending emulation time (In ticks)
+	uint64_t m_lastpresent = SDL_GetPerformanceCounter();
+	uint64_t m_accumulator = 0;
+
+	// On-screen performance HUD (Hidden until F1 is pressed)
+	m_hud m_hud;
+	bool m_hudready = m_hud_init(&m_hud, m_hudfont);
+
+	/*
+		Run-ahead (The debugger steps the real machine, there's nothing to run ahead of there, and
+		restoring the state every frame would wipe the undo journal's history)
+	*/
+	m_runahead m_runahead;
+
+	if (m_runahead_init(&m_runahead, ((m_dbgmode == true) || (m_journalkib != 0)) ? 0 : m_runaheadframes) == false)
+	{
+		printf("Couldn't allocate the run-ahead save state, exiting...\n");
+		return EXIT_FAILURE;
+	}
+
+	if (m_runahead.m_frames != 0)
+	{
+		printf("Running %u frames ahead!\n", m_runahead.m_frames);
+	}
+
+	m_hud.m_runahead = &m_runahead;
+
+	// Keys pressed on the keyboard and by control clients take the same way in
+	m_keypath m_keypath = { .m_vm = m_vm, .m_runahead = &m_runahead };
+
+	if (m_control != NULL)
+	{
+		cchip8_control_key_handler(m_control, m_key_event, &m_keypath);
+	}
+
+	// Performance counter value at which the current HUD-measured phase started
+	uint64_t m_phasestart = 0;
+
+	if (m_vsync == true)
+	{
+		SDL_DisplayMode m_mode;
+
+		if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_window), &m_mode) == 0)
+		{
+			printf("Display refresh rate: %d Hz, emulating at %d Hz\n", m_mode.refresh_rate, CHIP8_FRAMERATE);
+		}
+	}
+
 	while (true)
 	{
+		if (m_hud.m_visible)
+		{
+			m_phasestart = SDL_GetPerformanceCounter();
+		}
+
 		// Use a while() block waiting for SDL_PollEvent to intercept keyboard and sound events
 		while (SDL_PollEvent(&m_event))
 		{
 			switch (m_event.type)
 			{
 				case SDL_QUIT:
-					// Delist the Texture
-					m_texture = NULL;
+					// Release the HUD font and cached textures while their Renderer still exists
+					m_hud_destroy(&m_hud);
 
 					// Deallocate the Texture
 					SDL_DestroyTexture(m_texture);
 
-					// Delist the Renderer
-					m_renderer = NULL;
+					// Delist the Texture
+					m_texture = NULL;
 
 					// Deallocate the Renderer
 					SDL_DestroyRenderer(m_renderer);
 
-					// Delist the Window
-					m_window = NULL;
+					// Delist the Renderer
+					m_renderer = NULL;
 
 					// Deallocate the Window
 					SDL_DestroyWindow(m_window);
 
+					// Delist the Window
+					m_window = NULL;
+
 					// Close all SDL2 Subsystems
 					SDL_Quit();
 
+					if (m_showstats == true)
+					{
+						m_print_stats(&m_frametimes, &m_runahead, m_vm);
+					}
+
+					// Release the interpreter
+					cchip8_destroy(m_vm);
+					cchip8_export_destroy(m_export);
+					cchip8_control_destroy(m_control);
+					m_finish_capture(m_capture, m_capturename);
+					m_runahead_destroy(&m_runahead);
+
+					if (m_filter != NULL)
+					{
+						m_filter_destroy(m_filter);
+					}
+
 					// Exit the program successfully
 					exit(EXIT_SUCCESS);
 					
@@ -318,48 +550,43 @@ int main(int argc, char **argv)
 					break;
 
 				case SDL_KEYDOWN:
-					// Check if debug mode is enabled
-					if (m_dbgmode == true)
+					// F1 toggles the performance HUD (It isn't part of the CHIP8 keypad)
+					if (m_event.key.keysym.sym == SDLK_F1)
 					{
-						m_exec(&chip8);
+						m_hud.m_visible = (m_hud.m_visible == false) && m_hudready;
+						m_phasestart = SDL_GetPerformanceCounter();
 
-						printf("\n\nCurrent OP: 0x%X\n", chip8.m_currentopcode);
+						// Instructions keep being counted while the HUD is hidden, frames and phases aren't
+						m_hud_restart(&m_hud, m_phasestart);
+						break;
+					}
 
-						for (size_t i = 0; i < 16; i++)
+					// Check if debug mode is enabled
+					if (m_dbgmode == true)
+					{
+						// Reverse debugging keys first, any other key steps forward
+						if (m_debugger_key(m_vm, m_event.key.keysym.sym) == false)
 						{
-							printf("V Reg %zu: 0x%X\n",i , chip8.m_registers[i]);
+							m_status = cchip8_step(m_vm);
 						}
 
-						printf("Index Reg: 0x%X\n", chip8.m_index);
-						printf("PC Reg: 0x%X\n", chip8.m_programcounter);
-						printf("SP Reg: 0x%X\n", chip8.m_stackp);
-						printf("Delay Timer Reg: 0x%X\n", chip8.m_delaytmr);
-						printf("Sound Timer Reg: 0x%X\n", chip8.m_soundtmr);
+						m_print_registers(m_vm);
 						break;
 					}
 
-					for (size_t i = 0; i < CHIP8_KEYS; i++)
+					if (m_sdl_key(m_event.key.keysym.sym) >= 0)
 					{
-						if (m_event.key.keysym.sym == m_sdl_keys[i])
-						{
-							chip8.m_keyboard[i] = 1;
-						}
-            		}
+						m_key_event(&m_keypath, (uint8_t) m_sdl_key(m_event.key.keysym.sym), true);
+					}
 
 					// End case SDL_KEYDOWN
 					break;
 
 				case SDL_KEYUP:
 					// Check if debug mode isn't enabled
-					if (m_dbgmode == false)
+					if ((m_dbgmode == false) && (m_sdl_key(m_event.key.keysym.sym) >= 0))
 					{
-						for (size_t i = 0; i < CHIP8_KEYS; i++)
-						{
-							if (m_event.key.keysym.sym == m_sdl_keys[i])
-							{
-								chip8.m_keyboard[i] = 0;
-							}
-						}
+						m_key_event(&m_keypath, (uint8_t) m_sdl_key(m_event.key.keysym.sym), false);
 					}
 					// End if m_dbgmode... statement
 					break;
@@ -371,89 +598,189 @@ int main(int argc, char **argv)
 		}
 		
 		// Once SDL's PollEvent while() has returned, continue with execution
+
+		// Requests control clients sent since the last frame (Their frames run on top of the real ones)
+		if (m_control != NULL)
+		{
+			cchip8_control_serve(m_control, 0);
+		}
+
+		if (m_hud.m_visible)
+		{
+			m_phasestart = m_hud_account(&m_hud, M_HUD_POLL, m_phasestart);
+		}
 		
 		/*
-			Check if opcode is unimplemented, if true, exit the main emulator loop (Fetch & Decode),
-			clear the SDL2 surface, close the GUI window and quit SDL2 altogether.
+			Check if the machine faulted (Unimplemented opcode, stack overflow...), if true report why
+			and exit the main emulator loop (Fetch & Decode), clear the SDL2 surface, close the GUI
+			window and quit SDL2 altogether.
 		*/
-		if (chip8.m_isUnimplemented == true)
+		if (m_status == CCHIP8_HALTED)
 		{
+			cchip8_fault_info m_fault;
+			cchip8_get_fault(m_vm, &m_fault);
+
+			printf("Machine halted: %s at 0x%03X (Opcode 0x%04X) after %llu instructions\n",
+				cchip8_fault_name(m_fault.m_fault), m_fault.m_address, m_fault.m_opcode, (unsigned long long) m_fault.m_cycles);
+
 			if (m_no_exit == true)
 			{
-				while (true)
+				/*
+					Keep the last picture on screen until the window gets closed. SDL_WaitEvent sleeps
+					until something happens, polling here would burn a whole core on a halted machine.
+				*/
+				while (SDL_WaitEvent(&m_event))
 				{
-					while (SDL_PollEvent(&m_event))
+					if (m_event.type == SDL_QUIT)
 					{
-						switch (m_event.type)
-						{
-							case SDL_QUIT:
-								SDL_Quit();
-								exit(EXIT_FAILURE);
-
-							default:
-								break;
-						}	
+						break;
 					}
 				}
-			} else {
-				printf("Exiting the main loop...\n");
+			}
 
-				// Delist the Texture
-				m_texture = NULL;
+			printf("Exiting the main loop...\n");
 
-				// Deallocate the Texture
-				SDL_DestroyTexture(m_texture);
+			// Release the HUD font and cached textures while their Renderer still exists
+			m_hud_destroy(&m_hud);
 
-				// Delist the Renderer
-				m_renderer = NULL;
+			// Deallocate the Texture
+			SDL_DestroyTexture(m_texture);
 
-				// Deallocate the Renderer
-				SDL_DestroyRenderer(m_renderer);
+			// Delist the Texture
+			m_texture = NULL;
 
-				// Delist the Window
-				m_window = NULL;
+			// Deallocate the Renderer
+			SDL_DestroyRenderer(m_renderer);
 
-				// Deallocate the Window
-				SDL_DestroyWindow(m_window);
+			// Delist the Renderer
+			m_renderer = NULL;
 
-				// Close all SDL2 Subsystems
-				SDL_Quit();
+			// Deallocate the Window
+			SDL_DestroyWindow(m_window);
 
-				// Exit the program returning a failure
-				exit(EXIT_FAILURE);
+			// Delist the Window
+			m_window = NULL;
+
+			// Close all SDL2 Subsystems
+			SDL_Quit();
+
+			if (m_showstats == true)
+			{
+				m_print_stats(&m_frametimes, &m_runahead, m_vm);
 			}
-		} else {
-			if (m_dbgmode == false)
+
+			// Release the interpreter
+			cchip8_destroy(m_vm);
+			cchip8_export_destroy(m_export);
+			cchip8_control_destroy(m_control);
+			m_finish_capture(m_capture, m_capturename);
+			m_runahead_destroy(&m_runahead);
+
+			if (m_filter != NULL)
 			{
-				// Execute the fetch & decode
-				m_exec(&chip8);
+				m_filter_destroy(m_filter);
 			}
-		}
 
-		if (chip8.m_redraw)
+			// Exit the program returning a failure
+			exit(EXIT_FAILURE);
+		} else if (m_vsync == true)
 		{
-			chip8.m_redraw = false;
+			/*
+				VSync-paced mode:
+				Emulated frames run at a fixed 60 Hz independently of the display refresh (60, 120, 144 Hz...).
+				Every host frame we add the elapsed time to an accumulator and run as many whole emulated
+				frames as fit inside it, then present once; SDL_RenderPresent blocks until the next refresh.
+			*/
+			uint64_t m_now = SDL_GetPerformanceCounter();
+
+			m_frametimes_record(&m_frametimes, (double) (m_now - m_lastpresent) * 1000.0 / (double) m_perffreq);
+			m_accumulator += m_now - m_lastpresent;
+			m_lastpresent = m_now;
+
+			// After a long host stall (Window drag, breakpoint...) drop the backlog instead of fast-forwarding
+			if (m_accumulator > (4 * m_frameticks))
+			{
+				m_frametimes.m_droppedframes += (m_accumulator / m_frameticks) - 4;
+				m_accumulator = 4 * m_frameticks;
+			}
+
+			bool m_ran = false;
+			uint32_t m_frames = 0;
+
+			while (m_accumulator >= m_frameticks)
+			{
+				// Paused in the debugger the time still passes, it's just not emulated
+				if (m_dbgmode == false)
+				{
+					m_hud.m_instructions += m_emulate_frame(m_vm, &m_status);
+					m_frametimes.m_emulatedframes++;
+					m_ran = true;
+					m_frames++;
+				}
+
+				m_accumulator -= m_frameticks;
+			}
+
+			// Only upload the texture when the picture changed (Display or fading phosphor), but present every refresh
+			bool m_redraw = false;
+			const uint32_t *m_framebuffer = m_present_picture(m_vm, &m_runahead, m_ran, &m_redraw);
+
+			if (m_hud.m_visible)
+			{
+				m_phasestart = m_hud_account(&m_hud, M_HUD_EXEC, m_phasestart);
+				m_hud_update(&m_hud, m_renderer, m_vm);
+			}
+
+			m_upload_picture(m_texture, m_filter, m_framebuffer, m_redraw, m_frames);
 
-			SDL_UpdateTexture(m_texture, NULL, chip8.m_display, 64 * sizeof(uint32_t));
 			SDL_RenderClear(m_renderer);
 			SDL_RenderCopy(m_renderer, m_texture, NULL, NULL);
+			m_hud_draw(&m_hud, m_renderer);
 			SDL_RenderPresent(m_renderer);
+
+			if (m_hud.m_visible)
+			{
+				m_hud_account(&m_hud, M_HUD_RENDER, m_phasestart);
+				m_hud.m_frames++;
+			}
+
+			continue;
+		} else {
+			if (m_dbgmode == false)
+			{
+				// Execute a whole emulated frame worth of instructions
+				m_hud.m_instructions += m_emulate_frame(m_vm, &m_status);
+				m_frametimes.m_emulatedframes++;
+			}
 		}
 
-		// Update timers
-		if (chip8.m_delaytmr > 0)
+		bool m_redraw = false;
+		const uint32_t *m_framebuffer = m_present_picture(m_vm, &m_runahead, m_dbgmode == false, &m_redraw);
+
+		// The HUD may need a present even if the emulated display didn't change
+		bool m_hudchanged = false;
+
+		if (m_hud.m_visible)
 		{
-			chip8.m_delaytmr--;
+			m_phasestart = m_hud_account(&m_hud, M_HUD_EXEC, m_phasestart);
+			m_hudchanged = m_hud_update(&m_hud, m_renderer, m_vm);
 		}
 
-		if (chip8.m_soundtmr > 0)
+		// A fading phosphor changes the picture without the display changing
+		bool m_uploaded = m_upload_picture(m_texture, m_filter, m_framebuffer, m_redraw, (m_dbgmode == false) ? 1 : 0);
+
+		if (m_uploaded || m_hudchanged)
 		{
-			if(chip8.m_soundtmr == 1)
+			SDL_RenderClear(m_renderer);
+			SDL_RenderCopy(m_renderer, m_texture, NULL, NULL);
+			m_hud_draw(&m_hud, m_renderer);
+			SDL_RenderPresent(m_renderer);
+
+			if (m_hud.m_visible)
 			{
-				// Sound playing routine
+				m_hud_account(&m_hud, M_HUD_RENDER, m_phasestart);
+				m_hud.m_frames++;
 			}
-					
-			chip8.m_soundtmr--;
 		}
 
 		if (m_dbgmode == false)
@@ -466,48 +793,189 @@ int main(int argc, char **argv)
 				use <windows.h>'s Sleep() function instead, investigate how it works and apply
 				a good fix.
 			*/
-			usleep(1500);
+			usleep(1000000 / CHIP8_FRAMERATE);
 #endif
 #ifdef __unix__ || __APPLE__
+			// Sleep for one emulated frame (The instructions for it were executed in a single batch)
 			struct timespec time1, time2;
 			time1.tv_sec = 0;
-			time1.tv_nsec = 1500000;
+			time1.tv_nsec = 1000000000 / CHIP8_FRAMERATE;
 			nanosleep(&time1, &time2);
 #endif
 		}
+
+		// Every pass of the loop is a host frame, whether or not it had anything new to present
+		uint64_t m_now = SDL_GetPerformanceCounter();
+		m_frametimes_record(&m_frametimes, (double) (m_now - m_lastpresent) * 1000.0 / (double) m_perffreq);
+		m_lastpresent = m_now;
 	}
 }
 
-// SDL2 Icon using RAW Data Method by blog.gibson.sh
-void SDL_SetWindowIconFromRAW(SDL_Window* m_window)
+// Every keypad change goes through here, the SDL keyboard and the control socket alike
+static void m_key_event(void *m_user, uint8_t m_key, bool m_down)
 {
-  #include "include/cchip8_icn.h"
-
-  uint32_t rmask, gmask, bmask, amask;
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-  int shift = (m_cchip8_icn.bytes_per_pixel == 3) ? 8 : 0;
-  rmask = 0xff000000 >> shift;
-  gmask = 0x00ff0000 >> shift;
-  bmask = 0x0000ff00 >> shift;
-  amask = 0x000000ff >> shift;
-#else
-  rmask = 0x000000ff;
-  gmask = 0x0000ff00;
-  bmask = 0x00ff0000;
-  amask = (m_cchip8_icn.bytes_per_pixel == 3) ? 0 : 0xff000000;
-#endif
+	m_keypath *m_keypath = m_user;
 
-  SDL_Surface* m_icon = SDL_CreateRGBSurfaceFrom((void*)m_cchip8_icn.pixel_data,
-      m_cchip8_icn.width, m_cchip8_icn.height, m_cchip8_icn.bytes_per_pixel*8,
-      m_cchip8_icn.bytes_per_pixel*m_cchip8_icn.width, rmask, gmask, bmask, amask);
+	if (cchip8_key_event(m_keypath->m_vm, m_key, m_down))
+	{
+		m_runahead_input(m_keypath->m_runahead);
+	}
+}
+
+/*
+	Get the picture into m_texture, through the presentation filters when there are some (m_filter
+	is NULL otherwise). m_frames emulated frames ran since the previous call. Returns whether the
+	texture changed.
+*/
+static bool m_upload_picture(SDL_Texture *m_texture, m_filter *m_filter, const uint32_t *m_framebuffer, bool m_redraw, uint32_t m_frames)
+{
+	if (m_filter == NULL)
+	{
+		if (m_redraw)
+		{
+			SDL_UpdateTexture(m_texture, NULL, m_framebuffer, CCHIP8_WIDTH * sizeof(uint32_t));
+		}
+
+		return m_redraw;
+	}
+
+	if (m_filter_run(m_filter, m_framebuffer, m_redraw, m_frames) == false)
+	{
+		return false;
+	}
+
+	SDL_UpdateTexture(m_texture, NULL, m_filter->m_output, (int) (m_filter->m_width * sizeof(uint32_t)));
+
+	return true;
+}
+
+// Flush the capture's writer thread and say what it recorded
+static void m_finish_capture(cchip8_capture *m_capture, const char *m_filename)
+{
+	if (m_capture == NULL)
+	{
+		return;
+	}
+
+	cchip8_capture_stats m_stats;
+
+	cchip8_capture_destroy(m_capture, &m_stats);
+
+	printf("Captured %llu pictures over %llu frames to %s (%llu bytes, the machine waited on the writer %llu times)\n",
+		(unsigned long long) m_stats.m_records, (unsigned long long) m_stats.m_frames, m_filename,
+		(unsigned long long) m_stats.m_bytes, (unsigned long long) m_stats.m_stalls);
+}
+
+// Run one emulated frame through libcchip8, returns the amount of cycles that were executed
+static uint64_t m_emulate_frame(cchip8 *m_vm, enum cchip8_status *m_status)
+{
+	uint64_t m_start = cchip8_get_cycles(m_vm);
+
+	*m_status = cchip8_run_frames(m_vm, 1);
+
+	return cchip8_get_cycles(m_vm) - m_start;
+}
+
+/*
+	Picture to present and whether it changed: the real frame's, or with run-ahead the one
+	m_runahead->m_frames frames in the future (Only recomputed when a real frame ran, m_ran).
+*/
+static const uint32_t *m_present_picture(cchip8 *m_vm, m_runahead *m_runahead, bool m_ran, bool *m_redraw)
+{
+	const uint32_t *m_framebuffer = cchip8_get_framebuffer(m_vm, m_redraw);
+
+	if (m_runahead->m_frames == 0)
+	{
+		return m_framebuffer;
+	}
 
-  // Check if surface could not be made
-  if (m_icon == NULL)
-  {
-  	printf("Could not create SDL2 Surface: %s\n", SDL_GetError());
-  }
+	// The real picture never gets shown under run-ahead
+	*m_redraw = false;
 
-  SDL_SetWindowIcon(m_window, m_icon);
+	if (m_ran == true)
+	{
+		return m_runahead_frame(m_runahead, m_vm, m_redraw);
+	}
+
+	return m_runahead->m_picture;
+}
+
+// Print everything -stats collected during the session
+static void m_print_stats(const m_frametimes *m_frametimes, const m_runahead *m_runahead, const cchip8 *m_vm)
+{
+	m_frametimes_print(m_frametimes);
+	m_runahead_print(m_runahead);
+	cchip8_print_fusion_stats(m_vm, stdout);
+}
+
+// Dump the registers after a debugger step
+static void m_print_registers(const cchip8 *m_vm)
+{
+	cchip8_registers m_registers;
+	cchip8_get_registers(m_vm, &m_registers);
+
+	printf("\n\nCurrent OP: 0x%X\n", m_registers.m_opcode);
+
+	for (size_t i = 0; i < 16; i++)
+	{
+		printf("V Reg %zu: 0x%X\n",i , m_registers.m_registers[i]);
+	}
+
+	printf("Index Reg: 0x%X\n", m_registers.m_index);
+	printf("PC Reg: 0x%X\n", m_registers.m_programcounter);
+	printf("SP Reg: 0x%X\n", m_registers.m_stackp);
+	printf("Delay Timer Reg: 0x%X\n", m_registers.m_delaytimer);
+	printf("Sound Timer Reg: 0x%X\n", m_registers.m_soundtimer);
+}
+
+/*
+	Reverse debugging keys (Only useful with -journal): Backspace undoes the last instruction, F4
+	puts the breakpoint on the current PC, F5 undoes instructions until PC reaches it and F6 tells
+	which instruction last wrote the byte I points at. False if m_key isn't one of them.
+*/
+static bool m_debugger_key(cchip8 *m_vm, SDL_Keycode m_key)
+{
+	cchip8_registers m_registers;
+	uint16_t m_pc = 0;
+	uint64_t m_age = 0;
+
+	cchip8_get_registers(m_vm, &m_registers);
+
+	switch (m_key)
+	{
+		case SDLK_BACKSPACE:
+			if (cchip8_step_back(m_vm) == false)
+			{
+				printf("Nothing left to undo\n");
+			}
+			break;
+
+		case SDLK_F4:
+			cchip8_set_breakpoint(m_vm, m_registers.m_programcounter);
+			printf("Breakpoint at 0x%03X\n", m_registers.m_programcounter);
+			break;
+
+		case SDLK_F5:
+			if (cchip8_continue_back(m_vm) == CCHIP8_OK)
+			{
+				printf("Ran out of history before reaching the breakpoint\n");
+			}
+			break;
+
+		case SDLK_F6:
+			if (cchip8_last_writer(m_vm, m_registers.m_index, &m_pc, &m_age))
+			{
+				printf("RAM[0x%03X] was last written by 0x%03X, %llu instructions ago\n", m_registers.m_index & (FOURKiB - 1), m_pc, (unsigned long long) m_age);
+			} else {
+				printf("Nothing in the journal wrote RAM[0x%03X]\n", m_registers.m_index & (FOURKiB - 1));
+			}
+			break;
 
-  SDL_FreeSurface(m_icon);
-}
\ No newline at end of file
+		default:
+			return false;
+	}
+
+	printf("%llu instructions of history left\n", (unsigned long long) cchip8_journal_depth(m_vm));
+
+	return true;
+}
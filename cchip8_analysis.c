@@ -0,0 +1,495 @@
+#include "include/cchip8_analysis.h"
+
+// Evidence weights, SUPER-CHIP only opcodes are a much stronger hint than an instruction pattern
+#define M_VOTE_PATTERN 1
+#define M_VOTE_SCHIP 4
+
+// Quirk evidence gathered while walking the blocks
+typedef struct chip8_evidence
+{
+	uint32_t m_shift_vx;
+	uint32_t m_shift_vy;
+	uint32_t m_load_increment;
+	uint32_t m_jump_vx;
+	uint32_t m_jump_v0;
+
+} m_evidence;
+
+static inline uint16_t m_analysis_fetch(const uint8_t *m_memory, uint16_t m_address)
+{
+	return (m_memory[m_address] << 8) | m_memory[m_address + 1];
+}
+
+bool m_opcode_valid(uint16_t m_opcode)
+{
+	switch (m_opcode & 0xF000)
+	{
+		case 0x0000:
+			return (m_opcode == 0x00E0) || (m_opcode == 0x00EE);
+
+		case 0x8000:
+			return ((m_opcode & 0x000F) <= 0x7) || ((m_opcode & 0x000F) == 0xE);
+
+		case 0xE000:
+			return ((m_opcode & 0x00FF) == 0x9E) || ((m_opcode & 0x00FF) == 0xA1);
+
+		case 0xF000:
+			switch (m_opcode & 0x00FF)
+			{
+				case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E:
+				case 0x29: case 0x33: case 0x55: case 0x65:
+					return true;
+
+				default:
+					return false;
+			}
+
+		default:
+			return true;
+	}
+}
+
+// SUPER-CHIP extensions: 00CN, 00FB-00FF, DXY0, FX30, FX75, FX85
+static bool m_opcode_schip(uint16_t m_opcode)
+{
+	if (((m_opcode & 0xFFF0) == 0x00C0) || ((m_opcode >= 0x00FB) && (m_opcode <= 0x00FF)))
+	{
+		return true;
+	}
+
+	if ((m_opcode & 0xF00F) == 0xD000)
+	{
+		return true;
+	}
+
+	return ((m_opcode & 0xF0FF) == 0xF030) || ((m_opcode & 0xF0FF) == 0xF075) || ((m_opcode & 0xF0FF) == 0xF085);
+}
+
+static bool m_opcode_skips(uint16_t m_opcode)
+{
+	switch (m_opcode & 0xF000)
+	{
+		case 0x3000: case 0x4000: case 0x5000: case 0x9000:
+			return true;
+
+		case 0xE000:
+			return m_opcode_valid(m_opcode);
+
+		default:
+			return false;
+	}
+}
+
+static inline void m_analysis_mark(m_analysis *m_analysis, uint32_t m_address, uint32_t m_length, uint8_t m_flag)
+{
+	for (uint32_t i = m_address; (i < (m_address + m_length)) && (i < FOURKiB); i++)
+	{
+		m_analysis->m_flags[i] |= m_flag;
+	}
+}
+
+// Recursive-descent pass: mark every reachable instruction and every block leader
+static void m_analysis_discover(m_analysis *m_analysis, const uint8_t *m_memory)
+{
+	uint16_t m_worklist[FOURKiB];
+	size_t m_pending = 0;
+
+	m_worklist[m_pending++] = CHIP8_INITIAL_PC;
+	m_analysis->m_flags[CHIP8_INITIAL_PC] |= M_ADDR_LEADER;
+
+	while (m_pending > 0)
+	{
+		uint16_t m_pc = m_worklist[--m_pending];
+
+		// Walk straight-line code until it branches away or joins code we've already seen
+		while ((m_pc < (FOURKiB - 1)) && ((m_analysis->m_flags[m_pc] & M_ADDR_CODE) == 0))
+		{
+			uint16_t m_opcode = m_analysis_fetch(m_memory, m_pc);
+			uint16_t m_nnn = M_GET_NNN_FROM_OPCODE(m_opcode);
+
+			m_analysis->m_flags[m_pc] |= M_ADDR_CODE;
+			m_analysis->m_flags[m_pc + 1] |= M_ADDR_OPERAND;
+			m_analysis->m_instructions++;
+
+			if (m_opcode_schip(m_opcode))
+			{
+				m_analysis->m_schipopcodes++;
+			}
+
+			if (m_opcode_valid(m_opcode) == false)
+			{
+				m_analysis->m_flags[m_pc] |= M_ADDR_INVALID;
+				break;
+			}
+
+			uint16_t m_targets[2];
+			size_t m_targetcount = 0;
+			bool m_continues = true;
+
+			if ((m_opcode & 0xF000) == 0x1000)
+			{
+				m_targets[m_targetcount++] = m_nnn;
+				m_continues = false;
+			} else if ((m_opcode & 0xF000) == 0x2000)
+			{
+				m_targets[m_targetcount++] = m_nnn;
+				m_targets[m_targetcount++] = m_pc + 2;
+				m_continues = false;
+			} else if ((m_opcode == 0x00EE) || ((m_opcode & 0xF000) == 0xB000))
+			{
+				m_continues = false;
+			} else if (m_opcode_skips(m_opcode))
+			{
+				m_targets[m_targetcount++] = m_pc + 2;
+				m_targets[m_targetcount++] = m_pc + 4;
+				m_continues = false;
+			}
+
+			for (size_t i = 0; i < m_targetcount; i++)
+			{
+				if (m_targets[i] >= (FOURKiB - 1))
+				{
+					continue;
+				}
+
+				// M_ADDR_LEADER guards the worklist, every address gets pushed once at most
+				if ((m_analysis->m_flags[m_targets[i]] & M_ADDR_LEADER) == 0)
+				{
+					m_analysis->m_flags[m_targets[i]] |= M_ADDR_LEADER;
+
+					if (m_pending < FOURKiB)
+					{
+						m_worklist[m_pending++] = m_targets[i];
+					}
+				}
+			}
+
+			if (m_continues == false)
+			{
+				break;
+			}
+
+			m_pc += 2;
+		}
+	}
+}
+
+static void m_analysis_site(uint16_t *m_sites, size_t *m_count, uint16_t m_address)
+{
+	if (*m_count < M_ANALYSIS_MAX_SITES)
+	{
+		m_sites[*m_count] = m_address;
+	}
+
+	(*m_count)++;
+}
+
+/*
+	Split the reachable code into basic blocks and walk each one with a tiny abstract state: the
+	value of I (Known after ANNN) and which registers were written since the block started. That's
+	enough to find sprite/table data, stores into code and most of the quirk-dependent idioms.
+*/
+static void m_analysis_blocks(m_analysis *m_analysis, const uint8_t *m_memory, m_evidence *m_evidence)
+{
+	// Stores whose target is known, checked against the code map once every block was seen
+	uint16_t m_stores[FOURKiB][2];
+	size_t m_storecount = 0;
+	uint16_t m_storesites[FOURKiB];
+
+	for (uint32_t m_start = 0; m_start < (FOURKiB - 1); m_start++)
+	{
+		if ((m_analysis->m_flags[m_start] & (M_ADDR_CODE | M_ADDR_LEADER)) != (M_ADDR_CODE | M_ADDR_LEADER))
+		{
+			continue;
+		}
+
+		// At most one block per start address, M_ANALYSIS_MAX_BLOCKS covers the whole loop range
+		m_block *m_current = &m_analysis->m_blocks[m_analysis->m_blockcount];
+
+		m_current->m_start = (uint16_t) m_start;
+		m_current->m_next[0] = CHIP8_NO_BREAKPOINT;
+		m_current->m_next[1] = CHIP8_NO_BREAKPOINT;
+		m_current->m_exit = M_BLOCK_FALLTHROUGH;
+
+		bool m_iknown = false;
+		uint16_t m_ivalue = 0;
+
+		// Registers written inside the block, and whether FX55/FX65 left I pointing past the data
+		uint16_t m_written = 0;
+		bool m_iadvanced = false;
+
+		uint32_t m_pc = m_start;
+
+		while (true)
+		{
+			uint16_t m_opcode = m_analysis_fetch(m_memory, (uint16_t) m_pc);
+			uint8_t m_x = M_OPC_0X00(m_opcode);
+			uint8_t m_y = M_OPC_00X0(m_opcode);
+			uint16_t m_nnn = M_GET_NNN_FROM_OPCODE(m_opcode);
+			bool m_readsi = false;
+
+			if (m_analysis->m_flags[m_pc] & M_ADDR_INVALID)
+			{
+				m_current->m_exit = M_BLOCK_HALT;
+				m_pc += 2;
+				break;
+			}
+
+			switch (m_opcode & 0xF000)
+			{
+				case 0x1000:
+					m_current->m_exit = (m_nnn == m_pc) ? M_BLOCK_HALT : M_BLOCK_JUMP;
+					m_current->m_next[0] = m_nnn;
+					break;
+
+				case 0x2000:
+					m_current->m_exit = M_BLOCK_CALL;
+					m_current->m_next[0] = m_nnn;
+					m_current->m_next[1] = (uint16_t) (m_pc + 2);
+					break;
+
+				case 0x6000: case 0x7000: case 0xC000:
+					m_written |= (uint16_t) (1 << m_x);
+					break;
+
+				case 0x8000:
+					// 8XY6/8XYE: the shifted operand tells VX and VY apart when only one of them was just set up
+					if ((((m_opcode & 0x000F) == 0x6) || ((m_opcode & 0x000F) == 0xE)) && (m_x != m_y))
+					{
+						bool m_vxset = (m_written >> m_x) & 1;
+						bool m_vyset = (m_written >> m_y) & 1;
+
+						if (m_vyset && (m_vxset == false))
+						{
+							m_evidence->m_shift_vy++;
+						} else if (m_vxset && (m_vyset == false))
+						{
+							m_evidence->m_shift_vx++;
+						}
+					}
+
+					m_written |= (uint16_t) ((1 << m_x) | (1 << 0xF));
+					break;
+
+				case 0xA000:
+					m_iknown = true;
+					m_ivalue = m_nnn;
+					m_iadvanced = false;
+					break;
+
+				case 0xB000:
+					m_current->m_exit = M_BLOCK_INDIRECT;
+					m_analysis_site(m_analysis->m_indirect, &m_analysis->m_indirectcount, (uint16_t) m_pc);
+
+					// BXNN adds VX on CHIP-48/SUPER-CHIP, look at which register the block prepared
+					if ((M_OPC_0X00(m_opcode) != 0) && ((m_written >> M_OPC_0X00(m_opcode)) & 1) && (((m_written >> 0) & 1) == 0))
+					{
+						m_evidence->m_jump_vx++;
+					} else if ((m_written >> 0) & 1)
+					{
+						m_evidence->m_jump_v0++;
+					}
+					break;
+
+				case 0xD000:
+					m_readsi = true;
+
+					if (m_iknown)
+					{
+						// DXY0 draws a 16x16 SUPER-CHIP sprite (32 bytes)
+						uint32_t m_length = (M_OPC_000X(m_opcode) == 0) ? 32 : M_OPC_000X(m_opcode);
+						m_analysis_mark(m_analysis, m_ivalue, m_length, M_ADDR_DATA);
+					}
+
+					m_written |= (uint16_t) (1 << 0xF);
+					break;
+
+				case 0xF000:
+					switch (m_opcode & 0x00FF)
+					{
+						case 0x07: case 0x0A:
+							m_written |= (uint16_t) (1 << m_x);
+							break;
+
+						case 0x1E:
+							m_iknown = false;
+							m_iadvanced = false;
+							break;
+
+						case 0x29:
+							// Font glyph, never part of the ROM
+							m_iknown = false;
+							m_iadvanced = false;
+							break;
+
+						case 0x33: case 0x55:
+							m_readsi = true;
+
+							if (m_iknown && (m_storecount < FOURKiB))
+							{
+								m_stores[m_storecount][0] = m_ivalue;
+								m_stores[m_storecount][1] = ((m_opcode & 0x00FF) == 0x33) ? 3 : (m_x + 1);
+								m_storesites[m_storecount] = (uint16_t) m_pc;
+								m_storecount++;
+
+								m_analysis_mark(m_analysis, m_ivalue, m_stores[m_storecount - 1][1], M_ADDR_WRITTEN);
+							}
+							break;
+
+						case 0x65:
+							m_readsi = true;
+
+							if (m_iknown)
+							{
+								m_analysis_mark(m_analysis, m_ivalue, m_x + 1, M_ADDR_DATA);
+							}
+
+							m_written |= (uint16_t) ((2 << m_x) - 1);
+							break;
+
+						default:
+							break;
+					}
+					break;
+
+				default:
+					break;
+			}
+
+			/*
+				Reading through I right after FX55/FX65 without reloading it only makes sense if the
+				load/store advanced I (COSMAC VIP and modern interpreters)
+			*/
+			if (m_readsi && m_iadvanced)
+			{
+				m_evidence->m_load_increment++;
+			}
+
+			if (((m_opcode & 0xF0FF) == 0xF055) || ((m_opcode & 0xF0FF) == 0xF065))
+			{
+				m_iadvanced = true;
+			}
+
+			if ((m_opcode == 0x00EE) && (m_current->m_exit == M_BLOCK_FALLTHROUGH))
+			{
+				m_current->m_exit = M_BLOCK_RETURN;
+			}
+
+			if ((m_current->m_exit == M_BLOCK_FALLTHROUGH) && m_opcode_skips(m_opcode))
+			{
+				m_current->m_exit = M_BLOCK_SKIP;
+				m_current->m_next[0] = (uint16_t) (m_pc + 2);
+				m_current->m_next[1] = (uint16_t) (m_pc + 4);
+			}
+
+			m_pc += 2;
+
+			if (m_current->m_exit != M_BLOCK_FALLTHROUGH)
+			{
+				break;
+			}
+
+			// Fall into the next block (Or off the end of memory)
+			if ((m_pc >= (FOURKiB - 1)) || ((m_analysis->m_flags[m_pc] & M_ADDR_CODE) == 0))
+			{
+				m_current->m_exit = M_BLOCK_HALT;
+				break;
+			}
+
+			if (m_analysis->m_flags[m_pc] & M_ADDR_LEADER)
+			{
+				m_current->m_next[0] = (uint16_t) m_pc;
+				break;
+			}
+		}
+
+		m_current->m_end = (uint16_t) m_pc;
+		m_analysis->m_blockcount++;
+	}
+
+	// A store is self-modifying if any byte it writes was reached as code
+	for (size_t i = 0; i < m_storecount; i++)
+	{
+		for (uint32_t m_address = m_stores[i][0]; (m_address < (uint32_t) (m_stores[i][0] + m_stores[i][1])) && (m_address < FOURKiB); m_address++)
+		{
+			if (m_analysis->m_flags[m_address] & (M_ADDR_CODE | M_ADDR_OPERAND))
+			{
+				m_analysis_site(m_analysis->m_selfmodifying, &m_analysis->m_selfmodifyingcount, m_storesites[i]);
+				break;
+			}
+		}
+	}
+}
+
+void m_analyse(m_analysis *m_analysis, const uint8_t *m_memory)
+{
+	memset(m_analysis, 0, sizeof(*m_analysis));
+
+	m_evidence m_evidence;
+	memset(&m_evidence, 0, sizeof(m_evidence));
+
+	m_analysis_discover(m_analysis, m_memory);
+	m_analysis_blocks(m_analysis, m_memory, &m_evidence);
+
+	for (size_t i = 0; i < FOURKiB; i++)
+	{
+		m_analysis->m_codebytes += (m_analysis->m_flags[i] & (M_ADDR_CODE | M_ADDR_OPERAND)) != 0;
+		m_analysis->m_databytes += (m_analysis->m_flags[i] & M_ADDR_DATA) != 0;
+	}
+
+	// Score every profile by the evidence its quirks agree with, ties go to the earlier (More common) profile
+	m_analysis->m_profile = M_PROFILE_CCHIP8;
+
+	for (int m_profile = 0; m_profile < M_PROFILE_COUNT; m_profile++)
+	{
+		const m_quirks *m_quirks = m_get_quirks((enum m_profile) m_profile);
+		uint32_t m_votes = 0;
+
+		m_votes += M_VOTE_PATTERN * (m_quirks->m_shift_vx ? m_evidence.m_shift_vx : m_evidence.m_shift_vy);
+		m_votes += M_VOTE_PATTERN * (m_quirks->m_jump_vx ? m_evidence.m_jump_vx : m_evidence.m_jump_v0);
+		m_votes += M_VOTE_PATTERN * ((m_quirks->m_loadstore != 0) ? m_evidence.m_load_increment : 0);
+
+		if (m_profile == M_PROFILE_SCHIP)
+		{
+			m_votes += M_VOTE_SCHIP * (uint32_t) m_analysis->m_schipopcodes;
+		}
+
+		m_analysis->m_votes[m_profile] = m_votes;
+
+		if (m_votes > m_analysis->m_votes[m_analysis->m_profile])
+		{
+			m_analysis->m_profile = (enum m_profile) m_profile;
+		}
+	}
+}
+
+void m_analysis_print(const m_analysis *m_analysis, FILE *m_out)
+{
+	fprintf(m_out, "%zu instructions in %zu blocks (%zu code bytes, %zu data bytes)\n", m_analysis->m_instructions,
+		m_analysis->m_blockcount, m_analysis->m_codebytes, m_analysis->m_databytes);
+
+	fprintf(m_out, "%zu indirect jumps (BNNN)", m_analysis->m_indirectcount);
+
+	for (size_t i = 0; (i < m_analysis->m_indirectcount) && (i < M_ANALYSIS_MAX_SITES); i++)
+	{
+		fprintf(m_out, " 0x%03X", m_analysis->m_indirect[i]);
+	}
+
+	fprintf(m_out, "\n%zu self-modifying stores (FX33/FX55)", m_analysis->m_selfmodifyingcount);
+
+	for (size_t i = 0; (i < m_analysis->m_selfmodifyingcount) && (i < M_ANALYSIS_MAX_SITES); i++)
+	{
+		fprintf(m_out, " 0x%03X", m_analysis->m_selfmodifying[i]);
+	}
+
+	fprintf(m_out, "\n%zu SUPER-CHIP only instructions\n", m_analysis->m_schipopcodes);
+
+	fprintf(m_out, "Quirk profile guess: %s (Votes:", m_get_quirks(m_analysis->m_profile)->m_name);
+
+	for (int i = 0; i < M_PROFILE_COUNT; i++)
+	{
+		fprintf(m_out, " %s=%u", m_get_quirks((enum m_profile) i)->m_name, m_analysis->m_votes[i]);
+	}
+
+	fprintf(m_out, ")\n");
+}
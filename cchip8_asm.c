@@ -0,0 +1,838 @@
+#include "include/cchip8_asm.h"
+#include "include/cchip8_analysis.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+
+/*
+	Opcode forms:
+	An opcode belongs to a form if (m_opcode & m_mask) == m_pattern. Operand letters:
+		x  VX (Bits 8-11)      y  VY (Bits 4-7)
+		b  NN (Bits 0-7)       n  N (Bits 0-3)
+		a  NNN address (Bits 0-11, label or number)
+	Every other operand (I, V0, DT, ST, K, F, B, [I]) has to be spelled as is.
+*/
+typedef struct chip8_asm_form
+{
+	uint16_t m_mask;
+	uint16_t m_pattern;
+	const char *m_mnemonic;
+	const char *m_operands;
+	const char *m_name;
+
+} m_asm_form;
+
+static const m_asm_form m_asm_forms[] = {
+	{ 0xFFFF, 0x00E0, "CLS", "", "CLS" },
+	{ 0xFFFF, 0x00EE, "RET", "", "RET" },
+	{ 0xF000, 0x1000, "JP", "a", "JP addr" },
+	{ 0xF000, 0x2000, "CALL", "a", "CALL addr" },
+	{ 0xF000, 0x3000, "SE", "x,b", "SE Vx, byte" },
+	{ 0xF000, 0x4000, "SNE", "x,b", "SNE Vx, byte" },
+	{ 0xF00F, 0x5000, "SE", "x,y", "SE Vx, Vy" },
+	{ 0xF000, 0x6000, "LD", "x,b", "LD Vx, byte" },
+	{ 0xF000, 0x7000, "ADD", "x,b", "ADD Vx, byte" },
+	{ 0xF00F, 0x8000, "LD", "x,y", "LD Vx, Vy" },
+	{ 0xF00F, 0x8001, "OR", "x,y", "OR Vx, Vy" },
+	{ 0xF00F, 0x8002, "AND", "x,y", "AND Vx, Vy" },
+	{ 0xF00F, 0x8003, "XOR", "x,y", "XOR Vx, Vy" },
+	{ 0xF00F, 0x8004, "ADD", "x,y", "ADD Vx, Vy" },
+	{ 0xF00F, 0x8005, "SUB", "x,y", "SUB Vx, Vy" },
+	{ 0xF00F, 0x8006, "SHR", "x,y", "SHR Vx, Vy" },
+	{ 0xF00F, 0x8007, "SUBN", "x,y", "SUBN Vx, Vy" },
+	{ 0xF00F, 0x800E, "SHL", "x,y", "SHL Vx, Vy" },
+	{ 0xF00F, 0x9000, "SNE", "x,y", "SNE Vx, Vy" },
+	{ 0xF000, 0xA000, "LD", "I,a", "LD I, addr" },
+	{ 0xF000, 0xB000, "JP", "V0,a", "JP V0, addr" },
+	{ 0xF000, 0xC000, "RND", "x,b", "RND Vx, byte" },
+	{ 0xF000, 0xD000, "DRW", "x,y,n", "DRW Vx, Vy, nibble" },
+	{ 0xF0FF, 0xE09E, "SKP", "x", "SKP Vx" },
+	{ 0xF0FF, 0xE0A1, "SKNP", "x", "SKNP Vx" },
+	{ 0xF0FF, 0xF007, "LD", "x,DT", "LD Vx, DT" },
+	{ 0xF0FF, 0xF00A, "LD", "x,K", "LD Vx, K" },
+	{ 0xF0FF, 0xF015, "LD", "DT,x", "LD DT, Vx" },
+	{ 0xF0FF, 0xF018, "LD", "ST,x", "LD ST, Vx" },
+	{ 0xF0FF, 0xF01E, "ADD", "I,x", "ADD I, Vx" },
+	{ 0xF0FF, 0xF029, "LD", "F,x", "LD F, Vx" },
+	{ 0xF0FF, 0xF033, "LD", "B,x", "LD B, Vx" },
+	{ 0xF0FF, 0xF055, "LD", "[I],x", "LD [I], Vx" },
+	{ 0xF0FF, 0xF065, "LD", "x,[I]", "LD Vx, [I]" }
+};
+
+static_assert(sizeof(m_asm_forms) / sizeof(m_asm_forms[0]) == M_ASM_FORMS, "M_ASM_FORMS is out of sync with the form table");
+
+// Longest operand list a form has (DRW Vx, Vy, n)
+#define M_ASM_MAX_OPERANDS 3
+
+// Longest label name the assembler accepts
+#define M_ASM_MAX_LABEL 32
+
+// Names the assembler won't take as labels, operands would become ambiguous
+static const char *m_asm_reserved[] = { "I", "DT", "ST", "K", "F", "B" };
+
+const char *m_asm_form_name(size_t m_form)
+{
+	return (m_form < M_ASM_FORMS) ? m_asm_forms[m_form].m_name : "db";
+}
+
+// Form index of an opcode, M_ASM_FORMS if it has none (Or the interpreter doesn't implement it)
+static size_t m_asm_find_form(uint16_t m_opcode)
+{
+	if (m_opcode_valid(m_opcode) == false)
+	{
+		return M_ASM_FORMS;
+	}
+
+	for (size_t i = 0; i < M_ASM_FORMS; i++)
+	{
+		if ((m_opcode & m_asm_forms[i].m_mask) == m_asm_forms[i].m_pattern)
+		{
+			return i;
+		}
+	}
+
+	return M_ASM_FORMS;
+}
+
+void m_text_free(m_text *m_text)
+{
+	free(m_text->m_data);
+
+	m_text->m_data = NULL;
+	m_text->m_length = 0;
+	m_text->m_capacity = 0;
+}
+
+static bool m_text_printf(m_text *m_text, const char *m_format, ...)
+{
+	for (;;)
+	{
+		size_t m_free = m_text->m_capacity - m_text->m_length;
+
+		va_list m_args;
+		va_start(m_args, m_format);
+		int m_written = vsnprintf((m_text->m_data != NULL) ? &m_text->m_data[m_text->m_length] : NULL, m_free, m_format, m_args);
+		va_end(m_args);
+
+		if (m_written < 0)
+		{
+			return false;
+		}
+
+		if ((size_t) m_written < m_free)
+		{
+			m_text->m_length += (size_t) m_written;
+			return true;
+		}
+
+		// Didn't fit, grow (At least doubling) and format again
+		size_t m_capacity = (m_text->m_capacity < 4096) ? 4096 : (m_text->m_capacity * 2);
+
+		while (m_capacity <= (m_text->m_length + (size_t) m_written))
+		{
+			m_capacity *= 2;
+		}
+
+		char *m_data = realloc(m_text->m_data, m_capacity);
+
+		if (m_data == NULL)
+		{
+			return false;
+		}
+
+		m_text->m_data = m_data;
+		m_text->m_capacity = m_capacity;
+	}
+}
+
+// Print one operand of an opcode, addresses that start a line get their label
+static bool m_asm_print_operand(m_text *m_out, char m_kind, const char *m_literal, size_t m_length, uint16_t m_opcode,
+	const uint8_t *m_labels)
+{
+	uint16_t m_address = M_GET_NNN_FROM_OPCODE(m_opcode);
+
+	switch (m_kind)
+	{
+		case 'x':
+			return m_text_printf(m_out, "V%X", (m_opcode >> 8) & 0xF);
+
+		case 'y':
+			return m_text_printf(m_out, "V%X", (m_opcode >> 4) & 0xF);
+
+		case 'b':
+			return m_text_printf(m_out, "0x%02X", M_GET_NN_FROM_OPCODE(m_opcode));
+
+		case 'n':
+			return m_text_printf(m_out, "%u", m_opcode & 0xF);
+
+		case 'a':
+			return m_labels[m_address] ? m_text_printf(m_out, "L%03X", m_address) : m_text_printf(m_out, "0x%03X", m_address);
+
+		default:
+			return m_text_printf(m_out, "%.*s", (int) m_length, m_literal);
+	}
+}
+
+static bool m_asm_print_instruction(m_text *m_out, uint16_t m_opcode, size_t m_form, const uint8_t *m_labels)
+{
+	const m_asm_form *m_entry = &m_asm_forms[m_form];
+	const char *m_operand = m_entry->m_operands;
+
+	bool m_ok = m_text_printf(m_out, "\t%s", m_entry->m_mnemonic);
+
+	for (size_t i = 0; (*m_operand != '\0') && (m_ok == true); i++)
+	{
+		size_t m_length = strcspn(m_operand, ",");
+		char m_kind = (m_length == 1) ? m_operand[0] : '\0';
+
+		// A lone letter is a field, except for the single letter registers (I, K, F, B)
+		if ((m_kind != '\0') && (strchr("xybna", m_kind) == NULL))
+		{
+			m_kind = '\0';
+		}
+
+		m_ok = m_text_printf(m_out, (i == 0) ? " " : ", ") &&
+			m_asm_print_operand(m_out, m_kind, m_operand, m_length, m_opcode, m_labels);
+
+		m_operand += m_length + (m_operand[m_length] == ',');
+	}
+
+	return m_ok && m_text_printf(m_out, "\n");
+}
+
+bool m_disassemble(const uint8_t *m_rom, size_t m_size, bool m_linear, m_text *m_out, m_asm_stats *m_stats)
+{
+	if (m_size > CCHIP8_MAX_ROM_SIZE)
+	{
+		return false;
+	}
+
+	m_analysis *m_analysis = malloc(sizeof(*m_analysis));
+
+	if (m_analysis == NULL)
+	{
+		return false;
+	}
+
+	// The analysis wants the memory the ROM will run in (Sprites can come from the font)
+	uint8_t m_memory[FOURKiB] = { 0 };
+	memcpy(m_memory, m_font, CHIP8_FONT_SIZE);
+	memcpy(&m_memory[CHIP8_INITIAL_PC], m_rom, m_size);
+
+	m_analyse(m_analysis, m_memory);
+
+	const size_t m_end = CHIP8_INITIAL_PC + m_size;
+
+	// Pass 1: which addresses start an instruction line (The rest is printed as data)
+	uint8_t m_forms[FOURKiB];
+	uint8_t m_targets[FOURKiB] = { 0 };
+	uint8_t m_labels[FOURKiB] = { 0 };
+
+	memset(m_forms, M_ASM_FORMS, sizeof(m_forms));
+
+	for (size_t m_address = CHIP8_INITIAL_PC; m_address < m_end;)
+	{
+		uint16_t m_opcode = (m_address + 1 < m_end) ? (uint16_t) ((m_memory[m_address] << 8) | m_memory[m_address + 1]) : 0;
+		bool m_code = m_linear ? (((m_address - CHIP8_INITIAL_PC) % 2) == 0) : ((m_analysis->m_flags[m_address] & M_ADDR_CODE) != 0);
+		size_t m_form = ((m_code == true) && (m_address + 1 < m_end)) ? m_asm_find_form(m_opcode) : M_ASM_FORMS;
+
+		if (m_form == M_ASM_FORMS)
+		{
+			m_address++;
+			continue;
+		}
+
+		m_forms[m_address] = (uint8_t) m_form;
+
+		// Every operand that names an address might deserve a label
+		if (strchr(m_asm_forms[m_form].m_operands, 'a') != NULL)
+		{
+			m_targets[M_GET_NNN_FROM_OPCODE(m_opcode)] = 1;
+		}
+
+		m_address += 2;
+	}
+
+	// Only targets that start a line can be labelled, the rest stay numbers
+	for (size_t m_address = CHIP8_INITIAL_PC; m_address < m_end;)
+	{
+		m_labels[m_address] = m_targets[m_address];
+		m_address += (m_forms[m_address] != M_ASM_FORMS) ? 2 : 1;
+	}
+
+	m_asm_stats m_local;
+	memset(&m_local, 0, sizeof(m_local));
+	m_local.m_profile = m_analysis->m_profile;
+
+	bool m_ok = m_text_printf(m_out, "; %zu bytes, profile guess: %s\n", m_size, m_get_quirks(m_analysis->m_profile)->m_name);
+
+	free(m_analysis);
+
+	// Pass 2: print, data bytes are grouped 8 per line but never run across a label
+	for (size_t m_address = CHIP8_INITIAL_PC; (m_address < m_end) && (m_ok == true);)
+	{
+		if (m_labels[m_address])
+		{
+			m_ok = m_text_printf(m_out, "L%03zX:\n", m_address);
+		}
+
+		if (m_forms[m_address] != M_ASM_FORMS)
+		{
+			uint16_t m_opcode = (uint16_t) ((m_memory[m_address] << 8) | m_memory[m_address + 1]);
+
+			m_ok = m_ok && m_asm_print_instruction(m_out, m_opcode, m_forms[m_address], m_labels);
+			m_local.m_opcodes[m_forms[m_address]]++;
+			m_local.m_codebytes += 2;
+			m_address += 2;
+			continue;
+		}
+
+		m_ok = m_ok && m_text_printf(m_out, "\tdb 0x%02X", m_memory[m_address]);
+		m_address++;
+
+		for (size_t i = 1; (i < 8) && (m_address < m_end) && (m_forms[m_address] == M_ASM_FORMS) && !m_labels[m_address]; i++)
+		{
+			m_ok = m_ok && m_text_printf(m_out, ", 0x%02X", m_memory[m_address]);
+			m_address++;
+		}
+
+		m_ok = m_ok && m_text_printf(m_out, "\n");
+	}
+
+	m_local.m_databytes = m_size - m_local.m_codebytes;
+	m_local.m_opcodes[M_ASM_DATA] = m_local.m_databytes;
+
+	if (m_stats != NULL)
+	{
+		*m_stats = m_local;
+	}
+
+	return m_ok;
+}
+
+// Assembler state shared by both passes
+typedef struct chip8_asm
+{
+	char (*m_names)[M_ASM_MAX_LABEL + 1];
+	uint16_t *m_addresses;
+	size_t m_labelcount;
+	size_t m_labelcapacity;
+
+	uint8_t *m_output;
+	size_t m_capacity;
+	size_t m_size;
+
+	m_asm_error *m_error;
+	size_t m_line;
+
+} m_asm;
+
+static bool m_asm_fail(m_asm *m_asm, const char *m_format, ...)
+{
+	m_asm->m_error->m_line = m_asm->m_line;
+
+	va_list m_args;
+	va_start(m_args, m_format);
+	vsnprintf(m_asm->m_error->m_message, sizeof(m_asm->m_error->m_message), m_format, m_args);
+	va_end(m_args);
+
+	return false;
+}
+
+static bool m_asm_identifier(const char *m_token, size_t m_length)
+{
+	if ((m_length == 0) || ((isalpha((unsigned char) m_token[0]) == 0) && (m_token[0] != '_')))
+	{
+		return false;
+	}
+
+	for (size_t i = 1; i < m_length; i++)
+	{
+		if ((isalnum((unsigned char) m_token[i]) == 0) && (m_token[i] != '_'))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Case-insensitive comparison of a token with the first m_wordlength characters of a word
+static bool m_asm_matches(const char *m_token, size_t m_length, const char *m_word, size_t m_wordlength)
+{
+	if (m_length != m_wordlength)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < m_length; i++)
+	{
+		if (toupper((unsigned char) m_token[i]) != toupper((unsigned char) m_word[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool m_asm_equals(const char *m_token, size_t m_length, const char *m_word)
+{
+	return m_asm_matches(m_token, m_length, m_word, strlen(m_word));
+}
+
+// V0-VF, -1 if the token isn't a register
+static int m_asm_register(const char *m_token, size_t m_length)
+{
+	if ((m_length != 2) || (toupper((unsigned char) m_token[0]) != 'V') || (isxdigit((unsigned char) m_token[1]) == 0))
+	{
+		return -1;
+	}
+
+	return (int) strtol(&m_token[1], NULL, 16) & 0xF;
+}
+
+static bool m_asm_reserved_word(const char *m_token, size_t m_length)
+{
+	if (m_asm_register(m_token, m_length) >= 0)
+	{
+		return true;
+	}
+
+	for (size_t i = 0; i < sizeof(m_asm_reserved) / sizeof(m_asm_reserved[0]); i++)
+	{
+		if (m_asm_equals(m_token, m_length, m_asm_reserved[i]))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static const uint16_t *m_asm_find_label(const m_asm *m_asm, const char *m_token, size_t m_length)
+{
+	for (size_t i = 0; i < m_asm->m_labelcount; i++)
+	{
+		if ((strlen(m_asm->m_names[i]) == m_length) && (strncmp(m_asm->m_names[i], m_token, m_length) == 0))
+		{
+			return &m_asm->m_addresses[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool m_asm_define_label(m_asm *m_asm, const char *m_token, size_t m_length, uint16_t m_address)
+{
+	if ((m_length > M_ASM_MAX_LABEL) || m_asm_reserved_word(m_token, m_length))
+	{
+		return m_asm_fail(m_asm, "Invalid label name: %.*s", (int) m_length, m_token);
+	}
+
+	if (m_asm_find_label(m_asm, m_token, m_length) != NULL)
+	{
+		return m_asm_fail(m_asm, "Label defined twice: %.*s", (int) m_length, m_token);
+	}
+
+	if (m_asm->m_labelcount == m_asm->m_labelcapacity)
+	{
+		size_t m_capacity = (m_asm->m_labelcapacity == 0) ? 256 : (m_asm->m_labelcapacity * 2);
+		void *m_names = realloc(m_asm->m_names, m_capacity * sizeof(m_asm->m_names[0]));
+
+		if (m_names != NULL)
+		{
+			m_asm->m_names = m_names;
+		}
+
+		void *m_addresses = realloc(m_asm->m_addresses, m_capacity * sizeof(m_asm->m_addresses[0]));
+
+		if (m_addresses != NULL)
+		{
+			m_asm->m_addresses = m_addresses;
+		}
+
+		if ((m_names == NULL) || (m_addresses == NULL))
+		{
+			return m_asm_fail(m_asm, "Out of memory");
+		}
+
+		m_asm->m_labelcapacity = m_capacity;
+	}
+
+	memcpy(m_asm->m_names[m_asm->m_labelcount], m_token, m_length);
+	m_asm->m_names[m_asm->m_labelcount][m_length] = '\0';
+	m_asm->m_addresses[m_asm->m_labelcount] = m_address;
+	m_asm->m_labelcount++;
+
+	return true;
+}
+
+// Number (0x hex, 0b binary or decimal) or label, at most m_limit
+static bool m_asm_value(m_asm *m_asm, const char *m_token, size_t m_length, uint32_t m_limit, uint32_t *m_value)
+{
+	char m_number[M_ASM_MAX_LABEL + 1];
+
+	if ((m_length == 0) || (m_length > M_ASM_MAX_LABEL))
+	{
+		return m_asm_fail(m_asm, "Invalid operand: %.*s", (int) m_length, m_token);
+	}
+
+	if (isdigit((unsigned char) m_token[0]))
+	{
+		memcpy(m_number, m_token, m_length);
+		m_number[m_length] = '\0';
+
+		bool m_binary = (m_length > 2) && (m_number[0] == '0') && (tolower((unsigned char) m_number[1]) == 'b');
+		char *m_stop = NULL;
+		unsigned long m_parsed = m_binary ? strtoul(&m_number[2], &m_stop, 2) : strtoul(m_number, &m_stop, 0);
+
+		if (*m_stop != '\0')
+		{
+			return m_asm_fail(m_asm, "Invalid number: %s", m_number);
+		}
+
+		if (m_parsed > m_limit)
+		{
+			return m_asm_fail(m_asm, "Value out of range: %s (At most 0x%X)", m_number, m_limit);
+		}
+
+		*m_value = (uint32_t) m_parsed;
+		return true;
+	}
+
+	if ((m_asm_identifier(m_token, m_length) == false) || m_asm_reserved_word(m_token, m_length))
+	{
+		return m_asm_fail(m_asm, "Invalid operand: %.*s", (int) m_length, m_token);
+	}
+
+	const uint16_t *m_address = m_asm_find_label(m_asm, m_token, m_length);
+
+	if (m_address == NULL)
+	{
+		return m_asm_fail(m_asm, "Unknown label: %.*s", (int) m_length, m_token);
+	}
+
+	if (*m_address > m_limit)
+	{
+		return m_asm_fail(m_asm, "Label out of range: %.*s", (int) m_length, m_token);
+	}
+
+	*m_value = *m_address;
+	return true;
+}
+
+static bool m_asm_emit(m_asm *m_asm, uint8_t m_byte)
+{
+	if (m_asm->m_size >= m_asm->m_capacity)
+	{
+		return m_asm_fail(m_asm, "Program doesn't fit (At most %zu bytes)", m_asm->m_capacity);
+	}
+
+	if (m_asm->m_output != NULL)
+	{
+		m_asm->m_output[m_asm->m_size] = m_byte;
+	}
+
+	m_asm->m_size++;
+
+	return true;
+}
+
+// Trimmed view of the text between m_start and m_end
+static void m_asm_trim(const char **m_start, const char **m_end)
+{
+	while ((*m_start < *m_end) && isspace((unsigned char) **m_start))
+	{
+		(*m_start)++;
+	}
+
+	while ((*m_end > *m_start) && isspace((unsigned char) (*m_end)[-1]))
+	{
+		(*m_end)--;
+	}
+}
+
+// Try to encode the operands with one form, false (Without an error) if they don't fit it
+static bool m_asm_match(const m_asm_form *m_form, const char **m_operands, const size_t *m_lengths, size_t m_count,
+	m_asm *m_asm, uint16_t *m_opcode, bool *m_matched)
+{
+	const char *m_spec = m_form->m_operands;
+	size_t m_expected = (*m_spec == '\0') ? 0 : 1;
+
+	for (const char *c = m_spec; *c != '\0'; c++)
+	{
+		m_expected += (*c == ',');
+	}
+
+	*m_matched = false;
+
+	if (m_expected != m_count)
+	{
+		return true;
+	}
+
+	uint16_t m_result = m_form->m_pattern;
+
+	// First check the shape (Registers and literals), values get checked once a form matched
+	for (size_t i = 0; i < m_count; i++)
+	{
+		size_t m_length = strcspn(m_spec, ",");
+		char m_kind = (m_length == 1) ? m_spec[0] : '\0';
+
+		if ((m_kind == 'x') || (m_kind == 'y'))
+		{
+			int m_register = m_asm_register(m_operands[i], m_lengths[i]);
+
+			if (m_register < 0)
+			{
+				return true;
+			}
+
+			m_result |= (uint16_t) (m_register << ((m_kind == 'x') ? 8 : 4));
+		} else if ((m_kind == 'b') || (m_kind == 'n') || (m_kind == 'a'))
+		{
+			if (m_asm_reserved_word(m_operands[i], m_lengths[i]) || (m_operands[i][0] == '['))
+			{
+				return true;
+			}
+		} else if (m_asm_matches(m_operands[i], m_lengths[i], m_spec, m_length) == false)
+		{
+			return true;
+		}
+
+		m_spec += m_length + (m_spec[m_length] == ',');
+	}
+
+	*m_matched = true;
+	m_spec = m_form->m_operands;
+
+	for (size_t i = 0; i < m_count; i++)
+	{
+		size_t m_length = strcspn(m_spec, ",");
+		char m_kind = (m_length == 1) ? m_spec[0] : '\0';
+		uint32_t m_value = 0;
+
+		if ((m_kind == 'b') || (m_kind == 'n') || (m_kind == 'a'))
+		{
+			uint32_t m_limit = (m_kind == 'b') ? 0xFF : ((m_kind == 'n') ? 0xF : 0xFFF);
+
+			if (m_asm_value(m_asm, m_operands[i], m_lengths[i], m_limit, &m_value) == false)
+			{
+				return false;
+			}
+
+			m_result |= (uint16_t) m_value;
+		}
+
+		m_spec += m_length + (m_spec[m_length] == ',');
+	}
+
+	*m_opcode = m_result;
+
+	return true;
+}
+
+// Assemble one line (Comment and label already stripped), m_encode is false on the sizing pass
+static bool m_asm_statement(m_asm *m_asm, const char *m_start, const char *m_end, bool m_encode)
+{
+	const char *m_word = m_start;
+
+	while ((m_start < m_end) && (isspace((unsigned char) *m_start) == 0))
+	{
+		m_start++;
+	}
+
+	size_t m_wordlength = (size_t) (m_start - m_word);
+
+	// Split the operands on commas
+	const char *m_operands[M_ASM_MAX_OPERANDS + 1];
+	size_t m_lengths[M_ASM_MAX_OPERANDS + 1];
+	size_t m_count = 0;
+	bool m_data = m_asm_equals(m_word, m_wordlength, "db") || m_asm_equals(m_word, m_wordlength, "dw");
+
+	while (m_start < m_end)
+	{
+		const char *m_comma = memchr(m_start, ',', (size_t) (m_end - m_start));
+		const char *m_stop = (m_comma != NULL) ? m_comma : m_end;
+		const char *m_first = m_start;
+		const char *m_last = m_stop;
+
+		m_asm_trim(&m_first, &m_last);
+
+		if (m_first == m_last)
+		{
+			return m_asm_fail(m_asm, "Empty operand");
+		}
+
+		if (m_data == true)
+		{
+			// Data directives take any amount of values, emit them as they come
+			bool m_word16 = (toupper((unsigned char) m_word[1]) == 'W');
+			uint32_t m_value = 0;
+
+			if ((m_encode == true) && (m_asm_value(m_asm, m_first, (size_t) (m_last - m_first), m_word16 ? 0xFFFF : 0xFF, &m_value) == false))
+			{
+				return false;
+			}
+
+			if ((m_word16 == true) && (m_asm_emit(m_asm, (uint8_t) (m_value >> 8)) == false))
+			{
+				return false;
+			}
+
+			if (m_asm_emit(m_asm, (uint8_t) m_value) == false)
+			{
+				return false;
+			}
+		} else {
+			if (m_count == M_ASM_MAX_OPERANDS)
+			{
+				return m_asm_fail(m_asm, "Too many operands");
+			}
+
+			m_operands[m_count] = m_first;
+			m_lengths[m_count] = (size_t) (m_last - m_first);
+			m_count++;
+		}
+
+		m_start = (m_comma != NULL) ? (m_comma + 1) : m_end;
+
+		// A trailing comma leaves an empty operand behind
+		if ((m_comma != NULL) && (m_start == m_end))
+		{
+			return m_asm_fail(m_asm, "Empty operand");
+		}
+	}
+
+	if (m_data == true)
+	{
+		return (m_start != m_word + m_wordlength) ? true : m_asm_fail(m_asm, "%.*s needs at least one value", (int) m_wordlength, m_word);
+	}
+
+	bool m_known = false;
+
+	for (size_t i = 0; i < M_ASM_FORMS; i++)
+	{
+		const m_asm_form *m_form = &m_asm_forms[i];
+
+		if (m_asm_equals(m_word, m_wordlength, m_form->m_mnemonic) == false)
+		{
+			continue;
+		}
+
+		m_known = true;
+
+		// Every instruction is 2 bytes, the sizing pass doesn't have to know which one it is
+		if (m_encode == false)
+		{
+			return m_asm_emit(m_asm, 0) && m_asm_emit(m_asm, 0);
+		}
+
+		bool m_matched = false;
+		uint16_t m_opcode = 0;
+
+		if (m_asm_match(m_form, m_operands, m_lengths, m_count, m_asm, &m_opcode, &m_matched) == false)
+		{
+			return false;
+		}
+
+		if (m_matched == true)
+		{
+			return m_asm_emit(m_asm, (uint8_t) (m_opcode >> 8)) && m_asm_emit(m_asm, (uint8_t) m_opcode);
+		}
+	}
+
+	if (m_known == true)
+	{
+		return m_asm_fail(m_asm, "Invalid operands for %.*s", (int) m_wordlength, m_word);
+	}
+
+	return m_asm_fail(m_asm, "Unknown instruction: %.*s", (int) m_wordlength, m_word);
+}
+
+// One pass over the whole source, labels get defined on the first one (m_encode false)
+static bool m_asm_pass(m_asm *m_asm, const char *m_source, size_t m_length, bool m_encode)
+{
+	const char *m_cursor = m_source;
+	const char *m_eof = m_source + m_length;
+
+	m_asm->m_size = 0;
+	m_asm->m_line = 0;
+
+	while (m_cursor < m_eof)
+	{
+		const char *m_newline = memchr(m_cursor, '\n', (size_t) (m_eof - m_cursor));
+		const char *m_start = m_cursor;
+		const char *m_end = (m_newline != NULL) ? m_newline : m_eof;
+		const char *m_comment = memchr(m_start, ';', (size_t) (m_end - m_start));
+
+		m_cursor = (m_newline != NULL) ? (m_newline + 1) : m_eof;
+		m_asm->m_line++;
+
+		if (m_comment != NULL)
+		{
+			m_end = m_comment;
+		}
+
+		m_asm_trim(&m_start, &m_end);
+
+		// Label definition, an instruction may follow on the same line
+		const char *m_colon = memchr(m_start, ':', (size_t) (m_end - m_start));
+
+		if (m_colon != NULL)
+		{
+			const char *m_label = m_start;
+			const char *m_labelend = m_colon;
+
+			m_asm_trim(&m_label, &m_labelend);
+
+			if (m_asm_identifier(m_label, (size_t) (m_labelend - m_label)) == false)
+			{
+				return m_asm_fail(m_asm, "Invalid label name: %.*s", (int) (m_labelend - m_label), m_label);
+			}
+
+			if ((m_encode == false) &&
+				(m_asm_define_label(m_asm, m_label, (size_t) (m_labelend - m_label), (uint16_t) (CHIP8_INITIAL_PC + m_asm->m_size)) == false))
+			{
+				return false;
+			}
+
+			m_start = m_colon + 1;
+			m_asm_trim(&m_start, &m_end);
+		}
+
+		if ((m_start < m_end) && (m_asm_statement(m_asm, m_start, m_end, m_encode) == false))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool m_assemble(const char *m_source, size_t m_length, uint8_t *m_output, size_t m_capacity, size_t *m_size,
+	m_asm_error *m_error)
+{
+	m_asm m_asm;
+	memset(&m_asm, 0, sizeof(m_asm));
+
+	m_asm.m_capacity = m_capacity;
+	m_asm.m_error = m_error;
+
+	// Pass 1 only sizes statements and places labels, pass 2 encodes with every label known
+	bool m_ok = m_asm_pass(&m_asm, m_source, m_length, false);
+
+	if (m_ok == true)
+	{
+		m_asm.m_output = m_output;
+		m_ok = m_asm_pass(&m_asm, m_source, m_length, true);
+	}
+
+	*m_size = m_asm.m_size;
+
+	free(m_asm.m_names);
+	free(m_asm.m_addresses);
+
+	return m_ok;
+}
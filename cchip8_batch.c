@@ -0,0 +1,482 @@
+#include "include/cchip8_batch.h"
+
+// GCC vector extensions, these map to SSE2/AVX2/AVX-512 registers depending on the target flags
+typedef uint8_t m_vec8 __attribute__((vector_size(M_BATCH_WARP)));
+typedef uint16_t m_vec16 __attribute__((vector_size(M_BATCH_WARP * 2)));
+
+/*
+	Unaligned vector loads and stores.
+	These are macros rather than functions, passing wide vectors by value between functions
+	would depend on the target's vector ABI.
+*/
+#define m_load8(src) ({ m_vec8 m_vec; memcpy(&m_vec, (src), sizeof(m_vec)); m_vec; })
+#define m_store8(dst, vec) ({ m_vec8 m_out = (vec); memcpy((dst), &m_out, sizeof(m_out)); })
+#define m_load16(src) ({ m_vec16 m_vec; memcpy(&m_vec, (src), sizeof(m_vec)); m_vec; })
+#define m_store16(dst, vec) ({ m_vec16 m_out = (vec); memcpy((dst), &m_out, sizeof(m_out)); })
+
+// Turn a byte-lane comparison mask (0 or -1) into 16-bit lanes holding 0 or value
+#define m_mask16(mask, value) (__builtin_convertvector((mask), m_vec16) & (value))
+
+m_batch *m_batch_create(size_t m_count, const m_chip8 *m_template)
+{
+	m_batch *m_lanes = calloc(1, sizeof(m_batch));
+
+	if (m_lanes == NULL)
+	{
+		return NULL;
+	}
+
+	m_lanes->m_count = m_count;
+	m_lanes->m_slots = ((m_count + M_BATCH_WARP - 1) / M_BATCH_WARP) * M_BATCH_WARP;
+	m_lanes->m_cycles = m_template->m_cycles;
+	m_lanes->m_quirks = m_get_quirks(m_template->m_profile);
+
+	bool m_failed = false;
+
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		m_lanes->m_v[i] = calloc(m_lanes->m_slots, sizeof(uint8_t));
+		m_failed |= (m_lanes->m_v[i] == NULL);
+	}
+
+	m_lanes->m_index = calloc(m_lanes->m_slots, sizeof(uint16_t));
+	m_lanes->m_pc = calloc(m_lanes->m_slots, sizeof(uint16_t));
+	m_lanes->m_active = calloc(m_lanes->m_slots, sizeof(uint8_t));
+	m_lanes->m_lane = calloc(m_lanes->m_slots, sizeof(uint32_t));
+	m_lanes->m_instances = m_aligned_alloc(m_count * sizeof(m_chip8));
+	m_lanes->m_videos = calloc(m_count, sizeof(m_chip8_video));
+
+	if (m_failed || (m_lanes->m_index == NULL) || (m_lanes->m_pc == NULL) || (m_lanes->m_active == NULL) ||
+		(m_lanes->m_lane == NULL) || (m_lanes->m_instances == NULL) || (m_lanes->m_videos == NULL))
+	{
+		m_batch_destroy(m_lanes);
+		return NULL;
+	}
+
+	for (size_t m_slot = 0; m_slot < m_lanes->m_slots; m_slot++)
+	{
+		// Padding slots point to the last instance but never run
+		uint32_t m_id = (m_slot < m_count) ? (uint32_t) m_slot : (uint32_t) (m_count - 1);
+
+		m_lanes->m_lane[m_slot] = m_id;
+		m_lanes->m_active[m_slot] = (m_slot < m_count) && (m_template->m_fault == M_FAULT_NONE);
+		m_lanes->m_pc[m_slot] = m_template->m_programcounter;
+		m_lanes->m_index[m_slot] = m_template->m_index;
+
+		for (int i = 0; i < CHIP8_REGISTERS; i++)
+		{
+			m_lanes->m_v[i][m_slot] = m_template->m_registers[i];
+		}
+	}
+
+	for (size_t m_id = 0; m_id < m_count; m_id++)
+	{
+		m_lanes->m_instances[m_id] = *m_template;
+		m_lanes->m_instances[m_id].m_code = NULL;
+		m_lanes->m_instances[m_id].m_video = &m_lanes->m_videos[m_id];
+
+		memcpy(&m_lanes->m_videos[m_id], m_template->m_video, sizeof(m_chip8_video));
+	}
+
+	return m_lanes;
+}
+
+void m_batch_destroy(m_batch *m_lanes)
+{
+	if (m_lanes == NULL)
+	{
+		return;
+	}
+
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		free(m_lanes->m_v[i]);
+	}
+
+	free(m_lanes->m_index);
+	free(m_lanes->m_pc);
+	free(m_lanes->m_active);
+	free(m_lanes->m_lane);
+	m_aligned_free(m_lanes->m_instances);
+	free(m_lanes->m_videos);
+	free(m_lanes);
+}
+
+// Copy a slot's registers into its instance
+static inline void m_batch_store_slot(m_batch *m_lanes, size_t m_slot)
+{
+	m_chip8 *chip8 = &m_lanes->m_instances[m_lanes->m_lane[m_slot]];
+
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		chip8->m_registers[i] = m_lanes->m_v[i][m_slot];
+	}
+
+	chip8->m_index = m_lanes->m_index[m_slot];
+	chip8->m_programcounter = m_lanes->m_pc[m_slot];
+}
+
+void m_batch_sync(m_batch *m_lanes)
+{
+	for (size_t m_slot = 0; m_slot < m_lanes->m_count; m_slot++)
+	{
+		if (m_lanes->m_active[m_slot])
+		{
+			m_batch_store_slot(m_lanes, m_slot);
+			m_lanes->m_instances[m_lanes->m_lane[m_slot]].m_cycles = m_lanes->m_cycles;
+		}
+	}
+}
+
+// Execute one instruction of a single slot through the reference interpreter
+static void m_batch_scalar(m_batch *m_lanes, size_t m_slot, uint64_t m_cycle)
+{
+	m_chip8 *chip8 = &m_lanes->m_instances[m_lanes->m_lane[m_slot]];
+
+	m_batch_store_slot(m_lanes, m_slot);
+	chip8->m_cycles = m_cycle;
+
+	m_exec(chip8);
+
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		m_lanes->m_v[i][m_slot] = chip8->m_registers[i];
+	}
+
+	m_lanes->m_index[m_slot] = chip8->m_index;
+	m_lanes->m_pc[m_slot] = chip8->m_programcounter;
+
+	if (chip8->m_fault != M_FAULT_NONE)
+	{
+		m_lanes->m_active[m_slot] = false;
+	}
+
+	m_lanes->m_scalarsteps++;
+}
+
+/*
+	Check whether every lane of the warp starting at m_base is running, sits at the same PC
+	and sees the same opcode there (Instances can modify their own memory, so the opcode
+	has to be compared too). Returns the shared opcode, or 0 (Never vectorized) otherwise.
+*/
+static inline uint16_t m_batch_uniform(const m_batch *m_lanes, size_t m_base)
+{
+	uint16_t m_pc = m_lanes->m_pc[m_base];
+
+	if (m_pc >= (FOURKiB - 1))
+	{
+		return 0;
+	}
+
+	for (size_t m_slot = m_base; m_slot < m_base + M_BATCH_WARP; m_slot++)
+	{
+		if ((m_lanes->m_active[m_slot] == false) || (m_lanes->m_pc[m_slot] != m_pc))
+		{
+			return 0;
+		}
+	}
+
+	const uint8_t *m_ram = m_lanes->m_instances[m_lanes->m_lane[m_base]].m_memory;
+	uint16_t m_opcode = (m_ram[m_pc] << 8) | m_ram[m_pc + 1];
+
+	for (size_t m_slot = m_base + 1; m_slot < m_base + M_BATCH_WARP; m_slot++)
+	{
+		const uint8_t *m_other = m_lanes->m_instances[m_lanes->m_lane[m_slot]].m_memory;
+
+		if ((m_other[m_pc] != m_ram[m_pc]) || (m_other[m_pc + 1] != m_ram[m_pc + 1]))
+		{
+			return 0;
+		}
+	}
+
+	return m_opcode;
+}
+
+/*
+	Execute m_opcode on every lane of the warp at m_base with vector operations.
+	Each statement mirrors the one in m_exec (Including the order registers are read and
+	written in), so VF aliasing behaves exactly like the scalar interpreter.
+	Returns false if the instruction has no vector implementation.
+*/
+static inline bool m_batch_vector(m_batch *m_lanes, size_t m_base, uint16_t m_opcode)
+{
+	uint8_t *m_vx = &m_lanes->m_v[M_OPC_0X00(m_opcode)][m_base];
+	uint8_t *m_vy = &m_lanes->m_v[M_OPC_00X0(m_opcode)][m_base];
+	uint8_t *m_vf = &m_lanes->m_v[F][m_base];
+	uint16_t *m_pc = &m_lanes->m_pc[m_base];
+	uint16_t *m_idx = &m_lanes->m_index[m_base];
+	const uint8_t m_nn = M_GET_NN_FROM_OPCODE(m_opcode);
+	const uint16_t m_nnn = M_GET_NNN_FROM_OPCODE(m_opcode);
+	const m_quirks *m_quirks = m_lanes->m_quirks;
+
+	// Amount to add to every lane's PC (Skips add 2 more on the lanes where they're taken)
+	m_vec16 m_advance = (m_vec16) { 0 } + 2;
+
+	switch (m_opcode & 0xF000)
+	{
+		case 0x1000:
+			m_store16(m_pc, (m_vec16) { 0 } + m_nnn);
+			return true;
+
+		case 0x3000:
+			m_advance += m_mask16(m_load8(m_vx) == m_nn, 2);
+			break;
+
+		case 0x4000:
+			m_advance += m_mask16(m_load8(m_vx) != m_nn, 2);
+			break;
+
+		case 0x5000:
+			m_advance += m_mask16(m_load8(m_vx) == m_load8(m_vy), 2);
+			break;
+
+		case 0x6000:
+			m_store8(m_vx, (m_vec8) { 0 } + m_nn);
+			break;
+
+		case 0x7000:
+			m_store8(m_vx, m_load8(m_vx) + m_nn);
+			break;
+
+		case 0x8000:
+			switch (m_opcode & 0x000F)
+			{
+				case 0x0000:
+					m_store8(m_vx, m_load8(m_vy));
+					break;
+
+				case 0x0001:
+					m_store8(m_vx, m_load8(m_vx) | m_load8(m_vy));
+
+					if (m_quirks->m_vf_reset)
+					{
+						m_store8(m_vf, (m_vec8) { 0 });
+					}
+					break;
+
+				case 0x0002:
+					m_store8(m_vx, m_load8(m_vx) & m_load8(m_vy));
+
+					if (m_quirks->m_vf_reset)
+					{
+						m_store8(m_vf, (m_vec8) { 0 });
+					}
+					break;
+
+				case 0x0003:
+					m_store8(m_vx, m_load8(m_vx) ^ m_load8(m_vy));
+
+					if (m_quirks->m_vf_reset)
+					{
+						m_store8(m_vf, (m_vec8) { 0 });
+					}
+					break;
+
+				case 0x0004:
+				{
+					m_store8(m_vx, m_load8(m_vx) + m_load8(m_vy));
+
+					// (VX + VY) > UCHAR_MAX, computed with 16-bit lanes
+					m_vec16 m_sum = __builtin_convertvector(m_load8(m_vx), m_vec16) + __builtin_convertvector(m_load8(m_vy), m_vec16);
+					m_store8(m_vf, __builtin_convertvector(m_sum > UCHAR_MAX, m_vec8) & 1);
+					break;
+				}
+
+				case 0x0005:
+					m_store8(m_vx, m_load8(m_vx) - m_load8(m_vy));
+					m_store8(m_vf, (m_vec8) (m_load8(m_vx) <= m_load8(m_vy)) & 1);
+					break;
+
+				case 0x0006:
+					if (m_quirks->m_shift_vx)
+					{
+						m_store8(m_vf, m_load8(m_vx) & 0x1);
+						m_store8(m_vx, m_load8(m_vx) >> 1);
+					} else {
+						m_vec8 m_shifted = m_load8(m_vy);
+						m_store8(m_vx, m_shifted >> 1);
+						m_store8(m_vf, m_shifted & 0x1);
+					}
+					break;
+
+				case 0x0007:
+					m_store8(m_vx, m_load8(m_vy) - m_load8(m_vx));
+					m_store8(m_vf, (m_vec8) (m_load8(m_vy) > m_load8(m_vx)) & 1);
+					break;
+
+				case 0x000E:
+					if (m_quirks->m_shift_vx)
+					{
+						m_store8(m_vf, (m_load8(m_vx) & 0x80) >> 7);
+						m_store8(m_vx, m_load8(m_vx) << 1);
+					} else {
+						m_vec8 m_shifted = m_load8(m_vy);
+						m_store8(m_vx, m_shifted << 1);
+						m_store8(m_vf, (m_shifted & 0x80) >> 7);
+					}
+					break;
+
+				default:
+					return false;
+			}
+			break;
+
+		case 0x9000:
+			m_advance += m_mask16(m_load8(m_vx) != m_load8(m_vy), 2);
+			break;
+
+		case 0xA000:
+			m_store16(m_idx, (m_vec16) { 0 } + m_nnn);
+			break;
+
+		case 0xF000:
+			if ((m_opcode & 0x00FF) == 0x001E)
+			{
+				m_store16(m_idx, m_load16(m_idx) + __builtin_convertvector(m_load8(m_vx), m_vec16));
+				break;
+			}
+
+			if ((m_opcode & 0x00FF) == 0x0029)
+			{
+				m_store16(m_idx, __builtin_convertvector(m_load8(m_vx), m_vec16) * 0x5);
+				break;
+			}
+
+			return false;
+
+		default:
+			return false;
+	}
+
+	m_store16(m_pc, m_load16(m_pc) + m_advance);
+
+	return true;
+}
+
+/*
+	Regroup the lanes so the ones sharing a PC end up in the same warps.
+	This is a stable counting sort of the slots by PC (Stopped instances go last) which
+	permutes the whole struct-of-arrays state.
+*/
+static void m_batch_regroup(m_batch *m_lanes)
+{
+	const size_t m_slots = m_lanes->m_slots;
+
+	// One bucket per PC value plus one for the stopped lanes
+	uint32_t *m_buckets = calloc(0x10000 + 2, sizeof(uint32_t));
+	uint32_t *m_order = malloc(m_slots * sizeof(uint32_t));
+	uint8_t *m_scratch = malloc(m_slots * sizeof(uint32_t));
+
+	if ((m_buckets == NULL) || (m_order == NULL) || (m_scratch == NULL))
+	{
+		free(m_buckets);
+		free(m_order);
+		free(m_scratch);
+		return;
+	}
+
+	for (size_t m_slot = 0; m_slot < m_slots; m_slot++)
+	{
+		uint32_t m_key = m_lanes->m_active[m_slot] ? m_lanes->m_pc[m_slot] : 0x10000;
+		m_buckets[m_key + 1]++;
+	}
+
+	for (size_t i = 1; i < 0x10000 + 2; i++)
+	{
+		m_buckets[i] += m_buckets[i - 1];
+	}
+
+	for (size_t m_slot = 0; m_slot < m_slots; m_slot++)
+	{
+		uint32_t m_key = m_lanes->m_active[m_slot] ? m_lanes->m_pc[m_slot] : 0x10000;
+		m_order[m_buckets[m_key]++] = (uint32_t) m_slot;
+	}
+
+	// Gather every array through the new order
+#define M_BATCH_PERMUTE(array, type) \
+	do { \
+		type *m_tmp = (type *) m_scratch; \
+		for (size_t m_slot = 0; m_slot < m_slots; m_slot++) \
+			m_tmp[m_slot] = (array)[m_order[m_slot]]; \
+		memcpy((array), m_tmp, m_slots * sizeof(type)); \
+	} while (0)
+
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		M_BATCH_PERMUTE(m_lanes->m_v[i], uint8_t);
+	}
+
+	M_BATCH_PERMUTE(m_lanes->m_index, uint16_t);
+	M_BATCH_PERMUTE(m_lanes->m_pc, uint16_t);
+	M_BATCH_PERMUTE(m_lanes->m_active, uint8_t);
+	M_BATCH_PERMUTE(m_lanes->m_lane, uint32_t);
+
+#undef M_BATCH_PERMUTE
+
+	free(m_buckets);
+	free(m_order);
+	free(m_scratch);
+
+	m_lanes->m_regroups++;
+}
+
+void m_batch_run(m_batch *m_lanes, uint32_t m_steps)
+{
+	const size_t m_warps = m_lanes->m_slots / M_BATCH_WARP;
+
+	uint32_t m_done = 0;
+
+	while (m_done < m_steps)
+	{
+		uint32_t m_round = ((m_steps - m_done) < M_BATCH_ROUND) ? (m_steps - m_done) : M_BATCH_ROUND;
+
+		// Warp-steps that had to fall back to the scalar path during this round
+		uint64_t m_divergent = 0;
+
+		// Run each warp for the whole round while its registers are hot in the cache
+		for (size_t m_warp = 0; m_warp < m_warps; m_warp++)
+		{
+			const size_t m_base = m_warp * M_BATCH_WARP;
+
+			for (uint32_t m_step = 0; m_step < m_round; m_step++)
+			{
+				uint16_t m_opcode = m_batch_uniform(m_lanes, m_base);
+
+				if ((m_opcode != 0) && m_batch_vector(m_lanes, m_base, m_opcode))
+				{
+					m_lanes->m_vectorsteps++;
+					continue;
+				}
+
+				// Drain every running lane through the reference interpreter
+				size_t m_running = 0;
+
+				for (size_t m_slot = m_base; m_slot < m_base + M_BATCH_WARP; m_slot++)
+				{
+					if (m_lanes->m_active[m_slot])
+					{
+						m_batch_scalar(m_lanes, m_slot, m_lanes->m_cycles + m_step);
+						m_running++;
+					}
+				}
+
+				// Every lane of the warp faulted, there's nothing left to run in it and regrouping can't help either
+				if (m_running == 0)
+				{
+					break;
+				}
+
+				m_divergent++;
+			}
+		}
+
+		m_lanes->m_cycles += m_round;
+		m_done += m_round;
+
+		// Too many warps diverged, bring the lanes sharing a PC together
+		if ((m_divergent * 8) > ((uint64_t) m_warps * m_round))
+		{
+			m_batch_regroup(m_lanes);
+		}
+	}
+}
@@ -0,0 +1,526 @@
+// pthread_cond_timedwait() and clock_gettime() are POSIX, -std=c2x hides them otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/cchip8_capture.h"
+
+#include <stdatomic.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+/*
+	Capture: the emulation thread compares the display with the last one it handed over and, if it
+	changed, copies it into the next free slot of a preallocated ring and publishes the slot. That's
+	all it does, no allocation, no lock and no system call (Unless the ring runs half full and the
+	writer thread needs waking up early, or full and it has to wait for it). The writer thread packs,
+	delta and RLE codes the pictures and writes them out.
+*/
+
+// A frame handed over to the writer thread
+typedef struct chip8_capture_slot
+{
+	uint64_t m_frame;
+	uint32_t m_display[CHIP8_COLUMNS * CHIP8_ROWS];
+
+} m_capture_slot;
+
+struct cchip8_capture
+{
+	/*
+		Single producer (The emulation thread), single consumer (The writer thread) ring: slots
+		[m_tail, m_head) are full. Each index is only stored by its own side.
+	*/
+	alignas(M_CACHELINE) _Atomic uint64_t m_head;
+	alignas(M_CACHELINE) _Atomic uint64_t m_tail;
+
+	/* Emulation thread */
+
+	// Emulated frames so far, and the picture handed over last
+	alignas(M_CACHELINE) uint64_t m_frame;
+	uint32_t m_last[CHIP8_COLUMNS * CHIP8_ROWS];
+	bool m_started;
+	uint64_t m_stalls;
+
+	/* Writer thread */
+
+	FILE *m_file;
+	uint8_t m_previous[M_CAPTURE_FRAME];
+	uint64_t m_written;
+	uint64_t m_records;
+	uint64_t m_bytes;
+	bool m_failed;
+
+#if defined(__unix__) || defined(__APPLE__)
+	pthread_t m_thread;
+	pthread_mutex_t m_lock;
+
+	// Work for the writer (Or time to stop), room for the emulation thread
+	pthread_cond_t m_work;
+	pthread_cond_t m_room;
+	bool m_waiting;
+	bool m_stop;
+#endif
+
+	m_capture_slot m_slots[M_CAPTURE_SLOTS];
+};
+
+static void m_capture_varint(uint8_t **m_out, uint64_t m_value)
+{
+	do
+	{
+		*(*m_out)++ = (uint8_t) ((m_value & 0x7F) | ((m_value > 0x7F) ? 0x80 : 0x00));
+		m_value >>= 7;
+	} while (m_value != 0);
+}
+
+// Pack, XOR with the previous record and RLE code one picture, returns the record size
+static size_t m_capture_encode(cchip8_capture *m_capture, const m_capture_slot *m_slot, uint8_t *m_record)
+{
+	uint8_t m_delta[M_CAPTURE_FRAME];
+	uint8_t *m_out = m_record;
+
+	m_capture_varint(&m_out, m_slot->m_frame - m_capture->m_written);
+	m_capture->m_written = m_slot->m_frame;
+
+	for (size_t i = 0; i < M_CAPTURE_FRAME; i++)
+	{
+		uint8_t m_byte = 0;
+
+		for (size_t m_bit = 0; m_bit < 8; m_bit++)
+		{
+			m_byte = (uint8_t) ((m_byte << 1) | (m_slot->m_display[(i * 8) + m_bit] != 0));
+		}
+
+		m_delta[i] = m_byte ^ m_capture->m_previous[i];
+		m_capture->m_previous[i] = m_byte;
+	}
+
+	for (size_t i = 0; i < M_CAPTURE_FRAME;)
+	{
+		size_t m_run = 0;
+
+		// Unchanged bytes
+		while (((i + m_run) < M_CAPTURE_FRAME) && (m_delta[i + m_run] == 0) && (m_run < 128))
+		{
+			m_run++;
+		}
+
+		if (m_run != 0)
+		{
+			*m_out++ = (uint8_t) (m_run - 1);
+			i += m_run;
+			continue;
+		}
+
+		// Changed bytes, up to the next pair of unchanged ones (A lone zero is cheaper as a literal)
+		while (((i + m_run) < M_CAPTURE_FRAME) && (m_run < 128) &&
+			((m_delta[i + m_run] != 0) || (((i + m_run + 1) < M_CAPTURE_FRAME) && (m_delta[i + m_run + 1] != 0))))
+		{
+			m_run++;
+		}
+
+		*m_out++ = (uint8_t) (0x7F + m_run);
+		memcpy(m_out, &m_delta[i], m_run);
+		m_out += m_run;
+		i += m_run;
+	}
+
+	return (size_t) (m_out - m_record);
+}
+
+static void m_capture_write(cchip8_capture *m_capture, const uint8_t *m_bytes, size_t m_size)
+{
+	if ((m_capture->m_failed == false) && (fwrite(m_bytes, 1, m_size, m_capture->m_file) != m_size))
+	{
+		m_log("Capture: write failed, the rest of the session won't be recorded");
+		m_capture->m_failed = true;
+	}
+
+	m_capture->m_bytes += m_size;
+}
+
+// Encode and write every full slot, returns how many there were
+static uint64_t m_capture_drain(cchip8_capture *m_capture)
+{
+	// Varint, then the tokens (RLE never grows a picture by more than a few bytes, twice its size is plenty)
+	uint8_t m_record[10 + (2 * M_CAPTURE_FRAME)];
+	uint64_t m_tail = atomic_load_explicit(&m_capture->m_tail, memory_order_relaxed);
+	uint64_t m_head = atomic_load_explicit(&m_capture->m_head, memory_order_acquire);
+
+	for (uint64_t i = m_tail; i < m_head; i++)
+	{
+		size_t m_size = m_capture_encode(m_capture, &m_capture->m_slots[i % M_CAPTURE_SLOTS], m_record);
+
+		// The slot is free as soon as it's encoded
+		atomic_store_explicit(&m_capture->m_tail, i + 1, memory_order_release);
+
+		m_capture_write(m_capture, m_record, m_size);
+		m_capture->m_records++;
+	}
+
+	return m_head - m_tail;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// How long the writer sleeps when there's nothing to do (A few frames, the ring holds over a second)
+#define M_CAPTURE_NAP_NS 50000000L
+
+static void *m_capture_thread(void *m_arg)
+{
+	cchip8_capture *m_capture = m_arg;
+
+	pthread_mutex_lock(&m_capture->m_lock);
+
+	while (true)
+	{
+		bool m_stop = m_capture->m_stop;
+
+		pthread_mutex_unlock(&m_capture->m_lock);
+		uint64_t m_drained = m_capture_drain(m_capture);
+		pthread_mutex_lock(&m_capture->m_lock);
+
+		if (m_capture->m_waiting)
+		{
+			pthread_cond_signal(&m_capture->m_room);
+		}
+
+		// m_stop was read before the last drain, everything handed over before it got set is written
+		if (m_stop)
+		{
+			break;
+		}
+
+		if ((m_drained == 0) && (m_capture->m_stop == false))
+		{
+			struct timespec m_deadline;
+
+			clock_gettime(CLOCK_REALTIME, &m_deadline);
+			m_deadline.tv_nsec += M_CAPTURE_NAP_NS;
+
+			if (m_deadline.tv_nsec >= 1000000000L)
+			{
+				m_deadline.tv_sec++;
+				m_deadline.tv_nsec -= 1000000000L;
+			}
+
+			pthread_cond_timedwait(&m_capture->m_work, &m_capture->m_lock, &m_deadline);
+		}
+	}
+
+	pthread_mutex_unlock(&m_capture->m_lock);
+
+	return NULL;
+}
+
+cchip8_capture *cchip8_capture_create(const char *m_filename)
+{
+	cchip8_capture *m_capture = m_aligned_alloc(sizeof(cchip8_capture));
+
+	if (m_capture == NULL)
+	{
+		return NULL;
+	}
+
+	memset(m_capture, 0, sizeof(cchip8_capture));
+	atomic_init(&m_capture->m_head, 0);
+	atomic_init(&m_capture->m_tail, 0);
+
+	m_capture->m_file = fopen(m_filename, "wb");
+
+	if (m_capture->m_file == NULL)
+	{
+		m_log("Could not create the capture %s", m_filename);
+		m_aligned_free(m_capture);
+		return NULL;
+	}
+
+	uint8_t m_header[M_CAPTURE_HEADER] = { 'C', 'C', 'H', 'I', 'P', '8', 'V', M_CAPTURE_VERSION,
+		CHIP8_COLUMNS & 0xFF, CHIP8_COLUMNS >> 8, CHIP8_ROWS & 0xFF, CHIP8_ROWS >> 8, CHIP8_FRAMERATE & 0xFF, CHIP8_FRAMERATE >> 8 };
+
+	m_capture_write(m_capture, m_header, sizeof(m_header));
+
+	pthread_mutex_init(&m_capture->m_lock, NULL);
+	pthread_cond_init(&m_capture->m_work, NULL);
+	pthread_cond_init(&m_capture->m_room, NULL);
+
+	if (pthread_create(&m_capture->m_thread, NULL, m_capture_thread, m_capture) != 0)
+	{
+		pthread_cond_destroy(&m_capture->m_room);
+		pthread_cond_destroy(&m_capture->m_work);
+		pthread_mutex_destroy(&m_capture->m_lock);
+		fclose(m_capture->m_file);
+		remove(m_filename);
+		m_aligned_free(m_capture);
+		return NULL;
+	}
+
+	return m_capture;
+}
+
+void m_capture_frame(cchip8_capture *m_capture, const uint32_t *m_display, uint32_t m_frames)
+{
+	m_capture->m_frame += m_frames;
+
+	if (m_capture->m_started && (memcmp(m_display, m_capture->m_last, sizeof(m_capture->m_last)) == 0))
+	{
+		return;
+	}
+
+	m_capture->m_started = true;
+	memcpy(m_capture->m_last, m_display, sizeof(m_capture->m_last));
+
+	uint64_t m_head = atomic_load_explicit(&m_capture->m_head, memory_order_relaxed);
+
+	// Full: better to hold the machine up than to lose a frame of a regression recording
+	if ((m_head - atomic_load_explicit(&m_capture->m_tail, memory_order_acquire)) == M_CAPTURE_SLOTS)
+	{
+		m_capture->m_stalls++;
+
+		pthread_mutex_lock(&m_capture->m_lock);
+		m_capture->m_waiting = true;
+		pthread_cond_signal(&m_capture->m_work);
+
+		while ((m_head - atomic_load_explicit(&m_capture->m_tail, memory_order_acquire)) == M_CAPTURE_SLOTS)
+		{
+			pthread_cond_wait(&m_capture->m_room, &m_capture->m_lock);
+		}
+
+		m_capture->m_waiting = false;
+		pthread_mutex_unlock(&m_capture->m_lock);
+	}
+
+	m_capture_slot *m_slot = &m_capture->m_slots[m_head % M_CAPTURE_SLOTS];
+
+	m_slot->m_frame = m_capture->m_frame;
+	memcpy(m_slot->m_display, m_display, sizeof(m_slot->m_display));
+
+	atomic_store_explicit(&m_capture->m_head, m_head + 1, memory_order_release);
+
+	// The writer naps between drains, a machine running faster than real time wakes it up sooner
+	if ((m_head + 1 - atomic_load_explicit(&m_capture->m_tail, memory_order_relaxed)) == (M_CAPTURE_SLOTS / 2))
+	{
+		pthread_mutex_lock(&m_capture->m_lock);
+		pthread_cond_signal(&m_capture->m_work);
+		pthread_mutex_unlock(&m_capture->m_lock);
+	}
+}
+
+void cchip8_capture_destroy(cchip8_capture *m_capture, cchip8_capture_stats *m_stats)
+{
+	if (m_capture == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&m_capture->m_lock);
+	m_capture->m_stop = true;
+	pthread_cond_signal(&m_capture->m_work);
+	pthread_mutex_unlock(&m_capture->m_lock);
+
+	pthread_join(m_capture->m_thread, NULL);
+
+	// End record: how many frames the last picture stayed up after its own
+	uint8_t m_end[11];
+	uint8_t *m_out = m_end;
+
+	m_capture_varint(&m_out, 0);
+	m_capture_varint(&m_out, m_capture->m_frame - m_capture->m_written);
+	m_capture_write(m_capture, m_end, (size_t) (m_out - m_end));
+
+	if ((fclose(m_capture->m_file) != 0) && (m_capture->m_failed == false))
+	{
+		m_log("Capture: write failed, the end of the session wasn't recorded");
+	}
+
+	if (m_stats != NULL)
+	{
+		m_stats->m_frames = m_capture->m_frame;
+		m_stats->m_records = m_capture->m_records;
+		m_stats->m_bytes = m_capture->m_bytes;
+		m_stats->m_stalls = m_capture->m_stalls;
+	}
+
+	pthread_cond_destroy(&m_capture->m_room);
+	pthread_cond_destroy(&m_capture->m_work);
+	pthread_mutex_destroy(&m_capture->m_lock);
+	m_aligned_free(m_capture);
+}
+
+#else
+
+// No threads to write on, no capture
+cchip8_capture *cchip8_capture_create(const char *m_filename)
+{
+	(void) m_filename;
+	return NULL;
+}
+
+void m_capture_frame(cchip8_capture *m_capture, const uint32_t *m_display, uint32_t m_frames)
+{
+	(void) m_capture;
+	(void) m_display;
+	(void) m_frames;
+}
+
+void cchip8_capture_destroy(cchip8_capture *m_capture, cchip8_capture_stats *m_stats)
+{
+	(void) m_capture;
+	(void) m_stats;
+}
+
+#endif
+
+bool m_capture_open(m_capture_reader *m_reader, const char *m_filename)
+{
+	uint8_t m_header[M_CAPTURE_HEADER];
+
+	memset(m_reader, 0, sizeof(*m_reader));
+
+	m_reader->m_file = fopen(m_filename, "rb");
+
+	if (m_reader->m_file == NULL)
+	{
+		m_log("Could not open %s", m_filename);
+		return false;
+	}
+
+	if ((fread(m_header, 1, sizeof(m_header), m_reader->m_file) != sizeof(m_header)) ||
+		(memcmp(m_header, M_CAPTURE_MAGIC, 7) != 0) || (m_header[7] != M_CAPTURE_VERSION))
+	{
+		m_log("%s isn't a version %d capture stream", m_filename, M_CAPTURE_VERSION);
+		fclose(m_reader->m_file);
+		m_reader->m_file = NULL;
+		return false;
+	}
+
+	m_reader->m_columns = (uint16_t) (m_header[8] | (m_header[9] << 8));
+	m_reader->m_rows = (uint16_t) (m_header[10] | (m_header[11] << 8));
+	m_reader->m_framerate = (uint16_t) (m_header[12] | (m_header[13] << 8));
+
+	if ((m_reader->m_columns != CHIP8_COLUMNS) || (m_reader->m_rows != CHIP8_ROWS) || (m_reader->m_framerate == 0))
+	{
+		m_log("%s has a %ux%u display, only %ux%u ones are supported", m_filename, m_reader->m_columns, m_reader->m_rows,
+			CHIP8_COLUMNS, CHIP8_ROWS);
+		fclose(m_reader->m_file);
+		m_reader->m_file = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+// False on a stream that got cut off in the middle of the number
+static bool m_capture_read_varint(FILE *m_file, uint64_t *m_value)
+{
+	*m_value = 0;
+
+	for (unsigned m_shift = 0; m_shift < 64; m_shift += 7)
+	{
+		int m_byte = fgetc(m_file);
+
+		if (m_byte == EOF)
+		{
+			return false;
+		}
+
+		*m_value |= (uint64_t) (m_byte & 0x7F) << m_shift;
+
+		if ((m_byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Decode one record, false at the end record or wherever the stream got cut off
+static bool m_capture_record(m_capture_reader *m_reader)
+{
+	uint64_t m_delta = 0;
+
+	if (m_capture_read_varint(m_reader->m_file, &m_delta) == false)
+	{
+		return false;
+	}
+
+	if (m_delta == 0)
+	{
+		if (m_capture_read_varint(m_reader->m_file, &m_reader->m_trailing))
+		{
+			m_reader->m_trailing++;
+		}
+
+		return false;
+	}
+
+	uint8_t m_display[M_CAPTURE_FRAME];
+
+	for (size_t i = 0; i < M_CAPTURE_FRAME;)
+	{
+		int m_token = fgetc(m_reader->m_file);
+
+		if (m_token == EOF)
+		{
+			return false;
+		}
+
+		size_t m_run = (m_token < 0x80) ? (size_t) m_token + 1 : (size_t) m_token - 0x7F;
+
+		if ((i + m_run) > M_CAPTURE_FRAME)
+		{
+			return false;
+		}
+
+		if (m_token < 0x80)
+		{
+			memset(&m_display[i], 0, m_run);
+		} else if (fread(&m_display[i], 1, m_run, m_reader->m_file) != m_run)
+		{
+			return false;
+		}
+
+		i += m_run;
+	}
+
+	for (size_t i = 0; i < M_CAPTURE_FRAME; i++)
+	{
+		m_reader->m_display[i] ^= m_display[i];
+	}
+
+	m_reader->m_frame += m_delta;
+
+	return true;
+}
+
+bool m_capture_next(m_capture_reader *m_reader)
+{
+	if ((m_reader->m_file == NULL) || (m_reader->m_trailing != 0))
+	{
+		return false;
+	}
+
+	if (m_capture_record(m_reader))
+	{
+		return true;
+	}
+
+	// A stream cut off before its end record leaves the last picture up for its own frame only
+	if (m_reader->m_trailing == 0)
+	{
+		m_reader->m_trailing = 1;
+	}
+
+	return false;
+}
+
+void m_capture_close(m_capture_reader *m_reader)
+{
+	if (m_reader->m_file != NULL)
+	{
+		fclose(m_reader->m_file);
+		m_reader->m_file = NULL;
+	}
+}
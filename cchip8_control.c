@@ -0,0 +1,1040 @@
+// Sockets and poll() are POSIX, -std=c2x hides them otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/cchip8.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+	Control socket server and client (Protocol in libcchip8.h).
+
+	The server never blocks on a client: sockets are non-blocking, requests are parsed straight out
+	of each client's input buffer and replies collected in its output buffer, which gets written
+	once per batch. A client that stops reading its replies only stalls itself (We stop parsing its
+	requests once there's no room left for the largest reply).
+*/
+
+#define M_CONTROL_HEADER 4
+#define M_CONTROL_FRAME (M_CONTROL_HEADER + CCHIP8_CONTROL_MAX_PAYLOAD)
+
+// Connections served at once
+#define M_CONTROL_CLIENTS 8
+
+// Per connection buffers (Room for a few hundred pipelined step + observe requests)
+#define M_CONTROL_BUFFER (64 * 1024)
+
+// Clients send their queued requests once this much piled up
+#define M_CLIENT_BATCH (16 * 1024)
+
+static_assert(CCHIP8_CONTROL_MAX_PAYLOAD >= FOURKiB, "Memory reads and ROMs must fit a payload");
+static_assert(M_CONTROL_BUFFER >= (2 * M_CONTROL_FRAME), "A buffer must hold more than one frame");
+static_assert(CCHIP8_OBSERVATION_SIZE == 290, "Observation layout mismatch");
+
+typedef struct chip8_control_client
+{
+	int m_fd;
+
+	// Requests received, [0, m_inputlength)
+	uint8_t m_input[M_CONTROL_BUFFER];
+	size_t m_inputlength;
+
+	// Replies not written yet, [m_outputstart, m_outputstart + m_outputlength)
+	uint8_t m_output[M_CONTROL_BUFFER];
+	size_t m_outputstart;
+	size_t m_outputlength;
+
+} m_control_client;
+
+struct cchip8_control
+{
+	cchip8 *m_vm;
+
+	int m_listener;
+	char *m_path;
+
+	m_control_client *m_clients[M_CONTROL_CLIENTS];
+
+	// Save state slots, allocated on their first save
+	cchip8_state *m_slots[CCHIP8_CONTROL_SLOTS];
+
+	void (*m_keyhandler)(void *m_user, uint8_t m_key, bool m_down);
+	void *m_keyuser;
+};
+
+struct cchip8_client
+{
+	int m_fd;
+
+	// Queued requests
+	uint8_t *m_output;
+	size_t m_outputlength;
+	size_t m_outputcapacity;
+
+	// Received replies, [m_inputstart, m_inputlength), m_consumed is the size of the one handed out last
+	uint8_t *m_input;
+	size_t m_inputstart;
+	size_t m_inputlength;
+	size_t m_inputcapacity;
+	size_t m_consumed;
+};
+
+// Little endian helpers, the wire format doesn't depend on the host
+static inline uint16_t m_control_get16(const uint8_t *m_bytes)
+{
+	return (uint16_t) (m_bytes[0] | (m_bytes[1] << 8));
+}
+
+static inline uint32_t m_control_get32(const uint8_t *m_bytes)
+{
+	return (uint32_t) m_control_get16(m_bytes) | ((uint32_t) m_control_get16(m_bytes + 2) << 16);
+}
+
+static inline uint64_t m_control_get64(const uint8_t *m_bytes)
+{
+	return (uint64_t) m_control_get32(m_bytes) | ((uint64_t) m_control_get32(m_bytes + 4) << 32);
+}
+
+static inline uint8_t *m_control_put16(uint8_t *m_bytes, uint16_t m_value)
+{
+	m_bytes[0] = (uint8_t) m_value;
+	m_bytes[1] = (uint8_t) (m_value >> 8);
+
+	return m_bytes + 2;
+}
+
+static inline uint8_t *m_control_put64(uint8_t *m_bytes, uint64_t m_value)
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		m_bytes[i] = (uint8_t) (m_value >> (i * 8));
+	}
+
+	return m_bytes + 8;
+}
+
+// Registers and the display packed one bit per pixel, CCHIP8_OBSERVATION_SIZE bytes
+static uint8_t *m_control_observe(cchip8 *m_vm, uint8_t *m_bytes)
+{
+	cchip8_registers m_registers;
+
+	cchip8_get_registers(m_vm, &m_registers);
+
+	m_bytes = m_control_put64(m_bytes, cchip8_get_cycles(m_vm));
+	m_bytes = m_control_put16(m_bytes, m_registers.m_programcounter);
+	m_bytes = m_control_put16(m_bytes, m_registers.m_index);
+	m_bytes = m_control_put16(m_bytes, cchip8_get_keys(m_vm));
+
+	memcpy(m_bytes, m_registers.m_registers, 16);
+	m_bytes += 16;
+
+	*m_bytes++ = m_registers.m_stackp;
+	*m_bytes++ = m_registers.m_delaytimer;
+	*m_bytes++ = m_registers.m_soundtimer;
+	*m_bytes++ = (uint8_t) cchip8_get_fault(m_vm, NULL);
+
+	uint64_t m_rows[CCHIP8_HEIGHT];
+
+	cchip8_pack_display(m_vm, m_rows);
+
+	for (size_t m_row = 0; m_row < CCHIP8_HEIGHT; m_row++)
+	{
+		m_bytes = m_control_put64(m_bytes, m_rows[m_row]);
+	}
+
+	return m_bytes;
+}
+
+/*
+	Run one request, its reply payload goes to m_reply (Room for CCHIP8_CONTROL_MAX_PAYLOAD bytes).
+	Returns the status, m_length receives the payload size.
+*/
+static uint8_t m_control_execute(cchip8_control *m_control, uint8_t m_command, uint8_t m_argument, const uint8_t *m_payload,
+	uint16_t m_size, uint8_t *m_reply, uint16_t *m_length)
+{
+	cchip8 *m_vm = m_control->m_vm;
+	enum cchip8_status m_status = CCHIP8_OK;
+	uint8_t *m_end = m_reply;
+
+	switch (m_command)
+	{
+		case CCHIP8_CONTROL_LOAD_ROM:
+			if (cchip8_load_rom_from_memory(m_vm, m_payload, m_size) == false)
+			{
+				return CCHIP8_CONTROL_FAILED;
+			}
+			break;
+
+		case CCHIP8_CONTROL_RESET:
+			cchip8_reset(m_vm);
+			break;
+
+		case CCHIP8_CONTROL_KEY:
+			if ((m_argument & 0x7F) >= CHIP8_KEYS)
+			{
+				return CCHIP8_CONTROL_MALFORMED;
+			}
+
+			if (m_control->m_keyhandler != NULL)
+			{
+				m_control->m_keyhandler(m_control->m_keyuser, m_argument & 0x7F, (m_argument & 0x80) != 0);
+			} else {
+				cchip8_key_event(m_vm, m_argument & 0x7F, (m_argument & 0x80) != 0);
+			}
+
+			m_end = m_control_put16(m_end, cchip8_get_keys(m_vm));
+			break;
+
+		case CCHIP8_CONTROL_RUN_FRAMES:
+		case CCHIP8_CONTROL_STEP:
+			// Zero frames would be a frame boundary without a frame, nothing a client means to ask for
+			if ((m_command == CCHIP8_CONTROL_RUN_FRAMES) && (m_size != 0) && ((m_size != 4) || (m_control_get32(m_payload) == 0)))
+			{
+				return CCHIP8_CONTROL_MALFORMED;
+			}
+
+			if (m_command == CCHIP8_CONTROL_STEP)
+			{
+				m_status = cchip8_step(m_vm);
+			} else {
+				m_status = cchip8_run_frames(m_vm, (m_size == 4) ? m_control_get32(m_payload) : 1);
+			}
+
+			*m_end++ = (uint8_t) m_status;
+			m_end = m_control_put64(m_end, cchip8_get_cycles(m_vm));
+			break;
+
+		case CCHIP8_CONTROL_SAVE_STATE:
+		case CCHIP8_CONTROL_LOAD_STATE:
+			if (m_argument >= CCHIP8_CONTROL_SLOTS)
+			{
+				return CCHIP8_CONTROL_MALFORMED;
+			}
+
+			if (m_command == CCHIP8_CONTROL_LOAD_STATE)
+			{
+				if (m_control->m_slots[m_argument] == NULL)
+				{
+					return CCHIP8_CONTROL_FAILED;
+				}
+
+				cchip8_load_state(m_vm, m_control->m_slots[m_argument]);
+				break;
+			}
+
+			if (m_control->m_slots[m_argument] == NULL)
+			{
+				m_control->m_slots[m_argument] = cchip8_state_create();
+
+				if (m_control->m_slots[m_argument] == NULL)
+				{
+					return CCHIP8_CONTROL_FAILED;
+				}
+			}
+
+			cchip8_save_state(m_vm, m_control->m_slots[m_argument]);
+			break;
+
+		case CCHIP8_CONTROL_READ_MEMORY:
+			if ((m_size != 4) || (m_control_get16(m_payload + 2) > FOURKiB))
+			{
+				return CCHIP8_CONTROL_MALFORMED;
+			}
+
+			cchip8_read_memory(m_vm, m_control_get16(m_payload), m_end, m_control_get16(m_payload + 2));
+			m_end += m_control_get16(m_payload + 2);
+			break;
+
+		case CCHIP8_CONTROL_OBSERVE:
+			m_end = m_control_observe(m_vm, m_end);
+			break;
+
+		default:
+			return CCHIP8_CONTROL_UNKNOWN;
+	}
+
+	*m_length = (uint16_t) (m_end - m_reply);
+
+	return CCHIP8_CONTROL_OK;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+// Writing to a client that went away must fail with EPIPE, not raise SIGPIPE
+#if defined(MSG_NOSIGNAL)
+#define M_CONTROL_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define M_CONTROL_SEND_FLAGS 0
+#endif
+
+// sun_path is a fixed size array, false if m_path doesn't fit it
+static bool m_control_address(struct sockaddr_un *m_address, const char *m_path)
+{
+	memset(m_address, 0, sizeof(*m_address));
+	m_address->sun_family = AF_UNIX;
+
+	if (strlen(m_path) >= sizeof(m_address->sun_path))
+	{
+		return false;
+	}
+
+	strcpy(m_address->sun_path, m_path);
+
+	return true;
+}
+
+/*
+	A socket file left behind by an instance that didn't exit cleanly makes bind() fail, so it gets
+	removed. Only that though: a path naming anything but a socket (A mistyped -socket pointing at a
+	regular file) or a socket some instance still accepts connections on is left alone, false then.
+*/
+static bool m_control_clear_stale(const struct sockaddr_un *m_address, const char *m_path)
+{
+	struct stat m_info;
+
+	// Nothing there (Or nothing we can look at, bind() tells why)
+	if (lstat(m_path, &m_info) != 0)
+	{
+		return true;
+	}
+
+	if (S_ISSOCK(m_info.st_mode) == false)
+	{
+		m_log("%s exists and isn't a socket, not replacing it", m_path);
+		return false;
+	}
+
+	int m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (m_fd < 0)
+	{
+		return false;
+	}
+
+	bool m_live = (connect(m_fd, (const struct sockaddr *) m_address, sizeof(*m_address)) == 0);
+
+	close(m_fd);
+
+	if (m_live)
+	{
+		m_log("Another instance is listening on %s", m_path);
+		return false;
+	}
+
+	unlink(m_path);
+
+	return true;
+}
+
+cchip8_control *cchip8_control_create(cchip8 *m_vm, const char *m_path)
+{
+	struct sockaddr_un m_address;
+
+	if (m_control_address(&m_address, m_path) == false)
+	{
+		m_log("Control socket path too long: %s", m_path);
+		return NULL;
+	}
+
+	cchip8_control *m_control = calloc(1, sizeof(cchip8_control));
+
+	if (m_control == NULL)
+	{
+		return NULL;
+	}
+
+	m_control->m_vm = m_vm;
+	m_control->m_path = malloc(strlen(m_path) + 1);
+	m_control->m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if ((m_control->m_path == NULL) || (m_control->m_listener < 0))
+	{
+		if (m_control->m_listener >= 0)
+		{
+			close(m_control->m_listener);
+		}
+
+		free(m_control->m_path);
+		free(m_control);
+		return NULL;
+	}
+
+	strcpy(m_control->m_path, m_path);
+
+	if (m_control_clear_stale(&m_address, m_path) == false)
+	{
+		close(m_control->m_listener);
+		free(m_control->m_path);
+		free(m_control);
+		return NULL;
+	}
+
+	if (bind(m_control->m_listener, (struct sockaddr *) &m_address, sizeof(m_address)) != 0)
+	{
+		m_log("Could not bind %s: %s", m_path, strerror(errno));
+		close(m_control->m_listener);
+		free(m_control->m_path);
+		free(m_control);
+		return NULL;
+	}
+
+	/*
+		The socket file got the umask's permissions, and anyone who can connect drives the machine
+		(Keys, runs, resets, save state slots) and reads its memory. Only this user gets to, nobody can
+		connect before listen() anyway.
+	*/
+	if ((chmod(m_path, 0600) != 0) || (listen(m_control->m_listener, M_CONTROL_CLIENTS) != 0))
+	{
+		m_log("Could not listen on %s: %s", m_path, strerror(errno));
+		close(m_control->m_listener);
+		unlink(m_path);
+		free(m_control->m_path);
+		free(m_control);
+		return NULL;
+	}
+
+	fcntl(m_control->m_listener, F_SETFL, fcntl(m_control->m_listener, F_GETFL) | O_NONBLOCK);
+
+	return m_control;
+}
+
+static void m_control_disconnect(cchip8_control *m_control, size_t m_index)
+{
+	close(m_control->m_clients[m_index]->m_fd);
+	free(m_control->m_clients[m_index]);
+	m_control->m_clients[m_index] = NULL;
+}
+
+void cchip8_control_destroy(cchip8_control *m_control)
+{
+	if (m_control == NULL)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < M_CONTROL_CLIENTS; i++)
+	{
+		if (m_control->m_clients[i] != NULL)
+		{
+			m_control_disconnect(m_control, i);
+		}
+	}
+
+	for (size_t i = 0; i < CCHIP8_CONTROL_SLOTS; i++)
+	{
+		cchip8_state_destroy(m_control->m_slots[i]);
+	}
+
+	close(m_control->m_listener);
+	unlink(m_control->m_path);
+	free(m_control->m_path);
+	free(m_control);
+}
+
+void cchip8_control_key_handler(cchip8_control *m_control, void (*m_handler)(void *m_user, uint8_t m_key, bool m_down), void *m_user)
+{
+	m_control->m_keyhandler = m_handler;
+	m_control->m_keyuser = m_user;
+}
+
+static void m_control_accept(cchip8_control *m_control)
+{
+	for (size_t i = 0; i < M_CONTROL_CLIENTS; i++)
+	{
+		if (m_control->m_clients[i] != NULL)
+		{
+			continue;
+		}
+
+		int m_fd = accept(m_control->m_listener, NULL, NULL);
+
+		if (m_fd < 0)
+		{
+			return;
+		}
+
+		m_control->m_clients[i] = malloc(sizeof(m_control_client));
+
+		if (m_control->m_clients[i] == NULL)
+		{
+			close(m_fd);
+			return;
+		}
+
+		fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+		m_control->m_clients[i]->m_fd = m_fd;
+		m_control->m_clients[i]->m_inputlength = 0;
+		m_control->m_clients[i]->m_outputstart = 0;
+		m_control->m_clients[i]->m_outputlength = 0;
+	}
+}
+
+/*
+	Run the complete requests in m_client's input while the largest reply still fits its output.
+	Returns how many ran, -1 if the client broke the framing.
+*/
+static int m_control_process(cchip8_control *m_control, m_control_client *m_client)
+{
+	size_t m_offset = 0;
+	int m_count = 0;
+
+	// Move pending replies to the front, so the free room is one piece
+	if (m_client->m_outputstart != 0)
+	{
+		memmove(m_client->m_output, &m_client->m_output[m_client->m_outputstart], m_client->m_outputlength);
+		m_client->m_outputstart = 0;
+	}
+
+	while ((m_client->m_inputlength - m_offset) >= M_CONTROL_HEADER)
+	{
+		const uint8_t *m_request = &m_client->m_input[m_offset];
+		uint16_t m_size = m_control_get16(m_request + 2);
+
+		if (m_size > CCHIP8_CONTROL_MAX_PAYLOAD)
+		{
+			return -1;
+		}
+
+		if (((m_client->m_inputlength - m_offset) < (size_t) (M_CONTROL_HEADER + m_size)) ||
+			((M_CONTROL_BUFFER - m_client->m_outputlength) < M_CONTROL_FRAME))
+		{
+			break;
+		}
+
+		uint8_t *m_reply = &m_client->m_output[m_client->m_outputlength];
+		uint16_t m_length = 0;
+
+		m_reply[0] = m_request[0];
+		m_reply[1] = m_control_execute(m_control, m_request[0], m_request[1], m_request + M_CONTROL_HEADER, m_size,
+			m_reply + M_CONTROL_HEADER, &m_length);
+		m_control_put16(m_reply + 2, m_length);
+
+		m_client->m_outputlength += M_CONTROL_HEADER + m_length;
+		m_offset += M_CONTROL_HEADER + m_size;
+		m_count++;
+	}
+
+	// Keep the partial request for the next read
+	memmove(m_client->m_input, &m_client->m_input[m_offset], m_client->m_inputlength - m_offset);
+	m_client->m_inputlength -= m_offset;
+
+	return m_count;
+}
+
+// Write as much of the pending replies as the socket takes right now, false if the client went away
+static bool m_control_flush(m_control_client *m_client)
+{
+	while (m_client->m_outputlength != 0)
+	{
+		ssize_t m_written = send(m_client->m_fd, &m_client->m_output[m_client->m_outputstart], m_client->m_outputlength, M_CONTROL_SEND_FLAGS);
+
+		if (m_written < 0)
+		{
+			return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+		}
+
+		m_client->m_outputstart += (size_t) m_written;
+		m_client->m_outputlength -= (size_t) m_written;
+	}
+
+	m_client->m_outputstart = 0;
+
+	return true;
+}
+
+// Read what's there and answer it, false if the client went away or broke the framing
+static bool m_control_serve_client(cchip8_control *m_control, m_control_client *m_client, int *m_count)
+{
+	// A full input buffer waits for replies to drain first (recv() would report 0 bytes, like a hang up)
+	if (m_client->m_inputlength < M_CONTROL_BUFFER)
+	{
+		ssize_t m_read = recv(m_client->m_fd, &m_client->m_input[m_client->m_inputlength], M_CONTROL_BUFFER - m_client->m_inputlength, 0);
+
+		if (m_read == 0)
+		{
+			return false;
+		}
+
+		if ((m_read < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+		{
+			return false;
+		}
+
+		if (m_read > 0)
+		{
+			m_client->m_inputlength += (size_t) m_read;
+		}
+	}
+
+	/*
+		Replies go out as soon as they're ready. Requests left waiting on a full output buffer run once
+		it drained, right away if the socket took everything, or when poll() says it's writable again.
+	*/
+	int m_ran = 0;
+
+	do
+	{
+		m_ran = m_control_process(m_control, m_client);
+
+		if (m_ran < 0)
+		{
+			return false;
+		}
+
+		*m_count += m_ran;
+
+		if (m_control_flush(m_client) == false)
+		{
+			return false;
+		}
+	} while ((m_ran > 0) && (m_client->m_outputlength == 0));
+
+	return true;
+}
+
+int cchip8_control_serve(cchip8_control *m_control, int m_milliseconds)
+{
+	struct pollfd m_fds[M_CONTROL_CLIENTS + 1];
+	int m_count = 0;
+
+	m_fds[0] = (struct pollfd) { .fd = -1, .events = POLLIN, .revents = 0 };
+
+	for (size_t i = 0; i < M_CONTROL_CLIENTS; i++)
+	{
+		m_control_client *m_client = m_control->m_clients[i];
+
+		/*
+			The listener only gets watched while there's a free slot: m_control_accept leaves pending
+			connections in the backlog when they're all taken, and the listener would stay readable,
+			turning every poll() into a busy loop until a client leaves.
+		*/
+		if (m_client == NULL)
+		{
+			m_fds[0].fd = m_control->m_listener;
+		}
+
+		// Unused slots get a negative descriptor, which poll() skips
+		m_fds[i + 1] = (struct pollfd) { .fd = -1, .events = 0, .revents = 0 };
+
+		if (m_client != NULL)
+		{
+			m_fds[i + 1].fd = m_client->m_fd;
+			m_fds[i + 1].events = (short) (((m_client->m_inputlength < M_CONTROL_BUFFER) ? POLLIN : 0) | ((m_client->m_outputlength != 0) ? POLLOUT : 0));
+		}
+	}
+
+	if (poll(m_fds, M_CONTROL_CLIENTS + 1, m_milliseconds) < 0)
+	{
+		return (errno == EINTR) ? 0 : -1;
+	}
+
+	for (size_t i = 0; i < M_CONTROL_CLIENTS; i++)
+	{
+		m_control_client *m_client = m_control->m_clients[i];
+
+		if ((m_client == NULL) || (m_fds[i + 1].revents == 0))
+		{
+			continue;
+		}
+
+		if (m_control_serve_client(m_control, m_client, &m_count) == false)
+		{
+			m_control_disconnect(m_control, i);
+		}
+	}
+
+	if (m_fds[0].revents & POLLIN)
+	{
+		m_control_accept(m_control);
+	} else if (m_fds[0].revents != 0)
+	{
+		return -1;
+	}
+
+	return m_count;
+}
+
+cchip8_client *cchip8_client_connect(const char *m_path)
+{
+	struct sockaddr_un m_address;
+
+	if (m_control_address(&m_address, m_path) == false)
+	{
+		return NULL;
+	}
+
+	cchip8_client *m_client = calloc(1, sizeof(cchip8_client));
+
+	if (m_client == NULL)
+	{
+		return NULL;
+	}
+
+	m_client->m_outputcapacity = M_CLIENT_BATCH + M_CONTROL_FRAME;
+	m_client->m_inputcapacity = M_CONTROL_BUFFER;
+	m_client->m_output = malloc(m_client->m_outputcapacity);
+	m_client->m_input = malloc(m_client->m_inputcapacity);
+	m_client->m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if ((m_client->m_output == NULL) || (m_client->m_input == NULL) || (m_client->m_fd < 0) ||
+		(connect(m_client->m_fd, (struct sockaddr *) &m_address, sizeof(m_address)) != 0))
+	{
+		cchip8_client_close(m_client);
+		return NULL;
+	}
+
+	return m_client;
+}
+
+void cchip8_client_close(cchip8_client *m_client)
+{
+	if (m_client == NULL)
+	{
+		return;
+	}
+
+	if (m_client->m_fd >= 0)
+	{
+		close(m_client->m_fd);
+	}
+
+	free(m_client->m_output);
+	free(m_client->m_input);
+	free(m_client);
+}
+
+// Read whatever replies arrived, growing the buffer so a long pipeline never has to wait on us
+static bool m_client_read(cchip8_client *m_client)
+{
+	if (m_client->m_inputstart != 0)
+	{
+		memmove(m_client->m_input, &m_client->m_input[m_client->m_inputstart], m_client->m_inputlength - m_client->m_inputstart);
+		m_client->m_inputlength -= m_client->m_inputstart;
+		m_client->m_inputstart = 0;
+	}
+
+	if ((m_client->m_inputcapacity - m_client->m_inputlength) < M_CONTROL_FRAME)
+	{
+		uint8_t *m_input = realloc(m_client->m_input, m_client->m_inputcapacity * 2);
+
+		if (m_input == NULL)
+		{
+			return false;
+		}
+
+		m_client->m_input = m_input;
+		m_client->m_inputcapacity *= 2;
+	}
+
+	ssize_t m_read = recv(m_client->m_fd, &m_client->m_input[m_client->m_inputlength], m_client->m_inputcapacity - m_client->m_inputlength, 0);
+
+	if (m_read <= 0)
+	{
+		return (m_read < 0) && (errno == EINTR);
+	}
+
+	m_client->m_inputlength += (size_t) m_read;
+
+	return true;
+}
+
+/*
+	Send every queued request. The server stops reading once its reply buffer is full, so while
+	we're blocked on sending we keep reading replies too, otherwise both sides would wait forever.
+*/
+static bool m_client_flush(cchip8_client *m_client)
+{
+	size_t m_sent = 0;
+
+	while (m_sent < m_client->m_outputlength)
+	{
+		struct pollfd m_fd = { .fd = m_client->m_fd, .events = POLLIN | POLLOUT, .revents = 0 };
+
+		if (poll(&m_fd, 1, -1) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		if ((m_fd.revents & POLLIN) && (m_client_read(m_client) == false))
+		{
+			return false;
+		}
+
+		if (m_fd.revents & POLLOUT)
+		{
+			ssize_t m_written = send(m_client->m_fd, &m_client->m_output[m_sent], m_client->m_outputlength - m_sent,
+				M_CONTROL_SEND_FLAGS | MSG_DONTWAIT);
+
+			if ((m_written < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+			{
+				return false;
+			}
+
+			m_sent += (m_written > 0) ? (size_t) m_written : 0;
+		} else if ((m_fd.revents & POLLIN) == 0)
+		{
+			// Hung up or errored
+			return false;
+		}
+	}
+
+	m_client->m_outputlength = 0;
+
+	return true;
+}
+
+bool cchip8_client_send(cchip8_client *m_client, uint8_t m_command, uint8_t m_argument, const void *m_payload, uint16_t m_length)
+{
+	if (m_length > CCHIP8_CONTROL_MAX_PAYLOAD)
+	{
+		return false;
+	}
+
+	uint8_t *m_request = &m_client->m_output[m_client->m_outputlength];
+
+	m_request[0] = m_command;
+	m_request[1] = m_argument;
+	m_control_put16(m_request + 2, m_length);
+
+	if (m_length != 0)
+	{
+		memcpy(m_request + M_CONTROL_HEADER, m_payload, m_length);
+	}
+
+	m_client->m_outputlength += M_CONTROL_HEADER + m_length;
+
+	// The batch always keeps room for one more whole request
+	if (m_client->m_outputlength >= M_CLIENT_BATCH)
+	{
+		return m_client_flush(m_client);
+	}
+
+	return true;
+}
+
+bool cchip8_client_receive(cchip8_client *m_client, cchip8_reply *m_reply)
+{
+	m_client->m_inputstart += m_client->m_consumed;
+	m_client->m_consumed = 0;
+
+	if ((m_client->m_outputlength != 0) && (m_client_flush(m_client) == false))
+	{
+		return false;
+	}
+
+	while (true)
+	{
+		size_t m_available = m_client->m_inputlength - m_client->m_inputstart;
+		const uint8_t *m_frame = &m_client->m_input[m_client->m_inputstart];
+
+		if ((m_available >= M_CONTROL_HEADER) && (m_available >= (size_t) (M_CONTROL_HEADER + m_control_get16(m_frame + 2))))
+		{
+			m_reply->m_command = m_frame[0];
+			m_reply->m_status = m_frame[1];
+			m_reply->m_length = m_control_get16(m_frame + 2);
+			m_reply->m_payload = m_frame + M_CONTROL_HEADER;
+
+			m_client->m_consumed = M_CONTROL_HEADER + m_reply->m_length;
+			return true;
+		}
+
+		if (m_client_read(m_client) == false)
+		{
+			return false;
+		}
+	}
+}
+
+#else
+
+// No Unix domain sockets, no control socket
+cchip8_control *cchip8_control_create(cchip8 *m_vm, const char *m_path)
+{
+	(void) m_vm;
+	(void) m_path;
+	return NULL;
+}
+
+void cchip8_control_destroy(cchip8_control *m_control)
+{
+	(void) m_control;
+}
+
+void cchip8_control_key_handler(cchip8_control *m_control, void (*m_handler)(void *m_user, uint8_t m_key, bool m_down), void *m_user)
+{
+	(void) m_control;
+	(void) m_handler;
+	(void) m_user;
+}
+
+int cchip8_control_serve(cchip8_control *m_control, int m_milliseconds)
+{
+	(void) m_control;
+	(void) m_milliseconds;
+	return -1;
+}
+
+cchip8_client *cchip8_client_connect(const char *m_path)
+{
+	(void) m_path;
+	return NULL;
+}
+
+void cchip8_client_close(cchip8_client *m_client)
+{
+	(void) m_client;
+}
+
+bool cchip8_client_send(cchip8_client *m_client, uint8_t m_command, uint8_t m_argument, const void *m_payload, uint16_t m_length)
+{
+	(void) m_client;
+	(void) m_command;
+	(void) m_argument;
+	(void) m_payload;
+	(void) m_length;
+	return false;
+}
+
+bool cchip8_client_receive(cchip8_client *m_client, cchip8_reply *m_reply)
+{
+	(void) m_client;
+	(void) m_reply;
+	return false;
+}
+
+#endif
+
+bool cchip8_client_decode_observation(const cchip8_reply *m_reply, cchip8_observation *m_observation)
+{
+	const uint8_t *m_bytes = m_reply->m_payload;
+
+	if ((m_reply->m_command != CCHIP8_CONTROL_OBSERVE) || (m_reply->m_status != CCHIP8_CONTROL_OK) ||
+		(m_reply->m_length != CCHIP8_OBSERVATION_SIZE))
+	{
+		return false;
+	}
+
+	m_observation->m_cycles = m_control_get64(m_bytes);
+	m_observation->m_programcounter = m_control_get16(m_bytes + 8);
+	m_observation->m_index = m_control_get16(m_bytes + 10);
+	m_observation->m_keys = m_control_get16(m_bytes + 12);
+	memcpy(m_observation->m_registers, m_bytes + 14, 16);
+	m_observation->m_stackp = m_bytes[30];
+	m_observation->m_delaytimer = m_bytes[31];
+	m_observation->m_soundtimer = m_bytes[32];
+	m_observation->m_fault = m_bytes[33];
+
+	for (size_t m_row = 0; m_row < CHIP8_ROWS; m_row++)
+	{
+		m_observation->m_display[m_row] = m_control_get64(m_bytes + 34 + (m_row * 8));
+	}
+
+	return true;
+}
+
+// Synchronous request, m_reply receives the reply to it (False if the connection is gone or the request failed)
+static bool m_client_call(cchip8_client *m_client, uint8_t m_command, uint8_t m_argument, const void *m_payload, uint16_t m_length,
+	cchip8_reply *m_reply)
+{
+	if ((cchip8_client_send(m_client, m_command, m_argument, m_payload, m_length) == false) ||
+		(cchip8_client_receive(m_client, m_reply) == false))
+	{
+		return false;
+	}
+
+	return (m_reply->m_command == m_command) && (m_reply->m_status == CCHIP8_CONTROL_OK);
+}
+
+bool cchip8_client_load_rom(cchip8_client *m_client, const uint8_t *m_rom, uint16_t m_size)
+{
+	cchip8_reply m_reply;
+
+	return m_client_call(m_client, CCHIP8_CONTROL_LOAD_ROM, 0, m_rom, m_size, &m_reply);
+}
+
+bool cchip8_client_reset(cchip8_client *m_client)
+{
+	cchip8_reply m_reply;
+
+	return m_client_call(m_client, CCHIP8_CONTROL_RESET, 0, NULL, 0, &m_reply);
+}
+
+bool cchip8_client_key(cchip8_client *m_client, uint8_t m_key, bool m_down)
+{
+	cchip8_reply m_reply;
+
+	return m_client_call(m_client, CCHIP8_CONTROL_KEY, (uint8_t) ((m_key & 0x0F) | (m_down ? 0x80 : 0x00)), NULL, 0, &m_reply);
+}
+
+bool cchip8_client_run_frames(cchip8_client *m_client, uint32_t m_frames, enum cchip8_status *m_status)
+{
+	cchip8_reply m_reply;
+	uint8_t m_payload[4] = { (uint8_t) m_frames, (uint8_t) (m_frames >> 8), (uint8_t) (m_frames >> 16), (uint8_t) (m_frames >> 24) };
+
+	if ((m_client_call(m_client, CCHIP8_CONTROL_RUN_FRAMES, 0, m_payload, sizeof(m_payload), &m_reply) == false) || (m_reply.m_length != 9))
+	{
+		return false;
+	}
+
+	if (m_status != NULL)
+	{
+		*m_status = (enum cchip8_status) m_reply.m_payload[0];
+	}
+
+	return true;
+}
+
+bool cchip8_client_save_state(cchip8_client *m_client, uint8_t m_slot)
+{
+	cchip8_reply m_reply;
+
+	return m_client_call(m_client, CCHIP8_CONTROL_SAVE_STATE, m_slot, NULL, 0, &m_reply);
+}
+
+bool cchip8_client_load_state(cchip8_client *m_client, uint8_t m_slot)
+{
+	cchip8_reply m_reply;
+
+	return m_client_call(m_client, CCHIP8_CONTROL_LOAD_STATE, m_slot, NULL, 0, &m_reply);
+}
+
+bool cchip8_client_read_memory(cchip8_client *m_client, uint16_t m_address, uint8_t *m_buffer, uint16_t m_length)
+{
+	cchip8_reply m_reply;
+	uint8_t m_payload[4] = { (uint8_t) m_address, (uint8_t) (m_address >> 8), (uint8_t) m_length, (uint8_t) (m_length >> 8) };
+
+	if ((m_client_call(m_client, CCHIP8_CONTROL_READ_MEMORY, 0, m_payload, sizeof(m_payload), &m_reply) == false) ||
+		(m_reply.m_length != m_length))
+	{
+		return false;
+	}
+
+	memcpy(m_buffer, m_reply.m_payload, m_length);
+
+	return true;
+}
+
+bool cchip8_client_observe(cchip8_client *m_client, cchip8_observation *m_observation)
+{
+	cchip8_reply m_reply;
+
+	if (m_client_call(m_client, CCHIP8_CONTROL_OBSERVE, 0, NULL, 0, &m_reply) == false)
+	{
+		return false;
+	}
+
+	return cchip8_client_decode_observation(&m_reply, m_observation);
+}
@@ -0,0 +1,321 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "include/cchip8_corpus.h"
+
+#include <dirent.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+// Upper bound for the thread pool, more than this only adds contention on the file system
+#define M_CORPUS_MAX_THREADS 256
+
+static bool m_corpus_push(m_corpus *m_corpus, const char *m_path)
+{
+	if (m_corpus->m_count == m_corpus->m_capacity)
+	{
+		size_t m_capacity = (m_corpus->m_capacity == 0) ? 64 : (m_corpus->m_capacity * 2);
+		char **m_paths = realloc(m_corpus->m_paths, m_capacity * sizeof(char *));
+
+		if (m_paths == NULL)
+		{
+			printf("Couldn't allocate memory\n");
+			return false;
+		}
+
+		m_corpus->m_paths = m_paths;
+		m_corpus->m_capacity = m_capacity;
+	}
+
+	char *m_copy = malloc(strlen(m_path) + 1);
+
+	if (m_copy == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		return false;
+	}
+
+	strcpy(m_copy, m_path);
+	m_corpus->m_paths[m_corpus->m_count++] = m_copy;
+
+	return true;
+}
+
+static bool m_corpus_wanted(const char *m_name, const char *const *m_extensions)
+{
+	size_t m_length = strlen(m_name);
+
+	for (size_t i = 0; m_extensions[i] != NULL; i++)
+	{
+		size_t m_extlength = strlen(m_extensions[i]);
+
+		if ((m_length > m_extlength) && (strcmp(&m_name[m_length - m_extlength], m_extensions[i]) == 0))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool m_corpus_walk(m_corpus *m_corpus, const char *m_directory, const char *const *m_extensions)
+{
+	DIR *m_dir = opendir(m_directory);
+
+	if (m_dir == NULL)
+	{
+		printf("Could not open %s\n", m_directory);
+		return false;
+	}
+
+	bool m_ok = true;
+	struct dirent *m_entry;
+
+	while ((m_ok == true) && ((m_entry = readdir(m_dir)) != NULL))
+	{
+		if (m_entry->d_name[0] == '.')
+		{
+			continue;
+		}
+
+		size_t m_length = strlen(m_directory) + strlen(m_entry->d_name) + 2;
+		char *m_path = malloc(m_length);
+
+		if (m_path == NULL)
+		{
+			printf("Couldn't allocate memory\n");
+			m_ok = false;
+			break;
+		}
+
+		snprintf(m_path, m_length, "%s/%s", m_directory, m_entry->d_name);
+
+		struct stat m_info;
+
+		if (stat(m_path, &m_info) == 0)
+		{
+			if (S_ISDIR(m_info.st_mode))
+			{
+				m_ok = m_corpus_walk(m_corpus, m_path, m_extensions);
+			} else if (S_ISREG(m_info.st_mode) && m_corpus_wanted(m_entry->d_name, m_extensions))
+			{
+				m_ok = m_corpus_push(m_corpus, m_path);
+			}
+		}
+
+		free(m_path);
+	}
+
+	closedir(m_dir);
+
+	return m_ok;
+}
+
+static int m_corpus_compare(const void *m_a, const void *m_b)
+{
+	return strcmp(*(char *const *) m_a, *(char *const *) m_b);
+}
+
+bool m_corpus_add(m_corpus *m_corpus, const char *m_path, const char *const *m_extensions)
+{
+	struct stat m_info;
+
+	if (stat(m_path, &m_info) != 0)
+	{
+		printf("Could not open %s\n", m_path);
+		return false;
+	}
+
+	if (S_ISDIR(m_info.st_mode) == false)
+	{
+		return m_corpus_push(m_corpus, m_path);
+	}
+
+	size_t m_first = m_corpus->m_count;
+
+	if (m_corpus_walk(m_corpus, m_path, m_extensions) == false)
+	{
+		return false;
+	}
+
+	// Nothing matched, m_paths may still be NULL and qsort must not see it
+	if (m_corpus->m_count == m_first)
+	{
+		return true;
+	}
+
+	// readdir order depends on the file system, sort so reports come out the same everywhere
+	qsort(&m_corpus->m_paths[m_first], m_corpus->m_count - m_first, sizeof(char *), m_corpus_compare);
+
+	return true;
+}
+
+void m_corpus_free(m_corpus *m_corpus)
+{
+	for (size_t i = 0; i < m_corpus->m_count; i++)
+	{
+		free(m_corpus->m_paths[i]);
+	}
+
+	free(m_corpus->m_paths);
+
+	m_corpus->m_paths = NULL;
+	m_corpus->m_count = 0;
+	m_corpus->m_capacity = 0;
+}
+
+bool m_corpus_is_directory(const char *m_path)
+{
+	struct stat m_info;
+
+	return (stat(m_path, &m_info) == 0) && S_ISDIR(m_info.st_mode);
+}
+
+size_t m_corpus_threads(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	long m_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (m_cpus < 1)
+	{
+		return 1;
+	}
+
+	return (m_cpus > M_CORPUS_MAX_THREADS) ? M_CORPUS_MAX_THREADS : (size_t) m_cpus;
+#else
+	// No thread pool on other platforms, m_corpus_for runs everything on the calling thread
+	return 1;
+#endif
+}
+
+// State shared by the pool, m_next is the only thing the threads write
+typedef struct chip8_corpus_pool
+{
+	size_t m_count;
+	m_corpus_item m_job;
+	void *m_context;
+	atomic_size_t m_next;
+
+} m_corpus_pool;
+
+typedef struct chip8_corpus_worker
+{
+	m_corpus_pool *m_pool;
+	size_t m_index;
+
+#if defined(__unix__) || defined(__APPLE__)
+	pthread_t m_thread;
+#endif
+
+} m_corpus_worker;
+
+static void *m_corpus_worker_main(void *m_argument)
+{
+	m_corpus_worker *m_worker = m_argument;
+	m_corpus_pool *m_pool = m_worker->m_pool;
+
+	for (;;)
+	{
+		size_t m_item = atomic_fetch_add_explicit(&m_pool->m_next, 1, memory_order_relaxed);
+
+		if (m_item >= m_pool->m_count)
+		{
+			return NULL;
+		}
+
+		m_pool->m_job(m_pool->m_context, m_worker->m_index, m_item);
+	}
+}
+
+void m_corpus_for(size_t m_count, size_t m_threads, m_corpus_item m_job, void *m_context)
+{
+	if (m_threads == 0)
+	{
+		m_threads = m_corpus_threads();
+	}
+
+	if (m_threads > M_CORPUS_MAX_THREADS)
+	{
+		m_threads = M_CORPUS_MAX_THREADS;
+	}
+
+	m_corpus_pool m_pool = { .m_count = m_count, .m_job = m_job, .m_context = m_context };
+	atomic_init(&m_pool.m_next, 0);
+
+#if defined(__unix__) || defined(__APPLE__)
+	m_corpus_worker m_workers[M_CORPUS_MAX_THREADS];
+	size_t m_started = 0;
+
+	// Worker 0 is the calling thread, whatever couldn't be started is simply picked up by the others
+	for (size_t i = 1; i < m_threads; i++)
+	{
+		m_workers[m_started].m_pool = &m_pool;
+		m_workers[m_started].m_index = i;
+
+		if (pthread_create(&m_workers[m_started].m_thread, NULL, m_corpus_worker_main, &m_workers[m_started]) != 0)
+		{
+			break;
+		}
+
+		m_started++;
+	}
+#endif
+
+	m_corpus_worker m_self = { .m_pool = &m_pool, .m_index = 0 };
+	m_corpus_worker_main(&m_self);
+
+#if defined(__unix__) || defined(__APPLE__)
+	for (size_t i = 0; i < m_started; i++)
+	{
+		pthread_join(m_workers[i].m_thread, NULL);
+	}
+#endif
+}
+
+// m_corpus_run is m_corpus_for over the file list
+typedef struct chip8_corpus_files
+{
+	const m_corpus *m_corpus;
+	m_corpus_job m_job;
+	void *m_context;
+
+} m_corpus_files;
+
+static void m_corpus_file(void *m_context, size_t m_worker, size_t m_item)
+{
+	m_corpus_files *m_files = m_context;
+
+	m_files->m_job(m_files->m_context, m_worker, m_files->m_corpus->m_paths[m_item]);
+}
+
+void m_corpus_run(const m_corpus *m_corpus, size_t m_threads, m_corpus_job m_job, void *m_context)
+{
+	m_corpus_files m_files = { .m_corpus = m_corpus, .m_job = m_job, .m_context = m_context };
+
+	m_corpus_for(m_corpus->m_count, m_threads, m_corpus_file, &m_files);
+}
+
+bool m_corpus_output(char *m_output, size_t m_size, const char *m_directory, const char *m_input, const char *m_extension)
+{
+	const char *m_slash = strrchr(m_input, '/');
+	const char *m_base = (m_slash != NULL) ? (m_slash + 1) : m_input;
+	const char *m_dot = strrchr(m_base, '.');
+	size_t m_stem = ((m_dot != NULL) && (m_dot != m_base)) ? (size_t) (m_dot - m_base) : strlen(m_base);
+	int m_length;
+
+	if (m_directory != NULL)
+	{
+		m_length = snprintf(m_output, m_size, "%s/%.*s%s", m_directory, (int) m_stem, m_base, m_extension);
+	} else {
+		m_length = snprintf(m_output, m_size, "%.*s%s", (int) ((m_base - m_input) + m_stem), m_input, m_extension);
+	}
+
+	return (m_length > 0) && ((size_t) m_length < m_size);
+}
@@ -0,0 +1,291 @@
+// shm_open() and syscall() are POSIX/GNU, -std=c2x hides them otherwise
+#define _GNU_SOURCE
+
+#include "include/cchip8_export.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+struct cchip8_export
+{
+	// The mapped segment, and the name it gets unlinked under
+	m_export_segment *m_segment;
+	char *m_name;
+
+	// Writer side of the view living in the segment
+	m_view_writer m_writer;
+};
+
+struct cchip8_monitor
+{
+	m_export_segment *m_segment;
+};
+
+#if defined(__linux__)
+
+// glibc has no wrapper for futex(2), the words are process-shared so no FUTEX_PRIVATE_FLAG
+static long m_export_futex(_Atomic uint32_t *m_word, int m_op, uint32_t m_value, const struct timespec *m_timeout)
+{
+	return syscall(SYS_futex, m_word, m_op, m_value, m_timeout, NULL, 0);
+}
+
+cchip8_export *cchip8_export_create(const char *m_name)
+{
+	cchip8_export *m_export = m_aligned_alloc(sizeof(cchip8_export));
+
+	if (m_export == NULL)
+	{
+		return NULL;
+	}
+
+	m_export->m_name = malloc(strlen(m_name) + 1);
+
+	if (m_export->m_name == NULL)
+	{
+		m_aligned_free(m_export);
+		return NULL;
+	}
+
+	// Only this user's processes get to watch
+	int m_fd = shm_open(m_name, O_CREAT | O_RDWR, 0600);
+
+	if (m_fd < 0)
+	{
+		m_log("Could not create the shared memory segment %s", m_name);
+		free(m_export->m_name);
+		m_aligned_free(m_export);
+		return NULL;
+	}
+
+	// From here on the name exists, every failure has to unlink it again
+	if (ftruncate(m_fd, sizeof(m_export_segment)) != 0)
+	{
+		m_log("Could not size the shared memory segment %s", m_name);
+		close(m_fd);
+		shm_unlink(m_name);
+		free(m_export->m_name);
+		m_aligned_free(m_export);
+		return NULL;
+	}
+
+	m_export->m_segment = mmap(NULL, sizeof(m_export_segment), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+
+	// The mapping keeps the segment alive, the descriptor isn't needed anymore
+	close(m_fd);
+
+	if (m_export->m_segment == MAP_FAILED)
+	{
+		m_log("Could not map the shared memory segment %s", m_name);
+		shm_unlink(m_name);
+		free(m_export->m_name);
+		m_aligned_free(m_export);
+		return NULL;
+	}
+
+	strcpy(m_export->m_name, m_name);
+
+	m_export_segment *m_segment = m_export->m_segment;
+
+	// A segment left behind by a previous run gets taken over, readers see it as not ready until the magic is back
+	atomic_store(&m_segment->m_magic, 0);
+
+	m_segment->m_version = CCHIP8_EXPORT_VERSION;
+	m_segment->m_size = sizeof(m_export_segment);
+	m_segment->m_snapshotsize = sizeof(cchip8_snapshot);
+	atomic_store(&m_segment->m_frame, 0);
+	atomic_store(&m_segment->m_waiters, 0);
+
+	m_view_init(&m_segment->m_view, &m_export->m_writer);
+
+	atomic_store(&m_segment->m_magic, CCHIP8_EXPORT_MAGIC);
+
+	return m_export;
+}
+
+void cchip8_export_destroy(cchip8_export *m_export)
+{
+	if (m_export == NULL)
+	{
+		return;
+	}
+
+	m_export_segment *m_segment = m_export->m_segment;
+
+	// Monitors still mapping it find the magic gone, the sleeping ones get woken up to notice
+	atomic_store(&m_segment->m_magic, 0);
+	atomic_fetch_add(&m_segment->m_frame, 1);
+	m_export_futex(&m_segment->m_frame, FUTEX_WAKE, INT_MAX, NULL);
+
+	munmap(m_segment, sizeof(m_export_segment));
+	shm_unlink(m_export->m_name);
+	free(m_export->m_name);
+	m_aligned_free(m_export);
+}
+
+void m_export_publish(cchip8_export *m_export, const m_chip8 *chip8)
+{
+	m_export_segment *m_segment = m_export->m_segment;
+
+	m_view_update(&m_segment->m_view, &m_export->m_writer, chip8);
+
+	/*
+		Bump the frame counter, then look for sleepers. Readers register before checking the counter
+		one last time (And the futex checks it again atomically), so with both sides sequentially
+		consistent either we see them waiting or they see the new frame. No sleeper, no system call.
+	*/
+	atomic_fetch_add(&m_segment->m_frame, 1);
+
+	if (atomic_load(&m_segment->m_waiters) != 0)
+	{
+		m_export_futex(&m_segment->m_frame, FUTEX_WAKE, INT_MAX, NULL);
+	}
+}
+
+cchip8_monitor *cchip8_monitor_open(const char *m_name)
+{
+	int m_fd = shm_open(m_name, O_RDWR, 0);
+
+	if (m_fd < 0)
+	{
+		return NULL;
+	}
+
+	struct stat m_stat;
+	m_export_segment *m_segment = MAP_FAILED;
+
+	// A segment from another layout (Or still being sized) isn't ours to read
+	if ((fstat(m_fd, &m_stat) == 0) && (m_stat.st_size == (off_t) sizeof(m_export_segment)))
+	{
+		m_segment = mmap(NULL, sizeof(m_export_segment), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	}
+
+	close(m_fd);
+
+	if (m_segment == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	if ((m_segment->m_version != CCHIP8_EXPORT_VERSION) || (m_segment->m_snapshotsize != sizeof(cchip8_snapshot)))
+	{
+		munmap(m_segment, sizeof(m_export_segment));
+		return NULL;
+	}
+
+	cchip8_monitor *m_monitor = malloc(sizeof(cchip8_monitor));
+
+	if (m_monitor == NULL)
+	{
+		munmap(m_segment, sizeof(m_export_segment));
+		return NULL;
+	}
+
+	m_monitor->m_segment = m_segment;
+
+	return m_monitor;
+}
+
+void cchip8_monitor_close(cchip8_monitor *m_monitor)
+{
+	if (m_monitor == NULL)
+	{
+		return;
+	}
+
+	munmap(m_monitor->m_segment, sizeof(m_export_segment));
+	free(m_monitor);
+}
+
+uint32_t cchip8_monitor_wait(cchip8_monitor *m_monitor, uint32_t m_frame, uint32_t m_milliseconds)
+{
+	m_export_segment *m_segment = m_monitor->m_segment;
+	struct timespec m_timeout = { .tv_sec = m_milliseconds / 1000, .tv_nsec = (long) (m_milliseconds % 1000) * 1000000 };
+
+	if (atomic_load(&m_segment->m_frame) != m_frame)
+	{
+		return atomic_load(&m_segment->m_frame);
+	}
+
+	// Register first, then sleep only if the counter still holds m_frame (See m_export_publish)
+	atomic_fetch_add(&m_segment->m_waiters, 1);
+	m_export_futex(&m_segment->m_frame, FUTEX_WAIT, m_frame, &m_timeout);
+	atomic_fetch_sub(&m_segment->m_waiters, 1);
+
+	return atomic_load(&m_segment->m_frame);
+}
+
+bool cchip8_monitor_read(const cchip8_monitor *m_monitor, cchip8_snapshot *m_snapshot)
+{
+	const m_export_segment *m_segment = m_monitor->m_segment;
+
+	if (atomic_load(&m_segment->m_magic) != CCHIP8_EXPORT_MAGIC)
+	{
+		return false;
+	}
+
+	if (m_view_load(&m_segment->m_view, m_snapshot) == false)
+	{
+		// Odd for good: whoever exported it stopped in the middle of a publish
+		if ((atomic_load(&m_segment->m_view.m_sequence) & 1) != 0)
+		{
+			m_log("The exported machine stopped while publishing, its snapshot can't be read");
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+#else
+
+// No futexes, no export (The segment could be shared, but readers would have to poll)
+cchip8_export *cchip8_export_create(const char *m_name)
+{
+	(void) m_name;
+	return NULL;
+}
+
+void cchip8_export_destroy(cchip8_export *m_export)
+{
+	(void) m_export;
+}
+
+void m_export_publish(cchip8_export *m_export, const m_chip8 *chip8)
+{
+	(void) m_export;
+	(void) chip8;
+}
+
+cchip8_monitor *cchip8_monitor_open(const char *m_name)
+{
+	(void) m_name;
+	return NULL;
+}
+
+void cchip8_monitor_close(cchip8_monitor *m_monitor)
+{
+	(void) m_monitor;
+}
+
+uint32_t cchip8_monitor_wait(cchip8_monitor *m_monitor, uint32_t m_frame, uint32_t m_milliseconds)
+{
+	(void) m_monitor;
+	(void) m_milliseconds;
+	return m_frame;
+}
+
+bool cchip8_monitor_read(const cchip8_monitor *m_monitor, cchip8_snapshot *m_snapshot)
+{
+	(void) m_monitor;
+	(void) m_snapshot;
+	return false;
+}
+
+#endif
@@ -0,0 +1,326 @@
+#include "include/cchip8_filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes handled together, 32 fill an AVX2 register (Two SSE2 ones without -march=native)
+#define M_FILTER_LANES 32
+
+// GCC vector extensions, like the batch interpreter's
+typedef uint8_t m_vec8 __attribute__((vector_size(M_FILTER_LANES)));
+typedef uint16_t m_vec16 __attribute__((vector_size(M_FILTER_LANES * 2)));
+typedef uint32_t m_vecpixels __attribute__((vector_size(M_FILTER_LANES * 4)));
+typedef uint32_t m_vec32 __attribute__((vector_size(32)));
+
+#define m_load8(src) ({ m_vec8 m_vec; memcpy(&m_vec, (src), sizeof(m_vec)); m_vec; })
+#define m_store8(dst, vec) ({ m_vec8 m_out = (vec); memcpy((dst), &m_out, sizeof(m_out)); })
+#define m_load32(src) ({ m_vec32 m_vec; memcpy(&m_vec, (src), sizeof(m_vec)); m_vec; })
+#define m_store32(dst, vec) ({ m_vec32 m_out = (vec); memcpy((dst), &m_out, sizeof(m_out)); })
+
+// Lanes of m_a where m_mask is set (All ones), m_b elsewhere
+#define m_select(mask, a, b) ({ m_vec8 m_lanes = (m_vec8) (mask); (m_lanes & (a)) | (~m_lanes & (b)); })
+
+// Display with a one pixel border repeating the edges, so the scalers' neighbour loads never need a check
+#define M_FILTER_PAD (CCHIP8_WIDTH + 2)
+
+// A long stall decays everything that's going to anyway, no point looping further
+#define M_FILTER_MAX_DECAY 64
+
+bool m_filter_init(m_filter *m_filter, m_scaler m_scaler, uint32_t m_scale, uint8_t m_persistence, bool m_scanlines)
+{
+	memset(m_filter, 0, sizeof(*m_filter));
+
+	m_scale = (m_scale / m_scaler) * m_scaler;
+
+	m_filter->m_scaler = m_scaler;
+	m_filter->m_persistence = m_persistence;
+	m_filter->m_scanlines = m_scanlines;
+	m_filter->m_factor = (m_scale == 0) ? 1 : (m_scale / m_scaler);
+	m_filter->m_width = CCHIP8_WIDTH * m_scaler * m_filter->m_factor;
+	m_filter->m_height = CCHIP8_HEIGHT * m_scaler * m_filter->m_factor;
+
+	m_filter->m_scaled = malloc((size_t) CCHIP8_WIDTH * CCHIP8_HEIGHT * m_scaler * m_scaler);
+
+	// The plain row and its scanline version side by side
+	m_filter->m_row = malloc(2 * (((size_t) m_filter->m_width * sizeof(uint32_t)) + M_FILTER_SLACK));
+	m_filter->m_output = calloc((size_t) m_filter->m_width * m_filter->m_height, sizeof(uint32_t));
+
+	if ((m_filter->m_scaled == NULL) || (m_filter->m_row == NULL) || (m_filter->m_output == NULL))
+	{
+		m_filter_destroy(m_filter);
+		return false;
+	}
+
+	// Grey ramp from the background to the pixel color (Black to white like the plain texture)
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		m_filter->m_palette[i] = 0xFF000000 | (i << 16) | (i << 8) | i;
+	}
+
+	return true;
+}
+
+// Lit pixels go to full intensity, the others lose m_persistence/256 of theirs per step
+static void m_filter_phosphor(m_filter *m_filter, const uint32_t *m_display, uint32_t m_steps)
+{
+	m_vec8 m_fading = { 0 };
+
+	if (m_steps > M_FILTER_MAX_DECAY)
+	{
+		m_steps = M_FILTER_MAX_DECAY;
+	}
+
+	for (size_t i = 0; i < (CCHIP8_WIDTH * CCHIP8_HEIGHT); i += M_FILTER_LANES)
+	{
+		m_vecpixels m_pixels;
+		memcpy(&m_pixels, &m_display[i], sizeof(m_pixels));
+
+		m_vec8 m_lit = __builtin_convertvector(m_pixels != 0, m_vec8);
+		m_vec8 m_glow = m_lit;
+
+		if (m_filter->m_persistence != 0)
+		{
+			m_glow = m_load8(&m_filter->m_glow[i]);
+
+			for (uint32_t m_step = 0; m_step < m_steps; m_step++)
+			{
+				m_glow = __builtin_convertvector((__builtin_convertvector(m_glow, m_vec16) * m_filter->m_persistence) >> 8, m_vec8);
+			}
+
+			// Lit lanes are all ones, so OR is the brighter of the two
+			m_glow |= m_lit;
+			m_fading |= (m_vec8) ((m_glow != 0) & (m_glow != 255));
+		}
+
+		m_store8(&m_filter->m_glow[i], m_glow);
+	}
+
+	uint64_t m_words[M_FILTER_LANES / 8];
+	memcpy(m_words, &m_fading, sizeof(m_words));
+
+	m_filter->m_fading = false;
+
+	for (size_t i = 0; i < (M_FILTER_LANES / 8); i++)
+	{
+		m_filter->m_fading |= (m_words[i] != 0);
+	}
+}
+
+static void m_filter_pad(const uint8_t *m_glow, uint8_t *m_pad)
+{
+	for (int y = -1; y <= CCHIP8_HEIGHT; y++)
+	{
+		int m_source = (y < 0) ? 0 : ((y >= CCHIP8_HEIGHT) ? (CCHIP8_HEIGHT - 1) : y);
+		const uint8_t *m_in = &m_glow[m_source * CCHIP8_WIDTH];
+		uint8_t *m_out = &m_pad[(y + 1) * M_FILTER_PAD];
+
+		m_out[0] = m_in[0];
+		memcpy(&m_out[1], m_in, CCHIP8_WIDTH);
+		m_out[CCHIP8_WIDTH + 1] = m_in[CCHIP8_WIDTH - 1];
+	}
+}
+
+/*
+	Scale2x, every pixel E becomes 2x2 from its neighbours:
+		  B        E0 E1
+		D E F  ->  E2 E3
+		  H
+	A corner takes the neighbours' value where they meet in an edge the others don't continue.
+*/
+static void m_filter_scale2x(m_filter *m_filter, const uint8_t *m_pad)
+{
+	const size_t m_stride = CCHIP8_WIDTH * 2;
+
+	for (size_t y = 0; y < CCHIP8_HEIGHT; y++)
+	{
+		const uint8_t *m_up = &m_pad[y * M_FILTER_PAD];
+		const uint8_t *m_mid = m_up + M_FILTER_PAD;
+		const uint8_t *m_down = m_mid + M_FILTER_PAD;
+		uint8_t *m_out = &m_filter->m_scaled[y * 2 * m_stride];
+
+		for (size_t x = 0; x < CCHIP8_WIDTH; x += M_FILTER_LANES)
+		{
+			m_vec8 B = m_load8(&m_up[x + 1]);
+			m_vec8 D = m_load8(&m_mid[x]);
+			m_vec8 E = m_load8(&m_mid[x + 1]);
+			m_vec8 F = m_load8(&m_mid[x + 2]);
+			m_vec8 H = m_load8(&m_down[x + 1]);
+
+			uint8_t m_corners[4][M_FILTER_LANES];
+
+			m_store8(m_corners[0], m_select((D == B) & (B != F) & (D != H), D, E));
+			m_store8(m_corners[1], m_select((B == F) & (B != D) & (F != H), F, E));
+			m_store8(m_corners[2], m_select((D == H) & (D != B) & (H != F), D, E));
+			m_store8(m_corners[3], m_select((H == F) & (D != H) & (B != F), F, E));
+
+			for (size_t i = 0; i < M_FILTER_LANES; i++)
+			{
+				m_out[(2 * (x + i)) + 0] = m_corners[0][i];
+				m_out[(2 * (x + i)) + 1] = m_corners[1][i];
+				m_out[m_stride + (2 * (x + i)) + 0] = m_corners[2][i];
+				m_out[m_stride + (2 * (x + i)) + 1] = m_corners[3][i];
+			}
+		}
+	}
+}
+
+/*
+	Scale3x, every pixel E becomes 3x3 from all eight neighbours:
+		A B C      E0 E1 E2
+		D E F  ->  E3 E4 E5
+		G H I      E6 E7 E8
+*/
+static void m_filter_scale3x(m_filter *m_filter, const uint8_t *m_pad)
+{
+	const size_t m_stride = CCHIP8_WIDTH * 3;
+
+	for (size_t y = 0; y < CCHIP8_HEIGHT; y++)
+	{
+		const uint8_t *m_up = &m_pad[y * M_FILTER_PAD];
+		const uint8_t *m_mid = m_up + M_FILTER_PAD;
+		const uint8_t *m_down = m_mid + M_FILTER_PAD;
+		uint8_t *m_out = &m_filter->m_scaled[y * 3 * m_stride];
+
+		for (size_t x = 0; x < CCHIP8_WIDTH; x += M_FILTER_LANES)
+		{
+			m_vec8 A = m_load8(&m_up[x]);
+			m_vec8 B = m_load8(&m_up[x + 1]);
+			m_vec8 C = m_load8(&m_up[x + 2]);
+			m_vec8 D = m_load8(&m_mid[x]);
+			m_vec8 E = m_load8(&m_mid[x + 1]);
+			m_vec8 F = m_load8(&m_mid[x + 2]);
+			m_vec8 G = m_load8(&m_down[x]);
+			m_vec8 H = m_load8(&m_down[x + 1]);
+			m_vec8 I = m_load8(&m_down[x + 2]);
+
+			// The four edge conditions of Scale2x, the rest only refines them
+			m_vec8 m_topleft = (m_vec8) ((D == B) & (B != F) & (D != H));
+			m_vec8 m_topright = (m_vec8) ((B == F) & (B != D) & (F != H));
+			m_vec8 m_bottomleft = (m_vec8) ((D == H) & (D != B) & (H != F));
+			m_vec8 m_bottomright = (m_vec8) ((H == F) & (D != H) & (B != F));
+
+			uint8_t m_cells[9][M_FILTER_LANES];
+
+			m_store8(m_cells[0], m_select(m_topleft, D, E));
+			m_store8(m_cells[1], m_select((m_topleft & (m_vec8) (E != C)) | (m_topright & (m_vec8) (E != A)), B, E));
+			m_store8(m_cells[2], m_select(m_topright, F, E));
+			m_store8(m_cells[3], m_select((m_topleft & (m_vec8) (E != G)) | (m_bottomleft & (m_vec8) (E != A)), D, E));
+			m_store8(m_cells[4], E);
+			m_store8(m_cells[5], m_select((m_topright & (m_vec8) (E != I)) | (m_bottomright & (m_vec8) (E != C)), F, E));
+			m_store8(m_cells[6], m_select(m_bottomleft, D, E));
+			m_store8(m_cells[7], m_select((m_bottomleft & (m_vec8) (E != I)) | (m_bottomright & (m_vec8) (E != G)), H, E));
+			m_store8(m_cells[8], m_select(m_bottomright, F, E));
+
+			for (size_t i = 0; i < M_FILTER_LANES; i++)
+			{
+				for (size_t m_row = 0; m_row < 3; m_row++)
+				{
+					uint8_t *m_cell = &m_out[(m_row * m_stride) + (3 * (x + i))];
+
+					m_cell[0] = m_cells[(m_row * 3) + 0][i];
+					m_cell[1] = m_cells[(m_row * 3) + 1][i];
+					m_cell[2] = m_cells[(m_row * 3) + 2][i];
+				}
+			}
+		}
+	}
+}
+
+/*
+	Every scaler pixel becomes m_factor x m_factor output pixels: one row gets expanded with vector
+	stores of the pixel's color (Whole vectors, the next pixel overwrites what spilled over), the
+	output rows are copies of it. With scanlines the bottom quarter of every block (At least one
+	row) is a copy darkened to half.
+*/
+static void m_filter_expand(m_filter *m_filter)
+{
+	const uint32_t m_columns = CCHIP8_WIDTH * m_filter->m_scaler;
+	const uint32_t m_rows = CCHIP8_HEIGHT * m_filter->m_scaler;
+	const uint32_t m_factor = m_filter->m_factor;
+	const size_t m_width = m_filter->m_width;
+
+	uint32_t m_dark = 0;
+
+	if (m_filter->m_scanlines && (m_factor >= 2))
+	{
+		m_dark = (m_factor < 8) ? 1 : (m_factor / 4);
+	}
+
+	uint32_t *m_plain = m_filter->m_row;
+	uint32_t *m_shaded = m_plain + m_width + (M_FILTER_SLACK / sizeof(uint32_t));
+
+	for (uint32_t r = 0; r < m_rows; r++)
+	{
+		const uint8_t *m_source = &m_filter->m_scaled[(size_t) r * m_columns];
+		uint32_t *m_out = &m_filter->m_output[(size_t) r * m_factor * m_width];
+
+		for (uint32_t x = 0; x < m_columns; x++)
+		{
+			m_vec32 m_color = (m_vec32) { 0 } + m_filter->m_palette[m_source[x]];
+			uint32_t *m_block = &m_plain[(size_t) x * m_factor];
+
+			for (uint32_t j = 0; j < m_factor; j += 8)
+			{
+				m_store32(&m_block[j], m_color);
+			}
+		}
+
+		if (m_dark != 0)
+		{
+			// Output widths are multiples of 64, whole vectors
+			for (size_t x = 0; x < m_width; x += 8)
+			{
+				m_vec32 m_pixels = m_load32(&m_plain[x]);
+
+				m_store32(&m_shaded[x], ((m_pixels >> 1) & 0x007F7F7F) | 0xFF000000);
+			}
+		}
+
+		for (uint32_t i = 0; i < m_factor; i++)
+		{
+			memcpy(&m_out[i * m_width], (i < (m_factor - m_dark)) ? m_plain : m_shaded, m_width * sizeof(uint32_t));
+		}
+	}
+}
+
+bool m_filter_run(m_filter *m_filter, const uint32_t *m_display, bool m_changed, uint32_t m_frames)
+{
+	if ((m_changed == false) && ((m_filter->m_fading == false) || (m_frames == 0)))
+	{
+		return false;
+	}
+
+	// A debugger stepping through the program still sees erased pixels fade
+	m_filter_phosphor(m_filter, m_display, (m_frames == 0) ? 1 : m_frames);
+
+	if (m_filter->m_scaler == M_SCALER_NEAREST)
+	{
+		memcpy(m_filter->m_scaled, m_filter->m_glow, sizeof(m_filter->m_glow));
+	} else {
+		uint8_t m_pad[(CCHIP8_HEIGHT + 2) * M_FILTER_PAD];
+
+		m_filter_pad(m_filter->m_glow, m_pad);
+
+		if (m_filter->m_scaler == M_SCALER_SCALE2X)
+		{
+			m_filter_scale2x(m_filter, m_pad);
+		} else {
+			m_filter_scale3x(m_filter, m_pad);
+		}
+	}
+
+	m_filter_expand(m_filter);
+
+	return true;
+}
+
+void m_filter_destroy(m_filter *m_filter)
+{
+	free(m_filter->m_scaled);
+	free(m_filter->m_row);
+	free(m_filter->m_output);
+
+	m_filter->m_scaled = NULL;
+	m_filter->m_row = NULL;
+	m_filter->m_output = NULL;
+}
@@ -0,0 +1,148 @@
+#include "include/cchip8_fusion.h"
+
+static const char *m_fusion_names[M_FUSE_KINDS] = {
+	"none",
+	"6XNN;6YNN",
+	"ANNN;DXYN",
+	"ANNN;FX65",
+	"7XNN;3YNN;1NNN"
+};
+
+// Amount of instructions each fusion covers
+static const uint8_t m_fusion_lengths[M_FUSE_KINDS] = { 1, 2, 2, 2, 3 };
+
+m_code *m_code_create(m_chip8 *chip8)
+{
+	// Don't leak a previously attached cache
+	m_code_destroy(chip8);
+
+	// calloc leaves every entry with m_length = 0 (Undecoded)
+	m_code *m_cache = calloc(1, sizeof(m_code));
+
+	if (m_cache == NULL)
+	{
+		m_log("Couldn't allocate the predecode cache");
+		return NULL;
+	}
+
+	chip8->m_code = m_cache;
+
+	return m_cache;
+}
+
+void m_code_destroy(m_chip8 *chip8)
+{
+	free(chip8->m_code);
+	chip8->m_code = NULL;
+}
+
+static inline uint16_t m_code_fetch(const uint8_t *m_memory, uint16_t m_address)
+{
+	return (m_memory[m_address] << 8) | m_memory[m_address + 1];
+}
+
+/*
+	Decode the instruction at m_address and look ahead for a fusable sequence.
+	Every sequence we fuse only contains instructions the interpreter implements,
+	so the fused handlers can never run into an unimplemented opcode halfway.
+*/
+void m_code_decode(m_code *m_cache, const uint8_t *m_memory, uint16_t m_address)
+{
+	m_decoded *m_entry = &m_cache->m_entries[m_address];
+
+	uint16_t m_first = m_code_fetch(m_memory, m_address);
+	uint16_t m_second = (m_address + 3 < FOURKiB) ? m_code_fetch(m_memory, m_address + 2) : 0;
+	uint16_t m_third = (m_address + 5 < FOURKiB) ? m_code_fetch(m_memory, m_address + 4) : 0;
+
+	enum m_fusion m_fusion = M_FUSE_NONE;
+
+	if (((m_first & 0xF000) == 0x7000) && ((m_second & 0xF000) == 0x3000) && ((m_third & 0xF000) == 0x1000))
+	{
+		m_fusion = M_FUSE_ADD_SKIP_JMP;
+	} else if (((m_first & 0xF000) == 0x6000) && ((m_second & 0xF000) == 0x6000))
+	{
+		m_fusion = M_FUSE_LD_LD;
+	} else if (((m_first & 0xF000) == 0xA000) && ((m_second & 0xF000) == 0xD000))
+	{
+		m_fusion = M_FUSE_LDI_DRW;
+	} else if (((m_first & 0xF000) == 0xA000) && ((m_second & 0xF0FF) == 0xF065))
+	{
+		m_fusion = M_FUSE_LDI_LOAD;
+	}
+
+	m_entry->m_opcodes[0] = m_first;
+	m_entry->m_opcodes[1] = m_second;
+	m_entry->m_opcodes[2] = m_third;
+	m_entry->m_fusion = m_fusion;
+	m_entry->m_length = m_fusion_lengths[m_fusion];
+
+	m_code_count_site(m_cache, m_address, m_fusion);
+}
+
+void m_code_count_site(m_code *m_cache, uint16_t m_address, uint8_t m_fusion)
+{
+	uint8_t m_bit = (uint8_t) (1u << m_fusion);
+
+	if ((m_fusion == M_FUSE_NONE) || ((m_cache->m_detected[m_address] & m_bit) != 0))
+	{
+		return;
+	}
+
+	m_cache->m_detected[m_address] |= m_bit;
+	m_cache->m_sites[m_fusion]++;
+}
+
+/*
+	A fused entry spans up to 3 instructions (6 bytes), so a write at m_address can
+	affect entries starting up to 5 bytes before it.
+*/
+void m_code_invalidate(m_code *m_cache, uint16_t m_address, uint16_t m_length)
+{
+	int32_t m_start = (int32_t) m_address - 5;
+	int32_t m_end = (int32_t) m_address + m_length;
+
+	if (m_start < 0)
+	{
+		m_start = 0;
+	}
+
+	// Stores wrap around the end of memory, so flush the wrapped bytes too
+	if (m_end > FOURKiB)
+	{
+		for (int32_t i = 0; i < m_end - FOURKiB; i++)
+		{
+			m_cache->m_entries[i].m_length = 0;
+		}
+
+		m_end = FOURKiB;
+	}
+
+	for (int32_t i = m_start; i < m_end; i++)
+	{
+		m_cache->m_entries[i].m_length = 0;
+	}
+}
+
+void m_code_print_stats(const m_code *m_cache, uint64_t m_cycles, FILE *m_out)
+{
+	uint64_t m_saved = 0;
+
+	fprintf(m_out, "Superinstruction statistics:\n");
+
+	for (int i = M_FUSE_NONE + 1; i < M_FUSE_KINDS; i++)
+	{
+		uint64_t m_kindsaved = m_cache->m_saved[i];
+
+		fprintf(m_out, "  %-16s %6llu sites %12llu fired %12llu dispatches saved\n", m_fusion_names[i],
+			(unsigned long long) m_cache->m_sites[i], (unsigned long long) m_cache->m_fired[i],
+			(unsigned long long) m_kindsaved);
+
+		m_saved += m_kindsaved;
+	}
+
+	if (m_cycles > 0)
+	{
+		fprintf(m_out, "  %llu instructions in %llu dispatches (%.2f%% fewer)\n", (unsigned long long) m_cycles,
+			(unsigned long long) (m_cycles - m_saved), (100.0 * (double) m_saved) / (double) m_cycles);
+	}
+}
@@ -0,0 +1,199 @@
+#include "include/cchip8_hud.h"
+
+// Open the HUD font, the overlay starts hidden
+bool m_hud_init(m_hud *m_overlay, const char *m_fontpath)
+{
+	memset(m_overlay, 0, sizeof(*m_overlay));
+
+	if (TTF_Init() != 0)
+	{
+		printf("Could not initialize SDL2_ttf: %s\n", TTF_GetError());
+		return false;
+	}
+
+	m_overlay->m_font = TTF_OpenFont(m_fontpath, M_HUD_FONT_SIZE);
+
+	if (m_overlay->m_font == NULL)
+	{
+		printf("Could not open HUD font %s: %s\n", m_fontpath, TTF_GetError());
+		TTF_Quit();
+		return false;
+	}
+
+	m_overlay->m_windowstart = SDL_GetPerformanceCounter();
+
+	return true;
+}
+
+uint64_t m_hud_account(m_hud *m_overlay, enum m_hud_phase m_phase, uint64_t m_start)
+{
+	uint64_t m_now = SDL_GetPerformanceCounter();
+
+	m_overlay->m_phaseticks[m_phase] += m_now - m_start;
+
+	return m_now;
+}
+
+// Start a new measurement window, dropping whatever was counted so far
+void m_hud_restart(m_hud *m_overlay, uint64_t m_now)
+{
+	memset(m_overlay->m_phaseticks, 0, sizeof(m_overlay->m_phaseticks));
+	m_overlay->m_instructions = 0;
+	m_overlay->m_frames = 0;
+	m_overlay->m_windowstart = m_now;
+}
+
+/*
+	Latch the measured values every M_HUD_REFRESH_MS milliseconds and re-render the lines whose
+	text actually changed. Rendering text with SDL2_ttf is expensive, doing it every frame would
+	distort the very numbers the HUD is showing.
+*/
+bool m_hud_update(m_hud *m_overlay, SDL_Renderer *m_renderer, const cchip8 *m_vm)
+{
+	uint64_t m_now = SDL_GetPerformanceCounter();
+	uint64_t m_freq = SDL_GetPerformanceFrequency();
+	uint64_t m_elapsed = m_now - m_overlay->m_windowstart;
+
+	if ((m_elapsed * 1000) < (m_freq * M_HUD_REFRESH_MS))
+	{
+		return false;
+	}
+
+	double m_seconds = (double) m_elapsed / (double) m_freq;
+	double m_frames = (m_overlay->m_frames > 0) ? (double) m_overlay->m_frames : 1.0;
+	double m_tickms = 1000.0 / (double) m_freq;
+
+	char m_lines[M_HUD_LINES][M_HUD_LINE_LENGTH];
+	cchip8_registers m_registers;
+
+	cchip8_get_registers(m_vm, &m_registers);
+
+	snprintf(m_lines[0], M_HUD_LINE_LENGTH, "IPS: %.0f", (double) m_overlay->m_instructions / m_seconds);
+	snprintf(m_lines[1], M_HUD_LINE_LENGTH, "Frame: %.2f ms (%.1f FPS)", (m_seconds * 1000.0) / m_frames, m_overlay->m_frames / m_seconds);
+	snprintf(m_lines[2], M_HUD_LINE_LENGTH, "Exec %.3f / Poll %.3f / Render %.3f ms",
+		m_overlay->m_phaseticks[M_HUD_EXEC] * m_tickms / m_frames,
+		m_overlay->m_phaseticks[M_HUD_POLL] * m_tickms / m_frames,
+		m_overlay->m_phaseticks[M_HUD_RENDER] * m_tickms / m_frames);
+	snprintf(m_lines[3], M_HUD_LINE_LENGTH, "PC: 0x%03X  I: 0x%03X  SP: %u", m_registers.m_programcounter, m_registers.m_index, m_registers.m_stackp);
+	snprintf(m_lines[4], M_HUD_LINE_LENGTH, "DT: %3u  ST: %3u", m_registers.m_delaytimer, m_registers.m_soundtimer);
+
+	m_runahead *m_ahead = m_overlay->m_runahead;
+	double m_real = 0.0;
+	double m_shown = 0.0;
+
+	if ((m_ahead == NULL) || (m_ahead->m_frames == 0))
+	{
+		snprintf(m_lines[5], M_HUD_LINE_LENGTH, "Run-ahead: off");
+	} else {
+		double m_runs = (m_ahead->m_runs > 0) ? (double) m_ahead->m_runs : 1.0;
+		double m_snapshotus = m_ahead->m_snapshotticks * m_tickms * 1000.0 / m_runs;
+
+		if (m_runahead_latency(m_ahead, &m_real, &m_shown))
+		{
+			snprintf(m_lines[5], M_HUD_LINE_LENGTH, "Ahead %u: %.1f us/state, lag %.1f -> %.1f fr (-%.0f ms)", m_ahead->m_frames,
+				m_snapshotus, m_real, m_shown, (m_real - m_shown) * (1000.0 / CHIP8_FRAMERATE));
+		} else {
+			snprintf(m_lines[5], M_HUD_LINE_LENGTH, "Ahead %u: %.1f us/state, lag not measured yet", m_ahead->m_frames, m_snapshotus);
+		}
+
+		m_ahead->m_snapshotticks = 0;
+		m_ahead->m_aheadticks = 0;
+		m_ahead->m_runs = 0;
+	}
+
+	m_hud_restart(m_overlay, m_now);
+
+	bool m_changed = false;
+
+	for (int i = 0; i < M_HUD_LINES; i++)
+	{
+		if ((m_overlay->m_textures[i] != NULL) && (strcmp(m_overlay->m_text[i], m_lines[i]) == 0))
+		{
+			continue;
+		}
+
+		SDL_Surface *m_surface = TTF_RenderText_Blended(m_overlay->m_font, m_lines[i], (SDL_Color) { 0x00, 0xFF, 0x00, 0xFF });
+
+		if (m_surface == NULL)
+		{
+			continue;
+		}
+
+		if (m_overlay->m_textures[i] != NULL)
+		{
+			SDL_DestroyTexture(m_overlay->m_textures[i]);
+		}
+
+		m_overlay->m_textures[i] = SDL_CreateTextureFromSurface(m_renderer, m_surface);
+		m_overlay->m_widths[i] = m_surface->w;
+		m_overlay->m_heights[i] = m_surface->h;
+
+		SDL_FreeSurface(m_surface);
+
+		memcpy(m_overlay->m_text[i], m_lines[i], M_HUD_LINE_LENGTH);
+		m_changed = true;
+	}
+
+	return m_changed;
+}
+
+// Blit the cached line textures on top of a translucent backdrop
+void m_hud_draw(m_hud *m_overlay, SDL_Renderer *m_renderer)
+{
+	if (m_overlay->m_visible == false)
+	{
+		return;
+	}
+
+	SDL_Rect m_backdrop = { 0, 0, 0, 4 };
+
+	for (int i = 0; i < M_HUD_LINES; i++)
+	{
+		if (m_overlay->m_widths[i] + 8 > m_backdrop.w)
+		{
+			m_backdrop.w = m_overlay->m_widths[i] + 8;
+		}
+
+		m_backdrop.h += m_overlay->m_heights[i];
+	}
+
+	SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(m_renderer, 0x00, 0x00, 0x00, 0xB0);
+	SDL_RenderFillRect(m_renderer, &m_backdrop);
+
+	int m_y = 2;
+
+	for (int i = 0; i < M_HUD_LINES; i++)
+	{
+		if (m_overlay->m_textures[i] == NULL)
+		{
+			continue;
+		}
+
+		SDL_Rect m_dst = { 4, m_y, m_overlay->m_widths[i], m_overlay->m_heights[i] };
+		SDL_RenderCopy(m_renderer, m_overlay->m_textures[i], NULL, &m_dst);
+		m_y += m_overlay->m_heights[i];
+	}
+
+	// Restore the clear colour used by the emulator output
+	SDL_SetRenderDrawColor(m_renderer, 0x00, 0x00, 0x00, 0xFF);
+}
+
+void m_hud_destroy(m_hud *m_overlay)
+{
+	for (int i = 0; i < M_HUD_LINES; i++)
+	{
+		if (m_overlay->m_textures[i] != NULL)
+		{
+			SDL_DestroyTexture(m_overlay->m_textures[i]);
+			m_overlay->m_textures[i] = NULL;
+		}
+	}
+
+	if (m_overlay->m_font != NULL)
+	{
+		TTF_CloseFont(m_overlay->m_font);
+		m_overlay->m_font = NULL;
+		TTF_Quit();
+	}
+}
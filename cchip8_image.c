@@ -0,0 +1,539 @@
+#include "include/cchip8_image.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool m_image_create(m_image *m_image, uint32_t m_width, uint32_t m_height)
+{
+	m_image->m_width = m_width;
+	m_image->m_height = m_height;
+	m_image->m_pixels = calloc((size_t) m_width * m_height, 1);
+
+	return m_image->m_pixels != NULL;
+}
+
+void m_image_free(m_image *m_image)
+{
+	free(m_image->m_pixels);
+	m_image->m_pixels = NULL;
+}
+
+void m_image_fill(m_image *m_image, uint32_t m_scale, uint32_t m_column, uint32_t m_row, uint8_t m_index)
+{
+	for (uint32_t y = 0; y < m_scale; y++)
+	{
+		memset(&m_image->m_pixels[(((size_t) m_row * m_scale + y) * m_image->m_width) + ((size_t) m_column * m_scale)], m_index, m_scale);
+	}
+}
+
+/*
+	PNG:
+	Rows are filtered with Up when they repeat the previous one (All zeroes then) and left alone
+	otherwise, and the deflate stream only uses run matches (Distance 1) with the fixed Huffman
+	codes. Integer upscaled pictures are nothing but runs, so that's about as good as zlib -9.
+*/
+
+typedef struct chip8_png_bits
+{
+	uint8_t *m_data;
+	size_t m_size;
+	uint32_t m_buffer;
+	uint32_t m_count;
+
+} m_png_bits;
+
+// Deflate packs values least significant bit first
+static void m_png_put(m_png_bits *m_bits, uint32_t m_value, uint32_t m_count)
+{
+	m_bits->m_buffer |= m_value << m_bits->m_count;
+	m_bits->m_count += m_count;
+
+	while (m_bits->m_count >= 8)
+	{
+		m_bits->m_data[m_bits->m_size++] = (uint8_t) m_bits->m_buffer;
+		m_bits->m_buffer >>= 8;
+		m_bits->m_count -= 8;
+	}
+}
+
+// ...and Huffman codes most significant bit first
+static void m_png_code(m_png_bits *m_bits, uint32_t m_code, uint32_t m_length)
+{
+	uint32_t m_reversed = 0;
+
+	for (uint32_t i = 0; i < m_length; i++)
+	{
+		m_reversed |= ((m_code >> i) & 1) << (m_length - 1 - i);
+	}
+
+	m_png_put(m_bits, m_reversed, m_length);
+}
+
+// Fixed Huffman literal/length code
+static void m_png_symbol(m_png_bits *m_bits, uint32_t m_symbol)
+{
+	if (m_symbol < 144)
+	{
+		m_png_code(m_bits, 0x30 + m_symbol, 8);
+	} else if (m_symbol < 256)
+	{
+		m_png_code(m_bits, 0x190 + (m_symbol - 144), 9);
+	} else if (m_symbol < 280)
+	{
+		m_png_code(m_bits, m_symbol - 256, 7);
+	} else {
+		m_png_code(m_bits, 0xC0 + (m_symbol - 280), 8);
+	}
+}
+
+static const uint16_t m_png_lengthbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t m_png_lengthextra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+// Repeat the previous byte m_length (3-258) times
+static void m_png_run(m_png_bits *m_bits, uint32_t m_length)
+{
+	uint32_t m_code = 28;
+
+	while (m_png_lengthbase[m_code] > m_length)
+	{
+		m_code--;
+	}
+
+	m_png_symbol(m_bits, 257 + m_code);
+	m_png_put(m_bits, m_length - m_png_lengthbase[m_code], m_png_lengthextra[m_code]);
+
+	// Distance code 0 (Distance 1), 5 bits
+	m_png_code(m_bits, 0, 5);
+}
+
+static uint32_t m_png_crctable[256];
+
+static uint32_t m_png_crc(uint32_t m_crc, const uint8_t *m_data, size_t m_size)
+{
+	if (m_png_crctable[1] == 0)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t m_value = i;
+
+			for (int k = 0; k < 8; k++)
+			{
+				m_value = (m_value & 1) ? (0xEDB88320u ^ (m_value >> 1)) : (m_value >> 1);
+			}
+
+			m_png_crctable[i] = m_value;
+		}
+	}
+
+	m_crc = ~m_crc;
+
+	for (size_t i = 0; i < m_size; i++)
+	{
+		m_crc = m_png_crctable[(m_crc ^ m_data[i]) & 0xFF] ^ (m_crc >> 8);
+	}
+
+	return ~m_crc;
+}
+
+static void m_png_be32(uint8_t *m_bytes, uint32_t m_value)
+{
+	m_bytes[0] = (uint8_t) (m_value >> 24);
+	m_bytes[1] = (uint8_t) (m_value >> 16);
+	m_bytes[2] = (uint8_t) (m_value >> 8);
+	m_bytes[3] = (uint8_t) m_value;
+}
+
+static bool m_png_chunk(FILE *m_file, const char *m_type, const uint8_t *m_data, uint32_t m_size)
+{
+	uint8_t m_header[8];
+	uint8_t m_trailer[4];
+
+	m_png_be32(m_header, m_size);
+	memcpy(&m_header[4], m_type, 4);
+	m_png_be32(m_trailer, m_png_crc(m_png_crc(0, (const uint8_t *) m_type, 4), m_data, m_size));
+
+	return (fwrite(m_header, 1, 8, m_file) == 8) && (fwrite(m_data, 1, m_size, m_file) == m_size) && (fwrite(m_trailer, 1, 4, m_file) == 4);
+}
+
+bool m_image_write_png(const m_image *m_image, const m_color *m_palette, size_t m_colors, const char *m_filename)
+{
+	size_t m_stride = (size_t) m_image->m_width + 1;
+	size_t m_rawsize = m_stride * m_image->m_height;
+
+	// Filtered rows, then the zlib stream (Literals take at most 9 bits, plus header, trailer and slack)
+	uint8_t *m_raw = malloc(m_rawsize);
+	m_png_bits m_bits = { .m_data = malloc(((m_rawsize * 9) / 8) + 64), .m_size = 0, .m_buffer = 0, .m_count = 0 };
+
+	if ((m_raw == NULL) || (m_bits.m_data == NULL))
+	{
+		free(m_raw);
+		free(m_bits.m_data);
+		return false;
+	}
+
+	for (uint32_t y = 0; y < m_image->m_height; y++)
+	{
+		const uint8_t *m_row = &m_image->m_pixels[(size_t) y * m_image->m_width];
+		uint8_t *m_out = &m_raw[y * m_stride];
+
+		if ((y != 0) && (memcmp(m_row, m_row - m_image->m_width, m_image->m_width) == 0))
+		{
+			m_out[0] = 2;
+			memset(&m_out[1], 0, m_image->m_width);
+		} else {
+			m_out[0] = 0;
+			memcpy(&m_out[1], m_row, m_image->m_width);
+		}
+	}
+
+	// zlib header (Deflate, 32 KiB window, no dictionary), then one final fixed Huffman block
+	m_bits.m_data[m_bits.m_size++] = 0x78;
+	m_bits.m_data[m_bits.m_size++] = 0x01;
+	m_png_put(&m_bits, 1, 1);
+	m_png_put(&m_bits, 1, 2);
+
+	for (size_t i = 0; i < m_rawsize;)
+	{
+		m_png_symbol(&m_bits, m_raw[i]);
+
+		size_t m_run = 0;
+
+		while (((i + 1 + m_run) < m_rawsize) && (m_raw[i + 1 + m_run] == m_raw[i]) && (m_run < 258))
+		{
+			m_run++;
+		}
+
+		if (m_run >= 3)
+		{
+			m_png_run(&m_bits, (uint32_t) m_run);
+		} else {
+			for (size_t k = 0; k < m_run; k++)
+			{
+				m_png_symbol(&m_bits, m_raw[i]);
+			}
+		}
+
+		i += 1 + m_run;
+	}
+
+	m_png_symbol(&m_bits, 256);
+	m_png_put(&m_bits, 0, 7);
+
+	uint32_t m_a = 1;
+	uint32_t m_b = 0;
+
+	for (size_t i = 0; i < m_rawsize; i++)
+	{
+		m_a = (m_a + m_raw[i]) % 65521;
+		m_b = (m_b + m_a) % 65521;
+	}
+
+	m_png_be32(&m_bits.m_data[m_bits.m_size], (m_b << 16) | m_a);
+	m_bits.m_size += 4;
+
+	// 8 bit paletted
+	uint8_t m_header[13] = { 0, 0, 0, 0, 0, 0, 0, 0, 8, 3, 0, 0, 0 };
+	uint8_t m_plte[256 * 3];
+
+	m_png_be32(&m_header[0], m_image->m_width);
+	m_png_be32(&m_header[4], m_image->m_height);
+
+	for (size_t i = 0; i < m_colors; i++)
+	{
+		m_plte[(i * 3) + 0] = m_palette[i].m_red;
+		m_plte[(i * 3) + 1] = m_palette[i].m_green;
+		m_plte[(i * 3) + 2] = m_palette[i].m_blue;
+	}
+
+	FILE *m_file = fopen(m_filename, "wb");
+	bool m_ok = (m_file != NULL) && (fwrite("\x89PNG\r\n\x1A\n", 1, 8, m_file) == 8) &&
+		m_png_chunk(m_file, "IHDR", m_header, sizeof(m_header)) &&
+		m_png_chunk(m_file, "PLTE", m_plte, (uint32_t) (m_colors * 3)) &&
+		m_png_chunk(m_file, "IDAT", m_bits.m_data, (uint32_t) m_bits.m_size) &&
+		m_png_chunk(m_file, "IEND", NULL, 0);
+
+	if ((m_file != NULL) && (fclose(m_file) != 0))
+	{
+		m_ok = false;
+	}
+
+	if (m_ok == false)
+	{
+		printf("Could not write %s\n", m_filename);
+	}
+
+	free(m_raw);
+	free(m_bits.m_data);
+
+	return m_ok;
+}
+
+/*
+	GIF:
+	Plain LZW over the palette indices with a trie for the dictionary (One child per index),
+	cleared whenever its 4096 codes are used up.
+*/
+
+typedef struct chip8_gif_bits
+{
+	FILE *m_file;
+	uint8_t m_block[256];
+	uint32_t m_buffer;
+	uint32_t m_count;
+
+} m_gif_bits;
+
+// Codes are packed least significant bit first into sub-blocks of up to 255 bytes
+static void m_gif_put(m_gif_bits *m_bits, uint32_t m_code, uint32_t m_size)
+{
+	m_bits->m_buffer |= m_code << m_bits->m_count;
+	m_bits->m_count += m_size;
+
+	while (m_bits->m_count >= 8)
+	{
+		m_bits->m_block[1 + m_bits->m_block[0]++] = (uint8_t) m_bits->m_buffer;
+		m_bits->m_buffer >>= 8;
+		m_bits->m_count -= 8;
+
+		if (m_bits->m_block[0] == 255)
+		{
+			fwrite(m_bits->m_block, 1, 256, m_bits->m_file);
+			m_bits->m_block[0] = 0;
+		}
+	}
+}
+
+bool m_gif_open(m_gif *m_gif, const char *m_filename, uint32_t m_width, uint32_t m_height, const m_color *m_palette, size_t m_colors)
+{
+	memset(m_gif, 0, sizeof(*m_gif));
+
+	if ((m_width > 0xFFFF) || (m_height > 0xFFFF) || (m_colors > 256))
+	{
+		printf("A GIF can't be %ux%u\n", m_width, m_height);
+		return false;
+	}
+
+	m_gif->m_width = m_width;
+	m_gif->m_height = m_height;
+	m_gif->m_depth = 2;
+
+	while ((1u << m_gif->m_depth) < m_colors)
+	{
+		m_gif->m_depth++;
+	}
+
+	m_gif->m_codes = malloc(4096 * ((size_t) 1 << m_gif->m_depth) * sizeof(uint16_t));
+	m_gif->m_file = fopen(m_filename, "wb");
+
+	if ((m_gif->m_codes == NULL) || (m_gif->m_file == NULL))
+	{
+		printf("Could not create %s\n", m_filename);
+
+		if (m_gif->m_file != NULL)
+		{
+			fclose(m_gif->m_file);
+		}
+
+		free(m_gif->m_codes);
+		return false;
+	}
+
+	// Logical screen with a global color table of 1 << m_depth entries
+	uint8_t m_screen[13] = { 'G', 'I', 'F', '8', '9', 'a', (uint8_t) m_width, (uint8_t) (m_width >> 8), (uint8_t) m_height,
+		(uint8_t) (m_height >> 8), (uint8_t) (0x80 | ((m_gif->m_depth - 1) << 4) | (m_gif->m_depth - 1)), 0, 0 };
+
+	fwrite(m_screen, 1, sizeof(m_screen), m_gif->m_file);
+
+	for (size_t i = 0; i < ((size_t) 1 << m_gif->m_depth); i++)
+	{
+		m_color m_entry = (i < m_colors) ? m_palette[i] : (m_color) { 0, 0, 0 };
+		uint8_t m_rgb[3] = { m_entry.m_red, m_entry.m_green, m_entry.m_blue };
+
+		fwrite(m_rgb, 1, 3, m_gif->m_file);
+	}
+
+	// Loop forever
+	static const uint8_t m_loop[19] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+
+	fwrite(m_loop, 1, sizeof(m_loop), m_gif->m_file);
+
+	return true;
+}
+
+bool m_gif_frame(m_gif *m_gif, const m_image *m_image, uint16_t m_centiseconds)
+{
+	// Graphic control extension (Delay), then an image descriptor covering the whole screen
+	uint8_t m_control[8] = { 0x21, 0xF9, 0x04, 0x00, (uint8_t) m_centiseconds, (uint8_t) (m_centiseconds >> 8), 0x00, 0x00 };
+	uint8_t m_descriptor[11] = { 0x2C, 0, 0, 0, 0, (uint8_t) m_image->m_width, (uint8_t) (m_image->m_width >> 8),
+		(uint8_t) m_image->m_height, (uint8_t) (m_image->m_height >> 8), 0x00, m_gif->m_depth };
+
+	fwrite(m_control, 1, sizeof(m_control), m_gif->m_file);
+	fwrite(m_descriptor, 1, sizeof(m_descriptor), m_gif->m_file);
+
+	const uint32_t m_children = 1u << m_gif->m_depth;
+	const uint32_t m_clear = m_children;
+	size_t m_pixels = (size_t) m_image->m_width * m_image->m_height;
+
+	m_gif_bits m_bits = { .m_file = m_gif->m_file, .m_block = { 0 }, .m_buffer = 0, .m_count = 0 };
+	uint32_t m_size = m_gif->m_depth + 1u;
+	uint32_t m_next = m_clear + 2;
+	uint32_t m_prefix = m_image->m_pixels[0];
+
+	memset(m_gif->m_codes, 0, 4096 * m_children * sizeof(uint16_t));
+	m_gif_put(&m_bits, m_clear, m_size);
+
+	for (size_t i = 1; i < m_pixels; i++)
+	{
+		uint8_t m_index = m_image->m_pixels[i];
+		uint16_t *m_child = &m_gif->m_codes[(m_prefix * m_children) + m_index];
+
+		if (*m_child != 0)
+		{
+			m_prefix = *m_child;
+			continue;
+		}
+
+		m_gif_put(&m_bits, m_prefix, m_size);
+
+		if (m_next < 4096)
+		{
+			// The decoder widens its codes once it's about to need the next size
+			if (m_next == (1u << m_size))
+			{
+				m_size++;
+			}
+
+			*m_child = (uint16_t) m_next++;
+		} else {
+			m_gif_put(&m_bits, m_clear, m_size);
+			memset(m_gif->m_codes, 0, 4096 * m_children * sizeof(uint16_t));
+			m_size = m_gif->m_depth + 1u;
+			m_next = m_clear + 2;
+		}
+
+		m_prefix = m_index;
+	}
+
+	m_gif_put(&m_bits, m_prefix, m_size);
+	m_gif_put(&m_bits, m_clear + 1, m_size);
+	m_gif_put(&m_bits, 0, 7);
+
+	if (m_bits.m_block[0] != 0)
+	{
+		fwrite(m_bits.m_block, 1, (size_t) m_bits.m_block[0] + 1, m_gif->m_file);
+	}
+
+	// Block terminator
+	if (fputc(0, m_gif->m_file) == EOF)
+	{
+		m_gif->m_failed = true;
+	}
+
+	return m_gif->m_failed == false;
+}
+
+bool m_gif_close(m_gif *m_gif)
+{
+	bool m_ok = (m_gif->m_failed == false) && (fputc(0x3B, m_gif->m_file) != EOF);
+
+	if (fclose(m_gif->m_file) != 0)
+	{
+		m_ok = false;
+	}
+
+	free(m_gif->m_codes);
+
+	return m_ok;
+}
+
+/*
+	Y4M:
+	A text header and then raw frames, 4:4:4 so single pixel details keep their color. Colors are
+	converted with the BT.601 limited range matrix, what players assume when the header says nothing.
+*/
+
+bool m_y4m_open(m_y4m *m_y4m, const char *m_filename, uint32_t m_width, uint32_t m_height, uint32_t m_framerate)
+{
+	memset(m_y4m, 0, sizeof(*m_y4m));
+
+	m_y4m->m_width = m_width;
+	m_y4m->m_height = m_height;
+	m_y4m->m_planes = malloc((size_t) m_width * m_height * 3);
+	m_y4m->m_file = (strcmp(m_filename, "-") == 0) ? stdout : fopen(m_filename, "wb");
+
+	if ((m_y4m->m_planes == NULL) || (m_y4m->m_file == NULL))
+	{
+		printf("Could not create %s\n", m_filename);
+
+		if ((m_y4m->m_file != NULL) && (m_y4m->m_file != stdout))
+		{
+			fclose(m_y4m->m_file);
+		}
+
+		free(m_y4m->m_planes);
+		return false;
+	}
+
+	fprintf(m_y4m->m_file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", m_width, m_height, m_framerate);
+
+	return true;
+}
+
+bool m_y4m_frame(m_y4m *m_y4m, const m_image *m_image, const m_color *m_palette, size_t m_colors, uint64_t m_count)
+{
+	size_t m_plane = (size_t) m_y4m->m_width * m_y4m->m_height;
+	uint8_t m_yuv[256][3] = { { 0 } };
+
+	// Converted once per palette entry instead of once per pixel
+	for (size_t i = 0; i < m_colors; i++)
+	{
+		double m_red = m_palette[i].m_red;
+		double m_green = m_palette[i].m_green;
+		double m_blue = m_palette[i].m_blue;
+
+		m_yuv[i][0] = (uint8_t) (16.5 + ((65.481 * m_red) + (128.553 * m_green) + (24.966 * m_blue)) / 255.0);
+		m_yuv[i][1] = (uint8_t) (128.5 + ((-37.797 * m_red) - (74.203 * m_green) + (112.0 * m_blue)) / 255.0);
+		m_yuv[i][2] = (uint8_t) (128.5 + ((112.0 * m_red) - (93.786 * m_green) - (18.214 * m_blue)) / 255.0);
+	}
+
+	for (size_t i = 0; i < m_plane; i++)
+	{
+		const uint8_t *m_entry = m_yuv[m_image->m_pixels[i]];
+
+		m_y4m->m_planes[i] = m_entry[0];
+		m_y4m->m_planes[m_plane + i] = m_entry[1];
+		m_y4m->m_planes[(2 * m_plane) + i] = m_entry[2];
+	}
+
+	for (uint64_t i = 0; (i < m_count) && (m_y4m->m_failed == false); i++)
+	{
+		if ((fwrite("FRAME\n", 1, 6, m_y4m->m_file) != 6) || (fwrite(m_y4m->m_planes, 1, m_plane * 3, m_y4m->m_file) != (m_plane * 3)))
+		{
+			m_y4m->m_failed = true;
+		}
+	}
+
+	return m_y4m->m_failed == false;
+}
+
+bool m_y4m_close(m_y4m *m_y4m)
+{
+	bool m_ok = m_y4m->m_failed == false;
+
+	if (m_y4m->m_file == stdout)
+	{
+		m_ok = m_ok && (fflush(stdout) == 0);
+	} else if (fclose(m_y4m->m_file) != 0)
+	{
+		m_ok = false;
+	}
+
+	free(m_y4m->m_planes);
+
+	return m_ok;
+}
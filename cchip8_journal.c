@@ -0,0 +1,487 @@
+#include "include/cchip8_journal.h"
+#include "include/cchip8_fusion.h"
+
+// Offset and size of a m_chip8 field, what a M_JOURNAL_STATE patch needs
+#define M_JOURNAL_FIELD(field) offsetof(m_chip8, field), sizeof(((m_chip8 *) NULL)->field)
+
+m_journal *m_journal_create(size_t m_budget)
+{
+	m_journal *m_journal = calloc(1, sizeof(struct chip8_journal));
+
+	if (m_journal == NULL)
+	{
+		return NULL;
+	}
+
+	m_journal->m_capacity = (m_budget < M_JOURNAL_MIN_BUDGET) ? M_JOURNAL_MIN_BUDGET : m_budget;
+	m_journal->m_data = malloc(m_journal->m_capacity);
+
+	if (m_journal->m_data == NULL)
+	{
+		free(m_journal);
+		return NULL;
+	}
+
+	return m_journal;
+}
+
+void m_journal_destroy(m_journal *m_journal)
+{
+	if (m_journal == NULL)
+	{
+		return;
+	}
+
+	free(m_journal->m_data);
+	free(m_journal);
+}
+
+void m_journal_clear(m_journal *m_journal)
+{
+	m_journal->m_head = 0;
+	m_journal->m_tail = 0;
+	m_journal->m_wrap = 0;
+	m_journal->m_wrapped = false;
+	m_journal->m_records = 0;
+}
+
+static inline uint16_t m_journal_read16(const uint8_t *m_data)
+{
+	uint16_t m_value;
+	memcpy(&m_value, m_data, sizeof(m_value));
+	return m_value;
+}
+
+static inline void m_journal_write16(uint8_t *m_data, uint16_t m_value)
+{
+	memcpy(m_data, &m_value, sizeof(m_value));
+}
+
+// Drop the oldest record
+static void m_journal_drop(m_journal *m_journal)
+{
+	m_journal->m_tail += m_journal_read16(&m_journal->m_data[m_journal->m_tail]);
+	m_journal->m_records--;
+	m_journal->m_dropped++;
+
+	if (m_journal->m_records == 0)
+	{
+		m_journal_clear(m_journal);
+	} else if (m_journal->m_wrapped && (m_journal->m_tail == m_journal->m_wrap))
+	{
+		// The oldest records are now the ones the writer put at the start of the buffer
+		m_journal->m_tail = 0;
+		m_journal->m_wrapped = false;
+	}
+}
+
+// m_journal_reserve once the end of the buffer is reached: wrap around, dropping the oldest records as needed
+static uint8_t *m_journal_reserve_slow(m_journal *m_journal, size_t m_size)
+{
+	while (true)
+	{
+		if (m_journal->m_wrapped == false)
+		{
+			if ((m_journal->m_head + m_size) <= m_journal->m_capacity)
+			{
+				return &m_journal->m_data[m_journal->m_head];
+			}
+
+			if (m_journal->m_records == 0)
+			{
+				m_journal_clear(m_journal);
+				return m_journal->m_data;
+			}
+
+			// No room left at the end, go on from the start of the buffer
+			m_journal->m_wrap = m_journal->m_head;
+			m_journal->m_head = 0;
+			m_journal->m_wrapped = true;
+		}
+
+		// Wrapped: the free space is [m_head, m_tail)
+		if ((m_journal->m_head + m_size) <= m_journal->m_tail)
+		{
+			return &m_journal->m_data[m_journal->m_head];
+		}
+
+		m_journal_drop(m_journal);
+	}
+}
+
+// Contiguous room for a record of up to m_size bytes at m_head (Almost always there without dropping anything)
+static inline uint8_t *m_journal_reserve(m_journal *m_journal, size_t m_size)
+{
+	size_t m_limit = m_journal->m_wrapped ? m_journal->m_tail : m_journal->m_capacity;
+
+	if ((m_journal->m_head + m_size) <= m_limit)
+	{
+		return &m_journal->m_data[m_journal->m_head];
+	}
+
+	return m_journal_reserve_slow(m_journal, m_size);
+}
+
+// M_JOURNAL_STATE patch holding the current value of m_length bytes of the machine at m_offset
+static inline uint8_t *m_journal_state(uint8_t *m_out, const m_chip8 *chip8, size_t m_offset, size_t m_length)
+{
+	m_out[0] = M_JOURNAL_STATE;
+	m_out[1] = (uint8_t) m_length;
+	m_journal_write16(&m_out[2], (uint16_t) m_offset);
+	memcpy(&m_out[4], (const uint8_t *) chip8 + m_offset, m_length);
+
+	return m_out + 4 + m_length;
+}
+
+// RAM bytes [m_address, m_address + m_length), split in two patches where they wrap around at 4 KiB
+static inline uint8_t *m_journal_memory(uint8_t *m_out, const m_chip8 *chip8, uint16_t m_address, size_t m_length)
+{
+	m_address &= FOURKiB - 1;
+
+	size_t m_first = ((m_address + m_length) > FOURKiB) ? (size_t) (FOURKiB - m_address) : m_length;
+
+	m_out = m_journal_state(m_out, chip8, offsetof(m_chip8, m_memory) + m_address, m_first);
+
+	if (m_first < m_length)
+	{
+		m_out = m_journal_state(m_out, chip8, offsetof(m_chip8, m_memory), m_length - m_first);
+	}
+
+	return m_out;
+}
+
+static inline uint8_t *m_journal_register(uint8_t *m_out, const m_chip8 *chip8, uint8_t m_register)
+{
+	return m_journal_state(m_out, chip8, offsetof(m_chip8, m_registers) + m_register, 1);
+}
+
+/*
+	DXYN: the 8 pixels under every sprite row, starting at the sprite's corner. Rows and columns
+	wrap around, which covers every pixel a clipping profile can touch too.
+*/
+static uint8_t *m_journal_sprite(uint8_t *m_out, const m_chip8 *chip8, uint16_t m_opcode)
+{
+	const uint32_t *m_display = chip8->m_video->m_display;
+	uint8_t m_column = chip8->m_registers[M_OPC_0X00(m_opcode)] % CHIP8_COLUMNS;
+	uint8_t m_row = chip8->m_registers[M_OPC_00X0(m_opcode)] % CHIP8_ROWS;
+	uint8_t m_height = m_opcode & 0x000F;
+
+	m_out[0] = M_JOURNAL_SPRITE;
+	m_out[1] = m_height;
+	m_journal_write16(&m_out[2], (uint16_t) ((m_row * CHIP8_COLUMNS) + m_column));
+
+	for (uint8_t m_line = 0; m_line < m_height; m_line++)
+	{
+		const uint32_t *m_pixels = &m_display[((m_row + m_line) % CHIP8_ROWS) * CHIP8_COLUMNS];
+		uint8_t m_bits = 0;
+
+		for (uint8_t m_bit = 0; m_bit < 8; m_bit++)
+		{
+			m_bits |= (uint8_t) ((m_pixels[(m_column + m_bit) % CHIP8_COLUMNS] != 0) << m_bit);
+		}
+
+		m_out[4 + m_line] = m_bits;
+	}
+
+	return m_out + 4 + m_height;
+}
+
+// 00E0: the whole display
+static uint8_t *m_journal_screen(uint8_t *m_out, const m_chip8 *chip8)
+{
+	const uint32_t *m_display = chip8->m_video->m_display;
+	const size_t m_length = (CHIP8_COLUMNS * CHIP8_ROWS) / 8;
+
+	m_out[0] = M_JOURNAL_SCREEN;
+	m_out[1] = 0;
+	m_journal_write16(&m_out[2], (uint16_t) m_length);
+
+	memset(&m_out[4], 0, m_length);
+
+	for (size_t i = 0; i < (CHIP8_COLUMNS * CHIP8_ROWS); i++)
+	{
+		m_out[4 + (i / 8)] |= (uint8_t) ((m_display[i] != 0) << (i % 8));
+	}
+
+	return m_out + 4 + m_length;
+}
+
+// Patches with the prior value of everything m_opcode is about to overwrite (PC and the opcode latch go in the header)
+static uint8_t *m_journal_capture(uint8_t *m_out, const m_chip8 *chip8, uint16_t m_opcode)
+{
+	const uint8_t m_x = M_OPC_0X00(m_opcode);
+
+	switch (m_opcode & 0xF000)
+	{
+		case 0x0000:
+			if (m_opcode == 0x00E0)
+			{
+				m_out = m_journal_screen(m_out, chip8);
+			} else if (m_opcode == 0x00EE)
+			{
+				m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_stackp));
+			}
+			break;
+
+		case 0x2000:
+			m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_stackp));
+
+			// A call with a full stack faults before writing anything
+			if (chip8->m_stackp < CHIP8_MAXSTACKENTRIES)
+			{
+				m_out = m_journal_state(m_out, chip8, offsetof(m_chip8, m_stack) + (chip8->m_stackp * sizeof(uint16_t)), sizeof(uint16_t));
+			}
+			break;
+
+		case 0x6000:
+		case 0x7000:
+			m_out = m_journal_register(m_out, chip8, m_x);
+			break;
+
+		case 0x8000:
+			// Arithmetic and logic set VF on carry, borrow, shift or (VIP) reset
+			m_out = m_journal_register(m_out, chip8, m_x);
+			m_out = m_journal_register(m_out, chip8, 0xF);
+			break;
+
+		case 0xA000:
+			m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_index));
+			break;
+
+		case 0xC000:
+			m_out = m_journal_register(m_out, chip8, m_x);
+			m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_rngstate));
+			break;
+
+		case 0xD000:
+			m_out = m_journal_register(m_out, chip8, 0xF);
+
+			/*
+				DXYN reads its coordinates pixel by pixel while it's updating VF, a sprite positioned
+				with VF moves around as collisions happen, only the whole display covers that
+			*/
+			if ((m_x == 0xF) || (M_OPC_00X0(m_opcode) == 0xF))
+			{
+				m_out = m_journal_screen(m_out, chip8);
+			} else {
+				m_out = m_journal_sprite(m_out, chip8, m_opcode);
+			}
+			break;
+
+		case 0xF000:
+			switch (m_opcode & 0x00FF)
+			{
+				case 0x0007:
+				case 0x000A:
+					m_out = m_journal_register(m_out, chip8, m_x);
+					break;
+
+				case 0x0015:
+					m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_delaydeadline));
+					break;
+
+				case 0x0018:
+					m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_sounddeadline));
+					break;
+
+				case 0x001E:
+				case 0x0029:
+					m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_index));
+					break;
+
+				case 0x0033:
+					m_out = m_journal_memory(m_out, chip8, chip8->m_index, 3);
+					break;
+
+				case 0x0055:
+					m_out = m_journal_memory(m_out, chip8, chip8->m_index, (size_t) m_x + 1);
+					m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_index));
+					break;
+
+				case 0x0065:
+					m_out = m_journal_state(m_out, chip8, offsetof(m_chip8, m_registers), (size_t) m_x + 1);
+					m_out = m_journal_state(m_out, chip8, M_JOURNAL_FIELD(m_index));
+					break;
+
+				default:
+					break;
+			}
+			break;
+
+		// Jumps and skips only move PC, which the header holds
+		default:
+			break;
+	}
+
+	return m_out;
+}
+
+void m_journal_exec(m_journal *m_journal, m_chip8 *chip8)
+{
+	uint16_t m_pc = chip8->m_programcounter;
+	uint16_t m_opcode = (uint16_t) ((chip8->m_memory[m_pc & (FOURKiB - 1)] << 8) | chip8->m_memory[(m_pc + 1) & (FOURKiB - 1)]);
+
+	// Only instructions saving the whole display need the worst case, everything else fits in a few dozen bytes
+	uint8_t *m_record = m_journal_reserve(m_journal, (m_opcode == 0x00E0) || ((m_opcode & 0xF000) == 0xD000) ? M_JOURNAL_MAX_RECORD : 64);
+
+	m_journal_write16(&m_record[2], m_pc);
+	m_journal_write16(&m_record[4], chip8->m_currentopcode);
+
+	uint8_t *m_end = m_journal_capture(&m_record[6], chip8, m_opcode);
+	uint16_t m_size = (uint16_t) ((m_end - m_record) + 2);
+
+	// The opcode is already at hand, don't let m_exec fetch it again
+	m_exec_fetched(chip8, m_opcode);
+
+	// A faulting instruction didn't execute, there's nothing to undo
+	if (chip8->m_fault != M_FAULT_NONE)
+	{
+		return;
+	}
+
+	m_journal_write16(&m_record[0], m_size);
+	m_journal_write16(m_end, m_size);
+
+	m_journal->m_head += m_size;
+	m_journal->m_records++;
+}
+
+// Put a record's bytes back, the record starts at m_record and is m_size bytes long
+static void m_journal_apply(m_chip8 *chip8, const uint8_t *m_record, uint16_t m_size)
+{
+	const uint8_t *m_patch = &m_record[6];
+	const uint8_t *m_end = &m_record[m_size - 2];
+	uint32_t *m_display = chip8->m_video->m_display;
+
+	while (m_patch < m_end)
+	{
+		uint8_t m_kind = m_patch[0];
+		uint8_t m_length = m_patch[1];
+		uint16_t m_offset = m_journal_read16(&m_patch[2]);
+		const uint8_t *m_bytes = &m_patch[4];
+
+		switch (m_kind)
+		{
+			case M_JOURNAL_STATE:
+				memcpy((uint8_t *) chip8 + m_offset, m_bytes, m_length);
+
+				// Restored RAM may be code the predecode cache decoded from the newer bytes
+				if ((chip8->m_code != NULL) && (m_offset >= offsetof(m_chip8, m_memory)))
+				{
+					m_code_invalidate(chip8->m_code, (uint16_t) (m_offset - offsetof(m_chip8, m_memory)), m_length);
+				}
+				break;
+
+			case M_JOURNAL_SPRITE:
+				for (uint8_t m_line = 0; m_line < m_length; m_line++)
+				{
+					uint32_t *m_pixels = &m_display[(((m_offset / CHIP8_COLUMNS) + m_line) % CHIP8_ROWS) * CHIP8_COLUMNS];
+
+					for (uint8_t m_bit = 0; m_bit < 8; m_bit++)
+					{
+						m_pixels[((m_offset % CHIP8_COLUMNS) + m_bit) % CHIP8_COLUMNS] = ((m_bytes[m_line] >> m_bit) & 1) ? 0xFFFFFFFF : 0;
+					}
+				}
+
+				chip8->m_redraw = true;
+				break;
+
+			case M_JOURNAL_SCREEN:
+				for (size_t i = 0; i < (CHIP8_COLUMNS * CHIP8_ROWS); i++)
+				{
+					m_display[i] = ((m_bytes[i / 8] >> (i % 8)) & 1) ? 0xFFFFFFFF : 0;
+				}
+
+				// The screen's length doesn't fit the byte, the offset holds it
+				m_length = 0;
+				m_bytes += m_offset;
+				chip8->m_redraw = true;
+				break;
+
+			default:
+				break;
+		}
+
+		m_patch = m_bytes + m_length;
+	}
+
+	chip8->m_programcounter = m_journal_read16(&m_record[2]);
+	chip8->m_currentopcode = m_journal_read16(&m_record[4]);
+	chip8->m_cycles--;
+}
+
+bool m_journal_undo(m_journal *m_journal, m_chip8 *chip8)
+{
+	if (m_journal->m_records == 0)
+	{
+		return false;
+	}
+
+	// The newest record is the last one before the writer wrapped around
+	if (m_journal->m_wrapped && (m_journal->m_head == 0))
+	{
+		m_journal->m_head = m_journal->m_wrap;
+		m_journal->m_wrapped = false;
+	}
+
+	uint16_t m_size = m_journal_read16(&m_journal->m_data[m_journal->m_head - 2]);
+
+	m_journal->m_head -= m_size;
+	m_journal->m_records--;
+
+	m_journal_apply(chip8, &m_journal->m_data[m_journal->m_head], m_size);
+
+	if (m_journal->m_records == 0)
+	{
+		m_journal_clear(m_journal);
+	}
+
+	return true;
+}
+
+bool m_journal_writer(const m_journal *m_journal, size_t m_offset, uint16_t *m_pc, uint64_t *m_age)
+{
+	size_t m_head = m_journal->m_head;
+	bool m_wrapped = m_journal->m_wrapped;
+
+	// Same walk as m_journal_undo, without undoing anything
+	for (uint64_t m_record = 0; m_record < m_journal->m_records; m_record++)
+	{
+		if (m_wrapped && (m_head == 0))
+		{
+			m_head = m_journal->m_wrap;
+			m_wrapped = false;
+		}
+
+		uint16_t m_size = m_journal_read16(&m_journal->m_data[m_head - 2]);
+		const uint8_t *m_start = &m_journal->m_data[m_head - m_size];
+		const uint8_t *m_patch = &m_start[6];
+		const uint8_t *m_end = &m_start[m_size - 2];
+
+		m_head -= m_size;
+
+		while (m_patch < m_end)
+		{
+			uint8_t m_length = m_patch[1];
+			uint16_t m_at = m_journal_read16(&m_patch[2]);
+
+			// The screen's length is in its offset (See m_journal_apply), pixels aren't machine bytes anyway
+			if (m_patch[0] == M_JOURNAL_SCREEN)
+			{
+				m_patch += 4 + m_at;
+				continue;
+			}
+
+			if ((m_patch[0] == M_JOURNAL_STATE) && (m_offset >= m_at) && (m_offset < ((size_t) m_at + m_length)))
+			{
+				*m_pc = m_journal_read16(&m_start[2]);
+				*m_age = m_record + 1;
+				return true;
+			}
+
+			m_patch += 4 + m_length;
+		}
+	}
+
+	return false;
+}
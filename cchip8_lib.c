@@ -0,0 +1,921 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdarg.h>
+#include <stdatomic.h>
+
+#include "include/cchip8.h"
+#include "include/cchip8_fusion.h"
+#include "include/cchip8_analysis.h"
+#include "include/cchip8_journal.h"
+#include "include/cchip8_view.h"
+#include "include/cchip8_export.h"
+#include "include/cchip8_capture.h"
+
+/*
+	libcchip8 - Implementation of the public embedding API (See include/libcchip8.h).
+	A handle wraps one interpreter plus the memory image it gets reset to, nothing in here
+	is shared between handles.
+*/
+
+struct cchip8_instance
+{
+	// The interpreter itself (Cache-line aligned, see m_chip8_create)
+	m_chip8 *m_machine;
+
+	// Memory right after the last ROM load (Font + ROM), cchip8_reset restores it
+	uint8_t m_image[FOURKiB];
+
+	/*
+		Static analysis of the current image, only kept when the profile is picked automatically.
+		It chose m_profile, and every reset prewarms the predecode cache with the code it found.
+	*/
+	m_analysis *m_analysis;
+
+	/*
+		Sandbox budgets (0 = unlimited) and the watchdog deadline of the current run, m_deadline is
+		armed by the first cchip8_run_frames / cchip8_step after a reset (0 = not yet).
+	*/
+	uint64_t m_maxinstructions;
+	uint64_t m_maxnanoseconds;
+	uint64_t m_deadline;
+
+	// Undo journal for reverse debugging (NULL unless cchip8_set_journal enabled it)
+	m_journal *m_journal;
+
+	// View other threads read the machine through (NULL unless cchip8_attach_view attached one)
+	cchip8_view *m_view;
+
+	// Shared memory segment other processes read the machine through (NULL unless cchip8_attach_export attached one)
+	cchip8_export *m_export;
+
+	// Session recording (NULL unless cchip8_attach_capture attached one)
+	cchip8_capture *m_capture;
+
+	// Publishing to all three is suspended (cchip8_pause_publishing, for frames that don't really happen)
+	bool m_paused;
+
+	// Settings that survive a reset
+	bool m_reference;
+	uint32_t m_seed;
+	uint16_t m_breakpoint;
+	uint8_t m_profile;
+};
+
+// A save state is the interpreter as is plus the display it draws to
+struct cchip8_state
+{
+	m_chip8 m_machine;
+
+	uint32_t m_display[CHIP8_COLUMNS * CHIP8_ROWS];
+};
+
+// The public header can't see the internal constants, keep both views in sync
+static_assert(CCHIP8_WIDTH == CHIP8_COLUMNS && CCHIP8_HEIGHT == CHIP8_ROWS, "Framebuffer geometry mismatch");
+static_assert(CCHIP8_MAX_ROM_SIZE == FOURKiB - CHIP8_INITIAL_PC, "ROM size limit mismatch");
+static_assert((int) CCHIP8_FAULT_UNIMPLEMENTED == M_FAULT_UNIMPLEMENTED && (int) CCHIP8_FAULT_STACK_OVERFLOW == M_FAULT_STACK_OVERFLOW &&
+	(int) CCHIP8_FAULT_STACK_UNDERFLOW == M_FAULT_STACK_UNDERFLOW && (int) CCHIP8_FAULT_INSTRUCTION_BUDGET == M_FAULT_INSTRUCTION_BUDGET &&
+	(int) CCHIP8_FAULT_TIME_BUDGET == M_FAULT_TIME_BUDGET && M_FAULT_COUNT == 6, "Fault code mismatch");
+
+/*
+	Instructions cchip8_run_frames runs between two looks at the wall clock when there's a time budget,
+	about a millisecond of emulation, so the clock read vanishes next to the work in between.
+*/
+#define M_LIB_WATCHDOG_SLICE 262144
+
+// Monotonic clock for the watchdog, in nanoseconds
+static uint64_t m_lib_clock(void)
+{
+#if defined(__MINGW32__) || defined(__MINGW64__)
+	LARGE_INTEGER m_count;
+	LARGE_INTEGER m_frequency;
+
+	QueryPerformanceCounter(&m_count);
+	QueryPerformanceFrequency(&m_frequency);
+
+	// Split up so the multiplication can't overflow after a few hours of uptime
+	uint64_t m_seconds = (uint64_t) m_count.QuadPart / (uint64_t) m_frequency.QuadPart;
+	uint64_t m_rest = (uint64_t) m_count.QuadPart % (uint64_t) m_frequency.QuadPart;
+
+	return (m_seconds * 1000000000ull) + ((m_rest * 1000000000ull) / (uint64_t) m_frequency.QuadPart);
+#else
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+
+	return ((uint64_t) m_time.tv_sec * 1000000000ull) + (uint64_t) m_time.tv_nsec;
+#endif
+}
+
+static void m_log_stderr(void *m_user, const char *m_message)
+{
+	(void) m_user;
+	fprintf(stderr, "%s\n", m_message);
+}
+
+// Handler and its user pointer, swapped as one so a thread logging meanwhile never pairs one with the other's
+typedef struct chip8_log_target
+{
+	cchip8_log_handler m_handler;
+	void *m_user;
+
+} m_log_target;
+
+static const m_log_target m_log_default = { m_log_stderr, NULL };
+static _Atomic(const m_log_target *) m_logtarget = &m_log_default;
+
+void cchip8_set_log_handler(cchip8_log_handler m_handler, void *m_user)
+{
+	if (m_handler == NULL)
+	{
+		atomic_store_explicit(&m_logtarget, &m_log_default, memory_order_release);
+		return;
+	}
+
+	m_log_target *m_target = malloc(sizeof(*m_target));
+
+	// Without memory the previous handler stays
+	if (m_target == NULL)
+	{
+		return;
+	}
+
+	m_target->m_handler = m_handler;
+	m_target->m_user = m_user;
+
+	/*
+		The previous target is never freed, another thread may have just loaded it to log a
+		message. Handlers are set a few times per process at most, so that's a few bytes each.
+	*/
+	atomic_store_explicit(&m_logtarget, m_target, memory_order_release);
+}
+
+void m_log(const char *m_format, ...)
+{
+	char m_message[512];
+	va_list m_arguments;
+
+	va_start(m_arguments, m_format);
+	vsnprintf(m_message, sizeof(m_message), m_format, m_arguments);
+	va_end(m_arguments);
+
+	const m_log_target *m_target = atomic_load_explicit(&m_logtarget, memory_order_acquire);
+
+	m_target->m_handler(m_target->m_user, m_message);
+}
+
+void cchip8_default_options(cchip8_options *m_options)
+{
+	m_options->m_profile = NULL;
+	m_options->m_fusion = true;
+	m_options->m_reference = false;
+	m_options->m_seed = 0;
+	m_options->m_maxinstructions = 0;
+	m_options->m_maxmilliseconds = 0;
+}
+
+/*
+	Decode every instruction the static analysis reached up front, so m_run doesn't take the lazy
+	decode path on its first pass through the code. Stores the analysis saw landing on code are left
+	alone, m_run decodes those once the program wrote them.
+*/
+static void m_lib_prewarm(cchip8 *m_vm)
+{
+	m_code *m_cache = m_vm->m_machine->m_code;
+
+	if (m_vm->m_analysis == NULL)
+	{
+		return;
+	}
+
+	for (size_t i = CHIP8_INITIAL_PC; i < FOURKiB; i++)
+	{
+		if (((m_vm->m_analysis->m_flags[i] & (M_ADDR_CODE | M_ADDR_WRITTEN)) == M_ADDR_CODE) &&
+			(m_cache->m_entries[i].m_length == 0))
+		{
+			m_code_decode(m_cache, m_vm->m_image, (uint16_t) i);
+		}
+	}
+}
+
+cchip8 *cchip8_create(const cchip8_options *m_options)
+{
+	cchip8_options m_defaults;
+
+	if (m_options == NULL)
+	{
+		cchip8_default_options(&m_defaults);
+		m_options = &m_defaults;
+	}
+
+	enum m_profile m_profile = M_PROFILE_CCHIP8;
+	bool m_autoprofile = (m_options->m_profile != NULL) && (strcmp(m_options->m_profile, "auto") == 0);
+
+	if ((m_options->m_profile != NULL) && (m_autoprofile == false))
+	{
+		m_profile = m_profile_from_name(m_options->m_profile);
+
+		if (m_profile == M_PROFILE_COUNT)
+		{
+			return NULL;
+		}
+	}
+
+	cchip8 *m_vm = calloc(1, sizeof(cchip8));
+
+	if (m_vm == NULL)
+	{
+		return NULL;
+	}
+
+	m_vm->m_machine = m_chip8_create();
+
+	if (m_vm->m_machine == NULL)
+	{
+		free(m_vm);
+		return NULL;
+	}
+
+	// Predecode cache, the interpreter falls back to plain decoding if it can't be allocated
+	if ((m_options->m_fusion == true) && (m_options->m_reference == false))
+	{
+		m_code_create(m_vm->m_machine);
+	}
+
+	if (m_autoprofile == true)
+	{
+		m_vm->m_analysis = malloc(sizeof(m_analysis));
+
+		if (m_vm->m_analysis == NULL)
+		{
+			m_chip8_destroy(m_vm->m_machine);
+			free(m_vm);
+			return NULL;
+		}
+	}
+
+	m_vm->m_reference = m_options->m_reference;
+	m_vm->m_seed = (m_options->m_seed != 0) ? m_options->m_seed : CHIP8_DEFAULT_SEED;
+	m_vm->m_maxinstructions = m_options->m_maxinstructions;
+	m_vm->m_maxnanoseconds = (uint64_t) m_options->m_maxmilliseconds * 1000000ull;
+	m_vm->m_breakpoint = CHIP8_NO_BREAKPOINT;
+	m_vm->m_profile = (uint8_t) m_profile;
+
+	// Font goes at the start of memory, no ROM yet
+	memcpy(m_vm->m_image, m_font, CHIP8_FONT_SIZE);
+
+	if (m_vm->m_analysis != NULL)
+	{
+		m_analyse(m_vm->m_analysis, m_vm->m_image);
+	}
+
+	cchip8_reset(m_vm);
+
+	return m_vm;
+}
+
+void cchip8_destroy(cchip8 *m_vm)
+{
+	if (m_vm == NULL)
+	{
+		return;
+	}
+
+	m_chip8_destroy(m_vm->m_machine);
+	m_journal_destroy(m_vm->m_journal);
+	free(m_vm->m_analysis);
+	free(m_vm);
+}
+
+// Republish the attached view and export, if there are any (Every entry point that moves the machine ends here)
+static inline void m_lib_publish(cchip8 *m_vm)
+{
+	if (m_vm->m_paused)
+	{
+		return;
+	}
+
+	if (m_vm->m_view != NULL)
+	{
+		m_view_publish(m_vm->m_view, m_vm->m_machine);
+	}
+
+	if (m_vm->m_export != NULL)
+	{
+		m_export_publish(m_vm->m_export, m_vm->m_machine);
+	}
+}
+
+void cchip8_reset(cchip8 *m_vm)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	// Everything but the attached allocations goes back to 0
+	m_chip8_video *m_video = chip8->m_video;
+	struct chip8_code *m_cache = chip8->m_code;
+
+	memset(chip8, 0, sizeof(m_chip8));
+
+	chip8->m_video = m_video;
+	chip8->m_code = m_cache;
+
+	memset(chip8->m_video, 0, sizeof(m_chip8_video));
+	memcpy(chip8->m_memory, m_vm->m_image, FOURKiB);
+
+	chip8->m_programcounter = CHIP8_INITIAL_PC;
+	chip8->m_breakpoint = m_vm->m_breakpoint;
+	chip8->m_profile = m_vm->m_profile;
+	chip8->m_rngstate = m_vm->m_seed;
+
+	// The display was just cleared, let the embedder know
+	chip8->m_redraw = true;
+
+	// A new run gets a fresh time budget, and a fresh history
+	m_vm->m_deadline = 0;
+
+	if (m_vm->m_journal != NULL)
+	{
+		m_journal_clear(m_vm->m_journal);
+	}
+
+	// Memory changed under the predecode cache
+	if (chip8->m_code != NULL)
+	{
+		m_code_invalidate(chip8->m_code, 0, FOURKiB);
+		m_lib_prewarm(m_vm);
+	}
+
+	m_lib_publish(m_vm);
+}
+
+bool cchip8_load_rom_from_memory(cchip8 *m_vm, const uint8_t *m_rom, size_t m_size)
+{
+	if ((m_rom == NULL) || (m_size > CCHIP8_MAX_ROM_SIZE))
+	{
+		return false;
+	}
+
+	memset(m_vm->m_image, 0, FOURKiB);
+	memcpy(m_vm->m_image, m_font, CHIP8_FONT_SIZE);
+	memcpy(&m_vm->m_image[CHIP8_INITIAL_PC], m_rom, m_size);
+
+	// Pick the profile before the reset below hands it to the interpreter (And keys the cache with it)
+	if (m_vm->m_analysis != NULL)
+	{
+		m_analyse(m_vm->m_analysis, m_vm->m_image);
+		m_vm->m_profile = (uint8_t) m_vm->m_analysis->m_profile;
+	}
+
+#ifdef DEBUG
+	printf("Program size: %zu bytes\n", m_size);
+	printf("Program Memory Dump: \n");
+
+	for (size_t i = 0; i < m_size; i++)
+	{
+		printf("0x%x ", m_rom[i]);
+	}
+
+	printf("\n");
+#endif
+
+	cchip8_reset(m_vm);
+
+	return true;
+}
+
+/*
+	Sandbox checks, run in the prologue of every slice of instructions instead of per instruction.
+	Arms the watchdog on the first call after a reset, and stops the machine with a budget fault
+	(Precise like every other fault, PC points at the instruction that didn't run) once a budget is used up.
+*/
+static bool m_lib_within_budget(cchip8 *m_vm)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	if ((m_vm->m_maxinstructions != 0) && (chip8->m_cycles >= m_vm->m_maxinstructions))
+	{
+		chip8->m_fault = M_FAULT_INSTRUCTION_BUDGET;
+		return false;
+	}
+
+	if (m_vm->m_maxnanoseconds != 0)
+	{
+		uint64_t m_now = m_lib_clock();
+
+		if (m_vm->m_deadline == 0)
+		{
+			m_vm->m_deadline = m_now + m_vm->m_maxnanoseconds;
+		}
+		else if (m_now >= m_vm->m_deadline)
+		{
+			chip8->m_fault = M_FAULT_TIME_BUDGET;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	m_run's job one instruction at a time (Journaled if the journal is on, the plain m_exec on a
+	reference machine) until m_slice, stopping on a fault or at the breakpoint (Not before the first
+	instruction, like m_run).
+*/
+static enum m_runexit m_lib_run_stepwise(cchip8 *m_vm, uint64_t m_slice)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+	const uint64_t m_start = chip8->m_cycles;
+
+	while (chip8->m_cycles < m_slice)
+	{
+		if ((chip8->m_programcounter == chip8->m_breakpoint) && (chip8->m_cycles != m_start))
+		{
+			return M_RUN_BREAKPOINT;
+		}
+
+		if (m_vm->m_journal != NULL)
+		{
+			m_journal_exec(m_vm->m_journal, chip8);
+		} else {
+			m_exec(chip8);
+		}
+
+		if (chip8->m_fault != M_FAULT_NONE)
+		{
+			return M_RUN_FAULT;
+		}
+	}
+
+	return M_RUN_BUDGET;
+}
+
+/*
+	Run m_frames emulated frames (CHIP8_CYCLES_PER_FRAME instructions each) through m_run.
+	Draws end a batch early, so keep running until the frame's budget is consumed, the ROM faults
+	or the Program Counter reaches the breakpoint.
+	Under a sandbox the run is cut into slices: none reaches past the instruction budget, and with a
+	time budget none is longer than M_LIB_WATCHDOG_SLICE, the budgets get checked in between.
+*/
+static enum cchip8_status m_lib_run_frames(cchip8 *m_vm, uint32_t m_frames)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	if (chip8->m_fault != M_FAULT_NONE)
+	{
+		return CCHIP8_HALTED;
+	}
+
+	const uint64_t m_end = chip8->m_cycles + ((uint64_t) m_frames * CHIP8_CYCLES_PER_FRAME);
+
+	while (chip8->m_cycles < m_end)
+	{
+		if (m_lib_within_budget(m_vm) == false)
+		{
+			return CCHIP8_HALTED;
+		}
+
+		uint64_t m_slice = m_end;
+
+		if ((m_vm->m_maxinstructions != 0) && (m_slice > m_vm->m_maxinstructions))
+		{
+			m_slice = m_vm->m_maxinstructions;
+		}
+
+		if ((m_vm->m_maxnanoseconds != 0) && (m_slice - chip8->m_cycles > M_LIB_WATCHDOG_SLICE))
+		{
+			m_slice = chip8->m_cycles + M_LIB_WATCHDOG_SLICE;
+		}
+
+		while (chip8->m_cycles < m_slice)
+		{
+			uint64_t m_left = m_slice - chip8->m_cycles;
+			enum m_runexit m_exit;
+
+			if ((m_vm->m_journal != NULL) || (m_vm->m_reference == true))
+			{
+				m_exit = m_lib_run_stepwise(m_vm, m_slice);
+			} else {
+				m_exit = m_run(chip8, (m_left > UINT32_MAX) ? UINT32_MAX : (uint32_t) m_left);
+			}
+
+			if (m_exit == M_RUN_FAULT)
+			{
+				return CCHIP8_HALTED;
+			}
+
+			if (m_exit == M_RUN_BREAKPOINT)
+			{
+				return CCHIP8_BREAKPOINT;
+			}
+		}
+	}
+
+	// Running out of instructions exactly at the end of the request still counts
+	if (m_lib_within_budget(m_vm) == false)
+	{
+		return CCHIP8_HALTED;
+	}
+
+	return CCHIP8_OK;
+}
+
+// A frame boundary, where readers get to see the machine
+enum cchip8_status cchip8_run_frames(cchip8 *m_vm, uint32_t m_frames)
+{
+	enum cchip8_status m_status;
+
+	/*
+		Only whole frames get recorded, single steps from a debugger show up with the next one. So does
+		whatever a zero-frame run sees: its record would land on the previous frame, a delta of 0 is the end record.
+	*/
+	if ((m_vm->m_capture != NULL) && (m_vm->m_paused == false) && (m_frames > 0))
+	{
+		uint32_t m_done = 0;
+
+		// Every frame in between can show a picture of its own, the capture gets to see each one
+		do
+		{
+			m_status = m_lib_run_frames(m_vm, 1);
+			m_done++;
+
+			m_capture_frame(m_vm->m_capture, m_vm->m_machine->m_video->m_display, 1);
+		} while ((m_status == CCHIP8_OK) && (m_done < m_frames));
+
+		// A machine that stopped early keeps its picture up for the rest of the request
+		if (m_done < m_frames)
+		{
+			m_capture_frame(m_vm->m_capture, m_vm->m_machine->m_video->m_display, m_frames - m_done);
+		}
+	} else {
+		m_status = m_lib_run_frames(m_vm, m_frames);
+	}
+
+	m_lib_publish(m_vm);
+
+	return m_status;
+}
+
+enum cchip8_status cchip8_step(cchip8 *m_vm)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	if ((chip8->m_fault == M_FAULT_NONE) && (m_lib_within_budget(m_vm) == true))
+	{
+		if (m_vm->m_journal != NULL)
+		{
+			m_journal_exec(m_vm->m_journal, chip8);
+		} else {
+			m_exec(chip8);
+		}
+	}
+
+	m_lib_publish(m_vm);
+
+	return (chip8->m_fault != M_FAULT_NONE) ? CCHIP8_HALTED : CCHIP8_OK;
+}
+
+enum cchip8_fault cchip8_get_fault(const cchip8 *m_vm, cchip8_fault_info *m_info)
+{
+	const m_chip8 *chip8 = m_vm->m_machine;
+
+	if (m_info != NULL)
+	{
+		uint16_t m_address = chip8->m_programcounter & (FOURKiB - 1);
+
+		m_info->m_fault = (enum cchip8_fault) chip8->m_fault;
+		m_info->m_address = chip8->m_programcounter;
+		m_info->m_opcode = (uint16_t) ((chip8->m_memory[m_address] << 8) | chip8->m_memory[(m_address + 1) & (FOURKiB - 1)]);
+		m_info->m_cycles = chip8->m_cycles;
+	}
+
+	return (enum cchip8_fault) chip8->m_fault;
+}
+
+const char *cchip8_fault_name(enum cchip8_fault m_fault)
+{
+	return m_fault_name((enum m_fault) m_fault);
+}
+
+void cchip8_set_keys(cchip8 *m_vm, uint16_t m_keys)
+{
+	for (size_t i = 0; i < CHIP8_KEYS; i++)
+	{
+		m_vm->m_machine->m_keyboard[i] = (m_keys >> i) & 1;
+	}
+}
+
+uint16_t cchip8_get_keys(const cchip8 *m_vm)
+{
+	uint16_t m_keys = 0;
+
+	for (size_t i = 0; i < CHIP8_KEYS; i++)
+	{
+		if (m_vm->m_machine->m_keyboard[i] != 0)
+		{
+			m_keys |= (uint16_t) (1 << i);
+		}
+	}
+
+	return m_keys;
+}
+
+bool cchip8_key_event(cchip8 *m_vm, uint8_t m_key, bool m_down)
+{
+	uint8_t *m_held = &m_vm->m_machine->m_keyboard[m_key & (CHIP8_KEYS - 1)];
+
+	if ((*m_held != 0) == m_down)
+	{
+		return false;
+	}
+
+	*m_held = m_down;
+
+	return true;
+}
+
+const uint32_t *cchip8_get_framebuffer(cchip8 *m_vm, bool *m_changed)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	if (m_changed != NULL)
+	{
+		*m_changed = chip8->m_redraw;
+		chip8->m_redraw = false;
+	}
+
+	return chip8->m_video->m_display;
+}
+
+uint64_t m_pack_row(const uint32_t *m_pixels)
+{
+	uint64_t m_bits = 0;
+
+	for (size_t m_column = 0; m_column < CHIP8_COLUMNS; m_column++)
+	{
+		m_bits |= (uint64_t) (m_pixels[m_column] != 0) << m_column;
+	}
+
+	return m_bits;
+}
+
+void m_pack_display(const m_chip8 *chip8, uint64_t m_rows[CHIP8_ROWS])
+{
+	for (size_t m_row = 0; m_row < CHIP8_ROWS; m_row++)
+	{
+		m_rows[m_row] = m_pack_row(&chip8->m_video->m_display[m_row * CHIP8_COLUMNS]);
+	}
+}
+
+void cchip8_pack_display(const cchip8 *m_vm, uint64_t m_rows[CCHIP8_HEIGHT])
+{
+	m_pack_display(m_vm->m_machine, m_rows);
+}
+
+/*
+	One multiply and shift per row, then a murmur3 finaliser so single pixel changes spread over
+	every bit. Only arithmetic on the row values, so it's the same on any host.
+*/
+uint64_t cchip8_hash_display(const uint64_t m_rows[CCHIP8_HEIGHT])
+{
+	uint64_t m_hash = 0x243F6A8885A308D3ULL;
+
+	for (size_t m_row = 0; m_row < CCHIP8_HEIGHT; m_row++)
+	{
+		m_hash = (m_hash ^ m_rows[m_row]) * 0x9E3779B97F4A7C15ULL;
+		m_hash ^= m_hash >> 32;
+	}
+
+	m_hash ^= m_hash >> 33;
+	m_hash *= 0xFF51AFD7ED558CCDULL;
+	m_hash ^= m_hash >> 33;
+	m_hash *= 0xC4CEB9FE1A85EC53ULL;
+	m_hash ^= m_hash >> 33;
+
+	return m_hash;
+}
+
+bool cchip8_get_sound(const cchip8 *m_vm)
+{
+	return m_get_soundtmr(m_vm->m_machine) > 0;
+}
+
+uint64_t cchip8_get_cycles(const cchip8 *m_vm)
+{
+	return m_vm->m_machine->m_cycles;
+}
+
+void cchip8_set_breakpoint(cchip8 *m_vm, uint16_t m_address)
+{
+	m_vm->m_breakpoint = m_address;
+	m_vm->m_machine->m_breakpoint = m_address;
+}
+
+const char *cchip8_get_profile(const cchip8 *m_vm)
+{
+	return m_get_quirks((enum m_profile) m_vm->m_profile)->m_name;
+}
+
+void cchip8_get_registers(const cchip8 *m_vm, cchip8_registers *m_registers)
+{
+	const m_chip8 *chip8 = m_vm->m_machine;
+
+	m_registers->m_programcounter = chip8->m_programcounter;
+	m_registers->m_index = chip8->m_index;
+	m_registers->m_opcode = chip8->m_currentopcode;
+	memcpy(m_registers->m_registers, chip8->m_registers, sizeof(m_registers->m_registers));
+	m_registers->m_stackp = chip8->m_stackp;
+	m_registers->m_delaytimer = m_get_delaytmr(chip8);
+	m_registers->m_soundtimer = m_get_soundtmr(chip8);
+}
+
+void cchip8_read_memory(const cchip8 *m_vm, uint16_t m_address, uint8_t *m_buffer, size_t m_length)
+{
+	for (size_t i = 0; i < m_length; i++)
+	{
+		m_buffer[i] = m_vm->m_machine->m_memory[(m_address + i) & (FOURKiB - 1)];
+	}
+}
+
+void cchip8_print_fusion_stats(const cchip8 *m_vm, FILE *m_out)
+{
+	if (m_vm->m_machine->m_code != NULL)
+	{
+		m_code_print_stats(m_vm->m_machine->m_code, m_vm->m_machine->m_cycles, m_out);
+	}
+}
+
+cchip8_state *cchip8_state_create(void)
+{
+	// m_chip8 is cache-line aligned, so is the state holding it
+	cchip8_state *m_state = m_aligned_alloc(sizeof(cchip8_state));
+
+	if (m_state != NULL)
+	{
+		memset(m_state, 0, sizeof(cchip8_state));
+	}
+
+	return m_state;
+}
+
+void cchip8_state_destroy(cchip8_state *m_state)
+{
+	m_aligned_free(m_state);
+}
+
+void cchip8_save_state(const cchip8 *m_vm, cchip8_state *m_state)
+{
+	const m_chip8 *chip8 = m_vm->m_machine;
+
+	memcpy(&m_state->m_machine, chip8, sizeof(m_chip8));
+	memcpy(m_state->m_display, chip8->m_video->m_display, sizeof(m_state->m_display));
+}
+
+/*
+	Two memcpys plus keeping the predecode cache honest: its entries were decoded from the memory
+	that's about to be replaced, so the cache lines whose bytes differ in the state get invalidated.
+	Run-ahead restores a state that usually differs in a few bytes of data, the code stays decoded.
+*/
+void cchip8_load_state(cchip8 *m_vm, const cchip8_state *m_state)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	if (chip8->m_code != NULL)
+	{
+		for (size_t m_line = 0; m_line < FOURKiB; m_line += M_CACHELINE)
+		{
+			if (memcmp(&chip8->m_memory[m_line], &m_state->m_machine.m_memory[m_line], M_CACHELINE) != 0)
+			{
+				m_code_invalidate(chip8->m_code, (uint16_t) m_line, M_CACHELINE);
+			}
+		}
+	}
+
+	// What belongs to the instance or the embedder survives the copy
+	m_chip8_video *m_video = chip8->m_video;
+	struct chip8_code *m_cache = chip8->m_code;
+	uint8_t m_keyboard[CHIP8_KEYS];
+
+	memcpy(m_keyboard, chip8->m_keyboard, CHIP8_KEYS);
+
+	memcpy(chip8, &m_state->m_machine, sizeof(m_chip8));
+	memcpy(m_video->m_display, m_state->m_display, sizeof(m_state->m_display));
+
+	chip8->m_video = m_video;
+	chip8->m_code = m_cache;
+	chip8->m_breakpoint = m_vm->m_breakpoint;
+	memcpy(chip8->m_keyboard, m_keyboard, CHIP8_KEYS);
+
+	chip8->m_redraw = true;
+
+	// The journal's history leads to the state we just left, not to this one
+	if (m_vm->m_journal != NULL)
+	{
+		m_journal_clear(m_vm->m_journal);
+	}
+
+	m_lib_publish(m_vm);
+}
+
+bool cchip8_set_journal(cchip8 *m_vm, size_t m_budget)
+{
+	m_journal_destroy(m_vm->m_journal);
+	m_vm->m_journal = NULL;
+
+	if (m_budget == 0)
+	{
+		return true;
+	}
+
+	m_vm->m_journal = m_journal_create(m_budget);
+
+	return m_vm->m_journal != NULL;
+}
+
+uint64_t cchip8_journal_depth(const cchip8 *m_vm)
+{
+	return (m_vm->m_journal != NULL) ? m_vm->m_journal->m_records : 0;
+}
+
+// cchip8_step_back without publishing (cchip8_continue_back publishes once it stops)
+static bool m_lib_step_back(cchip8 *m_vm)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	// Faults are precise, the faulting instruction didn't run and PC still points at it
+	if (chip8->m_fault != M_FAULT_NONE)
+	{
+		chip8->m_fault = M_FAULT_NONE;
+		return true;
+	}
+
+	return (m_vm->m_journal != NULL) && m_journal_undo(m_vm->m_journal, chip8);
+}
+
+bool cchip8_step_back(cchip8 *m_vm)
+{
+	bool m_undone = m_lib_step_back(m_vm);
+
+	m_lib_publish(m_vm);
+
+	return m_undone;
+}
+
+enum cchip8_status cchip8_continue_back(cchip8 *m_vm)
+{
+	m_chip8 *chip8 = m_vm->m_machine;
+
+	enum cchip8_status m_status = CCHIP8_BREAKPOINT;
+
+	// Like cchip8_run_frames, leaving the breakpoint we're sitting on doesn't count as reaching it
+	if (m_lib_step_back(m_vm) == false)
+	{
+		m_status = CCHIP8_OK;
+	}
+
+	while ((m_status == CCHIP8_BREAKPOINT) && (chip8->m_programcounter != chip8->m_breakpoint))
+	{
+		if (m_lib_step_back(m_vm) == false)
+		{
+			m_status = CCHIP8_OK;
+		}
+	}
+
+	m_lib_publish(m_vm);
+
+	return m_status;
+}
+
+void cchip8_attach_view(cchip8 *m_vm, cchip8_view *m_view)
+{
+	m_vm->m_view = m_view;
+
+	// Readers shouldn't have to wait for the next frame to see the machine
+	m_lib_publish(m_vm);
+}
+
+void cchip8_attach_export(cchip8 *m_vm, cchip8_export *m_export)
+{
+	m_vm->m_export = m_export;
+
+	// Same as a view, a monitor opened before the first frame gets a picture right away
+	m_lib_publish(m_vm);
+}
+
+void cchip8_attach_capture(cchip8 *m_vm, cchip8_capture *m_capture)
+{
+	m_vm->m_capture = m_capture;
+}
+
+void cchip8_pause_publishing(cchip8 *m_vm, bool m_paused)
+{
+	m_vm->m_paused = m_paused;
+}
+
+bool cchip8_last_writer(const cchip8 *m_vm, uint16_t m_address, uint16_t *m_pc, uint64_t *m_age)
+{
+	if (m_vm->m_journal == NULL)
+	{
+		return false;
+	}
+
+	return m_journal_writer(m_vm->m_journal, offsetof(m_chip8, m_memory) + (m_address & (FOURKiB - 1)), m_pc, m_age);
+}
@@ -0,0 +1,313 @@
+#include "include/cchip8.h"
+#include "include/cchip8_loader.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct cchip8_archive
+{
+	// The whole archive file
+	m_rom m_file;
+
+	size_t m_count;
+};
+
+bool m_rom_map(m_rom *m_rom, const char *m_filename)
+{
+	memset(m_rom, 0, sizeof(*m_rom));
+
+#if defined(__unix__) || defined(__APPLE__)
+	int m_fd = open(m_filename, O_RDONLY);
+
+	if (m_fd < 0)
+	{
+		m_log("Could not open %s", m_filename);
+		return false;
+	}
+
+	struct stat m_stat;
+
+	if ((fstat(m_fd, &m_stat) != 0) || (S_ISREG(m_stat.st_mode) == false))
+	{
+		m_log("%s is not a regular file", m_filename);
+		close(m_fd);
+		return false;
+	}
+
+	m_rom->m_size = (size_t) m_stat.st_size;
+
+	// mmap refuses empty mappings, an empty file is just an empty ROM
+	if (m_rom->m_size > 0)
+	{
+		void *m_view = mmap(NULL, m_rom->m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+
+		if (m_view == MAP_FAILED)
+		{
+			m_log("Could not map %s", m_filename);
+			close(m_fd);
+			return false;
+		}
+
+		m_rom->m_data = m_view;
+		m_rom->m_mapped = true;
+	}
+
+	// The mapping keeps the file alive
+	close(m_fd);
+
+	return true;
+#else
+	FILE *m_file = fopen(m_filename, "rb");
+
+	if (m_file == NULL)
+	{
+		m_log("Could not open %s", m_filename);
+		return false;
+	}
+
+	fseek(m_file, 0, SEEK_END);
+	long m_size = ftell(m_file);
+	fseek(m_file, 0, SEEK_SET);
+
+	if (m_size < 0)
+	{
+		fclose(m_file);
+		return false;
+	}
+
+	uint8_t *m_buffer = malloc((m_size > 0) ? (size_t) m_size : 1);
+
+	if ((m_buffer == NULL) || (fread(m_buffer, 1, (size_t) m_size, m_file) != (size_t) m_size))
+	{
+		m_log("Could not read %s", m_filename);
+		free(m_buffer);
+		fclose(m_file);
+		return false;
+	}
+
+	fclose(m_file);
+
+	m_rom->m_data = m_buffer;
+	m_rom->m_size = (size_t) m_size;
+
+	return true;
+#endif
+}
+
+void m_rom_unmap(m_rom *m_rom)
+{
+#if defined(__unix__) || defined(__APPLE__)
+	if (m_rom->m_mapped == true)
+	{
+		munmap((void *) m_rom->m_data, m_rom->m_size);
+	}
+#endif
+
+	if (m_rom->m_mapped == false)
+	{
+		free((void *) m_rom->m_data);
+	}
+
+	memset(m_rom, 0, sizeof(*m_rom));
+}
+
+/*
+	Read a whole file into m_buffer, failing if it's larger than m_capacity.
+	Single ROMs are tiny, so a bounded read() is cheaper than setting up and tearing down a mapping.
+*/
+bool m_rom_read(const char *m_filename, uint8_t *m_buffer, size_t m_capacity, size_t *m_size)
+{
+	*m_size = 0;
+
+#if defined(__unix__) || defined(__APPLE__)
+	int m_fd = open(m_filename, O_RDONLY);
+
+	if (m_fd < 0)
+	{
+		m_log("Could not open %s", m_filename);
+		return false;
+	}
+
+	struct stat m_stat;
+
+	if ((fstat(m_fd, &m_stat) != 0) || (S_ISREG(m_stat.st_mode) == false))
+	{
+		m_log("%s is not a regular file", m_filename);
+		close(m_fd);
+		return false;
+	}
+
+	if ((size_t) m_stat.st_size > m_capacity)
+	{
+		m_log("%s doesn't fit in memory (%zu bytes, at most %zu)", m_filename, (size_t) m_stat.st_size, m_capacity);
+		close(m_fd);
+		return false;
+	}
+
+	// read() may return less than asked for, keep going until the end of the file
+	while (*m_size < (size_t) m_stat.st_size)
+	{
+		ssize_t m_read = read(m_fd, &m_buffer[*m_size], (size_t) m_stat.st_size - *m_size);
+
+		if (m_read <= 0)
+		{
+			m_log("Could not read %s", m_filename);
+			close(m_fd);
+			return false;
+		}
+
+		*m_size += (size_t) m_read;
+	}
+
+	close(m_fd);
+
+	return true;
+#else
+	FILE *m_file = fopen(m_filename, "rb");
+
+	if (m_file == NULL)
+	{
+		m_log("Could not open %s", m_filename);
+		return false;
+	}
+
+	// Ask for one byte more than fits to notice oversized files
+	*m_size = fread(m_buffer, 1, m_capacity, m_file);
+	bool m_oversized = (fgetc(m_file) != EOF);
+
+	fclose(m_file);
+
+	if (m_oversized == true)
+	{
+		m_log("%s doesn't fit in memory (At most %zu bytes)", m_filename, m_capacity);
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+bool cchip8_load_rom_from_file(cchip8 *m_vm, const char *m_filename)
+{
+	uint8_t m_buffer[CCHIP8_MAX_ROM_SIZE];
+	size_t m_size = 0;
+
+	if (m_rom_read(m_filename, m_buffer, sizeof(m_buffer), &m_size) == false)
+	{
+		return false;
+	}
+
+	if (m_size == 0)
+	{
+		m_log("%s is empty", m_filename);
+		return false;
+	}
+
+	return cchip8_load_rom_from_memory(m_vm, m_buffer, m_size);
+}
+
+cchip8_archive *cchip8_archive_open(const char *m_filename)
+{
+	cchip8_archive *m_archive = calloc(1, sizeof(cchip8_archive));
+
+	if (m_archive == NULL)
+	{
+		return NULL;
+	}
+
+	if (m_rom_map(&m_archive->m_file, m_filename) == false)
+	{
+		free(m_archive);
+		return NULL;
+	}
+
+	const uint8_t *m_data = m_archive->m_file.m_data;
+	const size_t m_size = m_archive->m_file.m_size;
+
+	if ((m_size < M_ARCHIVE_HEADER_SIZE) || (memcmp(m_data, M_ARCHIVE_MAGIC, 4) != 0) ||
+		(m_read_le32(&m_data[4]) != M_ARCHIVE_VERSION))
+	{
+		m_log("%s is not a CCHIP8 archive", m_filename);
+		cchip8_archive_close(m_archive);
+		return NULL;
+	}
+
+	m_archive->m_count = m_read_le32(&m_data[8]);
+
+	// Validate every entry once, the accessors then trust the table
+	bool m_valid = (m_archive->m_count <= (m_size - M_ARCHIVE_HEADER_SIZE) / M_ARCHIVE_ENTRY_SIZE);
+
+	for (size_t i = 0; m_valid && (i < m_archive->m_count); i++)
+	{
+		const uint8_t *m_entry = &m_data[M_ARCHIVE_HEADER_SIZE + i * M_ARCHIVE_ENTRY_SIZE];
+		uint64_t m_offset = m_read_le32(&m_entry[0]);
+		uint64_t m_length = m_read_le32(&m_entry[4]);
+		uint64_t m_name = m_read_le32(&m_entry[8]);
+
+		m_valid = ((m_offset + m_length) <= m_size) && (m_name < m_size) &&
+			(memchr(&m_data[m_name], '\0', m_size - m_name) != NULL);
+	}
+
+	if (m_valid == false)
+	{
+		m_log("%s is truncated or corrupt", m_filename);
+		cchip8_archive_close(m_archive);
+		return NULL;
+	}
+
+	return m_archive;
+}
+
+void cchip8_archive_close(cchip8_archive *m_archive)
+{
+	if (m_archive == NULL)
+	{
+		return;
+	}
+
+	m_rom_unmap(&m_archive->m_file);
+	free(m_archive);
+}
+
+size_t cchip8_archive_count(const cchip8_archive *m_archive)
+{
+	return m_archive->m_count;
+}
+
+const char *cchip8_archive_name(const cchip8_archive *m_archive, size_t m_index)
+{
+	if (m_index >= m_archive->m_count)
+	{
+		return NULL;
+	}
+
+	const uint8_t *m_entry = &m_archive->m_file.m_data[M_ARCHIVE_HEADER_SIZE + m_index * M_ARCHIVE_ENTRY_SIZE];
+
+	return (const char *) &m_archive->m_file.m_data[m_read_le32(&m_entry[8])];
+}
+
+const uint8_t *cchip8_archive_rom(const cchip8_archive *m_archive, size_t m_index, size_t *m_size)
+{
+	if (m_index >= m_archive->m_count)
+	{
+		return NULL;
+	}
+
+	const uint8_t *m_entry = &m_archive->m_file.m_data[M_ARCHIVE_HEADER_SIZE + m_index * M_ARCHIVE_ENTRY_SIZE];
+
+	*m_size = m_read_le32(&m_entry[4]);
+
+	return &m_archive->m_file.m_data[m_read_le32(&m_entry[0])];
+}
+
+bool cchip8_load_rom_from_archive(cchip8 *m_vm, const cchip8_archive *m_archive, size_t m_index)
+{
+	size_t m_size = 0;
+	const uint8_t *m_data = cchip8_archive_rom(m_archive, m_index, &m_size);
+
+	return (m_data != NULL) && cchip8_load_rom_from_memory(m_vm, m_data, m_size);
+}
@@ -0,0 +1,161 @@
+#include "include/cchip8_runahead.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+bool m_runahead_init(m_runahead *m_runahead, uint32_t m_frames)
+{
+	memset(m_runahead, 0, sizeof(*m_runahead));
+
+	m_runahead->m_frames = (m_frames > M_RUNAHEAD_MAX_FRAMES) ? M_RUNAHEAD_MAX_FRAMES : m_frames;
+
+	if (m_runahead->m_frames == 0)
+	{
+		return true;
+	}
+
+	m_runahead->m_state = cchip8_state_create();
+
+	return m_runahead->m_state != NULL;
+}
+
+void m_runahead_input(m_runahead *m_runahead)
+{
+	// Only an idle screen tells when the input got a reaction, an animating one changes regardless
+	if ((m_runahead->m_measuring == false) && m_runahead->m_idle)
+	{
+		m_runahead->m_measuring = true;
+		m_runahead->m_age = 0;
+		m_runahead->m_reallatency = 0;
+		m_runahead->m_shownlatency = 0;
+	}
+}
+
+// Advance the running latency measurement by one frame
+static void m_runahead_measure(m_runahead *m_runahead, bool m_realchanged, bool m_shownchanged)
+{
+	m_runahead->m_idle = (m_realchanged == false) && (m_shownchanged == false);
+
+	if (m_runahead->m_measuring == false)
+	{
+		return;
+	}
+
+	m_runahead->m_age++;
+
+	if (m_realchanged && (m_runahead->m_reallatency == 0))
+	{
+		m_runahead->m_reallatency = m_runahead->m_age;
+	}
+
+	if (m_shownchanged && (m_runahead->m_shownlatency == 0))
+	{
+		m_runahead->m_shownlatency = m_runahead->m_age;
+	}
+
+	if ((m_runahead->m_reallatency != 0) && (m_runahead->m_shownlatency != 0))
+	{
+		m_runahead->m_realsum += m_runahead->m_reallatency;
+		m_runahead->m_shownsum += m_runahead->m_shownlatency;
+		m_runahead->m_samples++;
+		m_runahead->m_measuring = false;
+	} else if (m_runahead->m_age >= M_RUNAHEAD_PATIENCE)
+	{
+		m_runahead->m_measuring = false;
+	}
+}
+
+const uint32_t *m_runahead_frame(m_runahead *m_runahead, cchip8 *m_vm, bool *m_changed)
+{
+	const size_t m_size = sizeof(m_runahead->m_picture);
+
+	// The real frame's picture, without consuming the embedder's changed flag
+	const uint32_t *m_framebuffer = cchip8_get_framebuffer(m_vm, NULL);
+	bool m_realchanged = memcmp(m_runahead->m_real, m_framebuffer, m_size) != 0;
+
+	if (m_realchanged)
+	{
+		memcpy(m_runahead->m_real, m_framebuffer, m_size);
+	}
+
+	uint64_t m_start = SDL_GetPerformanceCounter();
+
+	// The frames ahead never happen for real, views and exports keep showing the real timeline
+	cchip8_pause_publishing(m_vm, true);
+
+	cchip8_save_state(m_vm, m_runahead->m_state);
+
+	uint64_t m_saved = SDL_GetPerformanceCounter();
+
+	// A fault in the future is the real timeline's business once it gets there, show what's there until then
+	cchip8_run_frames(m_vm, m_runahead->m_frames);
+
+	m_framebuffer = cchip8_get_framebuffer(m_vm, NULL);
+	*m_changed = memcmp(m_runahead->m_picture, m_framebuffer, m_size) != 0;
+
+	if (*m_changed)
+	{
+		memcpy(m_runahead->m_picture, m_framebuffer, m_size);
+	}
+
+	uint64_t m_ahead = SDL_GetPerformanceCounter();
+
+	cchip8_load_state(m_vm, m_runahead->m_state);
+
+	cchip8_pause_publishing(m_vm, false);
+
+	uint64_t m_end = SDL_GetPerformanceCounter();
+
+	m_runahead->m_snapshotticks += (m_saved - m_start) + (m_end - m_ahead);
+	m_runahead->m_aheadticks += m_ahead - m_saved;
+	m_runahead->m_runs++;
+
+	m_runahead_measure(m_runahead, m_realchanged, *m_changed);
+
+	return m_runahead->m_picture;
+}
+
+bool m_runahead_latency(const m_runahead *m_runahead, double *m_real, double *m_shown)
+{
+	if (m_runahead->m_samples == 0)
+	{
+		return false;
+	}
+
+	*m_real = (double) m_runahead->m_realsum / (double) m_runahead->m_samples;
+	*m_shown = (double) m_runahead->m_shownsum / (double) m_runahead->m_samples;
+
+	return true;
+}
+
+void m_runahead_print(const m_runahead *m_runahead)
+{
+	double m_real = 0.0;
+	double m_shown = 0.0;
+
+	if (m_runahead->m_frames == 0)
+	{
+		return;
+	}
+
+	printf("Run-ahead: %u frames\n", m_runahead->m_frames);
+
+	if (m_runahead_latency(m_runahead, &m_real, &m_shown))
+	{
+		printf("Input latency: %.2f frames without run-ahead, %.2f with it (%.1f ms less, %llu input changes measured)\n",
+			m_real, m_shown, (m_real - m_shown) * (1000.0 / 60.0), (unsigned long long) m_runahead->m_samples);
+	} else {
+		printf("Input latency: no input change got a reaction on an idle screen, nothing measured\n");
+	}
+}
+
+void m_runahead_destroy(m_runahead *m_runahead)
+{
+	if (m_runahead->m_state != NULL)
+	{
+		cchip8_state_destroy(m_runahead->m_state);
+		m_runahead->m_state = NULL;
+	}
+}
@@ -0,0 +1,37 @@
+#include "include/cchip8_sdl.h"
+
+#include <stdio.h>
+
+// SDL2 Icon using RAW Data Method by blog.gibson.sh
+void SDL_SetWindowIconFromRAW(SDL_Window* m_window)
+{
+  #include "include/cchip8_icn.h"
+
+  uint32_t rmask, gmask, bmask, amask;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+  int shift = (m_cchip8_icn.bytes_per_pixel == 3) ? 8 : 0;
+  rmask = 0xff000000 >> shift;
+  gmask = 0x00ff0000 >> shift;
+  bmask = 0x0000ff00 >> shift;
+  amask = 0x000000ff >> shift;
+#else
+  rmask = 0x000000ff;
+  gmask = 0x0000ff00;
+  bmask = 0x00ff0000;
+  amask = (m_cchip8_icn.bytes_per_pixel == 3) ? 0 : 0xff000000;
+#endif
+
+  SDL_Surface* m_icon = SDL_CreateRGBSurfaceFrom((void*)m_cchip8_icn.pixel_data,
+      m_cchip8_icn.width, m_cchip8_icn.height, m_cchip8_icn.bytes_per_pixel*8,
+      m_cchip8_icn.bytes_per_pixel*m_cchip8_icn.width, rmask, gmask, bmask, amask);
+
+  // Check if surface could not be made
+  if (m_icon == NULL)
+  {
+  	printf("Could not create SDL2 Surface: %s\n", SDL_GetError());
+  }
+
+  SDL_SetWindowIcon(m_window, m_icon);
+
+  SDL_FreeSurface(m_icon);
+}
\ No newline at end of file
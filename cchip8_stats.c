@@ -0,0 +1,74 @@
+#include "include/cchip8_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reset the frame-time statistics
+void m_frametimes_init(m_frametimes *m_stats)
+{
+	memset(m_stats, 0, sizeof(*m_stats));
+}
+
+// Store a host frame time (In milliseconds) inside the ring buffer
+void m_frametimes_record(m_frametimes *m_stats, double m_ms)
+{
+	m_stats->m_samples[m_stats->m_count % M_FRAMETIME_SAMPLES] = m_ms;
+	m_stats->m_count++;
+}
+
+static int m_compare_doubles(const void *m_a, const void *m_b)
+{
+	double m_x = *(const double *) m_a;
+	double m_y = *(const double *) m_b;
+
+	return (m_x > m_y) - (m_x < m_y);
+}
+
+/*
+	Return the requested percentile (0 to 100) of the recorded frame times.
+	This sorts a copy of the samples, so it's meant to be called on exit, not every frame.
+*/
+double m_frametimes_percentile(const m_frametimes *m_stats, double m_percentile)
+{
+	size_t m_available = (m_stats->m_count < M_FRAMETIME_SAMPLES) ? (size_t) m_stats->m_count : M_FRAMETIME_SAMPLES;
+
+	if (m_available == 0)
+	{
+		return 0.0;
+	}
+
+	double *m_sorted = malloc(sizeof(double) * m_available);
+
+	if (m_sorted == NULL)
+	{
+		return 0.0;
+	}
+
+	memcpy(m_sorted, m_stats->m_samples, sizeof(double) * m_available);
+	qsort(m_sorted, m_available, sizeof(double), m_compare_doubles);
+
+	// Nearest-rank method
+	size_t m_rank = (size_t) ((m_percentile / 100.0) * (double) (m_available - 1) + 0.5);
+
+	double m_result = m_sorted[m_rank];
+
+	free(m_sorted);
+
+	return m_result;
+}
+
+void m_frametimes_print(const m_frametimes *m_stats)
+{
+	if (m_stats->m_count == 0)
+	{
+		printf("No frame-time samples were recorded\n");
+		return;
+	}
+
+	printf("Frame-time statistics (%llu host frames, %llu emulated frames, %llu dropped):\n",
+		(unsigned long long) m_stats->m_count, (unsigned long long) m_stats->m_emulatedframes,
+		(unsigned long long) m_stats->m_droppedframes);
+	printf("  p50: %.3f ms\n", m_frametimes_percentile(m_stats, 50.0));
+	printf("  p99: %.3f ms\n", m_frametimes_percentile(m_stats, 99.0));
+}
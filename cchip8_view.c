@@ -0,0 +1,181 @@
+#include "include/cchip8_view.h"
+
+struct cchip8_view
+{
+	m_view_words m_words;
+	m_view_writer m_writer;
+};
+
+void m_view_init(m_view_words *m_words, m_view_writer *m_writer)
+{
+	atomic_init(&m_words->m_sequence, 0);
+
+	for (size_t i = 0; i < M_VIEW_WORDS; i++)
+	{
+		atomic_init(&m_words->m_words[i], 0);
+	}
+
+	// A blank display packs to the zeroes already there
+	memset(m_writer->m_shadow, 0, sizeof(m_writer->m_shadow));
+	memset(m_writer->m_pixels, 0, sizeof(m_writer->m_pixels));
+}
+
+cchip8_view *cchip8_view_create(void)
+{
+	cchip8_view *m_view = m_aligned_alloc(sizeof(cchip8_view));
+
+	if (m_view != NULL)
+	{
+		m_view_init(&m_view->m_words, &m_view->m_writer);
+	}
+
+	return m_view;
+}
+
+void cchip8_view_destroy(cchip8_view *m_view)
+{
+	m_aligned_free(m_view);
+}
+
+/*
+	Store m_count words from m_bytes as snapshot words m_first onwards, skipping the ones readers
+	already have. Blocks of 4 cache lines get compared with memcmp first, most of them didn't change
+	(Smaller blocks spend more on memcmp calls than they save on words).
+*/
+static inline void m_view_store(m_view_words *m_words, m_view_writer *m_writer, size_t m_first, const uint8_t *m_bytes, size_t m_count)
+{
+	const size_t m_blockwords = (4 * M_CACHELINE) / sizeof(uint64_t);
+
+	for (size_t m_block = 0; m_block < m_count; m_block += m_blockwords)
+	{
+		size_t m_length = ((m_count - m_block) < m_blockwords) ? (m_count - m_block) : m_blockwords;
+
+		if (memcmp(&m_bytes[m_block * sizeof(uint64_t)], &m_writer->m_shadow[m_first + m_block], m_length * sizeof(uint64_t)) == 0)
+		{
+			continue;
+		}
+
+		for (size_t i = m_block; i < (m_block + m_length); i++)
+		{
+			uint64_t m_word;
+			memcpy(&m_word, &m_bytes[i * sizeof(uint64_t)], sizeof(m_word));
+
+			if (m_word != m_writer->m_shadow[m_first + i])
+			{
+				m_writer->m_shadow[m_first + i] = m_word;
+				atomic_store_explicit(&m_words->m_words[m_first + i], m_word, memory_order_relaxed);
+			}
+		}
+	}
+}
+
+void m_view_update(m_view_words *m_words, m_view_writer *m_writer, const m_chip8 *chip8)
+{
+	// Everything but RAM gets built privately first, RAM is compared straight from the machine
+	cchip8_snapshot m_snapshot;
+	uint64_t m_sequence = atomic_load_explicit(&m_words->m_sequence, memory_order_relaxed);
+
+	const size_t m_memoryword = offsetof(cchip8_snapshot, m_memory) / sizeof(uint64_t);
+	const size_t m_tailword = m_memoryword + (FOURKiB / sizeof(uint64_t));
+
+	m_snapshot.m_frame = (m_sequence / 2) + 1;
+	m_snapshot.m_cycles = chip8->m_cycles;
+
+	// Rows that didn't change since the last publish keep their packed bits
+	memcpy(m_snapshot.m_display, &m_writer->m_shadow[offsetof(cchip8_snapshot, m_display) / sizeof(uint64_t)], sizeof(m_snapshot.m_display));
+
+	for (size_t m_row = 0; m_row < CHIP8_ROWS; m_row++)
+	{
+		const uint32_t *m_pixels = &chip8->m_video->m_display[m_row * CHIP8_COLUMNS];
+		uint32_t *m_packed = &m_writer->m_pixels[m_row * CHIP8_COLUMNS];
+
+		if (memcmp(m_pixels, m_packed, CHIP8_COLUMNS * sizeof(uint32_t)) == 0)
+		{
+			continue;
+		}
+
+		memcpy(m_packed, m_pixels, CHIP8_COLUMNS * sizeof(uint32_t));
+		m_snapshot.m_display[m_row] = m_pack_row(m_pixels);
+	}
+
+	memcpy(m_snapshot.m_stack, chip8->m_stack, sizeof(m_snapshot.m_stack));
+	m_snapshot.m_programcounter = chip8->m_programcounter;
+	m_snapshot.m_index = chip8->m_index;
+	m_snapshot.m_keys = 0;
+
+	for (size_t m_key = 0; m_key < CHIP8_KEYS; m_key++)
+	{
+		m_snapshot.m_keys |= (uint16_t) ((chip8->m_keyboard[m_key] != 0) << m_key);
+	}
+
+	memcpy(m_snapshot.m_registers, chip8->m_registers, sizeof(m_snapshot.m_registers));
+	m_snapshot.m_stackp = chip8->m_stackp;
+	m_snapshot.m_delaytimer = m_get_delaytmr(chip8);
+	m_snapshot.m_soundtimer = m_get_soundtmr(chip8);
+	m_snapshot.m_fault = chip8->m_fault;
+
+	// Padding gets published too, keep it from changing every time
+	memset((uint8_t *) &m_snapshot + offsetof(cchip8_snapshot, m_fault) + 1, 0, sizeof(cchip8_snapshot) - offsetof(cchip8_snapshot, m_fault) - 1);
+
+	// Odd: readers copying from here on will throw their copy away. The fence keeps the words below from being stored before it
+	atomic_store_explicit(&m_words->m_sequence, m_sequence + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	const uint8_t *m_bytes = (const uint8_t *) &m_snapshot;
+
+	m_view_store(m_words, m_writer, 0, m_bytes, m_memoryword);
+	m_view_store(m_words, m_writer, m_memoryword, chip8->m_memory, FOURKiB / sizeof(uint64_t));
+	m_view_store(m_words, m_writer, m_tailword, &m_bytes[m_tailword * sizeof(uint64_t)], M_VIEW_WORDS - m_tailword);
+
+	// Even again, releasing the words to whoever loads this value
+	atomic_store_explicit(&m_words->m_sequence, m_sequence + 2, memory_order_release);
+}
+
+void m_view_publish(cchip8_view *m_view, const m_chip8 *chip8)
+{
+	m_view_update(&m_view->m_words, &m_view->m_writer, chip8);
+}
+
+bool m_view_load(const m_view_words *m_words, cchip8_snapshot *m_snapshot)
+{
+	uint8_t *m_bytes = (uint8_t *) m_snapshot;
+
+	for (uint32_t m_attempt = 0; m_attempt < M_VIEW_ATTEMPTS; m_attempt++)
+	{
+		uint64_t m_sequence = atomic_load_explicit(&m_words->m_sequence, memory_order_acquire);
+
+		// A publish is underway, its words aren't worth copying yet
+		if ((m_sequence & 1) != 0)
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < M_VIEW_WORDS; i++)
+		{
+			uint64_t m_word = atomic_load_explicit(&m_words->m_words[i], memory_order_relaxed);
+			memcpy(&m_bytes[i * sizeof(uint64_t)], &m_word, sizeof(m_word));
+		}
+
+		// Keep the loads above from being satisfied after the one below
+		atomic_thread_fence(memory_order_acquire);
+
+		// Nothing got published while we were copying, the copy is consistent
+		if (atomic_load_explicit(&m_words->m_sequence, memory_order_relaxed) == m_sequence)
+		{
+			return m_sequence != 0;
+		}
+	}
+
+	// The writer is stuck in the middle of a publish, m_snapshot holds nothing usable
+	return false;
+}
+
+uint64_t cchip8_view_frame(const cchip8_view *m_view)
+{
+	return atomic_load_explicit(&m_view->m_words.m_sequence, memory_order_acquire) / 2;
+}
+
+bool cchip8_view_read(const cchip8_view *m_view, cchip8_snapshot *m_snapshot)
+{
+	return m_view_load(&m_view->m_words, m_snapshot);
+}
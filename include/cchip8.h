@@ -1,8 +1,13 @@
+#pragma once
+
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdalign.h>
+#include <assert.h>
 
 // For UCHAR_MAX
 #include <limits.h>
@@ -11,7 +16,8 @@
 #include <time.h>
 #endif
 
-#include <SDL2/SDL.h>
+// Public embedding API (cchip8_create...), this header adds the interpreter internals on top
+#include "libcchip8.h"
 
 #if defined(__MINGW32__) || defined(__MINGW64__)
 #include <windows.h>
@@ -34,6 +40,18 @@
 
 #define CHIP8_INITIAL_PC 0x200
 
+// CHIP8 timers (And the emulated display) run at 60 Hz
+#define CHIP8_FRAMERATE 60
+
+// Amount of instructions executed per emulated frame (~600 instructions per second)
+#define CHIP8_CYCLES_PER_FRAME 10
+
+// Breakpoint value that never matches the Program Counter
+#define CHIP8_NO_BREAKPOINT 0xFFFF
+
+// CXNN generator seed for instances that weren't given one (xorshift32 state, must not be 0)
+#define CHIP8_DEFAULT_SEED 0x2545F491
+
 #define M_OPC_0X00(x)  ((x & 0x0F00) >> 8)
 #define M_OPC_00X0(x)  ((x & 0x00F0) >> 4)
 #define M_OPC_000X(x)  (x & 0x000F)
@@ -62,25 +80,48 @@ static const uint8_t m_font[CHIP8_FONT_SIZE] = {
 
 #define CHIP8_SPRITEHEIGHT 8
 
-static const uint8_t m_sdl_keys[CHIP8_KEYS] = {
-    SDLK_x, // 0
-    SDLK_1, // 1
-    SDLK_2, // 2
-    SDLK_3, // 3
-    SDLK_q, // 4
-    SDLK_w, // 5
-    SDLK_e, // 6
-    SDLK_a, // 7
-    SDLK_s, // 8
-    SDLK_d, // 9
-    SDLK_z, // A
-    SDLK_c, // B
-    SDLK_4, // C
-    SDLK_r, // D
-    SDLK_f, // E
-    SDLK_v  // F
+/*
+	Quirk profiles, the ambiguous instructions behave differently depending on the interpreter
+	a ROM was written for. Each profile is a separately compiled interpreter (See cchip8_interp.h).
+*/
+enum m_profile
+{
+	// CCHIP8's historical behaviour: shift VX, FX55/FX65 leave I alone, BNNN uses V0, sprites wrap
+	M_PROFILE_CCHIP8 = 0,
+
+	// COSMAC VIP: shift VY, FX55/FX65 increment I, sprites clip, 8XY1/2/3 reset VF
+	M_PROFILE_VIP,
+
+	// CHIP-48: shift VX, FX55/FX65 add X to I, BXNN uses VX, sprites clip
+	M_PROFILE_CHIP48,
+
+	// SUPER-CHIP: shift VX, FX55/FX65 leave I alone, BXNN uses VX, sprites clip
+	M_PROFILE_SCHIP,
+
+	// Modern interpreters (Octo): shift VY, FX55/FX65 increment I, sprites clip
+	M_PROFILE_MODERN,
+
+	M_PROFILE_COUNT
 };
 
+// Runtime description of a quirk profile
+typedef struct chip8_quirks
+{
+	const char *m_name;
+
+	bool m_shift_vx;
+
+	// 0: I unchanged, 1: I += X + 1, 2: I += X
+	uint8_t m_loadstore;
+
+	bool m_jump_vx;
+
+	bool m_clip;
+
+	bool m_vf_reset;
+
+} m_quirks;
+
 enum m_allreg
 {
 	V0 = 0x0,
@@ -101,29 +142,87 @@ enum m_allreg
 	F = 0xF
 };
 
+// Size of a host cache line, the hot interpreter state is laid out around it
+#define M_CACHELINE 64
+
+/*
+	Cold, host-side video state.
+	DXYN and 00E0 are the only instructions touching it, so it lives in its own allocation
+	instead of sitting between the CPU state and the rest of the interpreter.
+*/
+typedef struct chip8_video
+{
+	// CHIP8 - Output
+	// CHIP8 has a (row:col) 64 by 32 pixel buffer
+	// Declare an array containing (64*32=2048) entries
+	// to address the totality of the video buffer
+	uint32_t m_display[CHIP8_COLUMNS * CHIP8_ROWS];
+
+	// Pixel representation for SDL texture
+	uint32_t m_pixels[CHIP8_COLUMNS * CHIP8_ROWS];
+
+} m_chip8_video;
+
+/*
+	Interpreter state.
+	The first cache line holds everything an instruction reads or writes (Registers, PC, I,
+	cycle counter, flags), the second one the stack and keyboard, and RAM follows them.
+	Use m_chip8_create to get a properly aligned instance with its video state attached.
+*/
 typedef struct chip8
 {
+	/* Cache line 0: CPU state */
+
 	// CHIP8 - Arithmetic Registers
 	uint8_t m_registers[CHIP8_REGISTERS];
 
-	enum m_allreg m_regnames;
-
 	// CHIP8 - Index Register
 	uint16_t m_index;
 
 	// CHIP8 - Program Counter (PC) Register
 	uint16_t m_programcounter;
 
+	// Store current opcode
+	uint16_t m_currentopcode;
+
+	// m_run stops when the Program Counter reaches this address (CHIP8_NO_BREAKPOINT disables it)
+	uint16_t m_breakpoint;
+
 	// CHIP8 - Stack Pointer (SP) Register
-	uint16_t m_stack[CHIP8_MAXSTACKENTRIES];
 	uint8_t m_stackp;
 
-	// CHIP8 - Memory
-	// CHIP8 has a total of 4 KiloBytes (4096 bytes) of
-	// system memory. You can find a CHIP8 memory 
-	// map at http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#0.0
-	// Declare an array containing (4096) entries
-	uint8_t m_memory[FOURKiB];
+	// Quirk profile (enum m_profile) selecting the interpreter variant
+	uint8_t m_profile;
+
+	// This bool will be checked against in the main emulator loop
+	// in order to decide wether to draw or not the screen
+	bool m_redraw;
+
+	// Bool that stores the machine state
+	bool m_isRunning;
+
+	// Why the machine stopped (enum m_fault), M_FAULT_NONE while it can run
+	uint8_t m_fault;
+
+	// Amount of instructions executed since reset (Monotonically increasing)
+	uint64_t m_cycles;
+
+	/*
+		CHIP8 - Timer Registers
+		Timers aren't decremented one by one, instead we store the cycle at which they reach 0
+		and derive their current value from m_cycles when they're read (See m_get_delaytmr).
+		A timer tick lasts CHIP8_CYCLES_PER_FRAME cycles.
+	*/
+	uint64_t m_sounddeadline;
+	uint64_t m_delaydeadline;
+
+	// Predecoded (And fused) instructions used by m_run, NULL if disabled (See cchip8_fusion.h)
+	struct chip8_code *m_code;
+
+	/* Cache line 1: stack and input */
+
+	// CHIP8 - Stack Segment
+	alignas(M_CACHELINE) uint16_t m_stack[CHIP8_MAXSTACKENTRIES];
 
 	// CHIP8 - Input
 	// CHIP8 has 16 total keyboard keys
@@ -131,34 +230,26 @@ typedef struct chip8
 	// to manage keyboard inputs
 	uint8_t m_keyboard[CHIP8_KEYS];
 
-	// CHIP8 - Output
-	// CHIP8 has a (row:col) 64 by 32 pixel buffer
-	// Declare an array containing (64*32=2048) entries
-	// to address the totality of the video buffer
-	uint32_t m_display[CHIP8_COLUMNS * CHIP8_ROWS];
+	// Cold display state (Owned by the instance, see m_chip8_create)
+	m_chip8_video *m_video;
 
-	// Pixel representation for SDL texture
-	uint32_t m_pixels[CHIP8_COLUMNS * CHIP8_ROWS];
+	// CXNN random number generator state, per instance so machines never share global state
+	uint32_t m_rngstate;
 
-	// CHIP8 - Timer Registers
-	uint8_t m_soundtmr;
-	uint8_t m_delaytmr;
-
-	// This bool will be checked against in the main emulator loop
-	// in order to decide wether to draw or not the screen
-	bool m_redraw;
+	/* Cache line 2 onwards: RAM */
 
-	// Bool that stores the machine state
-	bool m_isRunning;
-
-	// Bool that checks if we've found an unimplemented opcode
-	bool m_isUnimplemented;
-
-	// Store current opcode
-	uint16_t m_currentopcode;
+	// CHIP8 - Memory
+	// CHIP8 has a total of 4 KiloBytes (4096 bytes) of
+	// system memory. You can find a CHIP8 memory 
+	// map at http://devernay.free.fr/hacks/chip8/C8TECH10.HTM#0.0
+	// Declare an array containing (4096) entries
+	alignas(M_CACHELINE) uint8_t m_memory[FOURKiB];
 
 } m_chip8;
 
+static_assert(offsetof(m_chip8, m_code) + sizeof(void *) <= M_CACHELINE, "CPU state must fit in one cache line");
+static_assert(offsetof(m_chip8, m_memory) == 2 * M_CACHELINE, "RAM must follow the CPU state and the stack");
+
 // Current Opcode
 #define M_OPCODE (chip8->m_currentopcode)
 
@@ -191,10 +282,140 @@ typedef struct chip8
 #define NN M_GET_NN_FROM_OPCODE(M_OPCODE)
 #define NNN M_GET_NNN_FROM_OPCODE(M_OPCODE)
 
-#define POP ({SS[SP] = 0; SP--;})
+// 2NNN and 00EE check SP before using these (Stack guards, see enum m_fault), so SP never leaves 0-16
+#define POP ({SP--;})
 #define PUSH(x) ({SS[SP] = x; SP++;})
 
+/*
+	Instruction trace hook, M_TRACE(address, opcode) runs before every instruction is dispatched.
+	It compiles to nothing unless the core is built with -DCCHIP8_TRACE, in which case the program
+	linking the core provides m_trace_map and gets a PC/opcode coverage bitmap (See tools/cchip8_fuzz.c).
+
+	A cell counts how often an instruction form (The opcode without its operands) ran inside a 256 byte
+	page of memory, so the map fills up with what the ROM does instead of every operand it tried.
+*/
+#ifdef CCHIP8_TRACE
+#define M_TRACE_MAP 16384
+
+extern uint8_t m_trace_map[M_TRACE_MAP];
+
+// Opcode with the operands masked out, the 0/E/F families are told apart by their low byte and 5/8/9 by their low nibble
+static inline uint16_t m_trace_form(uint16_t m_opcode)
+{
+	static const uint16_t m_masks[16] = {
+		0xF0FF, 0xF000, 0xF000, 0xF000, 0xF000, 0xF00F, 0xF000, 0xF000,
+		0xF00F, 0xF00F, 0xF000, 0xF000, 0xF000, 0xF000, 0xF0FF, 0xF0FF
+	};
+
+	return m_opcode & m_masks[m_opcode >> 12];
+}
+
+#define M_TRACE(m_address, m_opcode) \
+	(m_trace_map[((((uint32_t) (m_address) >> 8) * 0x9E37u) ^ m_trace_form(m_opcode) ^ (m_trace_form(m_opcode) >> 10)) & (M_TRACE_MAP - 1)]++)
+#else
+#define M_TRACE(m_address, m_opcode) ((void) 0)
+#endif
+
+/*
+	Why a machine stopped. Faults are precise: the faulting instruction doesn't execute (PC still
+	points at it and the cycle isn't counted) and the machine stays stopped until it's reset.
+	The budget faults come from the sandbox in libcchip8 (See cchip8_options), never from the interpreter.
+	Keep in sync with enum cchip8_fault.
+*/
+enum m_fault
+{
+	M_FAULT_NONE = 0,
+
+	// Opcode CCHIP8 doesn't implement (0NNN, SUPER-CHIP instructions...), the machine would spin on it forever
+	M_FAULT_UNIMPLEMENTED,
+
+	// 2NNN with all CHIP8_MAXSTACKENTRIES stack entries in use
+	M_FAULT_STACK_OVERFLOW,
+
+	// 00EE with an empty stack
+	M_FAULT_STACK_UNDERFLOW,
+
+	// The instance's instruction budget ran out
+	M_FAULT_INSTRUCTION_BUDGET,
+
+	// The instance's wall-clock budget ran out
+	M_FAULT_TIME_BUDGET,
+
+	M_FAULT_COUNT
+};
+
+// Human readable fault description ("stack overflow"...)
+const char *m_fault_name(enum m_fault m_fault);
+
+// Reasons for m_run to return
+enum m_runexit
+{
+	// The whole instruction budget was executed
+	M_RUN_BUDGET = 0,
+
+	// 00E0 or DXYN changed the display
+	M_RUN_DRAW,
+
+	// FX0A is waiting for a key (The rest of the budget was spent waiting)
+	M_RUN_KEYWAIT,
+
+	// The machine faulted (m_fault tells why)
+	M_RUN_FAULT,
+
+	// The Program Counter reached m_breakpoint
+	M_RUN_BREAKPOINT
+};
+
+// Cache-line aligned allocations (MinGW has no aligned_alloc), m_size must be a multiple of M_CACHELINE
+static inline void *m_aligned_alloc(size_t m_size)
+{
+#if defined(__MINGW32__) || defined(__MINGW64__)
+	return _aligned_malloc(m_size, M_CACHELINE);
+#else
+	return aligned_alloc(M_CACHELINE, m_size);
+#endif
+}
+
+static inline void m_aligned_free(void *m_ptr)
+{
+#if defined(__MINGW32__) || defined(__MINGW64__)
+	_aligned_free(m_ptr);
+#else
+	free(m_ptr);
+#endif
+}
+
+// Allocate a cache-line aligned, zeroed interpreter with its own video state
+m_chip8 *m_chip8_create(void);
+
+void m_chip8_destroy(m_chip8 *chip8);
+
+// Copy the whole machine state (Video included) from m_src, m_dst keeps its own allocations
+void m_chip8_copy(m_chip8 *m_dst, const m_chip8 *m_src);
+
 void m_exec(m_chip8 *chip8);
 
-// SDL2 Icon using RAW Data Method by blog.gibson.sh
-void SDL_SetWindowIconFromRAW(SDL_Window* m_window);
\ No newline at end of file
+// m_exec for callers that already fetched the opcode at PC (It must be what's stored there)
+void m_exec_fetched(m_chip8 *chip8, uint16_t m_opcode);
+
+// Execute up to m_budget instructions (Or until an event happens) in one go
+enum m_runexit m_run(m_chip8 *chip8, uint32_t m_budget);
+
+const m_quirks *m_get_quirks(enum m_profile m_profile);
+
+enum m_profile m_profile_from_name(const char *m_name);
+
+// One display row packed like cchip8_pack_display does it (Bit X set if pixel X is lit)
+uint64_t m_pack_row(const uint32_t *m_pixels);
+
+// Every row of chip8's display through m_pack_row, for code holding the machine instead of a cchip8
+void m_pack_display(const m_chip8 *chip8, uint64_t m_rows[CHIP8_ROWS]);
+
+// Diagnostic message for the host's log handler (See cchip8_set_log_handler)
+void m_log(const char *m_format, ...) __attribute__((format(printf, 1, 2)));
+
+// Timer accessors, the values are computed from the cycle counter on read
+uint8_t m_get_delaytmr(const m_chip8 *chip8);
+uint8_t m_get_soundtmr(const m_chip8 *chip8);
+void m_set_delaytmr(m_chip8 *chip8, uint8_t m_value);
+void m_set_soundtmr(m_chip8 *chip8, uint8_t m_value);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "cchip8.h"
+
+/*
+	Static ROM analysis:
+	Recursive-descent disassembly starting at CHIP8_INITIAL_PC. Control flow is followed through
+	jumps, calls and skips to build a control-flow graph, the bytes sprites and tables are read from
+	(ANNN followed by DXYN/FX65) are separated from the code, indirect BNNN jumps and stores that
+	land on code (FX33/FX55) are flagged, and the quirk profile the ROM most likely needs is guessed.
+	Nothing gets executed, ROMs with unknown control flow are analysed as far as it can be followed.
+*/
+
+// Per-address flags (m_analysis.m_flags)
+enum m_addrflags
+{
+	// First byte of a reachable instruction
+	M_ADDR_CODE = 1 << 0,
+
+	// Second byte of a reachable instruction
+	M_ADDR_OPERAND = 1 << 1,
+
+	// Read as sprite or table data
+	M_ADDR_DATA = 1 << 2,
+
+	// A basic block starts here
+	M_ADDR_LEADER = 1 << 3,
+
+	// Written by FX33 or FX55
+	M_ADDR_WRITTEN = 1 << 4,
+
+	// Instruction the interpreter doesn't implement (Execution would stop or hang there)
+	M_ADDR_INVALID = 1 << 5
+};
+
+// How a basic block ends
+enum m_blockexit
+{
+	// Runs into the next block
+	M_BLOCK_FALLTHROUGH = 0,
+
+	// 1NNN
+	M_BLOCK_JUMP,
+
+	// 2NNN (Successors: the subroutine and the return address)
+	M_BLOCK_CALL,
+
+	// 00EE
+	M_BLOCK_RETURN,
+
+	// 3XNN/4XNN/5XY0/9XY0/EX9E/EXA1 (Successors: next and skipped-to instruction)
+	M_BLOCK_SKIP,
+
+	// BNNN, target only known at run time
+	M_BLOCK_INDIRECT,
+
+	// Jump to itself, an unimplemented opcode or the end of memory
+	M_BLOCK_HALT
+};
+
+typedef struct chip8_block
+{
+	// First instruction and the address right after the last one
+	uint16_t m_start;
+	uint16_t m_end;
+
+	// Up to 2 successors (CHIP8_NO_BREAKPOINT if unused)
+	uint16_t m_next[2];
+
+	// enum m_blockexit
+	uint8_t m_exit;
+
+} m_block;
+
+/*
+	Largest amount of blocks a 4 KiB image can produce: one per leader, and since jumps can land on
+	odd addresses every byte that still has room for an instruction (0x000-0xFFE) can be a leader.
+	Overlapping misaligned code can exceed FOURKiB / 2 blocks, so the array covers all of them and
+	never truncates.
+*/
+#define M_ANALYSIS_MAX_BLOCKS (FOURKiB - 1)
+
+// Largest amount of individually reported sites (Indirect jumps, self-modifying stores)
+#define M_ANALYSIS_MAX_SITES 64
+
+typedef struct chip8_analysis
+{
+	// enum m_addrflags for every byte of memory
+	uint8_t m_flags[FOURKiB];
+
+	// Basic blocks, sorted by start address
+	m_block m_blocks[M_ANALYSIS_MAX_BLOCKS];
+	size_t m_blockcount;
+
+	size_t m_instructions;
+	size_t m_codebytes;
+	size_t m_databytes;
+
+	// BNNN sites
+	uint16_t m_indirect[M_ANALYSIS_MAX_SITES];
+	size_t m_indirectcount;
+
+	// FX33/FX55 sites whose store lands on reachable code
+	uint16_t m_selfmodifying[M_ANALYSIS_MAX_SITES];
+	size_t m_selfmodifyingcount;
+
+	// Instructions that only exist on SUPER-CHIP (00FX, 00CN, FX30, FX75...)
+	size_t m_schipopcodes;
+
+	// Quirk votes, per enum m_profile, and the profile with most of them
+	uint32_t m_votes[M_PROFILE_COUNT];
+	enum m_profile m_profile;
+
+} m_analysis;
+
+// Whether CCHIP8's interpreter implements an opcode
+bool m_opcode_valid(uint16_t m_opcode);
+
+/*
+	Analyse m_memory (A full 4 KiB image, font included) starting at CHIP8_INITIAL_PC.
+	m_analysis is large (~50 KiB), allocate it on the heap.
+*/
+void m_analyse(m_analysis *m_analysis, const uint8_t *m_memory);
+
+// Human readable description of the evidence behind the profile guess
+void m_analysis_print(const m_analysis *m_analysis, FILE *m_out);
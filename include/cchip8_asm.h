@@ -0,0 +1,74 @@
+#pragma once
+
+#include "cchip8.h"
+
+/*
+	Assembly syntax shared by cchip8-dis and cchip8-asm (Cowgod's mnemonics):
+
+		L200:               Label, the disassembler names them after their address
+			LD I, L20C      Instruction, operands separated by commas
+			DRW V0, V1, 5
+		L20C:
+			db 0xF0, 0x90   Raw bytes (dw emits big endian 16 bit words)
+		; Comment
+
+	Both directions go through one table of opcode forms, and a form only exists for opcodes
+	m_exec implements, so whatever the disassembler prints assembles back to the same bytes.
+	Anything else (Unreached bytes, sprites, SUPER-CHIP opcodes...) is printed as db.
+*/
+
+// Amount of opcode forms in the table (CLS, RET, JP addr, ... LD Vx, [I])
+#define M_ASM_FORMS 34
+
+// Opcode statistics bucket counting bytes emitted as data
+#define M_ASM_DATA M_ASM_FORMS
+
+// Growable text buffer the disassembler writes into
+typedef struct chip8_text
+{
+	char *m_data;
+	size_t m_length;
+	size_t m_capacity;
+
+} m_text;
+
+void m_text_free(m_text *m_text);
+
+// What the disassembler found in a ROM
+typedef struct chip8_asm_stats
+{
+	// Instructions per opcode form, data bytes in the last bucket
+	uint64_t m_opcodes[M_ASM_FORMS + 1];
+
+	uint64_t m_codebytes;
+	uint64_t m_databytes;
+
+	// Quirk profile the static analysis guessed
+	enum m_profile m_profile;
+
+} m_asm_stats;
+
+// Where assembling failed
+typedef struct chip8_asm_error
+{
+	size_t m_line;
+	char m_message[128];
+
+} m_asm_error;
+
+// Human readable name of an opcode form ("LD Vx, byte"), M_ASM_DATA gives "db"
+const char *m_asm_form_name(size_t m_form);
+
+/*
+	Disassemble a ROM (Loaded at CHIP8_INITIAL_PC) into m_out.
+	Code is told apart from data by following the control flow (See cchip8_analysis.h), m_linear
+	instead disassembles every aligned opcode the interpreter implements. m_stats may be NULL.
+*/
+bool m_disassemble(const uint8_t *m_rom, size_t m_size, bool m_linear, m_text *m_out, m_asm_stats *m_stats);
+
+/*
+	Assemble m_length bytes of source for CHIP8_INITIAL_PC into m_output.
+	Returns false with m_error filled in on the first error.
+*/
+bool m_assemble(const char *m_source, size_t m_length, uint8_t *m_output, size_t m_capacity, size_t *m_size,
+	m_asm_error *m_error);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "cchip8.h"
+
+/*
+	Lockstep batch interpreter:
+	Runs many m_chip8 instances of the same ROM (With different inputs) side by side.
+	The hot registers are stored as struct-of-arrays, so when every lane of a warp sits at the
+	same PC with the same opcode, the instruction executes for the whole warp with SIMD vector
+	operations. Everything else (Draws, stack, memory and timer instructions, divergent lanes)
+	is drained through the scalar m_exec, one lane at a time.
+*/
+
+// Lanes executed together, 32 byte-lanes fill an AVX2 register (Build with -DM_BATCH_WARP=64 for AVX-512)
+#ifndef M_BATCH_WARP
+#define M_BATCH_WARP 32
+#endif
+
+// Lockstep steps between two regrouping checks
+#define M_BATCH_ROUND 64
+
+typedef struct chip8_batch
+{
+	// Amount of instances and of lane slots (Rounded up to a whole warp)
+	size_t m_count;
+	size_t m_slots;
+
+	// Struct-of-arrays hot state, indexed by lane slot: m_v[register][slot]
+	uint8_t *m_v[CHIP8_REGISTERS];
+	uint16_t *m_index;
+	uint16_t *m_pc;
+
+	// Whether the slot holds a running instance (Padding slots and faulted instances don't)
+	uint8_t *m_active;
+
+	// Instance held by each slot, regrouping permutes the slots
+	uint32_t *m_lane;
+
+	// Cold per-instance state (Memory, stack, keyboard, timers), indexed by instance
+	m_chip8 *m_instances;
+
+	// Display of each instance, kept apart so the instances stay densely packed
+	m_chip8_video *m_videos;
+
+	// Quirks of the profile every instance runs with (The vector path honours them too)
+	const m_quirks *m_quirks;
+
+	// Cycle every running instance is at (They all advance in lockstep)
+	uint64_t m_cycles;
+
+	// Warp-steps executed with vectors and lane-steps drained through m_exec
+	uint64_t m_vectorsteps;
+	uint64_t m_scalarsteps;
+
+	// Amount of times the lanes got regrouped by PC
+	uint64_t m_regroups;
+
+} m_batch;
+
+// Create m_count instances, each one a copy of m_template (Which must have no predecode cache attached)
+m_batch *m_batch_create(size_t m_count, const m_chip8 *m_template);
+
+void m_batch_destroy(m_batch *m_lanes);
+
+// Execute m_steps instructions on every running instance
+void m_batch_run(m_batch *m_lanes, uint32_t m_steps);
+
+// Write the struct-of-arrays registers back to m_instances (Call before inspecting them)
+void m_batch_sync(m_batch *m_lanes);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "cchip8.h"
+
+/*
+	Capture stream (.c8v), written by cchip8_capture and read back by cchip8-convert:
+		header:  "CCHIP8V" | uint8 version | uint16 columns | uint16 rows | uint16 frames per second
+		records: varint frames since the previous record (From the start of the capture for the
+		         first one, never 0) | the display, RLE coded
+		end:     varint 0 | varint frames the last picture stayed on screen after its own (Missing if the writer died)
+	Integers are little endian, varints are LEB128. A record's display is packed one bit per pixel
+	(Row-major, 8 pixels per byte, leftmost in the most significant bit), XORed with the previous
+	record's (All zeroes before the first one) and RLE coded as tokens:
+		0x00-0x7F  that many plus one zero bytes
+		0x80-0xFF  that many minus 0x7F literal bytes follow
+	Only frames whose picture changed get a record, an idle screen costs nothing.
+*/
+
+#define M_CAPTURE_MAGIC "CCHIP8V"
+#define M_CAPTURE_VERSION 1
+#define M_CAPTURE_HEADER 14
+
+// Bytes of a packed display
+#define M_CAPTURE_FRAME ((CHIP8_COLUMNS * CHIP8_ROWS) / 8)
+
+// Frames the emulation thread can get ahead of the writer thread (Over a second at 60 Hz)
+#define M_CAPTURE_SLOTS 128
+
+// Emulation thread: hand the display over if it changed, m_frames (At least 1) emulated frames after the previous call
+void m_capture_frame(cchip8_capture *m_capture, const uint32_t *m_display, uint32_t m_frames);
+
+typedef struct chip8_capture_reader
+{
+	FILE *m_file;
+
+	uint16_t m_columns;
+	uint16_t m_rows;
+	uint16_t m_framerate;
+
+	// The last record's picture (Packed) and the frame it appeared on (Counted from 1)
+	uint8_t m_display[M_CAPTURE_FRAME];
+	uint64_t m_frame;
+
+	// Frames the last picture stayed on screen counting its own, known once m_capture_next returned false (0 before)
+	uint64_t m_trailing;
+
+} m_capture_reader;
+
+// Prints why and returns false if m_filename isn't a capture stream this version reads
+bool m_capture_open(m_capture_reader *m_reader, const char *m_filename);
+
+// Decode the next record into m_display / m_frame, false at the end of the stream (Or where it got cut off)
+bool m_capture_next(m_capture_reader *m_reader);
+
+void m_capture_close(m_capture_reader *m_reader);
+
+// Pixel (m_column, m_row) of a packed display
+static inline bool m_capture_pixel(const uint8_t *m_display, size_t m_column, size_t m_row)
+{
+	size_t m_bit = (m_row * CHIP8_COLUMNS) + m_column;
+
+	return (m_display[m_bit / 8] >> (7 - (m_bit % 8))) & 1;
+}
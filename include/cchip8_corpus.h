@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+	ROM corpus walking for the batch tools:
+	Files and directories (Searched recursively) given on the command line are collected into one
+	list, then a pool of threads works through it, each thread pulling the next file as soon as it
+	finished the previous one so a few big ROMs can't hold up the rest.
+*/
+
+typedef struct chip8_corpus
+{
+	char **m_paths;
+	size_t m_count;
+	size_t m_capacity;
+
+} m_corpus;
+
+/*
+	Add a file (Taken as is) or every file below a directory whose name ends with one of
+	m_extensions (NULL terminated list). Prints why and returns false on failure.
+*/
+bool m_corpus_add(m_corpus *m_corpus, const char *m_path, const char *const *m_extensions);
+
+void m_corpus_free(m_corpus *m_corpus);
+
+bool m_corpus_is_directory(const char *m_path);
+
+// Called once per file, m_worker (0 to threads - 1) tells which thread runs it
+typedef void (*m_corpus_job)(void *m_context, size_t m_worker, const char *m_path);
+
+// Amount of threads m_corpus_run uses when asked for 0 (One per online CPU, 1 where there is no thread pool)
+size_t m_corpus_threads(void);
+
+// Run m_job over every file with m_threads threads (0 = m_corpus_threads()), returns once all are done
+void m_corpus_run(const m_corpus *m_corpus, size_t m_threads, m_corpus_job m_job, void *m_context);
+
+// Called once per item, m_item goes from 0 to the count given to m_corpus_for - 1
+typedef void (*m_corpus_item)(void *m_context, size_t m_worker, size_t m_item);
+
+// The same pool over work that isn't a list of files (Manifest entries for example)
+void m_corpus_for(size_t m_count, size_t m_threads, m_corpus_item m_job, void *m_context);
+
+/*
+	Output file for m_input: its name with the extension swapped for m_extension, inside m_directory
+	(Or next to the input if m_directory is NULL). False if it doesn't fit in m_size.
+*/
+bool m_corpus_output(char *m_output, size_t m_size, const char *m_directory, const char *m_input, const char *m_extension);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "cchip8.h"
+#include "cchip8_view.h"
+
+/*
+	Shared memory segment behind cchip8_export and cchip8_monitor. Its layout is public (See
+	libcchip8.h), the asserts below keep this struct and the documented offsets in sync.
+*/
+typedef struct chip8_export_segment
+{
+	// CCHIP8_EXPORT_MAGIC once the segment is ready (Stored last)
+	_Atomic uint32_t m_magic;
+	uint32_t m_version;
+	uint32_t m_size;
+	uint32_t m_snapshotsize;
+
+	// Futex word: low 32 bits of the publications so far, and the readers sleeping on it
+	alignas(M_CACHELINE) _Atomic uint32_t m_frame;
+	_Atomic uint32_t m_waiters;
+
+	// Sequence at 128, snapshot words at 192
+	alignas(M_CACHELINE) m_view_words m_view;
+
+} m_export_segment;
+
+static_assert(offsetof(m_export_segment, m_frame) == 64 && offsetof(m_export_segment, m_waiters) == 68, "Export layout mismatch");
+static_assert(offsetof(m_export_segment, m_view) + offsetof(m_view_words, m_sequence) == 128, "Export layout mismatch");
+static_assert(offsetof(m_export_segment, m_view) + offsetof(m_view_words, m_words) == 192, "Export layout mismatch");
+static_assert(sizeof(_Atomic uint32_t) == sizeof(uint32_t) && sizeof(_Atomic uint64_t) == sizeof(uint64_t), "Atomics must be plain words to be shared");
+
+// Store the machine's current state as the next publication and wake the readers sleeping on it
+void m_export_publish(cchip8_export *m_export, const m_chip8 *chip8);
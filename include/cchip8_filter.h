@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libcchip8.h"
+
+/*
+	Presentation filters:
+	Turns the 64x32 display into the final window-sized ARGB picture on the CPU, so the renderer only
+	uploads one texture and copies it 1:1. Three stages, each one vectorised (GCC vector extensions,
+	SSE2 by default and AVX2/AVX-512 with -march=native):
+		phosphor   lit pixels light up fully and fade by m_persistence/256 per emulated frame once
+		           they're off, which hides the flicker of XOR sprites being erased and redrawn
+		scaler     Scale2x/Scale3x (AdvMAME) rounds off diagonals on the display, nearest doesn't
+		expansion  integer upscale of the result to the output size, darkening the bottom rows of
+		           every pixel with m_scanlines (CRT look)
+	The first two work on the small display, the cost is mostly writing the output once.
+*/
+
+typedef enum chip8_scaler
+{
+	// The value is the smoothing scaler's own factor
+	M_SCALER_NEAREST = 1,
+	M_SCALER_SCALE2X = 2,
+	M_SCALER_SCALE3X = 3,
+
+} m_scaler;
+
+// Bytes of slack after the expansion row, whole vectors get stored past a pixel's last column
+#define M_FILTER_SLACK 64
+
+typedef struct chip8_filter
+{
+	m_scaler m_scaler;
+	uint8_t m_persistence;
+	bool m_scanlines;
+
+	// Output size, and how many output pixels each scaler pixel becomes
+	uint32_t m_width;
+	uint32_t m_height;
+	uint32_t m_factor;
+
+	// Phosphor intensity of every display pixel (0 off, 255 lit)
+	uint8_t m_glow[CCHIP8_WIDTH * CCHIP8_HEIGHT];
+
+	// Whether some pixel is still fading (The output keeps changing without the display changing)
+	bool m_fading;
+
+	// Scaler output (Intensities, m_scaler times the display in both directions)
+	uint8_t *m_scaled;
+
+	// One expanded output row and its scanline version (Each plus M_FILTER_SLACK), then the whole output picture
+	uint32_t *m_row;
+	uint32_t *m_output;
+
+	// ARGB color of every intensity
+	uint32_t m_palette[256];
+
+} m_filter;
+
+/*
+	m_scale is output pixels per display pixel, rounded down to a multiple of the scaler's factor.
+	m_persistence 0 disables the phosphor. False if the buffers couldn't be allocated.
+*/
+bool m_filter_init(m_filter *m_filter, m_scaler m_scaler, uint32_t m_scale, uint8_t m_persistence, bool m_scanlines);
+
+/*
+	Run the stages on m_display, m_frames emulated frames after the previous call (Phosphor fades
+	by that many steps). m_changed tells whether the display changed since then. Returns whether
+	m_output changed, nothing gets computed when it wouldn't.
+*/
+bool m_filter_run(m_filter *m_filter, const uint32_t *m_display, bool m_changed, uint32_t m_frames);
+
+void m_filter_destroy(m_filter *m_filter);
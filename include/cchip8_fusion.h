@@ -0,0 +1,76 @@
+#pragma once
+
+#include "cchip8.h"
+
+/*
+	Superinstruction fusion:
+	Idiomatic instruction sequences get predecoded into a single "fused" entry that the m_run
+	loop executes with one dispatch, leaving exactly the same architectural state behind.
+*/
+enum m_fusion
+{
+	// Plain instruction, executed by the regular interpreter
+	M_FUSE_NONE = 0,
+
+	// 6XNN; 6YNN (Coordinate setup)
+	M_FUSE_LD_LD,
+
+	// ANNN; DXYN (Sprite draw)
+	M_FUSE_LDI_DRW,
+
+	// ANNN; FX65 (Table load)
+	M_FUSE_LDI_LOAD,
+
+	// 7XNN; 3YNN; 1NNN (Counted loop)
+	M_FUSE_ADD_SKIP_JMP,
+
+	M_FUSE_KINDS
+};
+
+// A single predecoded entry, there's one per RAM address (Instructions can be misaligned)
+typedef struct chip8_decoded
+{
+	// Instructions covered by this entry (Only the first m_length are meaningful)
+	uint16_t m_opcodes[3];
+
+	// enum m_fusion
+	uint8_t m_fusion;
+
+	// Amount of instructions covered by the entry, 0 means it still has to be decoded
+	uint8_t m_length;
+
+} m_decoded;
+
+typedef struct chip8_code
+{
+	m_decoded m_entries[FOURKiB];
+
+	// Amount of times each fusion got dispatched
+	uint64_t m_fired[M_FUSE_KINDS];
+
+	// Dispatches each fusion avoided (A taken 3YNN skip only covers 2 instructions)
+	uint64_t m_saved[M_FUSE_KINDS];
+
+	// Amount of distinct addresses each fusion got detected at
+	uint64_t m_sites[M_FUSE_KINDS];
+
+	// Fusions ever detected at each address (One bit per kind), re-decoding after an invalidation isn't a new site
+	uint8_t m_detected[FOURKiB];
+
+} m_code;
+
+// Allocate a predecode cache and attach it to the interpreter (m_run starts using it)
+m_code *m_code_create(m_chip8 *chip8);
+
+void m_code_destroy(m_chip8 *chip8);
+
+// Decode (And fuse) the entry at m_address, called lazily by m_run
+void m_code_decode(m_code *m_cache, const uint8_t *m_memory, uint16_t m_address);
+
+// Count m_fusion at m_address in m_sites, unless it was already detected there
+void m_code_count_site(m_code *m_cache, uint16_t m_address, uint8_t m_fusion);
+
+// Forget every entry that could cover [m_address, m_address + m_length)
+void m_code_invalidate(m_code *m_cache, uint16_t m_address, uint16_t m_length);
+
+void m_code_print_stats(const m_code *m_cache, uint64_t m_cycles, FILE *m_out);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "cchip8.h"
+#include "cchip8_runahead.h"
+
+// Default monospace font used by the HUD (Can be overriden with -font)
+#if defined(__MINGW32__) || defined(__MINGW64__)
+#define M_HUD_DEFAULT_FONT "C:\\Windows\\Fonts\\consola.ttf"
+#else
+#define M_HUD_DEFAULT_FONT "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf"
+#endif
+
+#define M_HUD_FONT_SIZE 12
+
+// Amount of text lines the HUD shows
+#define M_HUD_LINES 6
+
+#define M_HUD_LINE_LENGTH 64
+
+// How often (In milliseconds) the measured values get latched into the HUD text
+#define M_HUD_REFRESH_MS 500
+
+// Host-side phases the front end measures
+enum m_hud_phase
+{
+	M_HUD_EXEC = 0,
+	M_HUD_POLL,
+	M_HUD_RENDER,
+	M_HUD_PHASES
+};
+
+typedef struct chip8_hud
+{
+	TTF_Font *m_font;
+
+	// Whether the overlay is drawn or not (Toggled with F1)
+	bool m_visible;
+
+	// One cached texture per line, only re-rendered when its text changes
+	SDL_Texture *m_textures[M_HUD_LINES];
+	char m_text[M_HUD_LINES][M_HUD_LINE_LENGTH];
+	int m_widths[M_HUD_LINES];
+	int m_heights[M_HUD_LINES];
+
+	// Performance counter ticks spent on each phase during the current measurement window
+	uint64_t m_phaseticks[M_HUD_PHASES];
+
+	// Instructions executed and host frames presented during the current measurement window
+	uint64_t m_instructions;
+	uint64_t m_frames;
+
+	// Performance counter value at which the current measurement window started
+	uint64_t m_windowstart;
+
+	// Run-ahead whose cost and measured latency get shown (Its cost counters are cleared on every refresh)
+	m_runahead *m_runahead;
+
+} m_hud;
+
+bool m_hud_init(m_hud *m_overlay, const char *m_fontpath);
+
+// Account the ticks between m_start and now to a phase, returns the current counter value
+uint64_t m_hud_account(m_hud *m_overlay, enum m_hud_phase m_phase, uint64_t m_start);
+
+// Start a new measurement window at m_now (Performance counter value)
+void m_hud_restart(m_hud *m_overlay, uint64_t m_now);
+
+// Refresh the HUD text, returns true if any cached texture was re-rendered
+bool m_hud_update(m_hud *m_overlay, SDL_Renderer *m_renderer, const cchip8 *m_vm);
+
+void m_hud_draw(m_hud *m_overlay, SDL_Renderer *m_renderer);
+
+void m_hud_destroy(m_hud *m_overlay);
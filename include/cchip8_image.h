@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+	Image writers for the batch tools (No external libraries): paletted pictures saved as PNG,
+	animated GIF or a YUV4MPEG2 (Y4M) video stream ffmpeg and most players read as is.
+	PNG and GIF are compressed (Fixed Huffman deflate with run matches, and LZW) so big integer
+	upscales of a 64x32 display stay small.
+*/
+
+typedef struct chip8_color
+{
+	uint8_t m_red;
+	uint8_t m_green;
+	uint8_t m_blue;
+
+} m_color;
+
+// Up to 256 colors, m_pixels holds one palette index per pixel (Row-major)
+typedef struct chip8_image
+{
+	uint32_t m_width;
+	uint32_t m_height;
+	uint8_t *m_pixels;
+
+} m_image;
+
+// Black background, white pixels (Like the front end draws them)
+static const m_color m_image_mono[2] = { { 0x00, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF } };
+
+// Allocate a m_width x m_height picture filled with index 0, false if that fails
+bool m_image_create(m_image *m_image, uint32_t m_width, uint32_t m_height);
+
+void m_image_free(m_image *m_image);
+
+// Index m_index in the m_scale x m_scale block of display pixel (m_column, m_row)
+void m_image_fill(m_image *m_image, uint32_t m_scale, uint32_t m_column, uint32_t m_row, uint8_t m_index);
+
+// Prints why and returns false on failure
+bool m_image_write_png(const m_image *m_image, const m_color *m_palette, size_t m_colors, const char *m_filename);
+
+typedef struct chip8_gif
+{
+	FILE *m_file;
+	uint32_t m_width;
+	uint32_t m_height;
+
+	// Bits per palette index (The LZW minimum code size is at least 2)
+	uint8_t m_depth;
+
+	// LZW dictionary: entry m_codes[code * (1 << m_depth) + index] is the code of that string plus one index (0 = none)
+	uint16_t *m_codes;
+
+	bool m_failed;
+
+} m_gif;
+
+// Looping animated GIF with a global palette (At most 256 colors), prints why and returns false on failure
+bool m_gif_open(m_gif *m_gif, const char *m_filename, uint32_t m_width, uint32_t m_height, const m_color *m_palette, size_t m_colors);
+
+// One picture shown for m_centiseconds
+bool m_gif_frame(m_gif *m_gif, const m_image *m_image, uint16_t m_centiseconds);
+
+// False if anything failed to write
+bool m_gif_close(m_gif *m_gif);
+
+typedef struct chip8_y4m
+{
+	FILE *m_file;
+	uint32_t m_width;
+	uint32_t m_height;
+
+	// One full resolution 4:4:4 frame (Y, Cb and Cr planes)
+	uint8_t *m_planes;
+
+	bool m_failed;
+
+} m_y4m;
+
+// "-" writes to standard output (Piping into ffmpeg), prints why and returns false on failure
+bool m_y4m_open(m_y4m *m_y4m, const char *m_filename, uint32_t m_width, uint32_t m_height, uint32_t m_framerate);
+
+// m_image repeated for m_count frames
+bool m_y4m_frame(m_y4m *m_y4m, const m_image *m_image, const m_color *m_palette, size_t m_colors, uint64_t m_count);
+
+// False if anything failed to write
+bool m_y4m_close(m_y4m *m_y4m);
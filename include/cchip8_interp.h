@@ -0,0 +1,985 @@
+/*
+	CCHIP8 interpreter template.
+
+	This file is included by cchip8_fd.c once per quirk profile (See enum m_profile), with
+	M_PROFILE_SUFFIX, M_PROFILE_NAME and the M_QUIRK_* switches defined beforehand. Each inclusion generates
+	a separately compiled m_step/m_exec/m_run with the profile's behaviour baked in, so the
+	hot loop never tests a quirk at runtime. There's no include guard on purpose.
+
+	M_QUIRK_SHIFT_VX   8XY6/8XYE shift VX in place (0: VX = VY shifted)
+	M_QUIRK_LOADSTORE  FX55/FX65 leave I alone (0), set I to I + X + 1 (1) or to I + X (2)
+	M_QUIRK_JUMP_VX    BNNN jumps to NNN + VX (X being the highest nibble of NNN) instead of NNN + V0
+	M_QUIRK_CLIP       DXYN clips sprites at the screen edges instead of wrapping them around
+	M_QUIRK_VF_RESET   8XY1/8XY2/8XY3 reset VF to 0
+*/
+
+#define M_CONCAT_(name, suffix) name##_##suffix
+#define M_CONCAT(name, suffix) M_CONCAT_(name, suffix)
+#define M_VARIANT(name) M_CONCAT(name, M_PROFILE_SUFFIX)
+
+/*
+	Using switch cases, emulate the already fetched instruction.
+	m_cycle is the cycle the instruction executes at (Needed by the timer instructions).
+	Returns M_RUN_BUDGET if nothing noteworthy happened, or the event that should end a m_run batch.
+*/
+static inline __attribute__((always_inline)) enum m_runexit M_VARIANT(m_step)(m_chip8 *restrict chip8, uint16_t m_opcode,
+	uint16_t *restrict m_pc, uint16_t *restrict m_idx, uint64_t m_cycle)
+{
+	// Event reported back to the caller
+	enum m_runexit m_event = M_RUN_BUDGET;
+
+#if !M_QUIRK_SHIFT_VX
+	// Source operand of the VY-based shifts
+	uint8_t m_shifted;
+#endif
+
+#ifdef DEBUG
+	printf("opcode: 0x%x\n", M_OPCODE);
+#endif
+
+	switch(M_OPCODE & 0xF000)
+	{
+		/*
+			0x0000 opcode subfamily
+		*/
+		case 0x0000:
+			switch (M_OPCODE & 0x00FF)
+			{
+				/*
+					00E0:
+					Clear the screen
+				*/
+				case 0x00E0:
+					// Set each display pixel to 0 (Black)
+					for (int i = 0; i < (CHIP8_ROWS * CHIP8_COLUMNS); ++i)
+					{
+                        chip8->m_video->m_display[i] = 0;
+                    }
+
+                    // Redraw the entire screen with black pixels
+                    chip8->m_redraw = true;
+                    m_event = M_RUN_DRAW;
+
+                    // Increment the Program Counter Register
+                    PC += 2;
+                    break;
+
+                /*
+					00EE:
+					Return from a subroutine
+				*/
+				case 0x00EE:
+					// Stack guard: returning with an empty stack faults (PC stays on the 00EE) instead of wrapping SP around
+					if (__builtin_expect(SP == 0, 0))
+					{
+						chip8->m_fault = M_FAULT_STACK_UNDERFLOW;
+						return M_RUN_FAULT;
+					}
+
+					// Decrease the stack pointer by 1
+					POP;
+
+					// Set the program counter to the stack value pointed by stack pointer
+					PC = SS[SP];
+
+					// Increase the Program Counter by 2 (Returning effectively from the subroutine)
+					PC += 2;
+					break;
+
+				default:
+					// 0NNN (Machine code routines) and anything else CCHIP8 doesn't run, PC would never move past it
+					chip8->m_fault = M_FAULT_UNIMPLEMENTED;
+					return M_RUN_FAULT;
+			}
+
+			// Break from case 0x0000
+			break;
+
+		/*
+			1NNN:
+			Jumps to address NNN.
+		*/
+		case 0x1000:
+			/*
+				Do the same as 2NNN but don't touch the stack, as this is a jump, not a subroutine call where
+				we need to push the return address to the stack.
+
+				Set the program counter to the address NNN found in the current opcode.
+			*/
+			PC = NNN;
+
+#ifdef DEBUG
+			printf("Jumping to 0x%x\n", NNN);
+#endif
+
+			break;
+
+		/*
+			2NNN:
+			Call the subroutine located at 0xNNN
+		*/
+		case 0x2000:
+
+#ifdef DEBUG
+			printf("2NNN (%x) [NNN -> 0x%x]\n", M_OPCODE, NNN);
+			printf("2NNN -> PC: 0x%x\n", PC);
+#endif
+			/*
+				cake (24/10/2021):
+				When I first made the 2NNN implementation, I forgot that I had to push the current program counter
+				address to the stack and update the stack pointer accordingly
+			*/
+
+			// Stack guard: a 17th nested call faults instead of writing past m_stack
+			if (__builtin_expect(SP >= CHIP8_MAXSTACKENTRIES, 0))
+			{
+				chip8->m_fault = M_FAULT_STACK_OVERFLOW;
+				return M_RUN_FAULT;
+			}
+
+			// Push the current program counter to the stack at current stack pointer position
+			PUSH(PC);
+
+			// Set the program counter to the address provided by the opcode
+			PC = NNN;
+
+#ifdef DEBUG
+			printf("2NNN Jumped to: 0x%x\n", PC);
+#endif
+			break;
+
+		/*
+			3XNN:
+			Skips the next instruction if VX equals to NN
+		*/
+		case 0x3000:
+			// Check if X register contains NN bytes
+			if (VX == (NN))
+				// If true, increment PC by 4
+                PC += 4;
+            else
+            	// Else, increment PC by 2
+                PC += 2;
+            break;
+
+        /*
+			4XNN:
+			Skips the next instruction if VX is not equal to NN
+		*/
+        // Tip: It's the inverse of 3XNN
+        case 0x4000:
+			// Check if X register doesn't contain NN bytes
+			if (VX != (NN))
+				// If true, increment PC by 4
+				PC += 4;
+			else
+				// Else, increment PC by 2
+				PC += 2;
+
+			break;
+
+		/*
+			5XY0:
+			Skip the next instruction if VX = VY
+		*/
+		// Tip: The easiest of all the 3XNN-4XNN-5XNN series, checks if VX and VY are the same
+		case 0x5000:
+			if (VX == VY)
+				// Check if X register doesn't contain NN bytes
+				PC += 4;
+			else
+				// Else, increment PC by 2
+				PC += 2;
+
+			break;
+
+		/*
+			6XNN:
+			Set VX to NN
+		*/
+		case 0x6000:
+#ifdef DEBUG
+			printf("6XNN (%x) [NN -> 0x%x]\n", M_OPCODE, M_OPCODE & 0x00FF);
+#endif
+			// Get NN from current opcode and store it into registers[x]
+			VX = NN;
+			// Increment PC by 2
+			PC += 2;
+			break;
+
+		/*
+			7XNN:
+			Adds NN to VX. (Carry flag is not changed);
+		*/
+		case 0x7000:
+			// Calculate VX and add it NN (NN from Current Opcode)
+			VX += NN;
+			// Increment PC by 2
+			PC += 2;
+			break;
+
+		/*
+			0x8000 opcode subfamily
+		*/
+		case 0x8000:
+			// Determine which opcode we're dealing with based on last digit
+			switch (M_OPCODE & 0x000F)
+			{
+				/*
+					8XY0:
+					Set VX to the value of VY
+				*/
+				case 0x0000:
+					// Find V(x) register and set it to V(y)'s value
+                    VX = VY;
+                    // Increment PC by 2
+                    PC += 2;
+                    break;
+
+                /*
+                	8XY1:
+					Sets VX to VX or VY. (Bitwise OR operation)
+                */
+                case 0x0001:
+                	// Find V(x) register value, OR-it to V(y) register and save it to V(x)
+					VX |= VY;
+#if M_QUIRK_VF_RESET
+					VF = 0;
+#endif
+					// Increment PC by 2
+                    PC += 2;
+                	break;
+
+                /*
+					8XY2:
+					Sets VX to VX and VY. (Bitwise AND operation)
+				*/
+				case 0x0002:
+					// Find V(x) register value, AND-it to V(y) register and save it to V(x)
+					VX &= VY;
+#if M_QUIRK_VF_RESET
+					VF = 0;
+#endif
+					// Increment PC by 2
+                    PC += 2;
+					break;
+
+				/*
+					8XY3:
+					Sets VX to VX xor VY.
+				*/
+				case 0x0003:
+					// Find V(x) register value, AND-it to V(y) register and save it to V(x)
+					VX ^= VY;
+#if M_QUIRK_VF_RESET
+					VF = 0;
+#endif
+					// Increment PC by 2
+                    PC += 2;
+					break;
+
+				/*
+					8XY4:
+					Adds VY to VX. VF is set to 1 when there's a carry, and to 0 when there is not.
+				*/
+				case 0x0004:
+					// Find V(x) register value, add V(y) value to it
+					VX += VY;
+
+					/*
+						Check if the addition overflowed
+						If it overflowed, set VF (Flag Register) to 1, else to 0
+						Remember, unsigned chars are 8 bit values, that means
+						that the maximum integer they can hold is 255.
+						We'll use a 16-bit wide variable (unsigned short) to
+						perform an addition and compare it against UCHAR_MAX
+						to decide wether to flip VF or not.
+					*/
+                    if ((VX + VY) > UCHAR_MAX)
+                        VF = 1;
+                    else
+                        VF = 0;
+
+                    // Increment PC by 2
+                    PC += 2;
+					break;
+
+				/*
+					8XY5:
+					VY is subtracted from VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+				*/
+				case 0x0005:
+					// Substract VY from VX
+					VX -= VY;
+
+					/*
+						Check if there's a borrow, if it exists, flip VF (Flag Register).
+						It's a simple task to do, using algebra:
+						if x1 > x2; (x1 - x2) > 0 there's no borrow, else, there is
+					*/
+					if (VX > VY)
+                        VF = 0;
+                    else
+                        VF = 1;
+
+                    // Increment PC by 2
+                    PC += 2;
+                    break;
+
+                /*
+					8XY6:
+					Stores the least significant bit of VX in VF and then shifts VX to the right by 1.
+				*/
+                case 0x0006:
+                	/*
+						What we need to do is store the LSB of V(x) in VF.
+						It's a simple problem.
+						Let's say = V[x is 0x4 (Base 16)
+						0x4 in binary equals to 0100 (Base 2)
+						If we want to obtain the LSB, we can use a little
+						logic trick, which involves AND-ing 0x1 to the previous value.
+
+						Quick logical tables crash-course:
+						AND Operation: Y = A * B
+						| A | B | Y = A & B	|
+						| 0 | 0 |	  0 	|
+						| 0 | 1 |	  0 	|
+						| 1 | 0 |	  0 	|
+						| 1 | 1 |	  1 	|
+
+						So if we AND 0x1(16) [0001 (2)] to the value, we'll know what
+						the LSB of it looks like.
+                	*/
+#if M_QUIRK_SHIFT_VX
+                	VF = (VX & 0x1);
+
+                	// What's left is bitshifting 1 time to the right V(x) register
+                	VX >>= 1;
+#else
+                	// The original COSMAC VIP interpreter shifts VY and stores the result in VX
+                	m_shifted = VY;
+                	VX = m_shifted >> 1;
+                	VF = (m_shifted & 0x1);
+#endif
+
+                	// Increment PC by 2
+                	PC += 2;
+                    break;
+
+                /*
+					8XY7:
+					Sets VX to VY minus VX. VF is set to 0 when there's a borrow, and 1 when there is not.
+
+					Tip: 8XY7 does the opposite of 8XY5
+				*/
+				case 0x0007:
+					// Do the same as 8XY5 but the inverse
+					VX = VY - VX;
+
+					// I'll use a different trick that doesn't involve actually substracting
+					if (VY > VX)
+                        VF = 1;
+                    else
+                        VF = 0;
+
+                    // Increment PC by 2
+                    PC += 2;
+                    break;
+
+                /*
+					8XYE:
+					Stores the most significant bit of VX in VF and then shifts VX to the left by 1.
+
+					Tip: It's almost the same as 8XY6 but kinda the opposite
+				*/
+                case 0x000E:
+                	/*
+                		Instead of ANDing 0x1(16) [0001(2)], we and 0xF(16) [1111(2)]
+                		to get the MSB of the operand
+                	*/
+#if M_QUIRK_SHIFT_VX
+                	VF = (VX & 0x80) >> 7;
+
+                	// What's left is bitshifting 1 time to the left V(x) register
+                	VX <<= 1;
+#else
+                	m_shifted = VY;
+                	VX = m_shifted << 1;
+                	VF = (m_shifted & 0x80) >> 7;
+#endif
+
+                	// Increment PC by 2
+                	PC += 2;
+                    break;
+
+                default:
+                	chip8->m_fault = M_FAULT_UNIMPLEMENTED;
+                	return M_RUN_FAULT;
+			}
+
+			break;
+
+		/*
+			9XY0:
+			Skips the next instruction if VX does not equal VY.
+		*/
+		case 0x9000:
+			// Check if V(x) != V(y)
+			if ((VX) != (VY))
+				// If they're not equal, skip 1 instruction
+				PC += 4;
+			else
+				// Increment PC by 2
+				PC += 2;
+			break;
+
+		/*
+			ANNN:
+			Sets I to the address NNN.
+		*/
+		case 0xA000:
+#ifdef DEBUG
+			printf("ANNN (%x) [NNN -> 0x%x]\n", 
+				NNN, NNN);
+#endif
+			// Set Index Register to NNN (Obtained from opcode)
+			I = NNN;
+			// Increment PC by 2
+			PC += 2;
+			break;
+
+		/*
+			BNNN:
+			Jumps to the address NNN plus V0 (BXNN: NNN plus VX on CHIP-48 and SCHIP).
+		*/
+		case 0xB000:
+#if M_QUIRK_JUMP_VX
+			PC = NNN + VX;
+#else
+			// Set program counter to the address specified by opcode (NNN) plus V0 Register
+			PC = NNN + V[V0]; 
+#endif
+			break;
+
+		/*
+			CXNN:
+			Sets VX to the result of a bitwise and operation on a random number (Typically: 0 to 255) and NN.
+		*/
+		case 0xC000:
+			/*
+				Set V(x) register to the result of an AND Bitwise operation between a random byte
+				(0 to 255) and the NN number specified by the opcode.
+
+				The byte comes from the instance's own generator (See m_random) instead of rand(),
+				so machines don't share hidden global state and a seed reproduces a whole run.
+			*/
+			VX = m_random(chip8) & NN;
+			// Increment PC by 2
+            PC += 2;
+            break;
+
+        /*
+        	DXYN:
+        	Draws a sprite at coordinate (VX, VY) that has a width of 8 pixels and a height of N pixels.
+        	Each row of 8 pixels is read as bit-coded starting from memory location I;
+        	I value does not change after the execution of this instruction.
+        	As described above, VF is set to 1 if any screen pixels are flipped from set to
+        	unset when the sprite is drawn, and to 0 if that does not happen
+        */
+		case 0xD000:
+#ifdef DEBUG
+			printf("Drawing Sprite...\n");
+#endif
+			// DXYN uses VF as a collision detector, set it to 0 before entering the algorithm
+			VF = 0;
+
+			// Get the sprite height from the last digit of the opcode
+			uint8_t m_spriteheight = N;
+
+			// Loop through each byte of the sprite
+			for (size_t m_height = 0; m_height < m_spriteheight; m_height++)
+			{
+				// Sprite starts at RAM[Index Register + Current Sprite Height]
+				uint8_t m_sprite = RAM[(I + m_height) & (FOURKiB - 1)];
+
+#if M_QUIRK_CLIP
+				// The starting row wraps around, but the rows past the bottom edge get clipped
+				int32_t m_row = (VY % CHIP8_ROWS) + m_height;
+
+				if (m_row >= CHIP8_ROWS)
+				{
+					break;
+				}
+#else
+				/*
+					Calculate the row based on current sprite height added to VY modulo CHIP8_ROWS to
+					aid in screen wraps
+				*/
+				int32_t m_row = (VY + m_height) % CHIP8_ROWS;
+#endif
+
+				// Loop through the length of the sprite (Which is always 8, 5x8)
+				for (size_t m_width = 0; m_width < CHIP8_SPRITELENGTH; m_width++)
+				{
+					// Obtain the MSB of the sprite pixel to know if the pixel is on (1) or off (0)
+					uint8_t m_spritepixel = m_sprite & (0x80 >> m_width);
+
+#if M_QUIRK_CLIP
+					int32_t m_col = (VX % CHIP8_COLUMNS) + m_width;
+
+					if (m_col >= CHIP8_COLUMNS)
+					{
+						break;
+					}
+#else
+					// Obtain the column (Same method as m_row)
+					int32_t m_col = (VX + m_width) % CHIP8_COLUMNS;
+#endif
+
+					// Calculate the offset on the screen ((row * maxcol) + col)
+					int32_t m_offset = m_row * CHIP8_COLUMNS + m_col;
+
+					// Pointer to the display offset
+					uint32_t *m_displaypixel = &chip8->m_video->m_display[m_offset];
+
+					// Check if sprite pixel is on
+					if (m_spritepixel)
+					{
+						// The pixel was already turned on, collision
+						if (*m_displaypixel == 0xFFFFFFFF)
+						{
+							// Set collision detector register (VF) to 1
+							VF = 1;
+						}
+
+						// XOR the sprite pixel
+						*m_displaypixel ^= 0xFFFFFFFF;
+					}
+				}
+			}
+
+            // Redraw the screen
+    		chip8->m_redraw = true;
+    		m_event = M_RUN_DRAW;
+    		// Increment PC by 2
+			PC += 2;
+			break;
+
+		/*
+			0xE000 opcode subfamily
+		*/
+		case 0xE000:
+			switch (M_OPCODE & 0x00FF)
+			{
+				/*
+					EX9E:
+					Skips the next instruction if the key stored in VX is pressed.
+
+					Tip: Inverse of EXA1
+				*/
+				case 0x009E:
+					// Check if the V(x) pointer to the keyboard array equals to 1 (Key pressed), only the low nibble names a key
+					if (chip8->m_keyboard[VX & 0xF] == 1)
+						// Skip 1 instruction
+                        PC +=  4;
+                    else
+                    	// Increment PC by 2
+                        PC += 2;
+                    break;
+					
+				/*
+					EXA1:
+					Skips the next instruction if the key stored in VX is not pressed.
+				*/
+				case 0x00A1:
+					// Check if the V(x) pointer to the keyboard array equals to 0 (Key unpressed), only the low nibble names a key
+					if (chip8->m_keyboard[VX & 0xF] == 0)
+						// Skip 1 instruction
+                        PC +=  4;
+                    else
+                    	// Increment PC by 2
+                        PC += 2;
+                    break;
+
+                default:
+                	chip8->m_fault = M_FAULT_UNIMPLEMENTED;
+                	return M_RUN_FAULT;
+			}
+			break;
+
+		/*
+			0xF000 opcode subfamily
+		*/
+		case 0xF000:
+			switch (M_OPCODE & 0x00FF)
+			{
+
+				/*
+					FX07 (Inverse of FX15):
+					Sets VX to the value of the delay timer.
+				*/
+				case 0x0007:
+					VX = m_timer_value(chip8->m_delaydeadline, m_cycle);
+                    PC += 2;
+					break;
+
+				/*
+					FX0A:
+					A key press is awaited, and then stored in VX.
+				*/
+				case 0x000A:
+					// Keep waiting (Don't advance PC) unless a key is found below
+					m_event = M_RUN_KEYWAIT;
+
+					for (int i = 0; i < CHIP8_KEYS; i++)
+					{
+						if (chip8->m_keyboard[i] != 0)
+						{
+							VX = i;
+							PC += 2;
+							m_event = M_RUN_BUDGET;
+							break;
+						}
+					}
+
+					break;
+
+				/*
+					FX15 (Inverse of FX07):
+					Sets the delay timer to VX.
+				*/
+				case 0x0015:
+					chip8->m_delaydeadline = m_timer_deadline(m_cycle, VX);
+                    PC += 2;
+                    break;
+
+                case 0x0018:
+                	chip8->m_sounddeadline = m_timer_deadline(m_cycle, VX);
+                    PC += 2;
+                    break;
+
+                /*
+					FX1E:
+					Adds VX to I. VF is not affected.
+				*/
+                case 0x001E:
+                	// Add V(x) to the Index Register
+                	I += VX;
+                	// Increment PC by 2
+                	PC += 2;
+                	break;
+
+				/*
+					FX29:
+					Sets I to the location of the sprite for the character in VX.
+					Characters 0-F (in hexadecimal) are represented by a 4x5 font.
+				*/
+				case 0x0029:
+    					I = (VX * 0x5);
+    					PC += 2;
+    					break;
+				/*
+					FX33:
+					Stores the binary-coded decimal representation of VX, with the most significant
+					of three digits at the address in I, the middle digit at I plus 1, and the
+					least significant digit at I plus 2.
+					(In other words, take the decimal representation of VX, place the hundreds digit
+					in memory at location in I, the tens digit at location I+1, and the ones digit at location I+2.);
+				*/
+				case 0x0033:
+#ifdef DEBUG
+					printf("FX33 Opcode!\n"); 
+#endif
+    				RAM[I & (FOURKiB - 1)] = VX / 100;
+#ifdef DEBUG
+					printf("idx (%d)\n", RAM[I & (FOURKiB - 1)]); 
+#endif
+    				RAM[(I + 1) & (FOURKiB - 1)] = (VX / 10) % 10;
+#ifdef DEBUG
+					printf("idx+1 (%d)\n", RAM[(I + 1) & (FOURKiB - 1)]);
+#endif
+    				RAM[(I + 2) & (FOURKiB - 1)] = (VX % 100) % 10;
+#ifdef DEBUG
+					printf("idx+2 (%d)\n", RAM[(I + 2) & (FOURKiB - 1)]);
+#endif
+					// Self-modifying code, forget any predecoded instruction we just overwrote
+					if (chip8->m_code != NULL)
+					{
+						m_code_invalidate(chip8->m_code, I & (FOURKiB - 1), 3);
+					}
+
+					PC += 2;
+					break;
+
+				/*
+					FX55:
+					Stores V0 to VX (including VX) in memory starting at address I.
+					The offset from I is increased by 1 for each value written, I itself is updated depending on M_QUIRK_LOADSTORE.
+
+					Tip: The opposite of FX65
+				*/
+				case 0x0055:
+#ifdef DEBUG
+					printf("m_currentopcode 0x%x, m_currentopcode & 0x%x, m_currentopcode &>> 0x%x\n", M_OPCODE, M_OPCODE & 0x0F00, VX);
+#endif
+					for (size_t m_currentregister = 0; m_currentregister <= (size_t) X; m_currentregister++)
+					{
+						RAM[(I + m_currentregister) & (FOURKiB - 1)] = V[m_currentregister];
+					}
+
+					if (chip8->m_code != NULL)
+					{
+						m_code_invalidate(chip8->m_code, I & (FOURKiB - 1), X + 1);
+					}
+
+#if M_QUIRK_LOADSTORE == 1
+					I += X + 1;
+#elif M_QUIRK_LOADSTORE == 2
+					I += X;
+#endif
+
+					// Increase the program counter by 2
+					PC += 2;
+				
+					break;
+
+				/*
+					FX65:
+					Fills V0 to VX (including VX) with values from memory starting at address I.
+					The offset from I is increased by 1 for each value written, I itself is updated depending on M_QUIRK_LOADSTORE.
+				*/
+				case 0x0065:
+					/* 
+						Use a for() loop to do this task, starting at V0, iterate F(x) times (Calculated above) ending
+						at V(x) register. Each time we enter the for() loop, load in the value at the index register plus
+						m_currentregister onto the current register pointed by m_currentregister in the loop
+					*/
+					for (size_t m_currentregister = 0; m_currentregister <= (size_t) X; m_currentregister++)
+					{
+						V[m_currentregister] = RAM[(I + m_currentregister) & (FOURKiB - 1)];
+					}
+
+#if M_QUIRK_LOADSTORE == 1
+					I += X + 1;
+#elif M_QUIRK_LOADSTORE == 2
+					I += X;
+#endif
+
+					// Increase the program counter by 2
+					PC += 2;
+
+					break;
+
+				default:
+					chip8->m_fault = M_FAULT_UNIMPLEMENTED;
+					return M_RUN_FAULT;
+			}
+			break;
+	}
+
+	return m_event;
+}
+
+// Execute the instruction at PC, m_opcode being what's stored there (Fetched by the caller)
+static void M_VARIANT(m_exec_fetched)(m_chip8 *chip8, uint16_t m_opcode)
+{
+	uint16_t m_pc = chip8->m_programcounter;
+	uint16_t m_idx = chip8->m_index;
+
+	chip8->m_currentopcode = m_opcode;
+
+	M_TRACE(m_pc, chip8->m_currentopcode);
+
+	enum m_runexit m_event = M_VARIANT(m_step)(chip8, chip8->m_currentopcode, &m_pc, &m_idx, chip8->m_cycles);
+
+	chip8->m_programcounter = m_pc;
+	chip8->m_index = m_idx;
+
+	// One more instruction executed, this is what drives the timers
+	if (m_event != M_RUN_FAULT)
+	{
+		chip8->m_cycles++;
+	}
+}
+
+// Execute a single instruction (Reference entry point, used by the debugger)
+static void M_VARIANT(m_exec)(m_chip8 *chip8)
+{
+	M_VARIANT(m_exec_fetched)(chip8, m_fetch(chip8, chip8->m_programcounter));
+}
+
+/*
+	Execute up to m_budget instructions in a tight loop.
+	PC, I and the cycle counter are kept in locals for the whole batch and only written back on exit.
+	The batch ends early after a draw (00E0/DXYN), on a fault (See enum m_fault) or when PC reaches
+	chip8->m_breakpoint (Checked before every instruction but the first one, so a run can resume
+	from a breakpoint). When FX0A is waiting for a key, the rest of the budget is spent waiting,
+	just like the real interpreter would spin, so the timers keep running.
+
+	m_fused is a compile-time constant, m_run instantiates this loop with and without the
+	predecode cache so the plain interpreter doesn't pay for the fusion checks.
+*/
+static inline __attribute__((always_inline)) enum m_runexit M_VARIANT(m_run_loop)(m_chip8 *chip8, uint32_t m_budget, const bool m_fused)
+{
+	uint16_t m_pc = chip8->m_programcounter;
+	uint16_t m_idx = chip8->m_index;
+	uint64_t m_cycle = chip8->m_cycles;
+	const uint64_t m_end = m_cycle + m_budget;
+	const uint16_t m_breakpoint = chip8->m_breakpoint;
+	m_code *m_cache = chip8->m_code;
+
+	uint16_t m_opcode = chip8->m_currentopcode;
+	enum m_runexit m_exit = M_RUN_BUDGET;
+
+	while (m_cycle < m_end)
+	{
+		if ((m_pc == m_breakpoint) && (m_cycle != chip8->m_cycles))
+		{
+			m_exit = M_RUN_BREAKPOINT;
+			break;
+		}
+
+		enum m_fusion m_fusion = M_FUSE_NONE;
+		const m_decoded *m_entry = NULL;
+
+		if (m_fused && (m_pc < (FOURKiB - 1)))
+		{
+			m_entry = &m_cache->m_entries[m_pc];
+
+			if (__builtin_expect(m_entry->m_length == 0, 0))
+			{
+				m_code_decode(m_cache, RAM, m_pc);
+			}
+
+			m_fusion = m_entry->m_fusion;
+			m_opcode = m_entry->m_opcodes[0];
+
+			/*
+				Only take the fused path if the whole sequence fits in the budget and no
+				breakpoint sits in the middle of it, otherwise execute just the first instruction.
+			*/
+			if ((m_fusion != M_FUSE_NONE) && ((m_end - m_cycle < m_entry->m_length) ||
+				((uint16_t) (m_breakpoint - m_pc - 1) < (uint16_t) ((m_entry->m_length - 1) * 2))))
+			{
+				m_fusion = M_FUSE_NONE;
+			}
+		} else {
+			m_opcode = m_fetch(chip8, m_pc);
+		}
+
+		M_TRACE(m_pc, m_opcode);
+
+		enum m_runexit m_event = M_RUN_BUDGET;
+
+		switch (m_fusion)
+		{
+			case M_FUSE_LD_LD:
+				// 6XNN; 6YNN
+				V[M_OPC_0X00(m_entry->m_opcodes[0])] = M_GET_NN_FROM_OPCODE(m_entry->m_opcodes[0]);
+				V[M_OPC_0X00(m_entry->m_opcodes[1])] = M_GET_NN_FROM_OPCODE(m_entry->m_opcodes[1]);
+				m_pc += 4;
+				m_cycle += 2;
+				m_cache->m_fired[m_fusion]++;
+				m_cache->m_saved[m_fusion]++;
+				m_opcode = m_entry->m_opcodes[1];
+				continue;
+
+			case M_FUSE_ADD_SKIP_JMP:
+				// 7XNN; 3YNN; 1NNN
+				V[M_OPC_0X00(m_entry->m_opcodes[0])] += M_GET_NN_FROM_OPCODE(m_entry->m_opcodes[0]);
+
+				if (V[M_OPC_0X00(m_entry->m_opcodes[1])] == M_GET_NN_FROM_OPCODE(m_entry->m_opcodes[1]))
+				{
+					// The skip jumps over 1NNN, which never executes
+					m_pc += 6;
+					m_cycle += 2;
+					m_opcode = m_entry->m_opcodes[1];
+					m_cache->m_saved[m_fusion]++;
+				} else {
+					m_pc = M_GET_NNN_FROM_OPCODE(m_entry->m_opcodes[2]);
+					m_cycle += 3;
+					m_opcode = m_entry->m_opcodes[2];
+					m_cache->m_saved[m_fusion] += 2;
+				}
+
+				m_cache->m_fired[m_fusion]++;
+				continue;
+
+			case M_FUSE_LDI_DRW:
+			case M_FUSE_LDI_LOAD:
+				// ANNN followed by an instruction that uses I, let the interpreter run the second one
+				m_idx = M_GET_NNN_FROM_OPCODE(m_entry->m_opcodes[0]);
+				m_pc += 2;
+				m_cycle++;
+				m_opcode = m_entry->m_opcodes[1];
+				m_cache->m_fired[m_fusion]++;
+				m_cache->m_saved[m_fusion]++;
+				m_event = M_VARIANT(m_step)(chip8, m_opcode, &m_pc, &m_idx, m_cycle);
+				break;
+
+			default:
+				m_event = M_VARIANT(m_step)(chip8, m_opcode, &m_pc, &m_idx, m_cycle);
+				break;
+		}
+
+		if (__builtin_expect(m_event != M_RUN_BUDGET, 0))
+		{
+			if (m_event == M_RUN_FAULT)
+			{
+				m_exit = m_event;
+				break;
+			}
+
+			if (m_event == M_RUN_KEYWAIT)
+			{
+				m_cycle = m_end;
+				m_exit = m_event;
+				break;
+			}
+
+			m_cycle++;
+			m_exit = m_event;
+			break;
+		}
+
+		m_cycle++;
+	}
+
+	chip8->m_programcounter = m_pc;
+	chip8->m_index = m_idx;
+	chip8->m_cycles = m_cycle;
+	chip8->m_currentopcode = m_opcode;
+
+	return m_exit;
+}
+
+static enum m_runexit M_VARIANT(m_run)(m_chip8 *chip8, uint32_t m_budget)
+{
+	if (chip8->m_code != NULL)
+	{
+		return M_VARIANT(m_run_loop)(chip8, m_budget, true);
+	}
+
+	return M_VARIANT(m_run_loop)(chip8, m_budget, false);
+}
+
+// Describe the profile at runtime too (For the tools and the batch engine, never for the hot loop)
+static const m_quirks M_VARIANT(m_quirks) = {
+	M_PROFILE_NAME,
+	M_QUIRK_SHIFT_VX,
+	M_QUIRK_LOADSTORE,
+	M_QUIRK_JUMP_VX,
+	M_QUIRK_CLIP,
+	M_QUIRK_VF_RESET
+};
+
+#undef M_VARIANT
+#undef M_CONCAT
+#undef M_CONCAT_
+#undef M_PROFILE_SUFFIX
+#undef M_PROFILE_NAME
+#undef M_QUIRK_SHIFT_VX
+#undef M_QUIRK_LOADSTORE
+#undef M_QUIRK_JUMP_VX
+#undef M_QUIRK_CLIP
+#undef M_QUIRK_VF_RESET
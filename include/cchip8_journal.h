@@ -0,0 +1,81 @@
+#pragma once
+
+#include "cchip8.h"
+
+/*
+	Undo journal for reverse debugging:
+	Every instruction executed through m_journal_exec first records the prior value of each byte
+	it's about to overwrite (V registers, I, SP and the stack slot, timer deadlines, the random
+	generator, the RAM bytes FX33/FX55 store to, the display rows DXYN draws over, the whole
+	display for 00E0) plus the PC and opcode latch. Undoing a record puts those bytes back, so the
+	machine steps backwards one instruction at a time.
+
+	Records are variable sized (About 13 bytes for a typical instruction) and live in a byte ring
+	bounded by a memory budget, the oldest ones get dropped to make room for new ones.
+
+	Record layout (Native endianness, never leaves the process):
+		uint16 size | uint16 PC | uint16 opcode latch | patches... | uint16 size
+	Patch layout:
+		uint8 kind | uint8 length | uint16 offset | length bytes
+	The size is repeated at the end so the ring can be walked from both sides.
+*/
+
+// What a patch restores (Its offset and length mean different things for each)
+enum m_journal_patch
+{
+	// Bytes of m_chip8 itself (Registers, stack, timers, RAM...), offset from the start of the struct
+	M_JOURNAL_STATE = 0,
+
+	// DXYN: offset is row * CHIP8_COLUMNS + column of the sprite's corner, one byte (8 pixels) per row, rows and columns wrap around
+	M_JOURNAL_SPRITE,
+
+	// 00E0: the whole display, one bit per pixel
+	M_JOURNAL_SCREEN
+};
+
+// Largest record (DXYN positioned with VF: header, trailer, VF and the packed display)
+#define M_JOURNAL_MAX_RECORD (8 + 5 + 4 + ((CHIP8_COLUMNS * CHIP8_ROWS) / 8))
+
+// Smallest budget that makes sense (Room for a few hundred instructions)
+#define M_JOURNAL_MIN_BUDGET (16 * M_JOURNAL_MAX_RECORD)
+
+typedef struct chip8_journal
+{
+	uint8_t *m_data;
+	size_t m_capacity;
+
+	/*
+		Records live in [m_tail, m_head), or once the writer wrapped around to the start of the
+		buffer, in [m_tail, m_wrap) followed by [0, m_head).
+	*/
+	size_t m_head;
+	size_t m_tail;
+	size_t m_wrap;
+	bool m_wrapped;
+
+	// Records held, and records dropped to stay within the budget
+	uint64_t m_records;
+	uint64_t m_dropped;
+
+} m_journal;
+
+// m_budget is in bytes (Raised to M_JOURNAL_MIN_BUDGET), NULL if it can't be allocated
+m_journal *m_journal_create(size_t m_budget);
+
+void m_journal_destroy(m_journal *m_journal);
+
+// Forget the whole history (The machine got reset or loaded from a save state)
+void m_journal_clear(m_journal *m_journal);
+
+// Run one instruction through m_exec, journaling it (Faulting instructions don't execute and leave no record)
+void m_journal_exec(m_journal *m_journal, m_chip8 *chip8);
+
+// Undo the newest journaled instruction, false if there's nothing left to undo
+bool m_journal_undo(m_journal *m_journal, m_chip8 *chip8);
+
+/*
+	Newest journaled instruction that overwrote the byte m_offset of m_chip8 (offsetof(m_chip8, m_memory) + address
+	for RAM). m_pc receives its address, m_age how many instructions ago it ran (1 = the last one).
+	False if no instruction in the journal wrote it.
+*/
+bool m_journal_writer(const m_journal *m_journal, size_t m_offset, uint16_t *m_pc, uint64_t *m_age);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	ROM loading:
+	Single ROMs are read with one bounded read into a buffer and copied into the interpreter's memory
+	with one memcpy. Whole corpora can be packed into one archive that gets mapped read-only (mmap on
+	Unix, a single read elsewhere), so batch jobs open a single file instead of thousands and load
+	every ROM straight out of the mapping (See tools/cchip8_pack.c).
+*/
+
+// A mapped (Or read) file, m_data stays valid until m_rom_unmap
+typedef struct chip8_rom
+{
+	const uint8_t *m_data;
+	size_t m_size;
+
+	// true if m_data is an mmap'd view, false if it's a heap buffer
+	bool m_mapped;
+
+} m_rom;
+
+/*
+	Archive layout (All integers little endian):
+
+		Header:  "C8AR" | uint32 version | uint32 entry count
+		Entries: entry count * { uint32 data offset | uint32 data size | uint32 name offset }
+		Names:   NUL terminated strings
+		Data:    ROM images, back to back
+
+	Offsets are from the start of the file. Every entry is validated when the archive is opened,
+	so names and ROMs can be handed out as pointers straight into the mapping.
+*/
+#define M_ARCHIVE_MAGIC "C8AR"
+#define M_ARCHIVE_VERSION 1
+#define M_ARCHIVE_HEADER_SIZE 12
+#define M_ARCHIVE_ENTRY_SIZE 12
+
+// Map a whole file read-only, prints why and returns false on failure
+bool m_rom_map(m_rom *m_rom, const char *m_filename);
+
+void m_rom_unmap(m_rom *m_rom);
+
+// Read a whole file into m_buffer (At most m_capacity bytes), prints why and returns false on failure
+bool m_rom_read(const char *m_filename, uint8_t *m_buffer, size_t m_capacity, size_t *m_size);
+
+// Little endian helpers shared by the archive reader and writer
+static inline uint32_t m_read_le32(const uint8_t *m_bytes)
+{
+	return (uint32_t) m_bytes[0] | ((uint32_t) m_bytes[1] << 8) | ((uint32_t) m_bytes[2] << 16) | ((uint32_t) m_bytes[3] << 24);
+}
+
+static inline void m_write_le32(uint8_t *m_bytes, uint32_t m_value)
+{
+	m_bytes[0] = (uint8_t) m_value;
+	m_bytes[1] = (uint8_t) (m_value >> 8);
+	m_bytes[2] = (uint8_t) (m_value >> 16);
+	m_bytes[3] = (uint8_t) (m_value >> 24);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libcchip8.h"
+
+/*
+	Run-ahead (Like RetroArch's):
+	Input read by EX9E/EXA1/FX0A only shows up on screen one or more frames later. After every real
+	frame the machine gets saved, emulated m_frames more frames with the keys held right now, and
+	restored; the picture of that future frame is what gets presented. The real timeline never sees
+	the extra frames, so a ROM behaves exactly as without run-ahead, it just looks m_frames frames
+	less laggy (As long as the input doesn't change in between, which is what makes it a guess).
+*/
+
+// Most frames we'll emulate ahead (Each one costs a whole extra frame of emulation per host frame)
+#define M_RUNAHEAD_MAX_FRAMES 8
+
+// Input changes that didn't show up on screen within this many frames aren't measured
+#define M_RUNAHEAD_PATIENCE 30
+
+typedef struct chip8_runahead
+{
+	// Frames emulated ahead of the real machine (0 disables run-ahead)
+	uint32_t m_frames;
+
+	cchip8_state *m_state;
+
+	// Picture of the future frame (The one to present) and the real frame's picture of the last frame
+	uint32_t m_picture[CCHIP8_WIDTH * CCHIP8_HEIGHT];
+	uint32_t m_real[CCHIP8_WIDTH * CCHIP8_HEIGHT];
+
+	/*
+		Cost, in performance counter ticks: saving and restoring the state, and emulating the frames
+		ahead. Accumulated until someone reads and clears them (The HUD does every refresh).
+	*/
+	uint64_t m_snapshotticks;
+	uint64_t m_aheadticks;
+	uint64_t m_runs;
+
+	/*
+		Latency measurement: when the keys change on a frame where neither picture was changing,
+		count the frames until the real picture and the presented one react. The averages of both
+		tell how much latency run-ahead actually took off (Not just how many frames it runs ahead).
+	*/
+	bool m_measuring;
+	bool m_idle;
+	uint32_t m_age;
+	uint32_t m_reallatency;
+	uint32_t m_shownlatency;
+
+	uint64_t m_samples;
+	uint64_t m_realsum;
+	uint64_t m_shownsum;
+
+} m_runahead;
+
+// m_frames 0 leaves run-ahead disabled, false if the save state couldn't be allocated
+bool m_runahead_init(m_runahead *m_runahead, uint32_t m_frames);
+
+// Call whenever the held keys change, starts a latency measurement
+void m_runahead_input(m_runahead *m_runahead);
+
+/*
+	Call after the real frame ran: emulates ahead, restores the machine and returns the picture to
+	present. m_changed tells whether it differs from the previously returned one.
+*/
+const uint32_t *m_runahead_frame(m_runahead *m_runahead, cchip8 *m_vm, bool *m_changed);
+
+// Average input-to-picture latency measured so far (In frames), false if nothing got measured yet
+bool m_runahead_latency(const m_runahead *m_runahead, double *m_real, double *m_shown);
+
+void m_runahead_print(const m_runahead *m_runahead);
+
+void m_runahead_destroy(m_runahead *m_runahead);
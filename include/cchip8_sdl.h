@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "libcchip8.h"
+
+// Host keyboard layout of the CHIP8 keypad (Index = CHIP8 key)
+static const uint8_t m_sdl_keys[16] = {
+    SDLK_x, // 0
+    SDLK_1, // 1
+    SDLK_2, // 2
+    SDLK_3, // 3
+    SDLK_q, // 4
+    SDLK_w, // 5
+    SDLK_e, // 6
+    SDLK_a, // 7
+    SDLK_s, // 8
+    SDLK_d, // 9
+    SDLK_z, // A
+    SDLK_c, // B
+    SDLK_4, // C
+    SDLK_r, // D
+    SDLK_f, // E
+    SDLK_v  // F
+};
+
+// CHIP8 key an SDL key is mapped to, -1 if it isn't part of the keypad
+static inline int m_sdl_key(SDL_Keycode m_sym)
+{
+	for (int i = 0; i < 16; i++)
+	{
+		if (m_sym == m_sdl_keys[i])
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+// SDL2 Icon using RAW Data Method by blog.gibson.sh
+void SDL_SetWindowIconFromRAW(SDL_Window* m_window);
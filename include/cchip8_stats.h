@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Amount of host frame-time samples we keep around (Oldest ones get overwritten)
+#define M_FRAMETIME_SAMPLES 8192
+
+typedef struct chip8_frametimes
+{
+	// Ring buffer holding the latest host frame times (In milliseconds)
+	double m_samples[M_FRAMETIME_SAMPLES];
+
+	// Total amount of samples recorded since startup
+	uint64_t m_count;
+
+	// Amount of emulated (60 Hz) frames that got executed
+	uint64_t m_emulatedframes;
+
+	// Amount of emulated frames dropped to recover from a host stall
+	uint64_t m_droppedframes;
+
+} m_frametimes;
+
+void m_frametimes_init(m_frametimes *m_stats);
+
+void m_frametimes_record(m_frametimes *m_stats, double m_ms);
+
+double m_frametimes_percentile(const m_frametimes *m_stats, double m_percentile);
+
+void m_frametimes_print(const m_frametimes *m_stats);
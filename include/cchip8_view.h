@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include "cchip8.h"
+
+/*
+	Seqlock behind cchip8_view (See libcchip8.h):
+	m_sequence is odd while the writer is storing a snapshot and even once it's complete, a reader
+	copies the snapshot between two loads of it and starts over if they differ (Or were odd). The
+	snapshot itself lives in atomic words stored and loaded relaxed, so a reader racing the writer
+	gets a torn copy it throws away, never undefined behaviour; on x86 and ARM those are plain moves.
+
+	There's one writer per view (The thread driving the machine it's attached to), readers only ever
+	load, so they don't bounce the cache lines between each other.
+*/
+
+#define M_VIEW_WORDS (sizeof(cchip8_snapshot) / sizeof(uint64_t))
+
+/*
+	Times a reader looks at the sequence before giving up, several milliseconds of spinning. A publish
+	takes a microsecond or so, this outlasts a writer that got preempted halfway and only runs out
+	when it stopped for good (A process that died while publishing into an export segment).
+*/
+#define M_VIEW_ATTEMPTS (1u << 24)
+
+static_assert(sizeof(cchip8_snapshot) % sizeof(uint64_t) == 0, "The snapshot must be made of whole words");
+static_assert(offsetof(cchip8_snapshot, m_memory) % sizeof(uint64_t) == 0, "RAM gets published straight from the machine, a word at a time");
+
+/*
+	What readers load, kept apart from the writer's state so it can live in a cchip8_view or in a
+	shared memory segment other processes map (See cchip8_export.c, its layout is public there).
+*/
+typedef struct chip8_view_words
+{
+	// Even while the snapshot is complete, odd while it's being published (Twice the publications so far)
+	alignas(M_CACHELINE) _Atomic uint64_t m_sequence;
+
+	// The snapshot, on its own cache lines so polling m_sequence doesn't share them with the copy
+	alignas(M_CACHELINE) _Atomic uint64_t m_words[M_VIEW_WORDS];
+
+} m_view_words;
+
+/*
+	Writer side: a private copy of the last publication and of the display it was packed from.
+	Only words that changed get stored again, so the lines nothing wrote to between two publishes
+	(Most of RAM) stay shared in every reader's cache instead of being invalidated under them,
+	and only display rows that changed get packed again.
+*/
+typedef struct chip8_view_writer
+{
+	alignas(M_CACHELINE) uint64_t m_shadow[M_VIEW_WORDS];
+	uint32_t m_pixels[CHIP8_COLUMNS * CHIP8_ROWS];
+
+} m_view_writer;
+
+// Empty both halves (Nothing published, a blank display)
+void m_view_init(m_view_words *m_words, m_view_writer *m_writer);
+
+// Store the machine's current state as the next publication
+void m_view_update(m_view_words *m_words, m_view_writer *m_writer, const m_chip8 *chip8);
+
+// Consistent copy of the latest publication, false if nothing was published yet or it never got consistent
+bool m_view_load(const m_view_words *m_words, cchip8_snapshot *m_snapshot);
+
+// m_view_update on a cchip8_view
+void m_view_publish(cchip8_view *m_view, const m_chip8 *chip8);
@@ -0,0 +1,562 @@
+#pragma once
+
+/*
+	libcchip8 - Embeddable CHIP8 interpreter core.
+
+	Everything an embedder needs lives behind an opaque cchip8 handle: there's no global
+	state besides the log handler (Each instance carries its own random number generator) and this header doesn't
+	pull in SDL, so several independent machines can run side by side in one process.
+
+	Typical use:
+		cchip8 *m_vm = cchip8_create(NULL);
+		cchip8_load_rom_from_memory(m_vm, m_rom, m_romsize);
+
+		while (...)
+		{
+			cchip8_set_keys(m_vm, m_keymask);
+			cchip8_run_frames(m_vm, 1);
+			const uint32_t *m_pixels = cchip8_get_framebuffer(m_vm, NULL);
+		}
+
+		cchip8_destroy(m_vm);
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Bumped whenever a function signature or the meaning of a value below changes
+#define CCHIP8_API_VERSION 8
+
+// Framebuffer geometry, one ARGB8888 word per pixel (0xFFFFFFFF lit, 0x00000000 off)
+#define CCHIP8_WIDTH 64
+#define CCHIP8_HEIGHT 32
+
+// Largest ROM that fits between the program start (0x200) and the end of memory
+#define CCHIP8_MAX_ROM_SIZE (4096 - 0x200)
+
+typedef struct cchip8_instance cchip8;
+
+/*
+	The library never writes to standard output. When something fails for a reason worth explaining
+	(A file that can't be opened, a shared memory segment that can't be created...) the function
+	returns its error as usual and hands a one line message, without newline, to the log handler.
+	The default handler writes it to standard error. The handler is process-wide and swapped
+	atomically, so it can be changed while other threads (Or a capture writer) log: every message
+	goes to one complete handler + m_user pair, though one logged during the change may still reach
+	the previous handler. NULL puts the default back.
+*/
+typedef void (*cchip8_log_handler)(void *m_user, const char *m_message);
+
+void cchip8_set_log_handler(cchip8_log_handler m_handler, void *m_user);
+
+typedef struct cchip8_options
+{
+	/*
+		Quirk profile name (cchip8, vip, chip48, schip or modern), NULL selects cchip8.
+		"auto" analyses every loaded ROM without running it and picks the profile it most likely needs.
+	*/
+	const char *m_profile;
+
+	// Run through the predecoded superinstruction interpreter
+	bool m_fusion;
+
+	/*
+		Run every instruction on its own through the reference interpreter instead of m_run (A few
+		times slower, m_fusion is ignored). It's the one the fast paths get checked against, for
+		regression runners that want to tell a fast path bug from a ROM that changed.
+	*/
+	bool m_reference;
+
+	// Seed of the instance's CXNN random number generator (0 selects a fixed default)
+	uint32_t m_seed;
+
+	/*
+		Sandbox budgets for untrusted ROMs (0 leaves either unlimited). A machine that used one up stops
+		with CCHIP8_HALTED and a budget fault until it's reset. Both are checked between slices of
+		instructions in cchip8_run_frames, never per instruction, so they cost next to nothing.
+	*/
+	// Instructions the machine may execute after a reset
+	uint64_t m_maxinstructions;
+
+	// Wall-clock milliseconds the machine may keep running after the first instruction following a reset
+	uint32_t m_maxmilliseconds;
+
+} cchip8_options;
+
+// Why cchip8_run_frames returned
+enum cchip8_status
+{
+	// Every requested frame was emulated
+	CCHIP8_OK = 0,
+
+	// The machine faulted (See cchip8_get_fault), it stays halted until reset
+	CCHIP8_HALTED,
+
+	// The Program Counter reached the breakpoint (See cchip8_set_breakpoint)
+	CCHIP8_BREAKPOINT
+};
+
+// Why a machine halted
+enum cchip8_fault
+{
+	CCHIP8_FAULT_NONE = 0,
+
+	// Opcode that's no CHIP8 instruction
+	CCHIP8_FAULT_UNIMPLEMENTED,
+
+	// 2NNN with all 16 stack entries in use
+	CCHIP8_FAULT_STACK_OVERFLOW,
+
+	// 00EE with an empty stack
+	CCHIP8_FAULT_STACK_UNDERFLOW,
+
+	// cchip8_options.m_maxinstructions instructions were executed
+	CCHIP8_FAULT_INSTRUCTION_BUDGET,
+
+	// cchip8_options.m_maxmilliseconds went by
+	CCHIP8_FAULT_TIME_BUDGET
+};
+
+typedef struct cchip8_fault_info
+{
+	enum cchip8_fault m_fault;
+
+	/*
+		Where the machine stopped. Faults are precise, the faulting instruction (Or for the budget
+		faults, the next one that would have run) didn't execute and m_address still points at it.
+	*/
+	uint16_t m_address;
+	uint16_t m_opcode;
+
+	// Instructions executed since the last reset
+	uint64_t m_cycles;
+
+} cchip8_fault_info;
+
+// Fill m_options with the defaults cchip8_create(NULL) uses
+void cchip8_default_options(cchip8_options *m_options);
+
+// Create a machine with the font installed and no ROM, returns NULL on bad options or memory exhaustion
+cchip8 *cchip8_create(const cchip8_options *m_options);
+
+void cchip8_destroy(cchip8 *m_vm);
+
+// Power-cycle the machine: registers, display, timers and memory go back to the state right after the last ROM load
+void cchip8_reset(cchip8 *m_vm);
+
+// Copy a ROM to 0x200 and reset, fails (Leaving the machine untouched) if it doesn't fit
+bool cchip8_load_rom_from_memory(cchip8 *m_vm, const uint8_t *m_rom, size_t m_size);
+
+// Read a ROM file and load it, fails on missing, empty or oversized files
+bool cchip8_load_rom_from_file(cchip8 *m_vm, const char *m_filename);
+
+/*
+	ROM archives: a whole corpus packed into one file (See tools/cchip8_pack.c), mapped once and
+	validated on open. Names and ROM images point straight into the mapping until the archive is closed.
+*/
+typedef struct cchip8_archive cchip8_archive;
+
+cchip8_archive *cchip8_archive_open(const char *m_filename);
+
+void cchip8_archive_close(cchip8_archive *m_archive);
+
+size_t cchip8_archive_count(const cchip8_archive *m_archive);
+
+// NULL if m_index is out of range
+const char *cchip8_archive_name(const cchip8_archive *m_archive, size_t m_index);
+
+const uint8_t *cchip8_archive_rom(const cchip8_archive *m_archive, size_t m_index, size_t *m_size);
+
+bool cchip8_load_rom_from_archive(cchip8 *m_vm, const cchip8_archive *m_archive, size_t m_index);
+
+// Emulate m_frames 60 Hz frames (CHIP8 timers tick once per frame)
+enum cchip8_status cchip8_run_frames(cchip8 *m_vm, uint32_t m_frames);
+
+// Execute a single instruction (Debuggers, single stepping)
+enum cchip8_status cchip8_step(cchip8 *m_vm);
+
+// Keypad state, bit N set means key N (0x0-0xF) is held down
+void cchip8_set_keys(cchip8 *m_vm, uint16_t m_keys);
+
+uint16_t cchip8_get_keys(const cchip8 *m_vm);
+
+// Press (m_down) or release the key m_key (0x0-0xF) and leave the others held, true if that changed what's held
+bool cchip8_key_event(cchip8 *m_vm, uint8_t m_key, bool m_down);
+
+/*
+	CCHIP8_WIDTH * CCHIP8_HEIGHT pixels, row-major. The pointer stays valid until cchip8_destroy.
+	If m_changed isn't NULL it receives whether the picture changed since the previous call.
+*/
+const uint32_t *cchip8_get_framebuffer(cchip8 *m_vm, bool *m_changed);
+
+/*
+	Golden-frame tests: the display packed one bit per pixel (Bit X of m_rows[Y] is the pixel at (X, Y),
+	like cchip8_snapshot) and a fast 64 bit hash of that. The hash depends on nothing but the picture,
+	so hashes stored by one build and host stay valid for the next.
+*/
+void cchip8_pack_display(const cchip8 *m_vm, uint64_t m_rows[CCHIP8_HEIGHT]);
+
+uint64_t cchip8_hash_display(const uint64_t m_rows[CCHIP8_HEIGHT]);
+
+// Whether the buzzer should be sounding right now
+bool cchip8_get_sound(const cchip8 *m_vm);
+
+// Amount of instructions executed since the last reset
+uint64_t cchip8_get_cycles(const cchip8 *m_vm);
+
+// Why the machine halted (CCHIP8_FAULT_NONE while it can run), m_info receives the details unless it's NULL
+enum cchip8_fault cchip8_get_fault(const cchip8 *m_vm, cchip8_fault_info *m_info);
+
+// Human readable fault description ("stack overflow"...)
+const char *cchip8_fault_name(enum cchip8_fault m_fault);
+
+// Name of the quirk profile the machine runs under (The one picked for the current ROM under "auto")
+const char *cchip8_get_profile(const cchip8 *m_vm);
+
+// Architectural registers, what a debugger or an overlay shows
+typedef struct cchip8_registers
+{
+	uint16_t m_programcounter;
+	uint16_t m_index;
+
+	// Instruction single steps (cchip8_step) last fetched
+	uint16_t m_opcode;
+
+	uint8_t m_registers[16];
+	uint8_t m_stackp;
+	uint8_t m_delaytimer;
+	uint8_t m_soundtimer;
+
+} cchip8_registers;
+
+void cchip8_get_registers(const cchip8 *m_vm, cchip8_registers *m_registers);
+
+// Copy m_length bytes of RAM starting at m_address into m_buffer (Addresses wrap around at 4 KiB)
+void cchip8_read_memory(const cchip8 *m_vm, uint16_t m_address, uint8_t *m_buffer, size_t m_length);
+
+// Write the superinstruction statistics (Sites, dispatches and dispatches saved per sequence) to m_out, nothing without fusion
+void cchip8_print_fusion_stats(const cchip8 *m_vm, FILE *m_out);
+
+// Stop cchip8_run_frames when the Program Counter reaches m_address (0xFFFF disables it)
+void cchip8_set_breakpoint(cchip8 *m_vm, uint16_t m_address);
+
+/*
+	Save states: a full copy of the running machine (Registers, stack, timers, memory, display and
+	fault state) taken or put back in about a microsecond, so it can be done several times per frame
+	(Run-ahead, rewinding). Held keys and the breakpoint aren't part of a state, they stay whatever the
+	embedder set last. A state can be loaded into any instance, cchip8_reset still goes back to the
+	instance's own ROM.
+*/
+typedef struct cchip8_state cchip8_state;
+
+cchip8_state *cchip8_state_create(void);
+
+void cchip8_state_destroy(cchip8_state *m_state);
+
+void cchip8_save_state(const cchip8 *m_vm, cchip8_state *m_state);
+
+// The restored picture is reported as changed by the next cchip8_get_framebuffer
+void cchip8_load_state(cchip8 *m_vm, const cchip8_state *m_state);
+
+/*
+	Reverse debugging: with a journal enabled, every instruction first records the bytes it's about
+	to overwrite (Registers, I, stack, timers, the RAM FX33/FX55 store to, the pixels DXYN draws over),
+	about 13 bytes for a typical instruction. Execution can then be walked backwards one instruction
+	at a time. The journal holds at most m_budget bytes, the oldest instructions are forgotten first.
+	A reset, a ROM load or a cchip8_load_state starts a new history. Journaled instructions run one at
+	a time through the reference interpreter instead of m_run, which makes cchip8_run_frames 2-5x
+	slower (Depending on the ROM and the host), so only turn it on while debugging.
+*/
+
+// m_budget in bytes (0 disables journaling), false if it can't be allocated
+bool cchip8_set_journal(cchip8 *m_vm, size_t m_budget);
+
+// Amount of instructions the journal can still undo
+uint64_t cchip8_journal_depth(const cchip8 *m_vm);
+
+// Undo the last instruction (Or clear the fault of a halted machine, its instruction never ran), false if there's nothing to undo
+bool cchip8_step_back(cchip8 *m_vm);
+
+// Undo instructions until the Program Counter reaches the breakpoint (CCHIP8_BREAKPOINT) or the journal runs out (CCHIP8_OK)
+enum cchip8_status cchip8_continue_back(cchip8 *m_vm);
+
+/*
+	Which instruction last wrote the byte at m_address: m_pc receives its address and m_age how many
+	instructions ago it ran (1 = the last one). False if nothing in the journal wrote it.
+*/
+bool cchip8_last_writer(const cchip8 *m_vm, uint16_t m_address, uint16_t *m_pc, uint64_t *m_age);
+
+/*
+	Published view: a consistent copy of the machine that any amount of other threads can read while
+	it keeps running (Monitors, debugger front ends...). Once attached, the view gets republished at the
+	end of every cchip8_run_frames (A frame boundary), cchip8_step, step back, reset and state load, by
+	the thread making those calls. Readers never take a lock or make the emulation thread wait: a
+	sequence counter tells them whether the copy they just took was torn by a publish, in which case
+	they take it again.
+*/
+typedef struct cchip8_snapshot
+{
+	// Publications so far, this snapshot included (Increases by one per publish)
+	uint64_t m_frame;
+
+	// Instructions executed since the last reset
+	uint64_t m_cycles;
+
+	// The display, one bit per pixel: bit X of m_display[Y] is the pixel at (X, Y)
+	uint64_t m_display[CCHIP8_HEIGHT];
+
+	uint8_t m_memory[4096];
+
+	uint16_t m_stack[16];
+	uint16_t m_programcounter;
+	uint16_t m_index;
+
+	// Held keys, bit N set means key N is down
+	uint16_t m_keys;
+
+	uint8_t m_registers[16];
+	uint8_t m_stackp;
+	uint8_t m_delaytimer;
+	uint8_t m_soundtimer;
+
+	// enum cchip8_fault
+	uint8_t m_fault;
+
+} cchip8_snapshot;
+
+typedef struct cchip8_view cchip8_view;
+
+cchip8_view *cchip8_view_create(void);
+
+// Detach it from its machine first
+void cchip8_view_destroy(cchip8_view *m_view);
+
+// Publish m_vm into m_view from now on (Right away too), NULL detaches the current view
+void cchip8_attach_view(cchip8 *m_vm, cchip8_view *m_view);
+
+// Publications so far, a cheap way for readers to poll for a new frame
+uint64_t cchip8_view_frame(const cchip8_view *m_view);
+
+// Copy the latest publication into m_snapshot from any thread, false if nothing was published yet (Or the writer stalled mid-publish)
+bool cchip8_view_read(const cchip8_view *m_view, cchip8_snapshot *m_snapshot);
+
+/*
+	Shared-memory export (Linux): publishes the same snapshot as a cchip8_view into a POSIX shared
+	memory segment, so other local processes can watch the machine. A reader process maps it with
+	cchip8_monitor_open and sleeps on the frame counter (A futex) until the next publication; the
+	emulation process only makes the wake-up system call when somebody is actually waiting.
+
+	Segment layout (Version 1, native endianness and alignment, for readers that don't link libcchip8):
+		0     uint32  magic, CCHIP8_EXPORT_MAGIC once the segment is ready
+		4     uint32  layout version, CCHIP8_EXPORT_VERSION
+		8     uint32  segment size in bytes
+		12    uint32  size of cchip8_snapshot
+		64    uint32  frame counter (Low 32 bits of the publications so far), FUTEX_WAIT on it
+		68    uint32  readers sleeping on the frame counter (Increment before, decrement after waiting)
+		128   uint64  sequence, odd while a publication is being written
+		192   cchip8_snapshot, as 64-bit words
+	A consistent copy is the snapshot read between two loads of the sequence that are even and equal.
+*/
+#define CCHIP8_EXPORT_MAGIC 0x38504843
+#define CCHIP8_EXPORT_VERSION 1
+
+typedef struct cchip8_export cchip8_export;
+
+// Create (Or take over) the shared memory segment m_name ("/cchip8"...), NULL if that fails or the platform has no futexes
+cchip8_export *cchip8_export_create(const char *m_name);
+
+// Detach it from its machine first, clears the magic and unlinks the segment (Readers that mapped it keep their mapping)
+void cchip8_export_destroy(cchip8_export *m_export);
+
+// Publish m_vm into m_export whenever it would publish a view (Right away too), NULL detaches the current export
+void cchip8_attach_export(cchip8 *m_vm, cchip8_export *m_export);
+
+/*
+	Stop publishing to the attached view and export, and recording into the attached capture, for a
+	while (Run-ahead emulates frames that never happen for real, readers shouldn't see them). Nothing
+	gets published when it's resumed either.
+*/
+void cchip8_pause_publishing(cchip8 *m_vm, bool m_paused);
+
+// Reader side of an export, in another process
+typedef struct cchip8_monitor cchip8_monitor;
+
+// Map the segment m_name (Readers only write the sleeping count), NULL if it doesn't exist or has another layout version
+cchip8_monitor *cchip8_monitor_open(const char *m_name);
+
+void cchip8_monitor_close(cchip8_monitor *m_monitor);
+
+// Sleep until the frame counter differs from m_frame or m_milliseconds went by, returns the current frame counter
+uint32_t cchip8_monitor_wait(cchip8_monitor *m_monitor, uint32_t m_frame, uint32_t m_milliseconds);
+
+// Consistent copy of the latest publication, false if nothing was published yet, the export got destroyed or its writer stalled mid-publish
+bool cchip8_monitor_read(const cchip8_monitor *m_monitor, cchip8_snapshot *m_snapshot);
+
+/*
+	Control socket: drives an instance from another process (Automation, test harnesses) over a Unix
+	domain socket. Every request gets exactly one reply, in order, so clients can pipeline as many
+	requests as they like before collecting the replies.
+
+	Framing (Little endian):
+		request: uint8 command | uint8 argument | uint16 payload length | payload
+		reply:   uint8 command | uint8 status   | uint16 payload length | payload
+	Payloads are at most CCHIP8_CONTROL_MAX_PAYLOAD bytes, a client sending a longer one gets disconnected.
+*/
+#define CCHIP8_CONTROL_MAX_PAYLOAD 4096
+
+enum cchip8_command
+{
+	// Payload: the ROM image. Loads it and resets the machine
+	CCHIP8_CONTROL_LOAD_ROM = 1,
+
+	CCHIP8_CONTROL_RESET,
+
+	// Argument: the key (0x0-0xF), plus 0x80 to press it (Released otherwise). Reply: uint16 held keys
+	CCHIP8_CONTROL_KEY,
+
+	// Payload: uint32 frames (At least 1, 1 without a payload). Reply: uint8 enum cchip8_status | uint64 instructions since the reset
+	CCHIP8_CONTROL_RUN_FRAMES,
+
+	// A single instruction, same reply as CCHIP8_CONTROL_RUN_FRAMES
+	CCHIP8_CONTROL_STEP,
+
+	// Argument: save state slot (Below CCHIP8_CONTROL_SLOTS). Loading a slot nothing was saved to fails
+	CCHIP8_CONTROL_SAVE_STATE,
+	CCHIP8_CONTROL_LOAD_STATE,
+
+	// Payload: uint16 address | uint16 length (Up to 4096, wraps around). Reply: the bytes
+	CCHIP8_CONTROL_READ_MEMORY,
+
+	/*
+		Reply: uint64 instructions | uint16 PC | uint16 I | uint16 held keys | V0-VF | uint8 SP |
+		uint8 delay timer | uint8 sound timer | uint8 enum cchip8_fault | CCHIP8_HEIGHT uint64 display
+		rows (Bit X is the pixel at column X), CCHIP8_OBSERVATION_SIZE bytes
+	*/
+	CCHIP8_CONTROL_OBSERVE
+};
+
+#define CCHIP8_CONTROL_SLOTS 16
+#define CCHIP8_OBSERVATION_SIZE (8 + 6 + 16 + 4 + (CCHIP8_HEIGHT * 8))
+
+enum cchip8_control_status
+{
+	CCHIP8_CONTROL_OK = 0,
+
+	// No such command
+	CCHIP8_CONTROL_UNKNOWN,
+
+	// Payload or argument out of range for the command
+	CCHIP8_CONTROL_MALFORMED,
+
+	// Well formed but it didn't work (ROM rejected, empty save state slot...)
+	CCHIP8_CONTROL_FAILED
+};
+
+typedef struct cchip8_control cchip8_control;
+
+// Listen on the socket m_path (Replacing a stale socket nobody listens on, only the owner may connect) for clients driving m_vm, NULL if that fails or the platform has no Unix sockets
+cchip8_control *cchip8_control_create(cchip8 *m_vm, const char *m_path);
+
+// Disconnects every client and removes the socket
+void cchip8_control_destroy(cchip8_control *m_control);
+
+/*
+	Key requests go through m_handler instead of straight to cchip8_key_event, so a front end can run
+	them down the same path as its own keyboard (m_handler NULL goes back to cchip8_key_event).
+*/
+void cchip8_control_key_handler(cchip8_control *m_control, void (*m_handler)(void *m_user, uint8_t m_key, bool m_down), void *m_user);
+
+/*
+	Serve the clients from the calling thread (The one driving the machine, nothing else touches it):
+	waits up to m_milliseconds for something to happen (-1 as long as it takes, 0 doesn't wait), accepts
+	connections and runs every complete request. Returns how many requests ran, -1 once listening failed.
+*/
+int cchip8_control_serve(cchip8_control *m_control, int m_milliseconds);
+
+typedef struct cchip8_client cchip8_client;
+
+// A reply, m_payload stays valid until the next cchip8_client_send or cchip8_client_receive
+typedef struct cchip8_reply
+{
+	uint8_t m_command;
+	uint8_t m_status;
+	uint16_t m_length;
+	const uint8_t *m_payload;
+
+} cchip8_reply;
+
+// A decoded CCHIP8_CONTROL_OBSERVE reply
+typedef struct cchip8_observation
+{
+	uint64_t m_cycles;
+	uint64_t m_display[CCHIP8_HEIGHT];
+	uint16_t m_programcounter;
+	uint16_t m_index;
+	uint16_t m_keys;
+	uint8_t m_registers[16];
+	uint8_t m_stackp;
+	uint8_t m_delaytimer;
+	uint8_t m_soundtimer;
+	uint8_t m_fault;
+
+} cchip8_observation;
+
+// NULL if nothing listens on m_path
+cchip8_client *cchip8_client_connect(const char *m_path);
+
+void cchip8_client_close(cchip8_client *m_client);
+
+// Pipelining: queue a request (Sent in batches), false once the connection is gone
+bool cchip8_client_send(cchip8_client *m_client, uint8_t m_command, uint8_t m_argument, const void *m_payload, uint16_t m_length);
+
+// Sends whatever is queued and waits for the next reply, false once the connection is gone
+bool cchip8_client_receive(cchip8_client *m_client, cchip8_reply *m_reply);
+
+// False unless m_reply is a successful CCHIP8_CONTROL_OBSERVE reply
+bool cchip8_client_decode_observation(const cchip8_reply *m_reply, cchip8_observation *m_observation);
+
+/*
+	One request, one reply (Only with no pipelined requests outstanding). False if the connection is
+	gone or the request failed.
+*/
+bool cchip8_client_load_rom(cchip8_client *m_client, const uint8_t *m_rom, uint16_t m_size);
+bool cchip8_client_reset(cchip8_client *m_client);
+bool cchip8_client_key(cchip8_client *m_client, uint8_t m_key, bool m_down);
+bool cchip8_client_run_frames(cchip8_client *m_client, uint32_t m_frames, enum cchip8_status *m_status);
+bool cchip8_client_save_state(cchip8_client *m_client, uint8_t m_slot);
+bool cchip8_client_load_state(cchip8_client *m_client, uint8_t m_slot);
+bool cchip8_client_read_memory(cchip8_client *m_client, uint16_t m_address, uint8_t *m_buffer, uint16_t m_length);
+bool cchip8_client_observe(cchip8_client *m_client, cchip8_observation *m_observation);
+
+/*
+	Capture: records a session into a compact stream (See cchip8-convert for turning it into Y4M, GIF
+	or PNG). Every cchip8_run_frames of an attached machine whose picture changed hands the display
+	over to a background writer thread (A copy into a preallocated ring, no lock or system call), which
+	delta and RLE codes it. Frames that don't change the picture only get counted, so the stream keeps
+	the exact timing. If the writer ever falls a whole ring (128 pictures) behind, the machine waits
+	for it rather than lose a picture.
+*/
+typedef struct cchip8_capture cchip8_capture;
+
+typedef struct cchip8_capture_stats
+{
+	// Emulated frames covered, pictures recorded (Frames where it changed) and bytes written
+	uint64_t m_frames;
+	uint64_t m_records;
+	uint64_t m_bytes;
+
+	// Times the machine had to wait for the writer
+	uint64_t m_stalls;
+
+} cchip8_capture_stats;
+
+// Start writing to m_filename (Replaced if it exists), NULL if it can't be created or the platform has no threads
+cchip8_capture *cchip8_capture_create(const char *m_filename);
+
+// Detach it from its machine first, writes out what's left and closes the stream, m_stats (Unless NULL) receives the totals
+void cchip8_capture_destroy(cchip8_capture *m_capture, cchip8_capture_stats *m_stats);
+
+// Record m_vm into m_capture from its next cchip8_run_frames on (Paused publishing pauses it too, runs of 0 frames record nothing), NULL detaches it
+void cchip8_attach_capture(cchip8 *m_vm, cchip8_capture *m_capture);
@@ -0,0 +1,178 @@
+#include "../include/cchip8.h"
+#include "../include/cchip8_analysis.h"
+#include "../include/cchip8_loader.h"
+
+/*
+	CCHIP8 static ROM analyser:
+	Prints the control-flow graph, the code/data map, indirect jumps, self-modifying stores and the
+	quirk profile a ROM most likely needs, without running it.
+*/
+
+static const char *m_exit_names[] = {
+	"fallthrough",
+	"jump",
+	"call",
+	"return",
+	"skip",
+	"indirect",
+	"halt"
+};
+
+static void m_analyse_print_cfg(const m_analysis *m_analysis)
+{
+	for (size_t i = 0; i < m_analysis->m_blockcount; i++)
+	{
+		const m_block *m_block = &m_analysis->m_blocks[i];
+
+		printf("0x%03X-0x%03X %-11s", m_block->m_start, m_block->m_end, m_exit_names[m_block->m_exit]);
+
+		for (size_t j = 0; j < 2; j++)
+		{
+			if (m_block->m_next[j] != CHIP8_NO_BREAKPOINT)
+			{
+				printf(" -> 0x%03X", m_block->m_next[j]);
+			}
+		}
+
+		printf("\n");
+	}
+}
+
+static void m_analyse_print_dot(const m_analysis *m_analysis)
+{
+	printf("digraph cfg {\n\tnode [shape=box fontname=monospace];\n");
+
+	for (size_t i = 0; i < m_analysis->m_blockcount; i++)
+	{
+		const m_block *m_block = &m_analysis->m_blocks[i];
+
+		printf("\tb%03X [label=\"0x%03X-0x%03X\\n%s\"];\n", m_block->m_start, m_block->m_start, m_block->m_end,
+			m_exit_names[m_block->m_exit]);
+
+		for (size_t j = 0; j < 2; j++)
+		{
+			if (m_block->m_next[j] != CHIP8_NO_BREAKPOINT)
+			{
+				printf("\tb%03X -> b%03X;\n", m_block->m_start, m_block->m_next[j]);
+			}
+		}
+	}
+
+	printf("}\n");
+}
+
+// One character per byte: C instruction, c operand, D data, X both, W written, ! unimplemented, . unreached
+static void m_analyse_print_map(const m_analysis *m_analysis, size_t m_romsize)
+{
+	for (size_t m_address = CHIP8_INITIAL_PC; m_address < (CHIP8_INITIAL_PC + m_romsize); m_address++)
+	{
+		uint8_t m_flags = m_analysis->m_flags[m_address];
+		char m_class = '.';
+
+		if (m_flags & M_ADDR_INVALID)
+		{
+			m_class = '!';
+		} else if ((m_flags & (M_ADDR_CODE | M_ADDR_OPERAND)) && (m_flags & M_ADDR_DATA))
+		{
+			m_class = 'X';
+		} else if (m_flags & M_ADDR_CODE)
+		{
+			m_class = 'C';
+		} else if (m_flags & M_ADDR_OPERAND)
+		{
+			m_class = 'c';
+		} else if (m_flags & M_ADDR_DATA)
+		{
+			m_class = 'D';
+		} else if (m_flags & M_ADDR_WRITTEN)
+		{
+			m_class = 'W';
+		}
+
+		if (((m_address - CHIP8_INITIAL_PC) % 64) == 0)
+		{
+			printf("%s0x%03zX ", (m_address == CHIP8_INITIAL_PC) ? "" : "\n", m_address);
+		}
+
+		printf("%c", m_class);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	bool m_cfg = false;
+	bool m_dot = false;
+	bool m_map = false;
+	const char *m_filename = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-cfg") == 0)
+		{
+			m_cfg = true;
+		} else if (strcmp(argv[i], "-dot") == 0)
+		{
+			m_dot = true;
+		} else if (strcmp(argv[i], "-map") == 0)
+		{
+			m_map = true;
+		} else {
+			m_filename = argv[i];
+		}
+	}
+
+	if (m_filename == NULL)
+	{
+		printf("Usage: ./cchip8-analyse [-cfg] [-map] [-dot] [progname]\n");
+		return EXIT_FAILURE;
+	}
+
+	uint8_t m_memory[FOURKiB] = { 0 };
+	size_t m_romsize = 0;
+
+	memcpy(m_memory, m_font, CHIP8_FONT_SIZE);
+
+	if (m_rom_read(m_filename, &m_memory[CHIP8_INITIAL_PC], CCHIP8_MAX_ROM_SIZE, &m_romsize) == false)
+	{
+		return EXIT_FAILURE;
+	}
+
+	m_analysis *m_analysis = malloc(sizeof(*m_analysis));
+
+	if (m_analysis == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	m_analyse(m_analysis, m_memory);
+
+	// Graphviz output goes alone so it can be piped straight into dot
+	if (m_dot == true)
+	{
+		m_analyse_print_dot(m_analysis);
+		free(m_analysis);
+		return EXIT_SUCCESS;
+	}
+
+	printf("%s: %zu bytes\n", m_filename, m_romsize);
+	m_analysis_print(m_analysis, stdout);
+
+	if (m_cfg == true)
+	{
+		printf("\nControl-flow graph:\n");
+		m_analyse_print_cfg(m_analysis);
+	}
+
+	if (m_map == true)
+	{
+		printf("\nMemory map (C instruction, c operand, D data, X code read as data, W written, ! unimplemented):\n");
+		m_analyse_print_map(m_analysis, m_romsize);
+	}
+
+	free(m_analysis);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "../include/cchip8.h"
+#include "../include/cchip8_asm.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_loader.h"
+
+/*
+	CCHIP8 assembler:
+	Assembles listings in the syntax cchip8-dis prints (See include/cchip8_asm.h) into ROMs.
+	Directories are assembled in parallel, one thread per CPU.
+*/
+
+typedef struct chip8_asm_job
+{
+	// Write the ROMs here (NULL: next to their source)
+	const char *m_directory;
+
+	// Single source given with -o naming a file instead of a directory
+	const char *m_output;
+
+	// Per-thread counters, padded to a cache line each
+	uint64_t (*m_counts)[M_CACHELINE / sizeof(uint64_t)];
+
+} m_asm_job;
+
+// Counters in m_asm_job.m_counts
+enum m_asm_count
+{
+	M_ASM_COUNT_DONE = 0,
+	M_ASM_COUNT_FAILED,
+	M_ASM_COUNT_BYTES
+};
+
+static void m_asm_source(void *m_context, size_t m_worker, const char *m_filename)
+{
+	m_asm_job *m_job = m_context;
+	uint64_t *m_counts = m_job->m_counts[m_worker];
+
+	m_rom m_source;
+
+	if (m_rom_map(&m_source, m_filename) == false)
+	{
+		m_counts[M_ASM_COUNT_FAILED]++;
+		return;
+	}
+
+	uint8_t m_rom[CCHIP8_MAX_ROM_SIZE];
+	size_t m_size = 0;
+	m_asm_error m_error;
+
+	bool m_ok = m_assemble((const char *) m_source.m_data, m_source.m_size, m_rom, sizeof(m_rom), &m_size, &m_error);
+
+	m_rom_unmap(&m_source);
+
+	if (m_ok == false)
+	{
+		printf("%s:%zu: %s\n", m_filename, m_error.m_line, m_error.m_message);
+		m_counts[M_ASM_COUNT_FAILED]++;
+		return;
+	}
+
+	char m_path[4096];
+	const char *m_output = m_job->m_output;
+
+	if (m_output == NULL)
+	{
+		if (m_corpus_output(m_path, sizeof(m_path), m_job->m_directory, m_filename, ".ch8") == false)
+		{
+			printf("%s: output path too long\n", m_filename);
+			m_counts[M_ASM_COUNT_FAILED]++;
+			return;
+		}
+
+		m_output = m_path;
+	}
+
+	FILE *m_out = fopen(m_output, "wb");
+
+	if (m_out == NULL)
+	{
+		printf("Could not create %s\n", m_output);
+		m_counts[M_ASM_COUNT_FAILED]++;
+		return;
+	}
+
+	bool m_written = (m_size == 0) || (fwrite(m_rom, m_size, 1, m_out) == 1);
+
+	if ((fclose(m_out) != 0) || (m_written == false))
+	{
+		printf("Could not write %s\n", m_output);
+		m_counts[M_ASM_COUNT_FAILED]++;
+		return;
+	}
+
+	m_counts[M_ASM_COUNT_DONE]++;
+	m_counts[M_ASM_COUNT_BYTES] += m_size;
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const m_extensions[] = { ".asm", ".s", ".8s", NULL };
+
+	m_asm_job m_job = { 0 };
+	m_corpus m_corpus = { 0 };
+	const char *m_output = NULL;
+	size_t m_threads = 0;
+	size_t m_inputs = 0;
+	bool m_directories = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+		{
+			m_threads = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+		{
+			m_output = argv[++i];
+		} else {
+			size_t m_before = m_corpus.m_count;
+
+			if (m_corpus_add(&m_corpus, argv[i], m_extensions) == false)
+			{
+				m_corpus_free(&m_corpus);
+				return EXIT_FAILURE;
+			}
+
+			m_directories = m_directories || ((m_corpus.m_count - m_before) != 1);
+			m_inputs++;
+		}
+	}
+
+	if (m_inputs == 0)
+	{
+		printf("Usage: ./cchip8-asm [-j threads] [-o rom|directory] [source|directory]...\n");
+		return EXIT_FAILURE;
+	}
+
+	// -o names the ROM for a single source, the directory the ROMs go to otherwise
+	if ((m_output != NULL) && (m_corpus.m_count == 1) && (m_directories == false) && (m_corpus_is_directory(m_output) == false))
+	{
+		m_job.m_output = m_output;
+	} else {
+		m_job.m_directory = m_output;
+	}
+
+	if (m_threads == 0)
+	{
+		m_threads = m_corpus_threads();
+	}
+
+	m_job.m_counts = m_aligned_alloc(m_threads * M_CACHELINE);
+
+	if (m_job.m_counts == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		m_corpus_free(&m_corpus);
+		return EXIT_FAILURE;
+	}
+
+	memset(m_job.m_counts, 0, m_threads * M_CACHELINE);
+
+	m_corpus_run(&m_corpus, m_threads, m_asm_source, &m_job);
+
+	uint64_t m_done = 0;
+	uint64_t m_failed = 0;
+	uint64_t m_bytes = 0;
+
+	for (size_t i = 0; i < m_threads; i++)
+	{
+		m_done += m_job.m_counts[i][M_ASM_COUNT_DONE];
+		m_failed += m_job.m_counts[i][M_ASM_COUNT_FAILED];
+		m_bytes += m_job.m_counts[i][M_ASM_COUNT_BYTES];
+	}
+
+	if ((m_corpus.m_count > 1) || (m_failed > 0))
+	{
+		printf("%llu ROMs assembled (%llu bytes), %llu failed\n", (unsigned long long) m_done, (unsigned long long) m_bytes,
+			(unsigned long long) m_failed);
+	}
+
+	m_aligned_free(m_job.m_counts);
+	m_corpus_free(&m_corpus);
+
+	return (m_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,750 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cchip8.h"
+#include "../include/cchip8_fusion.h"
+#include "../include/cchip8_batch.h"
+#include "../include/cchip8_loader.h"
+#include "../include/cchip8_journal.h"
+#include "../include/cchip8_filter.h"
+#include "../include/cchip8_capture.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdatomic.h>
+
+/*
+	CCHIP8 headless benchmark:
+	Runs a ROM on many instances (Each one holding a different key) with the reference m_exec, the batched (Fused) m_run and the
+	lockstep SIMD batch engine, and reports instance-instructions per second for each of them.
+*/
+
+static double m_bench_now(void)
+{
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+	return (double) m_time.tv_sec + (double) m_time.tv_nsec / 1e9;
+}
+
+// Initialize an interpreter the same way the front end does and copy the ROM into it
+static bool m_bench_init(m_chip8 *chip8, const char *m_filename)
+{
+	chip8->m_programcounter = CHIP8_INITIAL_PC;
+	chip8->m_breakpoint = CHIP8_NO_BREAKPOINT;
+	chip8->m_profile = M_PROFILE_CCHIP8;
+
+	memcpy(chip8->m_memory, m_font, CHIP8_FONT_SIZE);
+
+	// Read the ROM straight into the interpreter's memory (Oversized images are refused)
+	size_t m_size = 0;
+
+	return m_rom_read(m_filename, &chip8->m_memory[CHIP8_INITIAL_PC], CCHIP8_MAX_ROM_SIZE, &m_size);
+}
+
+static void m_bench_report(const char *m_name, size_t m_instances, uint32_t m_steps, double m_seconds, double m_baseline)
+{
+	double m_rate = ((double) m_instances * (double) m_steps) / m_seconds;
+
+	printf("%-24s %10.3f s %14.0f instance-instructions/s", m_name, m_seconds, m_rate);
+
+	if (m_baseline > 0.0)
+	{
+		printf("  (%.2fx)", m_baseline / m_seconds);
+	}
+
+	printf("\n");
+}
+
+// Reader thread hammering a published view while the machine keeps running
+typedef struct chip8_bench_reader
+{
+	const cchip8_view *m_view;
+	atomic_bool *m_stop;
+	uint64_t m_reads;
+
+} m_bench_reader;
+
+static void *m_bench_read(void *m_arg)
+{
+	m_bench_reader *m_reader = m_arg;
+	cchip8_snapshot m_snapshot;
+	uint64_t m_frame = 0;
+
+	// Like a monitor would: poll the frame counter, take a copy of every new frame
+	while (atomic_load_explicit(m_reader->m_stop, memory_order_relaxed) == false)
+	{
+		if (cchip8_view_frame(m_reader->m_view) != m_frame)
+		{
+			if (cchip8_view_read(m_reader->m_view, &m_snapshot))
+			{
+				m_frame = m_snapshot.m_frame;
+				m_reader->m_reads++;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*
+	Frames per second of one machine running m_frames frames: on its own, publishing a view, and
+	publishing it while m_readers threads copy every frame (The emulation thread mustn't notice them).
+*/
+static void m_bench_view(const char *m_filename, uint32_t m_frames, size_t m_readers)
+{
+	cchip8 *m_vm = cchip8_create(NULL);
+	cchip8_view *m_view = cchip8_view_create();
+	m_bench_reader m_reader[8];
+	pthread_t m_threads[8];
+	atomic_bool m_stop;
+	double m_rates[3];
+
+	if ((m_vm == NULL) || (m_view == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_view_destroy(m_view);
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	m_readers = (m_readers > 8) ? 8 : m_readers;
+
+	for (size_t m_pass = 0; m_pass < 3; m_pass++)
+	{
+		cchip8_reset(m_vm);
+		cchip8_attach_view(m_vm, (m_pass > 0) ? m_view : NULL);
+		atomic_init(&m_stop, false);
+
+		for (size_t i = 0; (m_pass == 2) && (i < m_readers); i++)
+		{
+			m_reader[i] = (m_bench_reader) { .m_view = m_view, .m_stop = &m_stop, .m_reads = 0 };
+			pthread_create(&m_threads[i], NULL, m_bench_read, &m_reader[i]);
+		}
+
+		double m_start = m_bench_now();
+
+		for (uint32_t i = 0; i < m_frames; i++)
+		{
+			cchip8_run_frames(m_vm, 1);
+		}
+
+		m_rates[m_pass] = m_frames / (m_bench_now() - m_start);
+
+		atomic_store(&m_stop, true);
+
+		for (size_t i = 0; (m_pass == 2) && (i < m_readers); i++)
+		{
+			pthread_join(m_threads[i], NULL);
+		}
+	}
+
+	uint64_t m_reads = 0;
+
+	for (size_t i = 0; i < m_readers; i++)
+	{
+		m_reads += m_reader[i].m_reads;
+	}
+
+	printf("%-24s %10.0f frames/s alone, %.0f publishing (%.3f us per publish), %.0f with %zu readers (%.0f reads/s)\n", "Published view",
+		m_rates[0], m_rates[1], 1e6 / m_rates[1] - 1e6 / m_rates[0], m_rates[2], m_readers, m_reads * m_rates[2] / m_frames);
+
+	cchip8_attach_view(m_vm, NULL);
+	cchip8_view_destroy(m_view);
+	cchip8_destroy(m_vm);
+}
+
+// Same thing into a shared memory export, nobody sleeping on it (Publishing never makes a system call then)
+static void m_bench_export(const char *m_filename, uint32_t m_frames)
+{
+	cchip8 *m_vm = cchip8_create(NULL);
+	cchip8_export *m_export = cchip8_export_create("/cchip8-bench");
+	double m_rates[2];
+
+	if ((m_vm == NULL) || (m_export == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_export_destroy(m_export);
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	for (size_t m_pass = 0; m_pass < 2; m_pass++)
+	{
+		cchip8_reset(m_vm);
+		cchip8_attach_export(m_vm, (m_pass > 0) ? m_export : NULL);
+
+		double m_start = m_bench_now();
+
+		for (uint32_t i = 0; i < m_frames; i++)
+		{
+			cchip8_run_frames(m_vm, 1);
+		}
+
+		m_rates[m_pass] = m_frames / (m_bench_now() - m_start);
+	}
+
+	printf("%-24s %10.0f frames/s alone, %.0f exporting (%.3f us per publish)\n", "Shared memory export",
+		m_rates[0], m_rates[1], 1e6 / m_rates[1] - 1e6 / m_rates[0]);
+
+	cchip8_attach_export(m_vm, NULL);
+	cchip8_export_destroy(m_export);
+	cchip8_destroy(m_vm);
+}
+
+// Control socket server running in its own thread, like a headless instance in another process would
+typedef struct chip8_bench_server
+{
+	cchip8_control *m_control;
+	atomic_bool *m_stop;
+
+} m_bench_server;
+
+/*
+	Read a capture stream back: it has to hold m_records pictures on strictly increasing frames and
+	account for all m_frames emulated frames. False (With the reason) if it doesn't.
+*/
+static bool m_bench_capture_check(const char *m_filename, const cchip8_capture_stats *m_stats)
+{
+	m_capture_reader m_reader;
+	uint64_t m_pictures = 0;
+	uint64_t m_previous = 0;
+
+	if (m_capture_open(&m_reader, m_filename) == false)
+	{
+		return false;
+	}
+
+	while (m_capture_next(&m_reader))
+	{
+		if (m_reader.m_frame <= m_previous)
+		{
+			printf("Capture stream: picture %llu went back to frame %llu\n", (unsigned long long) m_pictures,
+				(unsigned long long) m_reader.m_frame);
+			m_capture_close(&m_reader);
+			return false;
+		}
+
+		m_previous = m_reader.m_frame;
+		m_pictures++;
+	}
+
+	m_capture_close(&m_reader);
+
+	if ((m_pictures != m_stats->m_records) || ((m_reader.m_frame + m_reader.m_trailing - 1) != m_stats->m_frames))
+	{
+		printf("Capture stream: read %llu pictures over %llu frames back, %llu over %llu were recorded\n",
+			(unsigned long long) m_pictures, (unsigned long long) (m_reader.m_frame + m_reader.m_trailing - 1),
+			(unsigned long long) m_stats->m_records, (unsigned long long) m_stats->m_frames);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Multi-frame runs: a machine capturing in runs of 1 to 37 frames has to leave the same pictures on
+	the same frames in its stream as an identical machine running one frame at a time shows. False
+	(With the first difference) if it doesn't.
+*/
+static bool m_bench_capture_runs(const char *m_filename, uint32_t m_frames)
+{
+	cchip8 *m_vm = cchip8_create(NULL);
+	cchip8 *m_twin = cchip8_create(NULL);
+	cchip8_capture *m_capture = cchip8_capture_create("/tmp/cchip8-bench-runs.c8v");
+	uint64_t *m_changes = malloc(m_frames * sizeof(uint64_t));
+	bool m_intact = true;
+
+	if ((m_vm == NULL) || (m_twin == NULL) || (m_capture == NULL) || (m_changes == NULL) ||
+		(cchip8_load_rom_from_file(m_vm, m_filename) == false) || (cchip8_load_rom_from_file(m_twin, m_filename) == false))
+	{
+		cchip8_capture_destroy(m_capture, NULL);
+		cchip8_destroy(m_vm);
+		cchip8_destroy(m_twin);
+		free(m_changes);
+		remove("/tmp/cchip8-bench-runs.c8v");
+		return true;
+	}
+
+	// The frames the twin's picture changed on (The first one always counts)
+	uint64_t m_rows[CCHIP8_HEIGHT];
+	uint64_t m_last[CCHIP8_HEIGHT];
+	size_t m_changecount = 0;
+
+	for (uint32_t m_frame = 1; m_frame <= m_frames; m_frame++)
+	{
+		cchip8_run_frames(m_twin, 1);
+		cchip8_pack_display(m_twin, m_rows);
+
+		if ((m_frame == 1) || (memcmp(m_rows, m_last, sizeof(m_rows)) != 0))
+		{
+			m_changes[m_changecount++] = m_frame;
+			memcpy(m_last, m_rows, sizeof(m_last));
+		}
+	}
+
+	cchip8_attach_capture(m_vm, m_capture);
+
+	for (uint32_t m_frame = 0, m_run = 1; m_frame < m_frames; m_run = (m_run % 37) + 1)
+	{
+		uint32_t m_count = ((m_frames - m_frame) < m_run) ? (m_frames - m_frame) : m_run;
+
+		cchip8_run_frames(m_vm, m_count);
+		m_frame += m_count;
+	}
+
+	cchip8_attach_capture(m_vm, NULL);
+	cchip8_capture_destroy(m_capture, NULL);
+
+	m_capture_reader m_reader;
+	size_t m_pictures = 0;
+
+	if (m_capture_open(&m_reader, "/tmp/cchip8-bench-runs.c8v"))
+	{
+		while (m_intact && m_capture_next(&m_reader))
+		{
+			if ((m_pictures >= m_changecount) || (m_reader.m_frame != m_changes[m_pictures]))
+			{
+				printf("Capture stream: picture %zu is on frame %llu, one frame at a time it's on frame %llu\n", m_pictures,
+					(unsigned long long) m_reader.m_frame, (m_pictures < m_changecount) ? (unsigned long long) m_changes[m_pictures] : 0ULL);
+				m_intact = false;
+			}
+
+			m_pictures++;
+		}
+
+		m_capture_close(&m_reader);
+	} else {
+		m_intact = false;
+	}
+
+	if (m_intact && (m_pictures != m_changecount))
+	{
+		printf("Capture stream: %zu pictures read back, one frame at a time shows %zu\n", m_pictures, m_changecount);
+		m_intact = false;
+	}
+
+	printf("%-24s %10zu pictures over %u frames in runs of 1 to 37 frames, stream %s\n", "Capture (Runs)", m_changecount,
+		m_frames, m_intact ? "read back" : "BROKEN");
+
+	cchip8_destroy(m_vm);
+	cchip8_destroy(m_twin);
+	free(m_changes);
+	remove("/tmp/cchip8-bench-runs.c8v");
+
+	return m_intact;
+}
+
+/*
+	Per-frame cost of a capture: the change check and handoff on the emulation thread, with the writer
+	thread encoding on another core. Faster than real time the ring fills up, stalls count how often
+	the machine had to wait for the writer. Zero-frame runs and single steps get mixed in like a
+	control client would, then the stream gets read back (They must not end it early). False if it
+	didn't read back as recorded.
+*/
+static bool m_bench_capture(const char *m_filename, uint32_t m_frames)
+{
+	cchip8 *m_vm = cchip8_create(NULL);
+	cchip8_capture *m_capture = cchip8_capture_create("/tmp/cchip8-bench.c8v");
+	cchip8_capture_stats m_stats = { 0 };
+	double m_rates[2];
+
+	if ((m_vm == NULL) || (m_capture == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_capture_destroy(m_capture, NULL);
+		cchip8_destroy(m_vm);
+		remove("/tmp/cchip8-bench.c8v");
+
+		// Nothing got recorded, so nothing can be broken
+		return true;
+	}
+
+	for (size_t m_pass = 0; m_pass < 2; m_pass++)
+	{
+		cchip8_reset(m_vm);
+		cchip8_attach_capture(m_vm, (m_pass > 0) ? m_capture : NULL);
+
+		double m_start = m_bench_now();
+
+		cchip8_run_frames(m_vm, 0);
+
+		for (uint32_t i = 0; i < m_frames; i++)
+		{
+			if ((i % 1024) == 1023)
+			{
+				cchip8_step(m_vm);
+				cchip8_run_frames(m_vm, 0);
+			}
+
+			cchip8_run_frames(m_vm, 1);
+		}
+
+		m_rates[m_pass] = m_frames / (m_bench_now() - m_start);
+	}
+
+	cchip8_attach_capture(m_vm, NULL);
+	cchip8_capture_destroy(m_capture, &m_stats);
+	cchip8_destroy(m_vm);
+
+	bool m_intact = m_bench_capture_check("/tmp/cchip8-bench.c8v", &m_stats);
+
+	remove("/tmp/cchip8-bench.c8v");
+
+	printf("%-24s %10.0f frames/s alone, %.0f capturing (%.3f us per frame, %llu pictures, %llu stalls, stream %s)\n", "Capture",
+		m_rates[0], m_rates[1], 1e6 / m_rates[1] - 1e6 / m_rates[0], (unsigned long long) m_stats.m_records,
+		(unsigned long long) m_stats.m_stalls, m_intact ? "read back" : "BROKEN");
+
+	return m_intact;
+}
+
+// Golden-frame check cost: packing the display and hashing it
+static void m_bench_hash(const char *m_filename, uint32_t m_rounds)
+{
+	cchip8 *m_vm = cchip8_create(NULL);
+
+	if ((m_vm == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	cchip8_run_frames(m_vm, 60);
+
+	uint64_t m_rows[CCHIP8_HEIGHT];
+	uint64_t m_mix = 0;
+	double m_start = m_bench_now();
+
+	for (uint32_t i = 0; i < m_rounds; i++)
+	{
+		cchip8_pack_display(m_vm, m_rows);
+		m_mix += cchip8_hash_display(m_rows);
+	}
+
+	double m_seconds = m_bench_now() - m_start;
+
+	printf("%-24s %10.0f checks/s (%.3f us per pack + hash, %016llx)\n", "Golden-frame hash", m_rounds / m_seconds,
+		1e6 * m_seconds / m_rounds, (unsigned long long) m_mix);
+
+	cchip8_destroy(m_vm);
+}
+
+/*
+	Presentation filter cost per frame at 3840x1920 (A 4K window, 60 output pixels per display pixel), every
+	frame a different picture so nothing gets skipped. One frame's budget at 60 Hz is 16.7 ms.
+*/
+static void m_bench_filter(const char *m_filename, uint32_t m_frames)
+{
+	static const struct
+	{
+		const char *m_name;
+		m_scaler m_scaler;
+		uint8_t m_persistence;
+		bool m_scanlines;
+
+	} m_configs[] = {
+		{ "Filter nearest", M_SCALER_NEAREST, 0, false },
+		{ "Filter scale2x", M_SCALER_SCALE2X, 0, false },
+		{ "Filter scale3x", M_SCALER_SCALE3X, 0, false },
+		{ "Filter + phosphor", M_SCALER_NEAREST, 192, false },
+		{ "Filter + scanlines", M_SCALER_NEAREST, 0, true },
+		{ "Filter scale3x + all", M_SCALER_SCALE3X, 192, true },
+	};
+
+	cchip8 *m_vm = cchip8_create(NULL);
+
+	if ((m_vm == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	// A minute of the ROM's pictures, replayed in a loop
+	static uint32_t m_pictures[64][CCHIP8_WIDTH * CCHIP8_HEIGHT];
+
+	for (size_t i = 0; i < 64; i++)
+	{
+		bool m_changed;
+
+		cchip8_run_frames(m_vm, 60);
+		memcpy(m_pictures[i], cchip8_get_framebuffer(m_vm, &m_changed), sizeof(m_pictures[i]));
+	}
+
+	cchip8_destroy(m_vm);
+
+	for (size_t c = 0; c < (sizeof(m_configs) / sizeof(m_configs[0])); c++)
+	{
+		m_filter m_filter;
+
+		if (m_filter_init(&m_filter, m_configs[c].m_scaler, 60, m_configs[c].m_persistence, m_configs[c].m_scanlines) == false)
+		{
+			return;
+		}
+
+		uint32_t m_mix = 0;
+		double m_start = m_bench_now();
+
+		for (uint32_t i = 0; i < m_frames; i++)
+		{
+			m_filter_run(&m_filter, m_pictures[i % 64], true, 1);
+			m_mix += m_filter.m_output[(i * 4099) % (m_filter.m_width * m_filter.m_height)];
+		}
+
+		double m_seconds = m_bench_now() - m_start;
+
+		printf("%-24s %10.3f ms per %ux%u frame (%.0f frames/s, %.2f GB/s written, %08x)\n", m_configs[c].m_name,
+			1e3 * m_seconds / m_frames, m_filter.m_width, m_filter.m_height, m_frames / m_seconds,
+			((double) m_frames * m_filter.m_width * m_filter.m_height * sizeof(uint32_t)) / (m_seconds * 1e9), m_mix);
+
+		m_filter_destroy(&m_filter);
+	}
+}
+
+static void *m_bench_serve(void *m_arg)
+{
+	m_bench_server *m_server = m_arg;
+
+	while (atomic_load_explicit(m_server->m_stop, memory_order_relaxed) == false)
+	{
+		cchip8_control_serve(m_server->m_control, 10);
+	}
+
+	return NULL;
+}
+
+/*
+	Step + observe round trips over the control socket (One frame, then the registers and display):
+	waiting for every reply, and pipelining m_depth of them before collecting the replies.
+*/
+static void m_bench_control(const char *m_filename, uint32_t m_trips, uint32_t m_depth)
+{
+	char m_path[64];
+	cchip8 *m_vm = cchip8_create(NULL);
+	atomic_bool m_stop;
+	pthread_t m_thread;
+
+	snprintf(m_path, sizeof(m_path), "/tmp/cchip8-bench-%ld.sock", (long) getpid());
+
+	if ((m_vm == NULL) || (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	m_bench_server m_server = { .m_control = cchip8_control_create(m_vm, m_path), .m_stop = &m_stop };
+	cchip8_client *m_client = NULL;
+
+	atomic_init(&m_stop, false);
+
+	if ((m_server.m_control == NULL) || (pthread_create(&m_thread, NULL, m_bench_serve, &m_server) != 0))
+	{
+		cchip8_control_destroy(m_server.m_control);
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	m_client = cchip8_client_connect(m_path);
+
+	double m_rates[2] = { 0.0, 0.0 };
+	cchip8_observation m_observation;
+	cchip8_reply m_reply;
+	bool m_ok = (m_client != NULL);
+
+	double m_start = m_bench_now();
+
+	for (uint32_t i = 0; m_ok && (i < m_trips); i++)
+	{
+		m_ok = cchip8_client_run_frames(m_client, 1, NULL) && cchip8_client_observe(m_client, &m_observation);
+	}
+
+	m_rates[0] = m_trips / (m_bench_now() - m_start);
+	m_start = m_bench_now();
+
+	for (uint32_t i = 0; m_ok && (i < m_trips); i += m_depth)
+	{
+		for (uint32_t j = 0; j < m_depth; j++)
+		{
+			m_ok = m_ok && cchip8_client_send(m_client, CCHIP8_CONTROL_RUN_FRAMES, 0, NULL, 0) &&
+				cchip8_client_send(m_client, CCHIP8_CONTROL_OBSERVE, 0, NULL, 0);
+		}
+
+		for (uint32_t j = 0; m_ok && (j < m_depth); j++)
+		{
+			m_ok = cchip8_client_receive(m_client, &m_reply) && cchip8_client_receive(m_client, &m_reply) &&
+				cchip8_client_decode_observation(&m_reply, &m_observation);
+		}
+	}
+
+	m_rates[1] = m_trips / (m_bench_now() - m_start);
+
+	if (m_ok)
+	{
+		printf("%-24s %10.0f step + observe round trips/s, %.0f pipelined %u deep\n", "Control socket", m_rates[0], m_rates[1], m_depth);
+	} else {
+		printf("%-24s failed\n", "Control socket");
+	}
+
+	cchip8_client_close(m_client);
+	atomic_store(&m_stop, true);
+	pthread_join(m_thread, NULL);
+	cchip8_control_destroy(m_server.m_control);
+	cchip8_destroy(m_vm);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: ./cchip8-bench [progname] [instances] [steps]\n");
+		return EXIT_FAILURE;
+	}
+
+	size_t m_instances = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1024;
+	uint32_t m_steps = (argc > 3) ? (uint32_t) strtoul(argv[3], NULL, 0) : 100000;
+
+	if (m_instances == 0)
+	{
+		m_instances = 1;
+	}
+
+	m_chip8 *m_template = m_chip8_create();
+	m_chip8 *m_scratch = m_chip8_create();
+
+	if ((m_template == NULL) || (m_scratch == NULL) || (m_bench_init(m_template, argv[1]) == false))
+	{
+		return EXIT_FAILURE;
+	}
+
+	printf("%s: %zu instances x %u instructions (Warp: %d lanes)\n", argv[1], m_instances, m_steps, M_BATCH_WARP);
+	printf("Instance size: %zu bytes (CPU state: %zu bytes, video: %zu bytes)\n", sizeof(m_chip8),
+		offsetof(m_chip8, m_stack), sizeof(m_chip8_video));
+
+	// Reference interpreter, one instruction per call
+	double m_start = m_bench_now();
+
+	for (size_t m_id = 0; m_id < m_instances; m_id++)
+	{
+		m_chip8_copy(m_scratch, m_template);
+		m_scratch->m_keyboard[m_id % CHIP8_KEYS] = 1;
+
+		for (uint32_t i = 0; (i < m_steps) && (m_scratch->m_fault == M_FAULT_NONE); i++)
+		{
+			m_exec(m_scratch);
+		}
+	}
+
+	double m_scalar = m_bench_now() - m_start;
+	m_bench_report("m_exec", m_instances, m_steps, m_scalar, 0.0);
+
+	// Reference interpreter recording an undo journal (What reverse debugging costs), one per instance like a debugger would
+	m_journal *m_history = m_journal_create(1 << 20);
+
+	if (m_history == NULL)
+	{
+		printf("Couldn't allocate the journal\n");
+		return EXIT_FAILURE;
+	}
+
+	m_start = m_bench_now();
+
+	for (size_t m_id = 0; m_id < m_instances; m_id++)
+	{
+		m_chip8_copy(m_scratch, m_template);
+		m_scratch->m_keyboard[m_id % CHIP8_KEYS] = 1;
+		m_journal_clear(m_history);
+
+		for (uint32_t i = 0; (i < m_steps) && (m_scratch->m_fault == M_FAULT_NONE); i++)
+		{
+			m_journal_exec(m_history, m_scratch);
+		}
+	}
+
+	m_bench_report("m_journal_exec", m_instances, m_steps, m_bench_now() - m_start, m_scalar);
+
+	m_journal_destroy(m_history);
+
+	// Batched interpreter through the predecode cache
+	m_start = m_bench_now();
+
+	for (size_t m_id = 0; m_id < m_instances; m_id++)
+	{
+		m_chip8_copy(m_scratch, m_template);
+		m_scratch->m_keyboard[m_id % CHIP8_KEYS] = 1;
+		m_code_create(m_scratch);
+
+		while (((m_scratch->m_cycles - m_template->m_cycles) < m_steps) && (m_scratch->m_fault == M_FAULT_NONE))
+		{
+			m_run(m_scratch, (uint32_t) (m_steps - (m_scratch->m_cycles - m_template->m_cycles)));
+		}
+
+		m_code_destroy(m_scratch);
+	}
+
+	m_bench_report("m_run (fused)", m_instances, m_steps, m_bench_now() - m_start, m_scalar);
+
+	// Lockstep struct-of-arrays engine
+	m_batch *m_lanes = m_batch_create(m_instances, m_template);
+
+	if (m_lanes == NULL)
+	{
+		printf("Couldn't allocate the batch\n");
+		return EXIT_FAILURE;
+	}
+
+	for (size_t m_id = 0; m_id < m_instances; m_id++)
+	{
+		m_lanes->m_instances[m_id].m_keyboard[m_id % CHIP8_KEYS] = 1;
+	}
+
+	m_start = m_bench_now();
+	m_batch_run(m_lanes, m_steps);
+	m_bench_report("m_batch_run (lockstep)", m_instances, m_steps, m_bench_now() - m_start, m_scalar);
+
+	uint64_t m_lanesteps = m_lanes->m_vectorsteps * M_BATCH_WARP + m_lanes->m_scalarsteps;
+
+	printf("  %.1f%% of lane-steps vectorized, %llu regroups\n",
+		(m_lanesteps > 0) ? (100.0 * (double) (m_lanes->m_vectorsteps * M_BATCH_WARP)) / (double) m_lanesteps : 0.0,
+		(unsigned long long) m_lanes->m_regroups);
+
+	m_batch_destroy(m_lanes);
+
+	/*
+		Save states as run-ahead uses them: save, emulate a frame, load it back. The frame is there
+		so the load has some memory (And predecode cache lines) to put back, it isn't timed.
+	*/
+	cchip8 *m_vm = cchip8_create(NULL);
+	cchip8_state *m_state = cchip8_state_create();
+
+	if ((m_vm != NULL) && (m_state != NULL) && cchip8_load_rom_from_file(m_vm, argv[1]))
+	{
+		const uint32_t m_rounds = 100000;
+		double m_snapshot = 0.0;
+
+		for (uint32_t i = 0; i < m_rounds; i++)
+		{
+			m_start = m_bench_now();
+			cchip8_save_state(m_vm, m_state);
+			m_snapshot += m_bench_now() - m_start;
+
+			cchip8_run_frames(m_vm, 1);
+
+			m_start = m_bench_now();
+			cchip8_load_state(m_vm, m_state);
+			m_snapshot += m_bench_now() - m_start;
+		}
+
+		printf("%-24s %10.3f us per save + load (%zu byte states)\n", "Save states", (m_snapshot * 1e6) / m_rounds, sizeof(m_chip8) + sizeof(m_chip8_video) / 2);
+	}
+
+	cchip8_state_destroy(m_state);
+	cchip8_destroy(m_vm);
+
+	m_bench_view(argv[1], 200000, 3);
+	m_bench_export(argv[1], 200000);
+	m_bench_control(argv[1], 20000, 64);
+	bool m_intact = m_bench_capture(argv[1], 200000);
+	m_intact = m_bench_capture_runs(argv[1], 20000) && m_intact;
+	m_bench_hash(argv[1], 1000000);
+	m_bench_filter(argv[1], 300);
+
+	m_chip8_destroy(m_template);
+	m_chip8_destroy(m_scratch);
+
+	return m_intact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
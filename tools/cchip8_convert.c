@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/cchip8_capture.h"
+#include "../include/cchip8_image.h"
+
+/*
+	CCHIP8 capture converter:
+	Turns a .c8v capture (-capture in the front end, cchip8_capture_create() in libcchip8) into
+	something a player or a review tool opens, at any integer scale:
+		y4m  raw video at the capture's frame rate, every emulated frame (Pipe into ffmpeg with -o -)
+		gif  looping animation, one image per picture change
+		png  one file per picture change, named <output>-<frame>.png
+	Y4M and PNG are exact. GIF delays are centiseconds and players slow down anything under 2, so
+	a picture shown for less than that is dropped in favour of the next one (The timing stays right).
+*/
+
+typedef enum chip8_convert_format
+{
+	M_CONVERT_Y4M,
+	M_CONVERT_GIF,
+	M_CONVERT_PNG,
+
+} m_convert_format;
+
+// The packed display drawn into m_image (Index 1 for lit pixels)
+static void m_convert_draw(m_image *m_image, const uint8_t *m_display, uint32_t m_scale)
+{
+	for (uint32_t y = 0; y < CHIP8_ROWS; y++)
+	{
+		for (uint32_t x = 0; x < CHIP8_COLUMNS; x++)
+		{
+			m_image_fill(m_image, m_scale, x, y, m_capture_pixel(m_display, x, y) ? 1 : 0);
+		}
+	}
+}
+
+// Centiseconds from the first picture to m_frame
+static uint64_t m_convert_centiseconds(const m_capture_reader *m_reader, uint64_t m_first, uint64_t m_frame)
+{
+	return (((m_frame - m_first) * 100) + (m_reader->m_framerate / 2)) / m_reader->m_framerate;
+}
+
+int main(int argc, char **argv)
+{
+	const char *m_input = NULL;
+	const char *m_output = NULL;
+	m_convert_format m_format = M_CONVERT_Y4M;
+	uint32_t m_scale = 8;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-format") == 0) && ((i + 1) < argc))
+		{
+			i++;
+
+			if (strcmp(argv[i], "y4m") == 0)
+			{
+				m_format = M_CONVERT_Y4M;
+			} else if (strcmp(argv[i], "gif") == 0)
+			{
+				m_format = M_CONVERT_GIF;
+			} else if (strcmp(argv[i], "png") == 0)
+			{
+				m_format = M_CONVERT_PNG;
+			} else {
+				printf("Unknown format %s (y4m, gif or png)\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+		} else if ((strcmp(argv[i], "-scale") == 0) && ((i + 1) < argc))
+		{
+			m_scale = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+		{
+			m_output = argv[++i];
+		} else if ((argv[i][0] != '-') && (m_input == NULL))
+		{
+			m_input = argv[i];
+		} else {
+			m_input = NULL;
+			break;
+		}
+	}
+
+	if ((m_input == NULL) || (m_output == NULL) || (m_scale == 0) || (m_scale > 256))
+	{
+		printf("Usage: ./cchip8-convert capture.c8v [-format y4m|gif|png] [-scale 1-256] -o output\n");
+		return EXIT_FAILURE;
+	}
+
+	m_capture_reader m_reader;
+
+	if (m_capture_open(&m_reader, m_input) == false)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (m_capture_next(&m_reader) == false)
+	{
+		printf("%s holds no pictures\n", m_input);
+		m_capture_close(&m_reader);
+		return EXIT_FAILURE;
+	}
+
+	m_image m_picture;
+	uint32_t m_width = m_reader.m_columns * m_scale;
+	uint32_t m_height = m_reader.m_rows * m_scale;
+
+	if (m_image_create(&m_picture, m_width, m_height) == false)
+	{
+		printf("Not enough memory for %ux%u pictures\n", m_width, m_height);
+		m_capture_close(&m_reader);
+		return EXIT_FAILURE;
+	}
+
+	m_y4m m_video;
+	m_gif m_animation;
+	bool m_ok = true;
+
+	if (m_format == M_CONVERT_Y4M)
+	{
+		m_ok = m_y4m_open(&m_video, m_output, m_width, m_height, m_reader.m_framerate);
+	} else if (m_format == M_CONVERT_GIF)
+	{
+		m_ok = m_gif_open(&m_animation, m_output, m_width, m_height, m_image_mono, 2);
+	}
+
+	if (m_ok == false)
+	{
+		m_image_free(&m_picture);
+		m_capture_close(&m_reader);
+		return EXIT_FAILURE;
+	}
+
+	// Each picture is written once the next one says how long it stayed up
+	uint8_t m_display[M_CAPTURE_FRAME];
+	uint64_t m_first = m_reader.m_frame;
+	uint64_t m_shown = m_reader.m_frame;
+	uint64_t m_pictures = 0;
+	uint64_t m_start = 0;
+	bool m_more = true;
+
+	while (m_ok && m_more)
+	{
+		memcpy(m_display, m_reader.m_display, sizeof(m_display));
+		m_shown = m_reader.m_frame;
+		m_more = m_capture_next(&m_reader);
+
+		uint64_t m_until = m_more ? m_reader.m_frame : (m_shown + m_reader.m_trailing);
+
+		m_convert_draw(&m_picture, m_display, m_scale);
+
+		if (m_format == M_CONVERT_Y4M)
+		{
+			m_ok = m_y4m_frame(&m_video, &m_picture, m_image_mono, 2, m_until - m_shown);
+			m_pictures++;
+		} else if (m_format == M_CONVERT_GIF)
+		{
+			uint64_t m_end = m_convert_centiseconds(&m_reader, m_first, m_until);
+
+			if (((m_end - m_start) >= 2) || (m_more == false))
+			{
+				uint64_t m_delay = m_end - m_start;
+
+				m_ok = m_gif_frame(&m_animation, &m_picture, (uint16_t) ((m_delay < 2) ? 2 : ((m_delay > 0xFFFF) ? 0xFFFF : m_delay)));
+				m_start = m_end;
+				m_pictures++;
+			}
+		} else {
+			char m_filename[4096];
+
+			snprintf(m_filename, sizeof(m_filename), "%s-%08llu.png", m_output, (unsigned long long) m_shown);
+			m_ok = m_image_write_png(&m_picture, m_image_mono, 2, m_filename);
+			m_pictures++;
+		}
+	}
+
+	if (m_format == M_CONVERT_Y4M)
+	{
+		m_ok = m_y4m_close(&m_video) && m_ok;
+	} else if (m_format == M_CONVERT_GIF)
+	{
+		m_ok = m_gif_close(&m_animation) && m_ok;
+	}
+
+	// Y4M may be on standard output, the summary goes to standard error
+	fprintf(stderr, "%llu pictures over %llu frames written at %ux%u\n", (unsigned long long) m_pictures,
+		(unsigned long long) (m_shown + m_reader.m_trailing - m_first), m_width, m_height);
+
+	m_image_free(&m_picture);
+	m_capture_close(&m_reader);
+
+	if (m_ok == false)
+	{
+		fprintf(stderr, "Could not write %s\n", m_output);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,867 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/cchip8.h"
+#include "../include/cchip8_fusion.h"
+#include "../include/cchip8_batch.h"
+#include "../include/cchip8_analysis.h"
+#include "../include/cchip8_asm.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_loader.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+	CCHIP8 differential tester:
+	Generates random programs made of opcodes the interpreter implements and runs each one on the
+	reference m_exec and on every fast backend (Plain m_run, fused m_run, the SIMD batch engine)
+	side by side. After every block of 1 to 8 instructions the complete architectural state is
+	compared, the first divergence is shrunk down to a minimal ROM and printed with its listing
+	and the command line that replays it.
+*/
+
+// Backends checked against m_exec
+enum m_diff_backend
+{
+	M_DIFF_RUN = 0,
+	M_DIFF_FUSED,
+	M_DIFF_BATCH,
+
+	M_DIFF_BACKENDS
+};
+
+static const char *m_diff_names[M_DIFF_BACKENDS] = { "m_run", "m_run (fused)", "batch" };
+
+// Instances the batch backend runs side by side (Each with its own keys and random seed)
+#define M_DIFF_LANES 8
+
+// Longest program the generator writes (In instructions)
+#define M_DIFF_MAX_WORDS 256
+
+// A generated (Or loaded) test program and everything else that decides how it runs
+typedef struct chip8_diff_case
+{
+	uint64_t m_seed;
+
+	uint8_t m_rom[CCHIP8_MAX_ROM_SIZE];
+	size_t m_size;
+
+	uint8_t m_profile;
+	uint16_t m_keys;
+	uint32_t m_rngseed;
+	uint32_t m_steps;
+
+} m_diff_case;
+
+// Where a backend first disagreed with the reference
+typedef struct chip8_diff_result
+{
+	bool m_diverged;
+	enum m_diff_backend m_backend;
+	size_t m_lane;
+	uint64_t m_cycle;
+	char m_field[128];
+
+} m_diff_result;
+
+static uint64_t m_diff_next(uint64_t *m_state)
+{
+	// splitmix64, every case gets its own well mixed stream from a plain counter
+	uint64_t m_value = (*m_state += 0x9E3779B97F4A7C15ULL);
+
+	m_value = (m_value ^ (m_value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	m_value = (m_value ^ (m_value >> 27)) * 0x94D049BB133111EBULL;
+
+	return m_value ^ (m_value >> 31);
+}
+
+// Random implemented opcode, jumps and calls stay on instruction boundaries inside the program
+static uint16_t m_diff_opcode(uint64_t *m_state, size_t m_words)
+{
+	for (;;)
+	{
+		uint64_t m_random = m_diff_next(m_state);
+		uint16_t m_opcode = (uint16_t) m_random;
+		uint16_t m_target = (uint16_t) (CHIP8_INITIAL_PC + 2 * ((m_random >> 16) % m_words));
+
+		switch (m_opcode & 0xF000)
+		{
+			case 0x0000:
+				// Returns are rarer than calls, deep call chains get exercised too
+				m_opcode = ((m_random >> 32) % 4 == 0) ? 0x00E0 : 0x00EE;
+				break;
+
+			case 0x1000:
+			case 0x2000:
+				m_opcode = (m_opcode & 0xF000) | m_target;
+				break;
+
+			case 0xA000:
+				// Mostly point I into the program or the font, sometimes anywhere
+				if ((m_random >> 32) % 4 != 0)
+				{
+					m_opcode = 0xA000 | (uint16_t) (((m_random >> 40) % 2) ? m_target : ((m_random >> 48) % CHIP8_FONT_SIZE));
+				}
+				break;
+
+			case 0xB000:
+				m_opcode = 0xB000 | (uint16_t) (m_target & 0xFF0);
+				break;
+
+			case 0xE000:
+				m_opcode = (m_opcode & 0xFF00) | (((m_random >> 32) % 2) ? 0x9E : 0xA1);
+				break;
+
+			case 0xF000:
+			{
+				static const uint8_t m_forms[] = { 0x07, 0x0A, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65 };
+
+				m_opcode = (m_opcode & 0xFF00) | m_forms[(m_random >> 32) % sizeof(m_forms)];
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		if (m_opcode_valid(m_opcode))
+		{
+			return m_opcode;
+		}
+	}
+}
+
+/*
+	Next instructions of a program, at most m_room of them: a quarter of the time one of the sequences
+	the predecode cache fuses (Random opcodes almost never line up into one), otherwise a single opcode.
+	Returns how many it wrote.
+*/
+static size_t m_diff_sequence(uint64_t *m_state, size_t m_words, uint16_t *m_out, size_t m_room)
+{
+	uint64_t m_random = m_diff_next(m_state);
+	uint16_t m_operands = (uint16_t) (m_random >> 8) & 0x0FFF;
+	uint16_t m_other = (uint16_t) (m_random >> 20) & 0x0FFF;
+
+	if (((m_random & 3) != 0) || (m_room < 3))
+	{
+		m_out[0] = m_diff_opcode(m_state, m_words);
+		return 1;
+	}
+
+	switch ((m_random >> 2) % 4)
+	{
+		case 0:
+			// 6XNN; 6YNN
+			m_out[0] = 0x6000 | m_operands;
+			m_out[1] = 0x6000 | m_other;
+			return 2;
+
+		case 1:
+			// ANNN; DXYN (I from the same distribution as a lone ANNN)
+			do
+			{
+				m_out[0] = m_diff_opcode(m_state, m_words);
+			} while ((m_out[0] & 0xF000) != 0xA000);
+
+			m_out[1] = 0xD000 | m_other;
+			return 2;
+
+		case 2:
+			// ANNN; FX65
+			do
+			{
+				m_out[0] = m_diff_opcode(m_state, m_words);
+			} while ((m_out[0] & 0xF000) != 0xA000);
+
+			m_out[1] = 0xF065 | (m_other & 0x0F00);
+			return 2;
+
+		default:
+			// 7XNN; 3YNN; 1NNN (The jump stays inside the program like any other)
+			m_out[0] = 0x7000 | m_operands;
+			m_out[1] = 0x3000 | m_other;
+			m_out[2] = (uint16_t) (0x1000 | (CHIP8_INITIAL_PC + 2 * ((m_random >> 40) % m_words)));
+			return 3;
+	}
+}
+
+static void m_diff_generate(m_diff_case *m_case, uint64_t m_seed, uint32_t m_steps)
+{
+	uint64_t m_state = m_seed;
+	size_t m_words = 4 + (m_diff_next(&m_state) % (M_DIFF_MAX_WORDS - 4));
+
+	memset(m_case, 0, sizeof(*m_case));
+
+	m_case->m_seed = m_seed;
+	m_case->m_size = m_words * 2;
+	m_case->m_profile = (uint8_t) (m_diff_next(&m_state) % M_PROFILE_COUNT);
+	m_case->m_keys = (uint16_t) m_diff_next(&m_state) & (uint16_t) m_diff_next(&m_state);
+	m_case->m_rngseed = (uint32_t) m_diff_next(&m_state) | 1;
+	m_case->m_steps = m_steps;
+
+	uint16_t m_program[M_DIFF_MAX_WORDS];
+	size_t m_filled = 0;
+
+	while (m_filled < m_words)
+	{
+		m_filled += m_diff_sequence(&m_state, m_words, &m_program[m_filled], m_words - m_filled);
+	}
+
+	for (size_t i = 0; i < m_words; i++)
+	{
+		m_case->m_rom[2 * i] = (uint8_t) (m_program[i] >> 8);
+		m_case->m_rom[2 * i + 1] = (uint8_t) m_program[i];
+	}
+}
+
+// Power-on state for a case, the same way cchip8_reset builds it
+static void m_diff_boot(m_chip8 *chip8, const m_diff_case *m_case, uint16_t m_keys, uint32_t m_rngseed)
+{
+	m_chip8_video *m_video = chip8->m_video;
+	struct chip8_code *m_cache = chip8->m_code;
+
+	memset(chip8, 0, sizeof(m_chip8));
+	memset(m_video, 0, sizeof(m_chip8_video));
+
+	chip8->m_video = m_video;
+	chip8->m_code = m_cache;
+
+	memcpy(chip8->m_memory, m_font, CHIP8_FONT_SIZE);
+	memcpy(&chip8->m_memory[CHIP8_INITIAL_PC], m_case->m_rom, m_case->m_size);
+
+	chip8->m_programcounter = CHIP8_INITIAL_PC;
+	chip8->m_breakpoint = CHIP8_NO_BREAKPOINT;
+	chip8->m_profile = m_case->m_profile;
+	chip8->m_rngstate = m_rngseed;
+
+	for (size_t i = 0; i < CHIP8_KEYS; i++)
+	{
+		chip8->m_keyboard[i] = (m_keys >> i) & 1;
+	}
+
+	if (m_cache != NULL)
+	{
+		m_code_invalidate(m_cache, 0, FOURKiB);
+	}
+}
+
+// Keys and random seed of a batch lane, lane 0 is the case itself
+static uint16_t m_diff_lane_keys(const m_diff_case *m_case, size_t m_lane)
+{
+	return (uint16_t) ((m_case->m_keys << m_lane) | (m_case->m_keys >> ((16 - m_lane) & 15)));
+}
+
+static uint32_t m_diff_lane_seed(const m_diff_case *m_case, size_t m_lane)
+{
+	return m_case->m_rngseed + (uint32_t) m_lane * 0x9E3779B9u;
+}
+
+// Instructions in the next block, a fixed function of the cycle so replays split blocks the same way
+static uint32_t m_diff_block(uint64_t m_cycle)
+{
+	return 1 + (uint32_t) (((m_cycle + 1) * 0x9E3779B97F4A7C15ULL) >> 61);
+}
+
+// Step the reference m_count instructions (A stopped machine stays where it is)
+static void m_diff_reference(m_chip8 *chip8, uint32_t m_count)
+{
+	for (uint32_t i = 0; (i < m_count) && (chip8->m_fault == M_FAULT_NONE); i++)
+	{
+		m_exec(chip8);
+	}
+}
+
+// First difference in architectural state, false if there's none
+static bool m_diff_compare(const m_chip8 *m_expected, const m_chip8 *m_actual, char *m_field, size_t m_size)
+{
+	for (int i = 0; i < CHIP8_REGISTERS; i++)
+	{
+		if (m_expected->m_registers[i] != m_actual->m_registers[i])
+		{
+			snprintf(m_field, m_size, "V%X: expected 0x%02X, got 0x%02X", i, m_expected->m_registers[i], m_actual->m_registers[i]);
+			return true;
+		}
+	}
+
+	const struct
+	{
+		const char *m_name;
+		uint64_t m_expected;
+		uint64_t m_actual;
+
+	} m_scalars[] = {
+		{ "PC", m_expected->m_programcounter, m_actual->m_programcounter },
+		{ "I", m_expected->m_index, m_actual->m_index },
+		{ "SP", m_expected->m_stackp, m_actual->m_stackp },
+		{ "Cycles", m_expected->m_cycles, m_actual->m_cycles },
+		{ "Delay timer deadline", m_expected->m_delaydeadline, m_actual->m_delaydeadline },
+		{ "Sound timer deadline", m_expected->m_sounddeadline, m_actual->m_sounddeadline },
+		{ "RNG state", m_expected->m_rngstate, m_actual->m_rngstate },
+		{ "Fault", m_expected->m_fault, m_actual->m_fault }
+	};
+
+	for (size_t i = 0; i < sizeof(m_scalars) / sizeof(m_scalars[0]); i++)
+	{
+		if (m_scalars[i].m_expected != m_scalars[i].m_actual)
+		{
+			snprintf(m_field, m_size, "%s: expected 0x%llX, got 0x%llX", m_scalars[i].m_name,
+				(unsigned long long) m_scalars[i].m_expected, (unsigned long long) m_scalars[i].m_actual);
+			return true;
+		}
+	}
+
+	for (int i = 0; i < CHIP8_MAXSTACKENTRIES; i++)
+	{
+		if (m_expected->m_stack[i] != m_actual->m_stack[i])
+		{
+			snprintf(m_field, m_size, "Stack[%d]: expected 0x%03X, got 0x%03X", i, m_expected->m_stack[i], m_actual->m_stack[i]);
+			return true;
+		}
+	}
+
+	if (memcmp(m_expected->m_memory, m_actual->m_memory, FOURKiB) != 0)
+	{
+		size_t i = 0;
+
+		while (m_expected->m_memory[i] == m_actual->m_memory[i])
+		{
+			i++;
+		}
+
+		snprintf(m_field, m_size, "RAM[0x%03zX]: expected 0x%02X, got 0x%02X", i, m_expected->m_memory[i], m_actual->m_memory[i]);
+		return true;
+	}
+
+	const uint32_t *m_left = m_expected->m_video->m_display;
+	const uint32_t *m_right = m_actual->m_video->m_display;
+
+	if (memcmp(m_left, m_right, sizeof(m_expected->m_video->m_display)) != 0)
+	{
+		size_t i = 0;
+
+		while (m_left[i] == m_right[i])
+		{
+			i++;
+		}
+
+		snprintf(m_field, m_size, "Pixel (%zu, %zu): expected 0x%08X, got 0x%08X", i % CHIP8_COLUMNS, i / CHIP8_COLUMNS,
+			m_left[i], m_right[i]);
+		return true;
+	}
+
+	return false;
+}
+
+// Per-thread machines, allocated once and booted again for every case
+typedef struct chip8_diff_machines
+{
+	m_chip8 *m_reference[M_DIFF_LANES];
+	m_chip8 *m_run;
+	m_chip8 *m_fused;
+
+} m_diff_machines;
+
+static bool m_diff_machines_create(m_diff_machines *m_machines)
+{
+	memset(m_machines, 0, sizeof(*m_machines));
+
+	bool m_ok = true;
+
+	for (size_t i = 0; i < M_DIFF_LANES; i++)
+	{
+		m_machines->m_reference[i] = m_chip8_create();
+		m_ok = m_ok && (m_machines->m_reference[i] != NULL);
+	}
+
+	m_machines->m_run = m_chip8_create();
+	m_machines->m_fused = m_chip8_create();
+
+	return m_ok && (m_machines->m_run != NULL) && (m_machines->m_fused != NULL) && (m_code_create(m_machines->m_fused) != NULL);
+}
+
+static void m_diff_machines_destroy(m_diff_machines *m_machines)
+{
+	for (size_t i = 0; i < M_DIFF_LANES; i++)
+	{
+		m_chip8_destroy(m_machines->m_reference[i]);
+	}
+
+	m_chip8_destroy(m_machines->m_run);
+	m_chip8_destroy(m_machines->m_fused);
+}
+
+static void m_diff_report(m_diff_result *m_result, enum m_diff_backend m_backend, size_t m_lane, uint64_t m_cycle)
+{
+	m_result->m_diverged = true;
+	m_result->m_backend = m_backend;
+	m_result->m_lane = m_lane;
+	m_result->m_cycle = m_cycle;
+}
+
+// Reference and one m_run flavour in lockstep, the reference decides how far each block goes
+static bool m_diff_check_run(m_diff_machines *m_machines, const m_diff_case *m_case, enum m_diff_backend m_backend, m_diff_result *m_result)
+{
+	m_chip8 *m_reference = m_machines->m_reference[0];
+	m_chip8 *m_fast = (m_backend == M_DIFF_FUSED) ? m_machines->m_fused : m_machines->m_run;
+
+	m_diff_boot(m_reference, m_case, m_case->m_keys, m_case->m_rngseed);
+	m_diff_boot(m_fast, m_case, m_case->m_keys, m_case->m_rngseed);
+
+	for (uint32_t m_step = 0; m_step < m_case->m_steps;)
+	{
+		uint32_t m_block = m_diff_block(m_step);
+
+		m_block = (m_block > (m_case->m_steps - m_step)) ? (m_case->m_steps - m_step) : m_block;
+		m_diff_reference(m_reference, m_block);
+
+		/*
+			m_run stops early on draws, keep going until it caught up (Or stops making progress).
+			Faults don't count as a cycle, so a faulted reference gets one instruction more: the one m_run has to fault on.
+		*/
+		bool m_faulted = (m_reference->m_fault != M_FAULT_NONE);
+
+		while (((m_fast->m_cycles < m_reference->m_cycles) || m_faulted) && (m_fast->m_fault == M_FAULT_NONE))
+		{
+			uint64_t m_before = m_fast->m_cycles;
+
+			m_run(m_fast, (uint32_t) (m_reference->m_cycles - m_fast->m_cycles) + m_faulted);
+
+			if (m_fast->m_cycles == m_before)
+			{
+				break;
+			}
+		}
+
+		m_step += m_block;
+
+		if (m_diff_compare(m_reference, m_fast, m_result->m_field, sizeof(m_result->m_field)))
+		{
+			m_diff_report(m_result, m_backend, 0, m_reference->m_cycles);
+			return true;
+		}
+
+		// Both stopped on the same fault, nothing left to compare
+		if (m_reference->m_fault != M_FAULT_NONE)
+		{
+			break;
+		}
+	}
+
+	return false;
+}
+
+// Reference copies of M_DIFF_LANES instances against one batch running all of them
+static bool m_diff_check_batch(m_diff_machines *m_machines, const m_diff_case *m_case, m_diff_result *m_result)
+{
+	m_chip8 *m_template = m_machines->m_run;
+
+	m_diff_boot(m_template, m_case, m_case->m_keys, m_case->m_rngseed);
+
+	m_batch *m_lanes = m_batch_create(M_DIFF_LANES, m_template);
+
+	if (m_lanes == NULL)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < M_DIFF_LANES; i++)
+	{
+		uint16_t m_keys = m_diff_lane_keys(m_case, i);
+		uint32_t m_seed = m_diff_lane_seed(m_case, i);
+
+		m_diff_boot(m_machines->m_reference[i], m_case, m_keys, m_seed);
+
+		// The batch copied the template, give every instance its own keys and seed (Lane i holds instance i until the first regroup)
+		m_lanes->m_instances[i].m_rngstate = m_seed;
+
+		for (size_t k = 0; k < CHIP8_KEYS; k++)
+		{
+			m_lanes->m_instances[i].m_keyboard[k] = (m_keys >> k) & 1;
+		}
+	}
+
+	bool m_diverged = false;
+
+	for (uint32_t m_step = 0; (m_step < m_case->m_steps) && (m_diverged == false);)
+	{
+		uint32_t m_block = m_diff_block(m_step);
+
+		m_block = (m_block > (m_case->m_steps - m_step)) ? (m_case->m_steps - m_step) : m_block;
+
+		for (size_t i = 0; i < M_DIFF_LANES; i++)
+		{
+			m_diff_reference(m_machines->m_reference[i], m_block);
+		}
+
+		m_batch_run(m_lanes, m_block);
+		m_batch_sync(m_lanes);
+
+		m_step += m_block;
+
+		for (size_t i = 0; i < M_DIFF_LANES; i++)
+		{
+			if (m_diff_compare(m_machines->m_reference[i], &m_lanes->m_instances[i], m_result->m_field, sizeof(m_result->m_field)))
+			{
+				m_diff_report(m_result, M_DIFF_BATCH, i, m_machines->m_reference[i]->m_cycles);
+				m_diverged = true;
+				break;
+			}
+		}
+	}
+
+	m_batch_destroy(m_lanes);
+
+	return m_diverged;
+}
+
+static bool m_diff_check(m_diff_machines *m_machines, const m_diff_case *m_case, uint32_t m_backends, m_diff_result *m_result)
+{
+	m_result->m_diverged = false;
+
+	for (int i = 0; i < M_DIFF_BACKENDS; i++)
+	{
+		if ((m_backends & (1u << i)) == 0)
+		{
+			continue;
+		}
+
+		bool m_diverged = (i == M_DIFF_BATCH) ? m_diff_check_batch(m_machines, m_case, m_result) :
+			m_diff_check_run(m_machines, m_case, (enum m_diff_backend) i, m_result);
+
+		if (m_diverged == true)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+	Shrink a diverging case: stop right after the divergence, then blank every instruction
+	(Last to first) whose removal keeps the backend diverging, and drop the trailing zeros.
+*/
+static void m_diff_shrink(m_diff_machines *m_machines, m_diff_case *m_case, m_diff_result *m_result)
+{
+	const uint32_t m_backend = 1u << m_result->m_backend;
+	m_diff_result m_attempt;
+
+	m_case->m_steps = (uint32_t) m_result->m_cycle + 8;
+
+	for (size_t i = m_case->m_size / 2; i-- > 0;)
+	{
+		uint8_t m_high = m_case->m_rom[2 * i];
+		uint8_t m_low = m_case->m_rom[2 * i + 1];
+
+		if ((m_high | m_low) == 0)
+		{
+			continue;
+		}
+
+		m_case->m_rom[2 * i] = 0;
+		m_case->m_rom[2 * i + 1] = 0;
+
+		if (m_diff_check(m_machines, m_case, m_backend, &m_attempt))
+		{
+			*m_result = m_attempt;
+			m_case->m_steps = (uint32_t) m_result->m_cycle + 8;
+		} else {
+			m_case->m_rom[2 * i] = m_high;
+			m_case->m_rom[2 * i + 1] = m_low;
+		}
+	}
+
+	while ((m_case->m_size > 0) && (m_case->m_rom[m_case->m_size - 1] == 0))
+	{
+		m_case->m_size--;
+	}
+
+	// Trimming can't change the outcome (Memory past the ROM is 0 anyway), refresh the details
+	m_diff_check(m_machines, m_case, m_backend, m_result);
+}
+
+static void m_diff_print(m_diff_machines *m_machines, m_diff_case *m_case, m_diff_result *m_result)
+{
+	fprintf(stderr, "\nDivergence in %s (Lane %zu) after %llu instructions, case %llu (Profile %s)\n",
+		m_diff_names[m_result->m_backend], m_result->m_lane, (unsigned long long) m_result->m_cycle,
+		(unsigned long long) m_case->m_seed, m_get_quirks((enum m_profile) m_case->m_profile)->m_name);
+	fprintf(stderr, "  %s\n", m_result->m_field);
+
+	m_diff_shrink(m_machines, m_case, m_result);
+
+	char m_filename[64];
+	snprintf(m_filename, sizeof(m_filename), "difftest-%llu.ch8", (unsigned long long) m_case->m_seed);
+
+	FILE *m_out = fopen(m_filename, "wb");
+
+	if ((m_out == NULL) || ((m_case->m_size > 0) && (fwrite(m_case->m_rom, m_case->m_size, 1, m_out) != 1)))
+	{
+		fprintf(stderr, "Could not write %s\n", m_filename);
+	}
+
+	if (m_out != NULL)
+	{
+		fclose(m_out);
+	}
+
+	fprintf(stderr, "\nMinimal reproducer (%zu bytes, diverges after %llu instructions):\n  %s\n", m_case->m_size,
+		(unsigned long long) m_result->m_cycle, m_result->m_field);
+	fprintf(stderr, "Replay: ./cchip8-difftest -rom %s -quirks %s -keys 0x%04X -rng 0x%08X -steps %u\n\n", m_filename,
+		m_get_quirks((enum m_profile) m_case->m_profile)->m_name, m_case->m_keys, m_case->m_rngseed, m_case->m_steps);
+
+	m_text m_listing = { 0 };
+
+	if (m_disassemble(m_case->m_rom, m_case->m_size, true, &m_listing, NULL))
+	{
+		fwrite(m_listing.m_data, 1, m_listing.m_length, stderr);
+	}
+
+	m_text_free(&m_listing);
+}
+
+// Shared by the worker threads, the counters are the only thing they write
+typedef struct chip8_diff_run
+{
+	uint64_t m_first;
+	uint64_t m_count;
+	uint32_t m_steps;
+	double m_deadline;
+
+	atomic_uint_fast64_t m_next;
+	atomic_uint_fast64_t m_done;
+	atomic_bool m_stop;
+
+	// Superinstructions the fused backend dispatched, tells the generated sequences actually got fused
+	atomic_uint_fast64_t m_fused;
+
+	// Lowest diverging case found so far (UINT64_MAX if none)
+	pthread_mutex_t m_lock;
+	uint64_t m_failed;
+
+} m_diff_run;
+
+static double m_diff_now(void)
+{
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+	return (double) m_time.tv_sec + (double) m_time.tv_nsec / 1e9;
+}
+
+static void *m_diff_worker(void *m_argument)
+{
+	m_diff_run *m_run = m_argument;
+	m_diff_machines m_machines;
+	m_diff_case m_case;
+	m_diff_result m_result;
+
+	if (m_diff_machines_create(&m_machines) == false)
+	{
+		m_diff_machines_destroy(&m_machines);
+		return NULL;
+	}
+
+	while (atomic_load_explicit(&m_run->m_stop, memory_order_relaxed) == false)
+	{
+		uint64_t m_index = atomic_fetch_add_explicit(&m_run->m_next, 1, memory_order_relaxed);
+
+		if ((m_index >= m_run->m_count) || (m_diff_now() > m_run->m_deadline))
+		{
+			break;
+		}
+
+		m_diff_generate(&m_case, m_run->m_first + m_index, m_run->m_steps);
+
+		if (m_diff_check(&m_machines, &m_case, (1u << M_DIFF_BACKENDS) - 1, &m_result))
+		{
+			pthread_mutex_lock(&m_run->m_lock);
+
+			if (m_case.m_seed < m_run->m_failed)
+			{
+				m_run->m_failed = m_case.m_seed;
+			}
+
+			pthread_mutex_unlock(&m_run->m_lock);
+			atomic_store(&m_run->m_stop, true);
+			break;
+		}
+
+		atomic_fetch_add_explicit(&m_run->m_done, 1, memory_order_relaxed);
+	}
+
+	uint64_t m_fired = 0;
+
+	for (size_t i = M_FUSE_NONE + 1; i < M_FUSE_KINDS; i++)
+	{
+		m_fired += m_machines.m_fused->m_code->m_fired[i];
+	}
+
+	atomic_fetch_add_explicit(&m_run->m_fused, m_fired, memory_order_relaxed);
+	m_diff_machines_destroy(&m_machines);
+
+	return NULL;
+}
+
+// Check a single case (Generated or loaded from a file) and print its divergence if there's one
+static int m_diff_single(m_diff_case *m_case)
+{
+	m_diff_machines m_machines;
+	m_diff_result m_result;
+
+	if (m_diff_machines_create(&m_machines) == false)
+	{
+		fprintf(stderr, "Couldn't allocate memory\n");
+		m_diff_machines_destroy(&m_machines);
+		return EXIT_FAILURE;
+	}
+
+	bool m_diverged = m_diff_check(&m_machines, m_case, (1u << M_DIFF_BACKENDS) - 1, &m_result);
+
+	if (m_diverged == true)
+	{
+		m_diff_print(&m_machines, m_case, &m_result);
+	} else {
+		fprintf(stderr, "No divergence in %u instructions\n", m_case->m_steps);
+	}
+
+	m_diff_machines_destroy(&m_machines);
+
+	return m_diverged ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t m_first = 0;
+	uint64_t m_count = UINT64_MAX;
+	uint32_t m_steps = 1000;
+	double m_seconds = 60.0;
+	size_t m_threads = 0;
+	bool m_single = false;
+
+	m_diff_case m_case;
+	memset(&m_case, 0, sizeof(m_case));
+
+	const char *m_rom = NULL;
+	const char *m_profile = "cchip8";
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool m_value = (i + 1) < argc;
+
+		if ((strcmp(argv[i], "-n") == 0) && m_value)
+		{
+			m_count = strtoull(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-t") == 0) && m_value)
+		{
+			m_seconds = strtod(argv[++i], NULL);
+		} else if ((strcmp(argv[i], "-j") == 0) && m_value)
+		{
+			m_threads = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-seed") == 0) && m_value)
+		{
+			m_first = strtoull(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-steps") == 0) && m_value)
+		{
+			m_steps = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-case") == 0) && m_value)
+		{
+			m_first = strtoull(argv[++i], NULL, 0);
+			m_single = true;
+		} else if ((strcmp(argv[i], "-rom") == 0) && m_value)
+		{
+			m_rom = argv[++i];
+		} else if ((strcmp(argv[i], "-quirks") == 0) && m_value)
+		{
+			m_profile = argv[++i];
+		} else if ((strcmp(argv[i], "-keys") == 0) && m_value)
+		{
+			m_case.m_keys = (uint16_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-rng") == 0) && m_value)
+		{
+			m_case.m_rngseed = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else {
+			fprintf(stderr, "Usage: ./cchip8-difftest [-n programs] [-t seconds] [-j threads] [-seed first] [-steps n]\n");
+			fprintf(stderr, "       ./cchip8-difftest -case n [-steps n]\n");
+			fprintf(stderr, "       ./cchip8-difftest -rom file [-quirks profile] [-keys mask] [-rng seed] [-steps n]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (m_rom != NULL)
+	{
+		enum m_profile m_parsed = m_profile_from_name(m_profile);
+
+		if (m_parsed == M_PROFILE_COUNT)
+		{
+			fprintf(stderr, "Unknown quirk profile: %s\n", m_profile);
+			return EXIT_FAILURE;
+		}
+
+		if (m_rom_read(m_rom, m_case.m_rom, sizeof(m_case.m_rom), &m_case.m_size) == false)
+		{
+			return EXIT_FAILURE;
+		}
+
+		m_case.m_profile = (uint8_t) m_parsed;
+		m_case.m_steps = m_steps;
+		m_case.m_rngseed = (m_case.m_rngseed != 0) ? m_case.m_rngseed : CHIP8_DEFAULT_SEED;
+
+		return m_diff_single(&m_case);
+	}
+
+	if (m_single == true)
+	{
+		m_diff_generate(&m_case, m_first, m_steps);
+		return m_diff_single(&m_case);
+	}
+
+	m_diff_run m_run = { .m_first = m_first, .m_count = m_count, .m_steps = m_steps, .m_failed = UINT64_MAX };
+	pthread_t m_workers[256];
+
+	atomic_init(&m_run.m_next, 0);
+	atomic_init(&m_run.m_done, 0);
+	atomic_init(&m_run.m_fused, 0);
+	atomic_init(&m_run.m_stop, false);
+	pthread_mutex_init(&m_run.m_lock, NULL);
+
+	m_threads = (m_threads == 0) ? m_corpus_threads() : m_threads;
+	m_threads = (m_threads > 256) ? 256 : m_threads;
+
+	double m_start = m_diff_now();
+	m_run.m_deadline = m_start + m_seconds;
+
+	size_t m_started = 0;
+
+	for (size_t i = 0; i < m_threads; i++)
+	{
+		if (pthread_create(&m_workers[m_started], NULL, m_diff_worker, &m_run) == 0)
+		{
+			m_started++;
+		}
+	}
+
+	for (size_t i = 0; i < m_started; i++)
+	{
+		pthread_join(m_workers[i], NULL);
+	}
+
+	double m_elapsed = m_diff_now() - m_start;
+	uint64_t m_done = atomic_load(&m_run.m_done);
+
+	fprintf(stderr, "%llu programs x %u instructions on %zu threads in %.1f s (%.0f programs/s, %.1f M/hour, %llu superinstructions)\n",
+		(unsigned long long) m_done, m_steps, m_started, m_elapsed, (double) m_done / m_elapsed,
+		(double) m_done / m_elapsed * 3600.0 / 1e6, (unsigned long long) atomic_load(&m_run.m_fused));
+
+	pthread_mutex_destroy(&m_run.m_lock);
+
+	if (m_run.m_failed == UINT64_MAX)
+	{
+		fprintf(stderr, "No divergence\n");
+		return EXIT_SUCCESS;
+	}
+
+	// Deterministic from here: regenerate the lowest failing case and shrink it
+	m_diff_generate(&m_case, m_run.m_failed, m_steps);
+
+	return m_diff_single(&m_case);
+}
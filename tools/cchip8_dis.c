@@ -0,0 +1,342 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cchip8.h"
+#include "../include/cchip8_asm.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_loader.h"
+
+/*
+	CCHIP8 disassembler:
+	Turns ROMs into labelled assembly cchip8-asm turns back into the same bytes. Directories are
+	disassembled in parallel, one thread per CPU, and the corpus-wide statistics (Opcode frequency,
+	ROM sizes, quirk profile guesses) are gathered on the way.
+*/
+
+// ROM sizes are bucketed per 256 bytes (14 buckets cover the whole 3584 bytes)
+#define M_DIS_SIZE_BUCKET 256
+#define M_DIS_SIZE_BUCKETS ((CCHIP8_MAX_ROM_SIZE + M_DIS_SIZE_BUCKET - 1) / M_DIS_SIZE_BUCKET)
+
+// Per-thread totals, each on its own cache lines so the threads never share one
+typedef struct chip8_dis_totals
+{
+	alignas(M_CACHELINE) uint64_t m_opcodes[M_ASM_FORMS + 1];
+	uint64_t m_sizes[M_DIS_SIZE_BUCKETS];
+	uint64_t m_profiles[M_PROFILE_COUNT];
+
+	uint64_t m_roms;
+	uint64_t m_bytes;
+	uint64_t m_codebytes;
+	uint64_t m_smallest;
+	uint64_t m_largest;
+
+	uint64_t m_failed;
+	uint64_t m_mismatched;
+
+} m_dis_totals;
+
+typedef struct chip8_dis_job
+{
+	// Write <directory>/<rom>.asm (NULL: print a single ROM to stdout, or nothing for corpora)
+	const char *m_directory;
+	bool m_stdout;
+
+	bool m_linear;
+	bool m_verify;
+
+	m_dis_totals *m_totals;
+
+} m_dis_job;
+
+static double m_dis_now(void)
+{
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+	return (double) m_time.tv_sec + (double) m_time.tv_nsec / 1e9;
+}
+
+static bool m_dis_write(const char *m_filename, const m_text *m_text)
+{
+	FILE *m_out = fopen(m_filename, "wb");
+
+	if (m_out == NULL)
+	{
+		printf("Could not create %s\n", m_filename);
+		return false;
+	}
+
+	bool m_written = (fwrite(m_text->m_data, 1, m_text->m_length, m_out) == m_text->m_length);
+
+	return (fclose(m_out) == 0) && m_written;
+}
+
+// Assemble the listing again and compare it with the ROM it came from
+static bool m_dis_verify(const char *m_filename, const m_text *m_text, const uint8_t *m_rom, size_t m_size)
+{
+	uint8_t m_output[CCHIP8_MAX_ROM_SIZE];
+	size_t m_outsize = 0;
+	m_asm_error m_error;
+
+	if (m_assemble(m_text->m_data, m_text->m_length, m_output, sizeof(m_output), &m_outsize, &m_error) == false)
+	{
+		printf("%s: listing doesn't assemble (Line %zu: %s)\n", m_filename, m_error.m_line, m_error.m_message);
+		return false;
+	}
+
+	if ((m_outsize != m_size) || (memcmp(m_output, m_rom, m_size) != 0))
+	{
+		printf("%s: listing assembles to different bytes\n", m_filename);
+		return false;
+	}
+
+	return true;
+}
+
+static void m_dis_rom(void *m_context, size_t m_worker, const char *m_filename)
+{
+	m_dis_job *m_job = m_context;
+	m_dis_totals *m_totals = &m_job->m_totals[m_worker];
+
+	uint8_t m_rom[CCHIP8_MAX_ROM_SIZE];
+	size_t m_size = 0;
+	m_text m_listing = { 0 };
+	m_asm_stats m_stats;
+
+	if ((m_rom_read(m_filename, m_rom, sizeof(m_rom), &m_size) == false) ||
+		(m_disassemble(m_rom, m_size, m_job->m_linear, &m_listing, &m_stats) == false))
+	{
+		m_totals->m_failed++;
+		m_text_free(&m_listing);
+		return;
+	}
+
+	if ((m_job->m_verify == true) && (m_dis_verify(m_filename, &m_listing, m_rom, m_size) == false))
+	{
+		m_totals->m_mismatched++;
+	}
+
+	if (m_job->m_stdout == true)
+	{
+		fwrite(m_listing.m_data, 1, m_listing.m_length, stdout);
+	} else if (m_job->m_directory != NULL)
+	{
+		char m_output[4096];
+
+		if ((m_corpus_output(m_output, sizeof(m_output), m_job->m_directory, m_filename, ".asm") == false) ||
+			(m_dis_write(m_output, &m_listing) == false))
+		{
+			m_totals->m_failed++;
+		}
+	}
+
+	m_text_free(&m_listing);
+
+	for (size_t i = 0; i <= M_ASM_FORMS; i++)
+	{
+		m_totals->m_opcodes[i] += m_stats.m_opcodes[i];
+	}
+
+	m_totals->m_sizes[(m_size == 0) ? 0 : ((m_size - 1) / M_DIS_SIZE_BUCKET)]++;
+	m_totals->m_profiles[m_stats.m_profile]++;
+	m_totals->m_roms++;
+	m_totals->m_bytes += m_size;
+	m_totals->m_codebytes += m_stats.m_codebytes;
+	m_totals->m_smallest = ((m_totals->m_roms == 1) || (m_size < m_totals->m_smallest)) ? m_size : m_totals->m_smallest;
+	m_totals->m_largest = (m_size > m_totals->m_largest) ? m_size : m_totals->m_largest;
+}
+
+static void m_dis_merge(m_dis_totals *m_total, const m_dis_totals *m_part)
+{
+	for (size_t i = 0; i <= M_ASM_FORMS; i++)
+	{
+		m_total->m_opcodes[i] += m_part->m_opcodes[i];
+	}
+
+	for (size_t i = 0; i < M_DIS_SIZE_BUCKETS; i++)
+	{
+		m_total->m_sizes[i] += m_part->m_sizes[i];
+	}
+
+	for (size_t i = 0; i < M_PROFILE_COUNT; i++)
+	{
+		m_total->m_profiles[i] += m_part->m_profiles[i];
+	}
+
+	if ((m_part->m_roms > 0) && ((m_total->m_roms == 0) || (m_part->m_smallest < m_total->m_smallest)))
+	{
+		m_total->m_smallest = m_part->m_smallest;
+	}
+
+	m_total->m_largest = (m_part->m_largest > m_total->m_largest) ? m_part->m_largest : m_total->m_largest;
+	m_total->m_roms += m_part->m_roms;
+	m_total->m_bytes += m_part->m_bytes;
+	m_total->m_codebytes += m_part->m_codebytes;
+	m_total->m_failed += m_part->m_failed;
+	m_total->m_mismatched += m_part->m_mismatched;
+}
+
+static void m_dis_print_stats(const m_dis_totals *m_total, size_t m_threads, double m_seconds)
+{
+	printf("%llu ROMs, %llu bytes in %.3f s on %zu threads\n", (unsigned long long) m_total->m_roms,
+		(unsigned long long) m_total->m_bytes, m_seconds, m_threads);
+
+	if (m_total->m_roms == 0)
+	{
+		return;
+	}
+
+	printf("ROM size: min %llu, avg %.0f, max %llu bytes\n", (unsigned long long) m_total->m_smallest,
+		(double) m_total->m_bytes / (double) m_total->m_roms, (unsigned long long) m_total->m_largest);
+
+	for (size_t i = 0; i < M_DIS_SIZE_BUCKETS; i++)
+	{
+		if (m_total->m_sizes[i] != 0)
+		{
+			printf("  %4zu-%4zu bytes %8llu\n", i * M_DIS_SIZE_BUCKET + ((i == 0) ? 0 : 1), (i + 1) * M_DIS_SIZE_BUCKET,
+				(unsigned long long) m_total->m_sizes[i]);
+		}
+	}
+
+	printf("Code: %llu bytes (%.1f%%), data: %llu bytes\n", (unsigned long long) m_total->m_codebytes,
+		100.0 * (double) m_total->m_codebytes / (double) ((m_total->m_bytes > 0) ? m_total->m_bytes : 1),
+		(unsigned long long) (m_total->m_bytes - m_total->m_codebytes));
+
+	// Opcode forms, most frequent first (Static counts, every instruction once)
+	size_t m_order[M_ASM_FORMS];
+	uint64_t m_instructions = 0;
+
+	for (size_t i = 0; i < M_ASM_FORMS; i++)
+	{
+		m_order[i] = i;
+		m_instructions += m_total->m_opcodes[i];
+	}
+
+	for (size_t i = 1; i < M_ASM_FORMS; i++)
+	{
+		for (size_t j = i; (j > 0) && (m_total->m_opcodes[m_order[j]] > m_total->m_opcodes[m_order[j - 1]]); j--)
+		{
+			size_t m_swap = m_order[j];
+			m_order[j] = m_order[j - 1];
+			m_order[j - 1] = m_swap;
+		}
+	}
+
+	printf("Opcode frequency (%llu instructions):\n", (unsigned long long) m_instructions);
+
+	for (size_t i = 0; (i < M_ASM_FORMS) && (m_total->m_opcodes[m_order[i]] != 0); i++)
+	{
+		printf("  %-20s %10llu %6.2f%%\n", m_asm_form_name(m_order[i]), (unsigned long long) m_total->m_opcodes[m_order[i]],
+			100.0 * (double) m_total->m_opcodes[m_order[i]] / (double) m_instructions);
+	}
+
+	printf("Quirk profile guesses:");
+
+	for (size_t i = 0; i < M_PROFILE_COUNT; i++)
+	{
+		printf(" %s=%llu", m_get_quirks((enum m_profile) i)->m_name, (unsigned long long) m_total->m_profiles[i]);
+	}
+
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const m_extensions[] = { ".ch8", ".rom", NULL };
+
+	m_dis_job m_job = { 0 };
+	m_corpus m_corpus = { 0 };
+	bool m_stats = false;
+	size_t m_threads = 0;
+	size_t m_inputs = 0;
+	bool m_directories = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+		{
+			m_threads = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+		{
+			m_job.m_directory = argv[++i];
+		} else if (strcmp(argv[i], "-linear") == 0)
+		{
+			m_job.m_linear = true;
+		} else if (strcmp(argv[i], "-verify") == 0)
+		{
+			m_job.m_verify = true;
+		} else if (strcmp(argv[i], "-stats") == 0)
+		{
+			m_stats = true;
+		} else {
+			size_t m_before = m_corpus.m_count;
+
+			if (m_corpus_add(&m_corpus, argv[i], m_extensions) == false)
+			{
+				m_corpus_free(&m_corpus);
+				return EXIT_FAILURE;
+			}
+
+			m_directories = m_directories || ((m_corpus.m_count - m_before) != 1);
+			m_inputs++;
+		}
+	}
+
+	if (m_inputs == 0)
+	{
+		printf("Usage: ./cchip8-dis [-j threads] [-o directory] [-linear] [-verify] [-stats] [rom|directory]...\n");
+		return EXIT_FAILURE;
+	}
+
+	// A lone ROM without -o goes to stdout, whole corpora only produce statistics unless told where to go
+	m_job.m_stdout = (m_job.m_directory == NULL) && (m_corpus.m_count == 1) && (m_directories == false);
+	m_stats = m_stats || ((m_job.m_directory == NULL) && (m_job.m_stdout == false));
+
+	if (m_threads == 0)
+	{
+		m_threads = m_corpus_threads();
+	}
+
+	// Printing to stdout has to keep the order, one thread does
+	if (m_job.m_stdout == true)
+	{
+		m_threads = 1;
+	}
+
+	m_job.m_totals = m_aligned_alloc(m_threads * sizeof(m_dis_totals));
+
+	if (m_job.m_totals == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		m_corpus_free(&m_corpus);
+		return EXIT_FAILURE;
+	}
+
+	memset(m_job.m_totals, 0, m_threads * sizeof(m_dis_totals));
+
+	double m_start = m_dis_now();
+	m_corpus_run(&m_corpus, m_threads, m_dis_rom, &m_job);
+	double m_seconds = m_dis_now() - m_start;
+
+	m_dis_totals m_total = { 0 };
+
+	for (size_t i = 0; i < m_threads; i++)
+	{
+		m_dis_merge(&m_total, &m_job.m_totals[i]);
+	}
+
+	if (m_stats == true)
+	{
+		m_dis_print_stats(&m_total, m_threads, m_seconds);
+	}
+
+	if (m_job.m_verify == true)
+	{
+		printf("; Round trip: %llu of %llu listings reassemble to their ROM\n",
+			(unsigned long long) (m_total.m_roms - m_total.m_mismatched), (unsigned long long) m_total.m_roms);
+	}
+
+	m_aligned_free(m_job.m_totals);
+	m_corpus_free(&m_corpus);
+
+	return ((m_total.m_failed == 0) && (m_total.m_mismatched == 0)) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
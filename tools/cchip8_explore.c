@@ -0,0 +1,704 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 199309L
+
+#include "../include/cchip8.h"
+#include "../include/cchip8_analysis.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_loader.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+	CCHIP8 state-space explorer:
+	Drives a ROM through as many distinct machine states as it can reach. Starting from the boot
+	state, every state of the frontier is forked 17 times (Each of the 16 keys held, plus no key)
+	and each fork runs for K frames. The resulting RAM, registers, stack, timers and display are
+	hashed, forks whose hash was already seen are dropped, the others form the next frontier.
+	The search goes breadth-first, one level per round, with worker threads pulling frontier
+	states off a shared counter and deduplicating through one lock-free hash set.
+
+	Reported per level and at the end: states, distinct screens and Program Counter values reached,
+	faults hit, and how many states per second the search went through. -o writes the shortest input
+	sequence found for every PC and every kind of fault, so QA can replay how the code was reached.
+*/
+
+// Inputs tried from each state: keys 0x0-0xF held down, then no key at all
+#define M_EXPLORE_INPUTS (CHIP8_KEYS + 1)
+#define M_EXPLORE_NOKEY CHIP8_KEYS
+
+// Deepest level the search goes (Input sequences are stored inline with every state)
+#define M_EXPLORE_MAX_DEPTH 64
+
+// Seen-state set size (Slots, a power of two), the search stops once it's 3/4 full
+#define M_EXPLORE_SET_BITS 23
+
+// Distinct screens tracked
+#define M_EXPLORE_SCREEN_BITS 20
+
+#define M_EXPLORE_MAX_THREADS 256
+
+/*
+	A frontier entry: the full machine (Pointers to the video state and the predecode cache aren't
+	valid in here, they get re-attached on restore) plus its display packed to one bit per pixel,
+	and the inputs that led to it.
+*/
+typedef struct chip8_explore_state
+{
+	m_chip8 m_machine;
+
+	uint64_t m_display[CHIP8_ROWS];
+
+	uint8_t m_path[M_EXPLORE_MAX_DEPTH];
+
+} m_explore_state;
+
+/*
+	Lock-free set of 64-bit hashes (Open addressing, linear probing). 0 marks a free slot, so a
+	hash of 0 is stored as 1. Entries are never removed.
+*/
+typedef struct chip8_explore_set
+{
+	_Atomic uint64_t *m_slots;
+	uint64_t m_mask;
+	atomic_size_t m_count;
+
+} m_explore_set;
+
+// Shortest known way to a PC or a fault
+typedef struct chip8_explore_path
+{
+	uint8_t m_depth;
+	uint8_t m_keys[M_EXPLORE_MAX_DEPTH];
+
+} m_explore_path;
+
+// Per worker results, merged by the main thread after every level
+typedef struct chip8_explore_worker
+{
+	struct chip8_explore *m_explore;
+	pthread_t m_thread;
+
+	m_chip8 *m_scratch;
+
+	// PCs this worker executed (Non zero), and the first path that got it there
+	uint8_t m_pcs[FOURKiB];
+	m_explore_path *m_pcpaths;
+
+	uint64_t m_faults[M_FAULT_COUNT];
+	m_explore_path m_faultpaths[M_FAULT_COUNT];
+
+	uint64_t m_forks;
+	uint64_t m_instructions;
+
+} m_explore_worker;
+
+// The whole search, shared by the workers
+typedef struct chip8_explore
+{
+	uint32_t m_frames;
+	uint32_t m_depth;
+	double m_deadline;
+
+	// Level being expanded (Length of the frontier states' input sequences)
+	uint32_t m_level;
+
+	// Current level and the one being built from it
+	m_explore_state *m_frontier;
+	size_t m_frontiercount;
+	m_explore_state *m_next;
+	size_t m_capacity;
+
+	atomic_size_t m_claim;
+	atomic_size_t m_nextcount;
+	atomic_size_t m_dropped;
+	atomic_bool m_stop;
+
+	m_explore_set m_seen;
+	m_explore_set m_screens;
+
+	// Merged coverage and the paths behind it
+	uint8_t m_pcs[FOURKiB];
+	m_explore_path *m_pcpaths;
+	uint64_t m_faults[M_FAULT_COUNT];
+	m_explore_path m_faultpaths[M_FAULT_COUNT];
+
+	uint64_t m_forks;
+	uint64_t m_instructions;
+
+	m_explore_worker *m_workers;
+	size_t m_threads;
+
+} m_explore;
+
+static double m_explore_now(void)
+{
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+	return (double) m_time.tv_sec + (double) m_time.tv_nsec / 1e9;
+}
+
+// 64-bit words mixed in 4 independent lanes, byte-wise FNV would cost more than running the fork
+static uint64_t m_explore_hash(const void *m_data, size_t m_size, uint64_t m_seed)
+{
+	const uint8_t *m_bytes = m_data;
+	uint64_t m_lanes[4] = { m_seed, m_seed ^ 0x9E3779B97F4A7C15ULL, m_seed ^ 0xC2B2AE3D27D4EB4FULL, m_seed ^ 0x165667B19E3779F9ULL };
+	size_t i = 0;
+
+	for (; (i + 32) <= m_size; i += 32)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			uint64_t m_word;
+			memcpy(&m_word, &m_bytes[i + (size_t) k * 8], 8);
+
+			m_lanes[k] = (m_lanes[k] ^ m_word) * 0x9FB21C651E98DF25ULL;
+			m_lanes[k] ^= m_lanes[k] >> 29;
+		}
+	}
+
+	uint64_t m_hash = m_lanes[0] ^ (m_lanes[1] * 3) ^ (m_lanes[2] * 5) ^ (m_lanes[3] * 7) ^ m_size;
+
+	for (; i < m_size; i++)
+	{
+		m_hash = (m_hash ^ m_bytes[i]) * 0x100000001B3ULL;
+	}
+
+	m_hash ^= m_hash >> 32;
+	m_hash *= 0xD6E8FEB86659FD93ULL;
+	m_hash ^= m_hash >> 32;
+
+	return m_hash;
+}
+
+static bool m_explore_set_create(m_explore_set *m_set, unsigned m_bits)
+{
+	m_set->m_slots = calloc((size_t) 1 << m_bits, sizeof(uint64_t));
+	m_set->m_mask = ((uint64_t) 1 << m_bits) - 1;
+	atomic_init(&m_set->m_count, 0);
+
+	return m_set->m_slots != NULL;
+}
+
+// Whether the set still has room (Probing degrades quickly past 3/4)
+static bool m_explore_set_room(m_explore_set *m_set)
+{
+	return atomic_load_explicit(&m_set->m_count, memory_order_relaxed) < ((m_set->m_mask + 1) / 4) * 3;
+}
+
+// Add m_hash, true if it wasn't in the set yet
+static bool m_explore_set_insert(m_explore_set *m_set, uint64_t m_hash)
+{
+	m_hash = (m_hash != 0) ? m_hash : 1;
+
+	for (uint64_t m_slot = m_hash & m_set->m_mask;; m_slot = (m_slot + 1) & m_set->m_mask)
+	{
+		uint64_t m_current = atomic_load_explicit(&m_set->m_slots[m_slot], memory_order_relaxed);
+
+		if (m_current == m_hash)
+		{
+			return false;
+		}
+
+		if (m_current == 0)
+		{
+			if (atomic_compare_exchange_strong_explicit(&m_set->m_slots[m_slot], &m_current, m_hash,
+				memory_order_relaxed, memory_order_relaxed))
+			{
+				atomic_fetch_add_explicit(&m_set->m_count, 1, memory_order_relaxed);
+				return true;
+			}
+
+			// Someone else claimed the slot first, it may have been this very hash
+			if (m_current == m_hash)
+			{
+				return false;
+			}
+		}
+	}
+}
+
+// Load a frontier state into a worker's machine, keeping the machine's own attachments
+static void m_explore_restore(m_chip8 *chip8, const m_explore_state *m_state)
+{
+	m_chip8_video *m_video = chip8->m_video;
+	struct chip8_code *m_cache = chip8->m_code;
+
+	memcpy(chip8, &m_state->m_machine, sizeof(m_chip8));
+
+	chip8->m_video = m_video;
+	chip8->m_code = m_cache;
+
+	for (size_t m_row = 0; m_row < CHIP8_ROWS; m_row++)
+	{
+		for (size_t m_column = 0; m_column < CHIP8_COLUMNS; m_column++)
+		{
+			chip8->m_video->m_display[(m_row * CHIP8_COLUMNS) + m_column] = ((m_state->m_display[m_row] >> m_column) & 1) ? 0xFFFFFFFF : 0;
+		}
+	}
+}
+
+/*
+	Hash of everything that decides how a machine goes on: RAM, registers, the live part of the
+	stack, timer values and the display. Cycle counters, the opcode latch and the random generator
+	are left out, otherwise every ROM that calls CXNN would look like it reached a new state on every fork.
+*/
+static uint64_t m_explore_state_hash(const m_chip8 *chip8, const uint64_t *m_display)
+{
+	struct
+	{
+		uint8_t m_registers[CHIP8_REGISTERS];
+		uint16_t m_stack[CHIP8_MAXSTACKENTRIES];
+		uint16_t m_index;
+		uint16_t m_programcounter;
+		uint8_t m_stackp;
+		uint8_t m_delay;
+		uint8_t m_sound;
+		uint8_t m_pad;
+
+	} m_cpu;
+
+	memset(&m_cpu, 0, sizeof(m_cpu));
+	memcpy(m_cpu.m_registers, chip8->m_registers, CHIP8_REGISTERS);
+	memcpy(m_cpu.m_stack, chip8->m_stack, chip8->m_stackp * sizeof(uint16_t));
+	m_cpu.m_index = chip8->m_index;
+	m_cpu.m_programcounter = chip8->m_programcounter;
+	m_cpu.m_stackp = chip8->m_stackp;
+	m_cpu.m_delay = m_get_delaytmr(chip8);
+	m_cpu.m_sound = m_get_soundtmr(chip8);
+
+	uint64_t m_hash = m_explore_hash(chip8->m_memory, FOURKiB, 0x243F6A8885A308D3ULL);
+	m_hash = m_explore_hash(m_display, CHIP8_ROWS * sizeof(uint64_t), m_hash);
+
+	return m_explore_hash(&m_cpu, sizeof(m_cpu), m_hash);
+}
+
+static void m_explore_path_set(m_explore_path *m_path, const uint8_t *m_keys, uint32_t m_depth)
+{
+	m_path->m_depth = (uint8_t) m_depth;
+	memcpy(m_path->m_keys, m_keys, m_depth);
+}
+
+// Fork one frontier state with every input, the new states go to the next frontier
+static void m_explore_expand(m_explore_worker *m_worker, const m_explore_state *m_parent, uint32_t m_level)
+{
+	m_explore *m_explore = m_worker->m_explore;
+	m_chip8 *chip8 = m_worker->m_scratch;
+	const uint64_t m_steps = (uint64_t) m_explore->m_frames * CHIP8_CYCLES_PER_FRAME;
+
+	uint8_t m_path[M_EXPLORE_MAX_DEPTH];
+	memcpy(m_path, m_parent->m_path, m_level);
+
+	for (uint8_t m_input = 0; m_input < M_EXPLORE_INPUTS; m_input++)
+	{
+		m_explore_restore(chip8, m_parent);
+
+		for (size_t k = 0; k < CHIP8_KEYS; k++)
+		{
+			chip8->m_keyboard[k] = (k == m_input);
+		}
+
+		m_path[m_level] = m_input;
+
+		// Step by step so every PC gets seen, forking and hashing costs more than the instructions anyway
+		for (uint64_t i = 0; (i < m_steps) && (chip8->m_fault == M_FAULT_NONE); i++)
+		{
+			uint16_t m_pc = chip8->m_programcounter & (FOURKiB - 1);
+
+			if (m_worker->m_pcs[m_pc] == 0)
+			{
+				m_worker->m_pcs[m_pc] = 1;
+				m_explore_path_set(&m_worker->m_pcpaths[m_pc], m_path, m_level + 1);
+			}
+
+			m_exec(chip8);
+			m_worker->m_instructions++;
+		}
+
+		m_worker->m_forks++;
+
+		if (chip8->m_fault != M_FAULT_NONE)
+		{
+			// Faulted machines stay where they are, no point in exploring them further
+			if (m_worker->m_faults[chip8->m_fault]++ == 0)
+			{
+				m_explore_path_set(&m_worker->m_faultpaths[chip8->m_fault], m_path, m_level + 1);
+			}
+
+			continue;
+		}
+
+		uint64_t m_display[CHIP8_ROWS];
+		m_pack_display(chip8, m_display);
+
+		m_explore_set_insert(&m_explore->m_screens, m_explore_hash(m_display, sizeof(m_display), 0));
+
+		if (m_explore_set_insert(&m_explore->m_seen, m_explore_state_hash(chip8, m_display)) == false)
+		{
+			continue;
+		}
+
+		size_t m_slot = atomic_fetch_add_explicit(&m_explore->m_nextcount, 1, memory_order_relaxed);
+
+		if (m_slot >= m_explore->m_capacity)
+		{
+			// Next level is full, the state counts as seen but won't be expanded
+			atomic_fetch_add_explicit(&m_explore->m_dropped, 1, memory_order_relaxed);
+			continue;
+		}
+
+		m_explore_state *m_child = &m_explore->m_next[m_slot];
+
+		memcpy(&m_child->m_machine, chip8, sizeof(m_chip8));
+		memcpy(m_child->m_display, m_display, sizeof(m_display));
+		memcpy(m_child->m_path, m_path, (size_t) m_level + 1);
+	}
+}
+
+static void *m_explore_worker_run(void *m_argument)
+{
+	m_explore_worker *m_worker = m_argument;
+	m_explore *m_explore = m_worker->m_explore;
+
+	while (atomic_load_explicit(&m_explore->m_stop, memory_order_relaxed) == false)
+	{
+		size_t m_index = atomic_fetch_add_explicit(&m_explore->m_claim, 1, memory_order_relaxed);
+
+		if (m_index >= m_explore->m_frontiercount)
+		{
+			break;
+		}
+
+		if ((m_explore_now() > m_explore->m_deadline) || (m_explore_set_room(&m_explore->m_seen) == false))
+		{
+			atomic_store(&m_explore->m_stop, true);
+			break;
+		}
+
+		m_explore_expand(m_worker, &m_explore->m_frontier[m_index], m_explore->m_level);
+	}
+
+	return NULL;
+}
+
+// Fold a worker's coverage into the totals, keeping the shortest path to each PC and fault
+static void m_explore_merge(m_explore *m_explore, m_explore_worker *m_worker)
+{
+	for (size_t i = 0; i < FOURKiB; i++)
+	{
+		if ((m_worker->m_pcs[i] != 0) && ((m_explore->m_pcs[i] == 0) || (m_worker->m_pcpaths[i].m_depth < m_explore->m_pcpaths[i].m_depth)))
+		{
+			m_explore->m_pcs[i] = 1;
+			m_explore->m_pcpaths[i] = m_worker->m_pcpaths[i];
+		}
+	}
+
+	for (size_t i = 0; i < M_FAULT_COUNT; i++)
+	{
+		if ((m_worker->m_faults[i] != 0) && ((m_explore->m_faults[i] == 0) || (m_worker->m_faultpaths[i].m_depth < m_explore->m_faultpaths[i].m_depth)))
+		{
+			m_explore->m_faultpaths[i] = m_worker->m_faultpaths[i];
+		}
+
+		m_explore->m_faults[i] += m_worker->m_faults[i];
+		m_worker->m_faults[i] = 0;
+	}
+
+	m_explore->m_forks += m_worker->m_forks;
+	m_explore->m_instructions += m_worker->m_instructions;
+	m_worker->m_forks = 0;
+	m_worker->m_instructions = 0;
+}
+
+static size_t m_explore_pcs(const m_explore *m_explore)
+{
+	size_t m_count = 0;
+
+	for (size_t i = 0; i < FOURKiB; i++)
+	{
+		m_count += m_explore->m_pcs[i];
+	}
+
+	return m_count;
+}
+
+static uint64_t m_explore_faults(const m_explore *m_explore)
+{
+	uint64_t m_count = 0;
+
+	for (size_t i = 0; i < M_FAULT_COUNT; i++)
+	{
+		m_count += m_explore->m_faults[i];
+	}
+
+	return m_count;
+}
+
+static void m_explore_write_path(FILE *m_out, const m_explore_path *m_path)
+{
+	for (size_t i = 0; i < m_path->m_depth; i++)
+	{
+		if (m_path->m_keys[i] == M_EXPLORE_NOKEY)
+		{
+			fprintf(m_out, " -");
+		} else {
+			fprintf(m_out, " %X", m_path->m_keys[i]);
+		}
+	}
+
+	fprintf(m_out, "\n");
+}
+
+// Shortest input sequence (One entry of K frames per level, "-" for no key) reaching every PC and fault
+static bool m_explore_write(const m_explore *m_explore, const char *m_filename)
+{
+	FILE *m_out = fopen(m_filename, "w");
+
+	if (m_out == NULL)
+	{
+		fprintf(stderr, "Could not write %s\n", m_filename);
+		return false;
+	}
+
+	fprintf(m_out, "; Keys held for %u frames each, - for no key\n", m_explore->m_frames);
+
+	for (size_t i = 0; i < FOURKiB; i++)
+	{
+		if (m_explore->m_pcs[i] != 0)
+		{
+			fprintf(m_out, "pc 0x%03zX:", i);
+			m_explore_write_path(m_out, &m_explore->m_pcpaths[i]);
+		}
+	}
+
+	for (size_t i = 1; i < M_FAULT_COUNT; i++)
+	{
+		if (m_explore->m_faults[i] != 0)
+		{
+			fprintf(m_out, "fault %s:", m_fault_name((enum m_fault) i));
+			m_explore_write_path(m_out, &m_explore->m_faultpaths[i]);
+		}
+	}
+
+	fclose(m_out);
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t m_frames = 6;
+	uint32_t m_depth = 32;
+	size_t m_states = 8192;
+	double m_seconds = 60.0;
+	size_t m_threads = 0;
+	const char *m_profile = "cchip8";
+	const char *m_output = NULL;
+	const char *m_filename = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool m_value = (i + 1) < argc;
+
+		if ((strcmp(argv[i], "-frames") == 0) && m_value)
+		{
+			m_frames = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-depth") == 0) && m_value)
+		{
+			m_depth = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-states") == 0) && m_value)
+		{
+			m_states = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-t") == 0) && m_value)
+		{
+			m_seconds = strtod(argv[++i], NULL);
+		} else if ((strcmp(argv[i], "-j") == 0) && m_value)
+		{
+			m_threads = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-quirks") == 0) && m_value)
+		{
+			m_profile = argv[++i];
+		} else if ((strcmp(argv[i], "-o") == 0) && m_value)
+		{
+			m_output = argv[++i];
+		} else if ((argv[i][0] != '-') && (m_filename == NULL))
+		{
+			m_filename = argv[i];
+		} else {
+			m_filename = NULL;
+			break;
+		}
+	}
+
+	if ((m_filename == NULL) || (m_frames == 0) || (m_depth == 0) || (m_states == 0))
+	{
+		fprintf(stderr, "Usage: ./cchip8-explore [-frames K] [-depth levels] [-states per level] [-t seconds] [-j threads]\n");
+		fprintf(stderr, "                        [-quirks profile|auto] [-o paths.txt] rom.ch8\n");
+		return EXIT_FAILURE;
+	}
+
+	m_depth = (m_depth > M_EXPLORE_MAX_DEPTH) ? M_EXPLORE_MAX_DEPTH : m_depth;
+	m_threads = (m_threads == 0) ? m_corpus_threads() : m_threads;
+	m_threads = (m_threads > M_EXPLORE_MAX_THREADS) ? M_EXPLORE_MAX_THREADS : m_threads;
+
+	// Boot state, same as a freshly loaded libcchip8 machine
+	m_explore_state *m_boot = m_aligned_alloc(sizeof(m_explore_state));
+	m_analysis *m_analysis = malloc(sizeof(struct chip8_analysis));
+
+	if ((m_boot == NULL) || (m_analysis == NULL))
+	{
+		fprintf(stderr, "Couldn't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	memset(m_boot, 0, sizeof(m_explore_state));
+
+	size_t m_size = 0;
+	m_chip8 *m_root = &m_boot->m_machine;
+
+	memcpy(m_root->m_memory, m_font, CHIP8_FONT_SIZE);
+
+	if (m_rom_read(m_filename, &m_root->m_memory[CHIP8_INITIAL_PC], CCHIP8_MAX_ROM_SIZE, &m_size) == false)
+	{
+		return EXIT_FAILURE;
+	}
+
+	m_analyse(m_analysis, m_root->m_memory);
+
+	enum m_profile m_parsed = (strcmp(m_profile, "auto") == 0) ? m_analysis->m_profile : m_profile_from_name(m_profile);
+
+	if (m_parsed == M_PROFILE_COUNT)
+	{
+		fprintf(stderr, "Unknown quirk profile: %s\n", m_profile);
+		return EXIT_FAILURE;
+	}
+
+	m_root->m_programcounter = CHIP8_INITIAL_PC;
+	m_root->m_breakpoint = CHIP8_NO_BREAKPOINT;
+	m_root->m_profile = (uint8_t) m_parsed;
+	m_root->m_rngstate = CHIP8_DEFAULT_SEED;
+
+	m_explore m_explore;
+	memset(&m_explore, 0, sizeof(m_explore));
+
+	m_explore.m_frames = m_frames;
+	m_explore.m_depth = m_depth;
+	m_explore.m_capacity = m_states;
+	m_explore.m_threads = m_threads;
+	m_explore.m_frontier = m_aligned_alloc(m_states * sizeof(m_explore_state));
+	m_explore.m_next = m_aligned_alloc(m_states * sizeof(m_explore_state));
+	m_explore.m_pcpaths = calloc(FOURKiB, sizeof(m_explore_path));
+	m_explore.m_workers = calloc(m_threads, sizeof(m_explore_worker));
+
+	if ((m_explore.m_frontier == NULL) || (m_explore.m_next == NULL) || (m_explore.m_pcpaths == NULL) || (m_explore.m_workers == NULL) ||
+		(m_explore_set_create(&m_explore.m_seen, M_EXPLORE_SET_BITS) == false) ||
+		(m_explore_set_create(&m_explore.m_screens, M_EXPLORE_SCREEN_BITS) == false))
+	{
+		fprintf(stderr, "Couldn't allocate memory (%zu states per level need %zu MiB)\n", m_states,
+			(2 * m_states * sizeof(m_explore_state)) >> 20);
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < m_threads; i++)
+	{
+		m_explore.m_workers[i].m_explore = &m_explore;
+		m_explore.m_workers[i].m_scratch = m_chip8_create();
+		m_explore.m_workers[i].m_pcpaths = calloc(FOURKiB, sizeof(m_explore_path));
+
+		if ((m_explore.m_workers[i].m_scratch == NULL) || (m_explore.m_workers[i].m_pcpaths == NULL))
+		{
+			fprintf(stderr, "Couldn't allocate memory\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	memcpy(&m_explore.m_frontier[0], m_boot, sizeof(m_explore_state));
+	m_explore.m_frontiercount = 1;
+
+	m_explore_set_insert(&m_explore.m_seen, m_explore_state_hash(m_root, m_boot->m_display));
+	m_explore_set_insert(&m_explore.m_screens, m_explore_hash(m_boot->m_display, sizeof(m_boot->m_display), 0));
+
+	printf("%s: profile %s, %d inputs x %u frames per fork, up to %u levels of %zu states on %zu threads\n", m_filename,
+		m_get_quirks(m_parsed)->m_name, M_EXPLORE_INPUTS, m_frames, m_depth, m_states, m_threads);
+
+	double m_start = m_explore_now();
+	m_explore.m_deadline = m_start + m_seconds;
+	atomic_init(&m_explore.m_stop, false);
+
+	uint32_t m_level = 0;
+
+	for (; (m_level < m_depth) && (m_explore.m_frontiercount > 0) && (atomic_load(&m_explore.m_stop) == false); m_level++)
+	{
+		atomic_store(&m_explore.m_claim, 0);
+		atomic_store(&m_explore.m_nextcount, 0);
+		atomic_store(&m_explore.m_dropped, 0);
+		m_explore.m_level = m_level;
+
+		for (size_t i = 0; i < m_threads; i++)
+		{
+			pthread_create(&m_explore.m_workers[i].m_thread, NULL, m_explore_worker_run, &m_explore.m_workers[i]);
+		}
+
+		for (size_t i = 0; i < m_threads; i++)
+		{
+			pthread_join(m_explore.m_workers[i].m_thread, NULL);
+			m_explore_merge(&m_explore, &m_explore.m_workers[i]);
+		}
+
+		size_t m_found = atomic_load(&m_explore.m_nextcount);
+		size_t m_kept = (m_found > m_states) ? m_states : m_found;
+
+		printf("Level %2u: %8zu states  %8zu new  %6zu dropped  %6zu screens  %4zu PCs  %6llu faults  %9.0f states/s\n", m_level + 1,
+			atomic_load(&m_explore.m_seen.m_count), m_found, atomic_load(&m_explore.m_dropped), atomic_load(&m_explore.m_screens.m_count),
+			m_explore_pcs(&m_explore), (unsigned long long) m_explore_faults(&m_explore),
+			(double) m_explore.m_forks / (m_explore_now() - m_start));
+
+		// The new level becomes the frontier
+		m_explore_state *m_swap = m_explore.m_frontier;
+		m_explore.m_frontier = m_explore.m_next;
+		m_explore.m_next = m_swap;
+		m_explore.m_frontiercount = m_kept;
+	}
+
+	double m_elapsed = m_explore_now() - m_start;
+
+	if (atomic_load(&m_explore.m_stop) == true)
+	{
+		printf("Stopped early (%s)\n", m_explore_set_room(&m_explore.m_seen) ? "time limit" : "state set full");
+	} else if (m_explore.m_frontiercount == 0)
+	{
+		printf("State space exhausted after %u levels\n", m_level);
+	}
+
+	printf("\nExplored %llu forks (%.1f M instructions) in %.2f s, %.0f states/s\n", (unsigned long long) m_explore.m_forks,
+		(double) m_explore.m_instructions / 1e6, m_elapsed, (double) m_explore.m_forks / m_elapsed);
+	printf("Distinct states: %zu, distinct screens: %zu\n", atomic_load(&m_explore.m_seen.m_count), atomic_load(&m_explore.m_screens.m_count));
+	printf("PCs reached: %zu (The static analysis found %zu instructions)\n", m_explore_pcs(&m_explore), m_analysis->m_instructions);
+
+	for (size_t i = 1; i < M_FAULT_COUNT; i++)
+	{
+		if (m_explore.m_faults[i] != 0)
+		{
+			printf("Fault %s: %llu forks\n", m_fault_name((enum m_fault) i), (unsigned long long) m_explore.m_faults[i]);
+		}
+	}
+
+	bool m_written = (m_output == NULL) || m_explore_write(&m_explore, m_output);
+
+	for (size_t i = 0; i < m_threads; i++)
+	{
+		m_chip8_destroy(m_explore.m_workers[i].m_scratch);
+		free(m_explore.m_workers[i].m_pcpaths);
+	}
+
+	free(m_explore.m_workers);
+	free(m_explore.m_pcpaths);
+	free(m_explore.m_seen.m_slots);
+	free(m_explore.m_screens.m_slots);
+	m_aligned_free(m_explore.m_frontier);
+	m_aligned_free(m_explore.m_next);
+	m_aligned_free(m_boot);
+	free(m_analysis);
+
+	return m_written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,728 @@
+// clock_gettime(), setenv() and mkdir() are POSIX, -std=c2x hides them otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/cchip8.h"
+#include "../include/cchip8_fusion.h"
+#include "../include/cchip8_analysis.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_loader.h"
+
+#include <signal.h>
+#include <sys/stat.h>
+
+/*
+	CCHIP8 fuzzing target:
+	LLVMFuzzerTestOneInput runs one input on an interpreter that is reset from a booted snapshot
+	with a single memcpy (No allocation, no font loading, no ROM file), so an input costs little
+	more than the instructions it executes. The core is built with -DCCHIP8_TRACE, which makes
+	every dispatched instruction bump a cell of a PC/opcode coverage bitmap (m_trace_map).
+
+	Built with clang -fsanitize=fuzzer (make cchip8-libfuzzer) libFuzzer drives it and reads the
+	bitmap as extra counters. Built with gcc (make cchip8-fuzz) a small coverage-guided driver
+	below mutates inputs itself, keeps the ones reaching new bitmap cells and saves whatever
+	makes ASan/UBSan abort.
+
+	Input layout:
+		byte 0     bits 0-2: quirk profile (Modulo M_PROFILE_COUNT), bit 3: fused m_run,
+		           bit 4: single-step m_exec instead of m_run, bit 5: run the static analyser first
+		bytes 1-2  keyboard, bit N set holds key N down
+		bytes 3-   ROM loaded at CHIP8_INITIAL_PC (Anything past CCHIP8_MAX_ROM_SIZE is ignored)
+*/
+
+#ifndef CCHIP8_TRACE
+#error "The fuzzing target needs the coverage hook, build it with -DCCHIP8_TRACE (make cchip8-fuzz)"
+#endif
+
+#define M_FUZZ_HEADER 3
+#define M_FUZZ_MAX_INPUT (M_FUZZ_HEADER + CCHIP8_MAX_ROM_SIZE)
+
+// Instructions every input gets (CCHIP8_FUZZ_STEPS in the environment overrides it)
+#define M_FUZZ_STEPS 256
+
+// Mode bits in the first input byte
+#define M_FUZZ_PROFILE 0x07
+#define M_FUZZ_FUSED 0x08
+#define M_FUZZ_STEP 0x10
+#define M_FUZZ_ANALYSE 0x20
+
+// PC/opcode coverage bitmap filled by M_TRACE, libFuzzer collects its sections as extra feedback
+#ifdef CCHIP8_LIBFUZZER
+__attribute__((section("__libfuzzer_extra_counters")))
+#endif
+uint8_t m_trace_map[M_TRACE_MAP];
+
+// Everything an input is run with, allocated once
+typedef struct chip8_fuzz_target
+{
+	// Machine the inputs run on
+	m_chip8 *m_machine;
+
+	// Booted machine (Font loaded, PC at CHIP8_INITIAL_PC, empty RAM), shares m_machine's video state
+	m_chip8 *m_snapshot;
+
+	// Predecode cache for the fused inputs, detached from m_machine in between
+	m_code *m_cache;
+
+	// RAM as the last fused input left it, which is what every entry of m_cache was decoded from
+	uint8_t m_cached[FOURKiB];
+
+	m_analysis *m_analysis;
+
+	uint32_t m_steps;
+
+} m_fuzz_target;
+
+static m_fuzz_target m_fuzz;
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	(void) argc;
+	(void) argv;
+
+	m_fuzz.m_machine = m_chip8_create();
+	m_fuzz.m_snapshot = m_aligned_alloc(sizeof(m_chip8));
+	m_fuzz.m_analysis = malloc(sizeof(m_analysis));
+
+	if ((m_fuzz.m_machine == NULL) || (m_fuzz.m_snapshot == NULL) || (m_fuzz.m_analysis == NULL) ||
+		((m_fuzz.m_cache = m_code_create(m_fuzz.m_machine)) == NULL))
+	{
+		fprintf(stderr, "Couldn't allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_fuzz.m_machine->m_code = NULL;
+
+	m_chip8 *chip8 = m_fuzz.m_snapshot;
+
+	memset(chip8, 0, sizeof(m_chip8));
+	memcpy(chip8->m_memory, m_font, CHIP8_FONT_SIZE);
+
+	chip8->m_programcounter = CHIP8_INITIAL_PC;
+	chip8->m_breakpoint = CHIP8_NO_BREAKPOINT;
+	chip8->m_rngstate = CHIP8_DEFAULT_SEED;
+	chip8->m_video = m_fuzz.m_machine->m_video;
+
+	const char *m_steps = getenv("CCHIP8_FUZZ_STEPS");
+	m_fuzz.m_steps = (m_steps != NULL) ? (uint32_t) strtoul(m_steps, NULL, 0) : M_FUZZ_STEPS;
+
+	return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *m_data, size_t m_size)
+{
+	if (m_size < M_FUZZ_HEADER)
+	{
+		return 0;
+	}
+
+	m_chip8 *chip8 = m_fuzz.m_machine;
+
+	// The snapshot's display is blank, it only needs restoring if the previous input drew something
+	if (chip8->m_redraw == true)
+	{
+		memset(chip8->m_video->m_display, 0, sizeof(chip8->m_video->m_display));
+	}
+
+	memcpy(chip8, m_fuzz.m_snapshot, sizeof(m_chip8));
+
+	uint8_t m_mode = m_data[0];
+	uint16_t m_keys = (uint16_t) (m_data[1] | (m_data[2] << 8));
+	size_t m_romsize = m_size - M_FUZZ_HEADER;
+
+	m_romsize = (m_romsize > CCHIP8_MAX_ROM_SIZE) ? CCHIP8_MAX_ROM_SIZE : m_romsize;
+
+	chip8->m_profile = (uint8_t) ((m_mode & M_FUZZ_PROFILE) % M_PROFILE_COUNT);
+
+	for (size_t i = 0; i < CHIP8_KEYS; i++)
+	{
+		chip8->m_keyboard[i] = (m_keys >> i) & 1;
+	}
+
+	memcpy(&chip8->m_memory[CHIP8_INITIAL_PC], &m_data[M_FUZZ_HEADER], m_romsize);
+
+	if (m_mode & M_FUZZ_ANALYSE)
+	{
+		m_analyse(m_fuzz.m_analysis, chip8->m_memory);
+	}
+
+	/*
+		Flushing the whole predecode cache for every input would cost more than running most of them,
+		only the cache lines of RAM that differ from what the cache was decoded from get invalidated.
+	*/
+	if (m_mode & M_FUZZ_FUSED)
+	{
+		chip8->m_code = m_fuzz.m_cache;
+
+		for (size_t m_line = 0; m_line < FOURKiB; m_line += M_CACHELINE)
+		{
+			if (memcmp(&chip8->m_memory[m_line], &m_fuzz.m_cached[m_line], M_CACHELINE) != 0)
+			{
+				m_code_invalidate(m_fuzz.m_cache, (uint16_t) m_line, M_CACHELINE);
+			}
+		}
+	}
+
+	if (m_mode & M_FUZZ_STEP)
+	{
+		for (uint32_t i = 0; (i < m_fuzz.m_steps) && (chip8->m_fault == M_FAULT_NONE); i++)
+		{
+			m_exec(chip8);
+		}
+	} else {
+		const uint64_t m_end = m_fuzz.m_steps;
+
+		// m_run returns on every draw, keep calling it until the budget is gone or the machine stops
+		while ((chip8->m_cycles < m_end) && (m_run(chip8, (uint32_t) (m_end - chip8->m_cycles)) != M_RUN_FAULT))
+		{
+		}
+	}
+
+	if (chip8->m_code != NULL)
+	{
+		memcpy(m_fuzz.m_cached, chip8->m_memory, FOURKiB);
+	}
+
+	return 0;
+}
+
+#ifndef CCHIP8_LIBFUZZER
+
+/*
+	Standalone driver for builds without libFuzzer.
+	Mutates inputs from an in-memory corpus, an input that lights up a new coverage cell (Or a cell's
+	hit count reaching a new power of two bucket, like AFL does) joins the corpus.
+*/
+
+// Largest amount of inputs kept in memory
+#define M_FUZZ_MAX_CORPUS 65536
+
+// Inputs the driver starts from when it wasn't given any (Random valid programs)
+#define M_FUZZ_SEEDS 16
+
+typedef struct chip8_fuzz_input
+{
+	uint8_t *m_data;
+	size_t m_size;
+
+} m_fuzz_input;
+
+typedef struct chip8_fuzz_driver
+{
+	m_fuzz_input *m_corpus;
+	size_t m_count;
+
+	// Hit count buckets every cell of m_trace_map has reached so far
+	uint8_t m_seen[M_TRACE_MAP];
+	size_t m_cells;
+
+	// Where new inputs and crashes are written (NULL: crashes go to the working directory, inputs nowhere)
+	const char *m_directory;
+
+	uint64_t m_rng;
+
+	// Input being executed, written out by m_fuzz_crash
+	uint8_t m_current[M_FUZZ_MAX_INPUT];
+	size_t m_currentsize;
+
+} m_fuzz_driver;
+
+static m_fuzz_driver m_driver;
+
+static uint64_t m_fuzz_random(void)
+{
+	// splitmix64
+	uint64_t m_value = (m_driver.m_rng += 0x9E3779B97F4A7C15ULL);
+
+	m_value = (m_value ^ (m_value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	m_value = (m_value ^ (m_value >> 27)) * 0x94D049BB133111EBULL;
+
+	return m_value ^ (m_value >> 31);
+}
+
+static size_t m_fuzz_below(size_t m_limit)
+{
+	return (size_t) (m_fuzz_random() % m_limit);
+}
+
+static double m_fuzz_now(void)
+{
+	struct timespec m_time;
+	clock_gettime(CLOCK_MONOTONIC, &m_time);
+	return (double) m_time.tv_sec + (double) m_time.tv_nsec / 1e9;
+}
+
+// FNV-1a, names saved inputs after their contents so the same input is never stored twice
+static uint64_t m_fuzz_hash(const uint8_t *m_data, size_t m_size)
+{
+	uint64_t m_hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < m_size; i++)
+	{
+		m_hash = (m_hash ^ m_data[i]) * 0x100000001B3ULL;
+	}
+
+	return m_hash;
+}
+
+static void m_fuzz_save(const char *m_prefix, const uint8_t *m_data, size_t m_size)
+{
+	char m_path[4096];
+	const char *m_directory = (m_driver.m_directory != NULL) ? m_driver.m_directory : ".";
+
+	snprintf(m_path, sizeof(m_path), "%s/%s%016llx.fuzz", m_directory, m_prefix, (unsigned long long) m_fuzz_hash(m_data, m_size));
+
+	FILE *m_out = fopen(m_path, "wb");
+
+	if (m_out == NULL)
+	{
+		fprintf(stderr, "Could not create %s\n", m_path);
+		return;
+	}
+
+	if ((m_size > 0) && (fwrite(m_data, m_size, 1, m_out) != 1))
+	{
+		fprintf(stderr, "Could not write %s\n", m_path);
+	}
+
+	fclose(m_out);
+
+	if (m_prefix[0] != '\0')
+	{
+		fprintf(stderr, "Input saved to %s, replay it with: ./cchip8-fuzz -replay %s\n", m_path, m_path);
+	}
+}
+
+// Sanitizer reports end in abort() instead of _exit(), so m_fuzz_crash gets to save the input
+const char *__asan_default_options(void)
+{
+	return "abort_on_error=1";
+}
+
+const char *__ubsan_default_options(void)
+{
+	return "abort_on_error=1:print_stacktrace=1";
+}
+
+// Save the input that brought the process down, then let the signal kill it as usual
+static void m_fuzz_crash(int m_signal)
+{
+	m_fuzz_save("crash-", m_driver.m_current, m_driver.m_currentsize);
+
+	signal(m_signal, SIG_DFL);
+	raise(m_signal);
+}
+
+static bool m_fuzz_keep(const uint8_t *m_data, size_t m_size)
+{
+	if (m_driver.m_count == M_FUZZ_MAX_CORPUS)
+	{
+		return false;
+	}
+
+	uint8_t *m_copy = malloc((m_size > 0) ? m_size : 1);
+
+	if (m_copy == NULL)
+	{
+		return false;
+	}
+
+	memcpy(m_copy, m_data, m_size);
+
+	m_driver.m_corpus[m_driver.m_count].m_data = m_copy;
+	m_driver.m_corpus[m_driver.m_count].m_size = m_size;
+	m_driver.m_count++;
+
+	return true;
+}
+
+// AFL's hit count classes: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+static uint8_t m_fuzz_bucket(uint8_t m_hits)
+{
+	if (m_hits <= 3)
+	{
+		return (uint8_t) (1 << (m_hits - 1));
+	}
+
+	if (m_hits < 8)
+	{
+		return 0x08;
+	}
+
+	if (m_hits < 16)
+	{
+		return 0x10;
+	}
+
+	if (m_hits < 32)
+	{
+		return 0x20;
+	}
+
+	return (m_hits < 128) ? 0x40 : 0x80;
+}
+
+// Run one input, returns whether it reached something the corpus didn't (And clears the bitmap for the next one)
+static bool m_fuzz_execute(const uint8_t *m_data, size_t m_size)
+{
+	memcpy(m_driver.m_current, m_data, m_size);
+	m_driver.m_currentsize = m_size;
+
+	LLVMFuzzerTestOneInput(m_data, m_size);
+
+	bool m_new = false;
+	uint64_t *m_words = (uint64_t *) m_trace_map;
+
+	// Most of the bitmap is untouched, skip it 8 cells at a time
+	for (size_t w = 0; w < (M_TRACE_MAP / sizeof(uint64_t)); w++)
+	{
+		if (m_words[w] == 0)
+		{
+			continue;
+		}
+
+		for (size_t i = w * sizeof(uint64_t); i < (w + 1) * sizeof(uint64_t); i++)
+		{
+			if (m_trace_map[i] == 0)
+			{
+				continue;
+			}
+
+			uint8_t m_bucket = m_fuzz_bucket(m_trace_map[i]);
+
+			if ((m_driver.m_seen[i] & m_bucket) == 0)
+			{
+				m_driver.m_cells += (m_driver.m_seen[i] == 0);
+				m_driver.m_seen[i] |= m_bucket;
+				m_new = true;
+			}
+
+			m_trace_map[i] = 0;
+		}
+
+		m_words[w] = 0;
+	}
+
+	return m_new;
+}
+
+// Random opcode the interpreter implements, mutations built from them get past the first instruction
+static uint16_t m_fuzz_opcode(void)
+{
+	for (;;)
+	{
+		uint16_t m_opcode = (uint16_t) m_fuzz_random();
+
+		if (m_opcode_valid(m_opcode))
+		{
+			return m_opcode;
+		}
+	}
+}
+
+// Apply 1 to 4 random mutations in place, returns the new size
+static size_t m_fuzz_mutate(uint8_t *m_data, size_t m_size)
+{
+	size_t m_count = 1 + m_fuzz_below(4);
+
+	for (size_t n = 0; n < m_count; n++)
+	{
+		size_t m_romsize = m_size - M_FUZZ_HEADER;
+
+		switch (m_fuzz_below(8))
+		{
+			// Flip a bit
+			case 0:
+				if (m_romsize > 0)
+				{
+					m_data[M_FUZZ_HEADER + m_fuzz_below(m_romsize)] ^= (uint8_t) (1 << m_fuzz_below(8));
+				}
+				break;
+
+			// Random byte
+			case 1:
+				if (m_romsize > 0)
+				{
+					m_data[M_FUZZ_HEADER + m_fuzz_below(m_romsize)] = (uint8_t) m_fuzz_random();
+				}
+				break;
+
+			// Overwrite (Or append) an instruction with a valid one
+			case 2:
+			{
+				size_t m_offset = M_FUZZ_HEADER + (m_fuzz_below((m_romsize / 2) + 1) * 2);
+
+				if ((m_offset + 2) <= M_FUZZ_MAX_INPUT)
+				{
+					uint16_t m_opcode = m_fuzz_opcode();
+
+					m_data[m_offset] = (uint8_t) (m_opcode >> 8);
+					m_data[m_offset + 1] = (uint8_t) m_opcode;
+					m_size = (m_offset + 2 > m_size) ? (m_offset + 2) : m_size;
+				}
+				break;
+			}
+
+			// Copy a chunk of the ROM over another place in it
+			case 3:
+				if (m_romsize > 1)
+				{
+					size_t m_length = 1 + m_fuzz_below(m_romsize / 2);
+					size_t m_from = M_FUZZ_HEADER + m_fuzz_below(m_romsize - m_length + 1);
+					size_t m_to = M_FUZZ_HEADER + m_fuzz_below(m_romsize - m_length + 1);
+
+					memmove(&m_data[m_to], &m_data[m_from], m_length);
+				}
+				break;
+
+			// Insert up to 8 random bytes
+			case 4:
+			{
+				size_t m_length = 1 + m_fuzz_below(8);
+
+				if ((m_size + m_length) <= M_FUZZ_MAX_INPUT)
+				{
+					size_t m_at = M_FUZZ_HEADER + m_fuzz_below(m_romsize + 1);
+
+					memmove(&m_data[m_at + m_length], &m_data[m_at], m_size - m_at);
+
+					for (size_t i = 0; i < m_length; i++)
+					{
+						m_data[m_at + i] = (uint8_t) m_fuzz_random();
+					}
+
+					m_size += m_length;
+				}
+				break;
+			}
+
+			// Erase up to 8 bytes
+			case 5:
+				if (m_romsize > 0)
+				{
+					size_t m_length = 1 + m_fuzz_below((m_romsize < 8) ? m_romsize : 8);
+					size_t m_at = M_FUZZ_HEADER + m_fuzz_below(m_romsize - m_length + 1);
+
+					memmove(&m_data[m_at], &m_data[m_at + m_length], m_size - m_at - m_length);
+					m_size -= m_length;
+				}
+				break;
+
+			// Another profile, backend or keyboard
+			case 6:
+				m_data[m_fuzz_below(M_FUZZ_HEADER)] ^= (uint8_t) (1 << m_fuzz_below(8));
+				break;
+
+			// Splice the tail of another corpus entry in
+			default:
+			{
+				const m_fuzz_input *m_other = &m_driver.m_corpus[m_fuzz_below(m_driver.m_count)];
+
+				if (m_other->m_size > M_FUZZ_HEADER)
+				{
+					size_t m_at = M_FUZZ_HEADER + m_fuzz_below(m_romsize + 1);
+					size_t m_from = M_FUZZ_HEADER + m_fuzz_below(m_other->m_size - M_FUZZ_HEADER);
+					size_t m_length = m_other->m_size - m_from;
+
+					m_length = ((m_at + m_length) > M_FUZZ_MAX_INPUT) ? (M_FUZZ_MAX_INPUT - m_at) : m_length;
+
+					memcpy(&m_data[m_at], &m_other->m_data[m_from], m_length);
+					m_size = m_at + m_length;
+				}
+				break;
+			}
+		}
+	}
+
+	return m_size;
+}
+
+static bool m_fuzz_load(const m_corpus *m_files)
+{
+	uint8_t m_input[M_FUZZ_MAX_INPUT];
+
+	for (size_t i = 0; i < m_files->m_count; i++)
+	{
+		size_t m_size = 0;
+
+		if (m_rom_read(m_files->m_paths[i], m_input, sizeof(m_input), &m_size) == false)
+		{
+			return false;
+		}
+
+		m_fuzz_execute(m_input, m_size);
+
+		if (m_fuzz_keep(m_input, m_size) == false)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+static void m_fuzz_seed(void)
+{
+	uint8_t m_input[M_FUZZ_HEADER + 64];
+
+	for (size_t n = 0; n < M_FUZZ_SEEDS; n++)
+	{
+		m_input[0] = (uint8_t) n;
+		m_input[1] = 0;
+		m_input[2] = 0;
+
+		for (size_t i = M_FUZZ_HEADER; i < sizeof(m_input); i += 2)
+		{
+			uint16_t m_opcode = m_fuzz_opcode();
+
+			m_input[i] = (uint8_t) (m_opcode >> 8);
+			m_input[i + 1] = (uint8_t) m_opcode;
+		}
+
+		m_fuzz_execute(m_input, sizeof(m_input));
+		m_fuzz_keep(m_input, sizeof(m_input));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const m_extensions[] = { ".fuzz", NULL };
+
+	m_corpus m_files = { 0 };
+	double m_seconds = 60.0;
+	bool m_replay = false;
+
+	m_driver.m_rng = (uint64_t) time(NULL);
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool m_value = (i + 1) < argc;
+
+		if ((strcmp(argv[i], "-t") == 0) && m_value)
+		{
+			m_seconds = strtod(argv[++i], NULL);
+		} else if ((strcmp(argv[i], "-steps") == 0) && m_value)
+		{
+			setenv("CCHIP8_FUZZ_STEPS", argv[++i], 1);
+		} else if ((strcmp(argv[i], "-seed") == 0) && m_value)
+		{
+			m_driver.m_rng = strtoull(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-o") == 0) && m_value)
+		{
+			m_driver.m_directory = argv[++i];
+		} else if (strcmp(argv[i], "-replay") == 0)
+		{
+			m_replay = true;
+		} else if ((argv[i][0] != '-') && m_corpus_add(&m_files, argv[i], m_extensions))
+		{
+			continue;
+		} else {
+			fprintf(stderr, "Usage: ./cchip8-fuzz [-t seconds] [-steps n] [-seed n] [-o directory] [input|directory]...\n");
+			fprintf(stderr, "       ./cchip8-fuzz -replay [-steps n] input...\n");
+			m_corpus_free(&m_files);
+			return EXIT_FAILURE;
+		}
+	}
+
+	LLVMFuzzerInitialize(&argc, &argv);
+
+	signal(SIGABRT, m_fuzz_crash);
+	signal(SIGSEGV, m_fuzz_crash);
+	signal(SIGBUS, m_fuzz_crash);
+
+	if (m_replay == true)
+	{
+		for (size_t i = 0; i < m_files.m_count; i++)
+		{
+			size_t m_size = 0;
+
+			if (m_rom_read(m_files.m_paths[i], m_driver.m_current, sizeof(m_driver.m_current), &m_size))
+			{
+				fprintf(stderr, "%s: %zu bytes\n", m_files.m_paths[i], m_size);
+				m_fuzz_execute(m_driver.m_current, m_size);
+			}
+		}
+
+		m_corpus_free(&m_files);
+		return EXIT_SUCCESS;
+	}
+
+	m_driver.m_corpus = malloc(M_FUZZ_MAX_CORPUS * sizeof(m_fuzz_input));
+
+	if (m_driver.m_corpus == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	// A previous run's output directory is a corpus too
+	if ((m_driver.m_directory != NULL) && m_corpus_is_directory(m_driver.m_directory))
+	{
+		m_corpus_add(&m_files, m_driver.m_directory, m_extensions);
+	} else if ((m_driver.m_directory != NULL) && (mkdir(m_driver.m_directory, 0777) != 0))
+	{
+		fprintf(stderr, "Could not create %s\n", m_driver.m_directory);
+		m_corpus_free(&m_files);
+		return EXIT_FAILURE;
+	}
+
+	if (m_fuzz_load(&m_files) == false)
+	{
+		m_corpus_free(&m_files);
+		return EXIT_FAILURE;
+	}
+
+	m_corpus_free(&m_files);
+
+	if (m_driver.m_count == 0)
+	{
+		m_fuzz_seed();
+	}
+
+	uint8_t m_input[M_FUZZ_MAX_INPUT];
+	uint64_t m_execs = 0;
+	double m_start = m_fuzz_now();
+	double m_report = m_start + 1.0;
+	double m_now = m_start;
+
+	while ((m_now - m_start) < m_seconds)
+	{
+		// Clock reads are cheap but not free, check the time every 1024 inputs
+		for (size_t n = 0; n < 1024; n++)
+		{
+			const m_fuzz_input *m_parent = &m_driver.m_corpus[m_fuzz_below(m_driver.m_count)];
+
+			memcpy(m_input, m_parent->m_data, m_parent->m_size);
+
+			size_t m_size = m_fuzz_mutate(m_input, (m_parent->m_size < M_FUZZ_HEADER) ? M_FUZZ_HEADER : m_parent->m_size);
+
+			if (m_fuzz_execute(m_input, m_size) && m_fuzz_keep(m_input, m_size) && (m_driver.m_directory != NULL))
+			{
+				m_fuzz_save("", m_input, m_size);
+			}
+		}
+
+		m_execs += 1024;
+		m_now = m_fuzz_now();
+
+		if (m_now >= m_report)
+		{
+			fprintf(stderr, "#%llu  corpus: %zu  coverage: %zu cells  %.0f execs/s\n", (unsigned long long) m_execs,
+				m_driver.m_count, m_driver.m_cells, (double) m_execs / (m_now - m_start));
+			m_report = m_now + 1.0;
+		}
+	}
+
+	fprintf(stderr, "Done: %llu inputs in %.1f s (%.0f execs/s), corpus: %zu, coverage: %zu cells\n", (unsigned long long) m_execs,
+		m_now - m_start, (double) m_execs / (m_now - m_start), m_driver.m_count, m_driver.m_cells);
+
+	for (size_t i = 0; i < m_driver.m_count; i++)
+	{
+		free(m_driver.m_corpus[i].m_data);
+	}
+
+	free(m_driver.m_corpus);
+
+	return EXIT_SUCCESS;
+}
+
+#endif
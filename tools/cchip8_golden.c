@@ -0,0 +1,902 @@
+// clock_gettime(), strtok_r() and mkdir() are POSIX, -std=c2x hides them otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../include/libcchip8.h"
+#include "../include/cchip8_corpus.h"
+#include "../include/cchip8_image.h"
+
+/*
+	CCHIP8 golden-frame runner:
+	Runs every test of a manifest headless on each backend (The reference m_exec, m_run and fused
+	m_run; the first one is a machine created with cchip8_options.m_reference, so a hash only the
+	fast paths get wrong points at them instead of the ROM or the golden), presses and releases
+	keys on the frames the manifest says, and hashes the display on the frames it checks
+	(cchip8_hash_display). A hash that isn't the stored golden, or backends that disagree with each
+	other, fail the run and get a PNG next to the report: expected, actual and what changed. A
+	machine that halts before its last checked frame fails the test too. Manifest format:
+
+		# Comment
+		rom games/pong.ch8 [quirks vip] [seed 7]     Starts a test (Paths relative to the manifest)
+		press 5 10                                   Key 5 goes down before frame 10 runs
+		release 5 40                                 ...and back up before frame 40
+		frame 60 8d2f0c71a3e4b596                    Display hash once 60 frames ran (Left out = new)
+
+	-update writes the hashes of this run into the manifest and the pictures into its frame store
+	(<manifest>.frames, what the diffs show as expected). The store is keyed by hash, so equal
+	pictures are kept once: "CCHIP8G" | uint8 version | records of uint64 hash + CCHIP8_HEIGHT uint64
+	rows, little endian.
+*/
+
+#define M_GOLDEN_MAGIC "CCHIP8G"
+#define M_GOLDEN_VERSION 1
+
+// One record of the frame store
+#define M_GOLDEN_RECORD (8 + (CCHIP8_HEIGHT * 8))
+
+enum m_golden_backend
+{
+	M_GOLDEN_EXEC = 0,
+	M_GOLDEN_RUN,
+	M_GOLDEN_FUSED,
+
+	M_GOLDEN_BACKENDS
+};
+
+static const char *m_golden_names[M_GOLDEN_BACKENDS] = { "m_exec", "m_run", "m_run (fused)" };
+
+// Diff picture colors: off, on in both, only expected, only actual, panel separator
+static const m_color m_golden_palette[5] = {
+	{ 0x00, 0x00, 0x00 }, { 0xFF, 0xFF, 0xFF }, { 0xE0, 0x30, 0x30 }, { 0x30, 0xD0, 0x50 }, { 0x40, 0x40, 0x40 }
+};
+
+typedef struct chip8_golden_event
+{
+	uint32_t m_frame;
+	uint8_t m_key;
+	bool m_down;
+
+} m_golden_event;
+
+typedef struct chip8_golden_check
+{
+	uint32_t m_frame;
+
+	// Manifest line, -update rewrites it
+	size_t m_line;
+
+	bool m_known;
+	uint64_t m_expected;
+
+	// What each backend drew
+	uint64_t m_actual[M_GOLDEN_BACKENDS];
+	uint64_t m_rows[M_GOLDEN_BACKENDS][CCHIP8_HEIGHT];
+
+} m_golden_check;
+
+typedef struct chip8_golden_test
+{
+	char *m_rom;
+	char *m_profile;
+	uint32_t m_seed;
+	size_t m_line;
+
+	m_golden_event *m_events;
+	size_t m_eventcount;
+
+	m_golden_check *m_checks;
+	size_t m_checkcount;
+
+	// Why a backend couldn't run the test (Empty if it did)
+	char m_error[M_GOLDEN_BACKENDS][160];
+
+} m_golden_test;
+
+typedef struct chip8_golden_job
+{
+	m_golden_test *m_tests;
+	size_t m_count;
+
+	// Backends the run uses, the first one is the reference the others are compared with
+	enum m_golden_backend m_backends[M_GOLDEN_BACKENDS];
+	size_t m_backendcount;
+
+} m_golden_job;
+
+static double m_golden_now(void)
+{
+	struct timespec m_now;
+
+	clock_gettime(CLOCK_MONOTONIC, &m_now);
+
+	return (double) m_now.tv_sec + ((double) m_now.tv_nsec / 1e9);
+}
+
+// Room for one more element in a growing array, false if it can't get any
+static bool m_golden_grow(void **m_array, size_t m_count, size_t m_size)
+{
+	// Capacities are the powers of two the counts go through
+	if ((m_count != 0) && ((m_count & (m_count - 1)) != 0))
+	{
+		return true;
+	}
+
+	void *m_grown = realloc(*m_array, ((m_count == 0) ? 4 : (m_count * 2)) * m_size);
+
+	if (m_grown == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		return false;
+	}
+
+	*m_array = m_grown;
+
+	return true;
+}
+
+static char *m_golden_copy(const char *m_text)
+{
+	char *m_copy = malloc(strlen(m_text) + 1);
+
+	if (m_copy != NULL)
+	{
+		strcpy(m_copy, m_text);
+	}
+
+	return m_copy;
+}
+
+static void m_golden_free(m_golden_test *m_tests, size_t m_count)
+{
+	for (size_t i = 0; i < m_count; i++)
+	{
+		free(m_tests[i].m_rom);
+		free(m_tests[i].m_profile);
+		free(m_tests[i].m_events);
+		free(m_tests[i].m_checks);
+	}
+
+	free(m_tests);
+}
+
+// A frame number of the manifest, frames are counted from 1
+static bool m_golden_frame(const char *m_text, uint32_t *m_frame)
+{
+	char *m_end = NULL;
+	unsigned long m_value = (m_text != NULL) ? strtoul(m_text, &m_end, 10) : 0;
+
+	*m_frame = (uint32_t) m_value;
+
+	return (m_text != NULL) && (*m_end == '\0') && (m_value >= 1) && (m_value <= UINT32_MAX);
+}
+
+// Parse one manifest line into m_tests, prints why and returns false if it's malformed
+static bool m_golden_parse(m_golden_test **m_tests, size_t *m_count, char *m_text, size_t m_line, const char *m_directory)
+{
+	char *m_comment = strchr(m_text, '#');
+
+	if (m_comment != NULL)
+	{
+		*m_comment = '\0';
+	}
+
+	char *m_state = NULL;
+	char *m_word = strtok_r(m_text, " \t\r\n", &m_state);
+
+	if (m_word == NULL)
+	{
+		return true;
+	}
+
+	if (strcmp(m_word, "rom") == 0)
+	{
+		char *m_path = strtok_r(NULL, " \t\r\n", &m_state);
+
+		if ((m_path == NULL) || (m_golden_grow((void **) m_tests, *m_count, sizeof(m_golden_test)) == false))
+		{
+			printf("Line %zu: rom needs a path\n", m_line);
+			return false;
+		}
+
+		m_golden_test *m_test = &(*m_tests)[(*m_count)++];
+		memset(m_test, 0, sizeof(*m_test));
+		m_test->m_line = m_line;
+
+		size_t m_length = strlen(m_directory) + strlen(m_path) + 2;
+		m_test->m_rom = malloc(m_length);
+
+		if (m_test->m_rom == NULL)
+		{
+			printf("Couldn't allocate memory\n");
+			return false;
+		}
+
+		if ((m_path[0] == '/') || (m_directory[0] == '\0'))
+		{
+			snprintf(m_test->m_rom, m_length, "%s", m_path);
+		} else {
+			snprintf(m_test->m_rom, m_length, "%s/%s", m_directory, m_path);
+		}
+
+		while ((m_word = strtok_r(NULL, " \t\r\n", &m_state)) != NULL)
+		{
+			char *m_value = strtok_r(NULL, " \t\r\n", &m_state);
+
+			if ((strcmp(m_word, "quirks") == 0) && (m_value != NULL) && (m_test->m_profile == NULL))
+			{
+				m_test->m_profile = m_golden_copy(m_value);
+			} else if ((strcmp(m_word, "seed") == 0) && (m_value != NULL))
+			{
+				m_test->m_seed = (uint32_t) strtoul(m_value, NULL, 0);
+			} else {
+				printf("Line %zu: unknown rom option %s\n", m_line, m_word);
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	if (*m_count == 0)
+	{
+		printf("Line %zu: %s before the first rom\n", m_line, m_word);
+		return false;
+	}
+
+	m_golden_test *m_test = &(*m_tests)[*m_count - 1];
+
+	if ((strcmp(m_word, "press") == 0) || (strcmp(m_word, "release") == 0))
+	{
+		char *m_key = strtok_r(NULL, " \t\r\n", &m_state);
+		char *m_end = NULL;
+		unsigned long m_value = (m_key != NULL) ? strtoul(m_key, &m_end, 16) : 16;
+		m_golden_event m_event = { .m_key = (uint8_t) m_value, .m_down = (m_word[0] == 'p') };
+
+		if ((m_value > 0xF) || (*m_end != '\0') || (m_golden_frame(strtok_r(NULL, " \t\r\n", &m_state), &m_event.m_frame) == false))
+		{
+			printf("Line %zu: expected %s <key 0-F> <frame>\n", m_line, m_word);
+			return false;
+		}
+
+		if ((m_test->m_eventcount != 0) && (m_test->m_events[m_test->m_eventcount - 1].m_frame > m_event.m_frame))
+		{
+			printf("Line %zu: key events have to come in frame order\n", m_line);
+			return false;
+		}
+
+		if (m_golden_grow((void **) &m_test->m_events, m_test->m_eventcount, sizeof(m_golden_event)) == false)
+		{
+			return false;
+		}
+
+		m_test->m_events[m_test->m_eventcount++] = m_event;
+
+		return true;
+	}
+
+	if (strcmp(m_word, "frame") == 0)
+	{
+		m_golden_check m_check = { .m_line = m_line };
+		char *m_hash = NULL;
+
+		if (m_golden_frame(strtok_r(NULL, " \t\r\n", &m_state), &m_check.m_frame) == false)
+		{
+			printf("Line %zu: expected frame <frame> [hash]\n", m_line);
+			return false;
+		}
+
+		if ((m_hash = strtok_r(NULL, " \t\r\n", &m_state)) != NULL)
+		{
+			char *m_end = NULL;
+
+			m_check.m_expected = strtoull(m_hash, &m_end, 16);
+			m_check.m_known = true;
+
+			if ((*m_end != '\0') || (strlen(m_hash) != 16))
+			{
+				printf("Line %zu: a hash is 16 hex digits\n", m_line);
+				return false;
+			}
+		}
+
+		if ((m_test->m_checkcount != 0) && (m_test->m_checks[m_test->m_checkcount - 1].m_frame >= m_check.m_frame))
+		{
+			printf("Line %zu: checked frames have to come in increasing order\n", m_line);
+			return false;
+		}
+
+		if (m_golden_grow((void **) &m_test->m_checks, m_test->m_checkcount, sizeof(m_golden_check)) == false)
+		{
+			return false;
+		}
+
+		m_test->m_checks[m_test->m_checkcount++] = m_check;
+
+		return true;
+	}
+
+	printf("Line %zu: unknown directive %s\n", m_line, m_word);
+
+	return false;
+}
+
+// One test on one backend, every item is a (Test, backend) pair so a long test doesn't hold up the others
+static void m_golden_run(void *m_context, size_t m_worker, size_t m_item)
+{
+	(void) m_worker;
+
+	m_golden_job *m_job = m_context;
+	m_golden_test *m_test = &m_job->m_tests[m_item / m_job->m_backendcount];
+	enum m_golden_backend m_backend = m_job->m_backends[m_item % m_job->m_backendcount];
+	char *m_error = m_test->m_error[m_backend];
+
+	if (m_test->m_checkcount == 0)
+	{
+		return;
+	}
+
+	cchip8_options m_options;
+	cchip8_default_options(&m_options);
+
+	m_options.m_profile = m_test->m_profile;
+	m_options.m_seed = m_test->m_seed;
+	m_options.m_fusion = (m_backend == M_GOLDEN_FUSED);
+	m_options.m_reference = (m_backend == M_GOLDEN_EXEC);
+
+	cchip8 *m_vm = cchip8_create(&m_options);
+
+	if (m_vm == NULL)
+	{
+		snprintf(m_error, sizeof(m_test->m_error[0]), "unknown quirk profile %s", m_test->m_profile);
+		return;
+	}
+
+	if (cchip8_load_rom_from_file(m_vm, m_test->m_rom) == false)
+	{
+		snprintf(m_error, sizeof(m_test->m_error[0]), "could not load %s", m_test->m_rom);
+		cchip8_destroy(m_vm);
+		return;
+	}
+
+	size_t m_event = 0;
+	size_t m_check = 0;
+
+	for (uint32_t m_frame = 1; m_check < m_test->m_checkcount; m_frame++)
+	{
+		for (; (m_event < m_test->m_eventcount) && (m_test->m_events[m_event].m_frame == m_frame); m_event++)
+		{
+			cchip8_key_event(m_vm, m_test->m_events[m_event].m_key, m_test->m_events[m_event].m_down);
+		}
+
+		// A halted machine would keep showing its last picture, which isn't what the check asks for
+		if (cchip8_run_frames(m_vm, 1) != CCHIP8_OK)
+		{
+			cchip8_fault_info m_info;
+			enum cchip8_fault m_fault = cchip8_get_fault(m_vm, &m_info);
+
+			snprintf(m_error, sizeof(m_test->m_error[0]), "halted in frame %u before checking frame %u (%s at 0x%03X, opcode %04X)",
+				m_frame, m_test->m_checks[m_check].m_frame, cchip8_fault_name(m_fault), m_info.m_address, m_info.m_opcode);
+			break;
+		}
+
+		if (m_test->m_checks[m_check].m_frame == m_frame)
+		{
+			m_golden_check *m_result = &m_test->m_checks[m_check++];
+
+			cchip8_pack_display(m_vm, m_result->m_rows[m_backend]);
+			m_result->m_actual[m_backend] = cchip8_hash_display(m_result->m_rows[m_backend]);
+		}
+	}
+
+	cchip8_destroy(m_vm);
+}
+
+static void m_golden_le64(uint8_t *m_bytes, uint64_t m_value)
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		m_bytes[i] = (uint8_t) (m_value >> (i * 8));
+	}
+}
+
+static uint64_t m_golden_read64(const uint8_t *m_bytes)
+{
+	uint64_t m_value = 0;
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		m_value |= (uint64_t) m_bytes[i] << (i * 8);
+	}
+
+	return m_value;
+}
+
+static int m_golden_compare(const void *m_a, const void *m_b)
+{
+	uint64_t m_left = m_golden_read64(m_a);
+	uint64_t m_right = m_golden_read64(m_b);
+
+	return (m_left > m_right) - (m_left < m_right);
+}
+
+// Sort the store by hash and drop repeated pictures, returns how many records are left
+static size_t m_golden_sort_store(uint8_t *m_store, size_t m_records)
+{
+	size_t m_kept = 0;
+
+	if (m_records == 0)
+	{
+		return 0;
+	}
+
+	qsort(m_store, m_records, M_GOLDEN_RECORD, m_golden_compare);
+
+	for (size_t i = 1; i < m_records; i++)
+	{
+		if (m_golden_compare(&m_store[i * M_GOLDEN_RECORD], &m_store[m_kept * M_GOLDEN_RECORD]) != 0)
+		{
+			m_kept++;
+			memmove(&m_store[m_kept * M_GOLDEN_RECORD], &m_store[i * M_GOLDEN_RECORD], M_GOLDEN_RECORD);
+		}
+	}
+
+	return m_kept + 1;
+}
+
+// The picture stored for m_hash in a sorted store, false if it doesn't have it
+static bool m_golden_lookup(const uint8_t *m_store, size_t m_records, uint64_t m_hash, uint64_t *m_rows)
+{
+	uint8_t m_key[8];
+
+	m_golden_le64(m_key, m_hash);
+
+	const uint8_t *m_record = (m_records != 0) ? bsearch(m_key, m_store, m_records, M_GOLDEN_RECORD, m_golden_compare) : NULL;
+
+	if (m_record == NULL)
+	{
+		return false;
+	}
+
+	for (size_t m_row = 0; m_row < CCHIP8_HEIGHT; m_row++)
+	{
+		m_rows[m_row] = m_golden_read64(&m_record[8 + (m_row * 8)]);
+	}
+
+	return true;
+}
+
+// Frame store, read whole (NULL and 0 records if there's none yet)
+static uint8_t *m_golden_load_store(const char *m_filename, size_t *m_records)
+{
+	FILE *m_file = fopen(m_filename, "rb");
+	uint8_t m_header[8];
+
+	*m_records = 0;
+
+	if (m_file == NULL)
+	{
+		return NULL;
+	}
+
+	if ((fread(m_header, 1, 8, m_file) != 8) || (memcmp(m_header, M_GOLDEN_MAGIC, 7) != 0) || (m_header[7] != M_GOLDEN_VERSION))
+	{
+		printf("%s isn't a frame store this version reads, diffs won't show the expected pictures\n", m_filename);
+		fclose(m_file);
+		return NULL;
+	}
+
+	uint8_t *m_store = NULL;
+	size_t m_count = 0;
+	uint8_t m_record[M_GOLDEN_RECORD];
+
+	while (fread(m_record, 1, M_GOLDEN_RECORD, m_file) == M_GOLDEN_RECORD)
+	{
+		if (m_golden_grow((void **) &m_store, m_count, M_GOLDEN_RECORD) == false)
+		{
+			break;
+		}
+
+		memcpy(&m_store[m_count++ * M_GOLDEN_RECORD], m_record, M_GOLDEN_RECORD);
+	}
+
+	fclose(m_file);
+	*m_records = m_golden_sort_store(m_store, m_count);
+
+	return m_store;
+}
+
+/*
+	Expected, actual and diff side by side (Separated by one grey column): the diff is white where
+	both are lit, red where only the expected picture is and green where only the actual one is.
+	Without an expected picture the first and last panels stay grey.
+*/
+static void m_golden_diff(const char *m_filename, const uint64_t *m_expected, const uint64_t *m_actual, uint32_t m_scale)
+{
+	m_image m_picture;
+
+	if (m_image_create(&m_picture, ((CCHIP8_WIDTH * 3) + 2) * m_scale, CCHIP8_HEIGHT * m_scale) == false)
+	{
+		printf("Couldn't allocate memory\n");
+		return;
+	}
+
+	for (uint32_t y = 0; y < CCHIP8_HEIGHT; y++)
+	{
+		m_image_fill(&m_picture, m_scale, CCHIP8_WIDTH, y, 4);
+		m_image_fill(&m_picture, m_scale, (CCHIP8_WIDTH * 2) + 1, y, 4);
+
+		for (uint32_t x = 0; x < CCHIP8_WIDTH; x++)
+		{
+			bool m_now = (m_actual[y] >> x) & 1;
+			bool m_was = (m_expected != NULL) && ((m_expected[y] >> x) & 1);
+			uint8_t m_change = (m_was && m_now) ? 1 : (m_was ? 2 : (m_now ? 3 : 0));
+
+			m_image_fill(&m_picture, m_scale, x, y, (m_expected == NULL) ? 4 : m_was);
+			m_image_fill(&m_picture, m_scale, CCHIP8_WIDTH + 1 + x, y, m_now);
+			m_image_fill(&m_picture, m_scale, (CCHIP8_WIDTH * 2) + 2 + x, y, (m_expected == NULL) ? 4 : m_change);
+		}
+	}
+
+	m_image_write_png(&m_picture, m_golden_palette, 5, m_filename);
+	m_image_free(&m_picture);
+}
+
+// Diff file for a check: <directory>/<rom name>-<manifest line>-<frame>.png
+static void m_golden_diff_name(char *m_filename, size_t m_size, const char *m_directory, const m_golden_test *m_test, const m_golden_check *m_check)
+{
+	char m_suffix[64];
+
+	snprintf(m_suffix, sizeof(m_suffix), "-%zu-%u.png", m_test->m_line, m_check->m_frame);
+
+	if (m_corpus_output(m_filename, m_size, m_directory, m_test->m_rom, m_suffix) == false)
+	{
+		snprintf(m_filename, m_size, "%s/golden%s", m_directory, m_suffix);
+	}
+}
+
+// Manifest with the hashes of this run, and the frame store with its pictures
+static bool m_golden_update(const char *m_manifest, char **m_lines, size_t m_linecount, const m_golden_job *m_job, const char *m_storename)
+{
+	enum m_golden_backend m_reference = m_job->m_backends[0];
+	uint8_t *m_store = NULL;
+	size_t m_records = 0;
+	bool m_ok = true;
+
+	for (size_t t = 0; (t < m_job->m_count) && m_ok; t++)
+	{
+		const m_golden_test *m_test = &m_job->m_tests[t];
+
+		for (size_t c = 0; (c < m_test->m_checkcount) && m_ok; c++)
+		{
+			const m_golden_check *m_check = &m_test->m_checks[c];
+			char *m_line = m_lines[m_check->m_line - 1];
+			char *m_comment = strchr(m_line, '#');
+			size_t m_indent = strspn(m_line, " \t");
+			char m_text[1024];
+
+			// Keep the indentation and the comment
+			snprintf(m_text, sizeof(m_text), "%.*sframe %u %016llx%s%.*s\n", (int) m_indent, m_line, m_check->m_frame,
+				(unsigned long long) m_check->m_actual[m_reference], (m_comment != NULL) ? " " : "",
+				(m_comment != NULL) ? (int) strcspn(m_comment, "\r\n") : 0, (m_comment != NULL) ? m_comment : "");
+
+			free(m_line);
+			m_lines[m_check->m_line - 1] = m_golden_copy(m_text);
+			m_ok = (m_lines[m_check->m_line - 1] != NULL);
+
+			// Every picture goes in, repeats are dropped once they're all there
+			if (m_ok && (m_ok = m_golden_grow((void **) &m_store, m_records, M_GOLDEN_RECORD)))
+			{
+				uint8_t *m_record = &m_store[m_records++ * M_GOLDEN_RECORD];
+
+				m_golden_le64(m_record, m_check->m_actual[m_reference]);
+
+				for (size_t m_row = 0; m_row < CCHIP8_HEIGHT; m_row++)
+				{
+					m_golden_le64(&m_record[8 + (m_row * 8)], m_check->m_rows[m_reference][m_row]);
+				}
+			}
+		}
+	}
+
+	m_records = m_golden_sort_store(m_store, m_records);
+
+	FILE *m_file = m_ok ? fopen(m_manifest, "wb") : NULL;
+
+	for (size_t i = 0; (m_file != NULL) && (i < m_linecount); i++)
+	{
+		fputs(m_lines[i], m_file);
+	}
+
+	m_ok = (m_file != NULL) && (fclose(m_file) == 0);
+
+	FILE *m_frames = m_ok ? fopen(m_storename, "wb") : NULL;
+
+	m_ok = (m_frames != NULL) && (fwrite(M_GOLDEN_MAGIC, 1, 7, m_frames) == 7) && (fputc(M_GOLDEN_VERSION, m_frames) != EOF) &&
+		(fwrite(m_store, M_GOLDEN_RECORD, m_records, m_frames) == m_records);
+
+	if ((m_frames != NULL) && (fclose(m_frames) != 0))
+	{
+		m_ok = false;
+	}
+
+	if (m_ok == false)
+	{
+		printf("Could not update %s and %s\n", m_manifest, m_storename);
+	}
+
+	free(m_store);
+
+	return m_ok;
+}
+
+int main(int argc, char **argv)
+{
+	const char *m_manifest = NULL;
+	const char *m_storename = NULL;
+	const char *m_directory = ".";
+	size_t m_threads = 0;
+	uint32_t m_scale = 8;
+	bool m_update = false;
+
+	m_golden_job m_job = { .m_backends = { M_GOLDEN_EXEC, M_GOLDEN_RUN, M_GOLDEN_FUSED }, .m_backendcount = M_GOLDEN_BACKENDS };
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-j") == 0) && ((i + 1) < argc))
+		{
+			m_threads = strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-o") == 0) && ((i + 1) < argc))
+		{
+			m_directory = argv[++i];
+		} else if ((strcmp(argv[i], "-frames") == 0) && ((i + 1) < argc))
+		{
+			m_storename = argv[++i];
+		} else if ((strcmp(argv[i], "-scale") == 0) && ((i + 1) < argc))
+		{
+			m_scale = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-backend") == 0) && ((i + 1) < argc))
+		{
+			i++;
+			m_job.m_backendcount = 1;
+
+			if (strcmp(argv[i], "exec") == 0)
+			{
+				m_job.m_backends[0] = M_GOLDEN_EXEC;
+			} else if (strcmp(argv[i], "run") == 0)
+			{
+				m_job.m_backends[0] = M_GOLDEN_RUN;
+			} else if (strcmp(argv[i], "fused") == 0)
+			{
+				m_job.m_backends[0] = M_GOLDEN_FUSED;
+			} else if (strcmp(argv[i], "all") == 0)
+			{
+				m_job.m_backendcount = M_GOLDEN_BACKENDS;
+			} else {
+				m_manifest = NULL;
+				break;
+			}
+		} else if (strcmp(argv[i], "-update") == 0)
+		{
+			m_update = true;
+		} else if ((argv[i][0] != '-') && (m_manifest == NULL))
+		{
+			m_manifest = argv[i];
+		} else {
+			m_manifest = NULL;
+			break;
+		}
+	}
+
+	if ((m_manifest == NULL) || (m_scale == 0) || (m_scale > 64))
+	{
+		printf("Usage: ./cchip8-golden [-j threads] [-backend exec|run|fused|all] [-o directory] [-scale 1-64] [-frames store] [-update] manifest\n");
+		return EXIT_FAILURE;
+	}
+
+	// Diffs are written while reporting, long after the tests ran, so the directory has to be there first
+	if ((m_corpus_is_directory(m_directory) == false) && (mkdir(m_directory, 0777) != 0))
+	{
+		printf("Could not create %s\n", m_directory);
+		return EXIT_FAILURE;
+	}
+
+	// The frame store lives next to the manifest unless told otherwise
+	char m_defaultstore[4096];
+
+	if (m_storename == NULL)
+	{
+		snprintf(m_defaultstore, sizeof(m_defaultstore), "%s.frames", m_manifest);
+		m_storename = m_defaultstore;
+	}
+
+	FILE *m_file = fopen(m_manifest, "rb");
+
+	if (m_file == NULL)
+	{
+		printf("Could not open %s\n", m_manifest);
+		return EXIT_FAILURE;
+	}
+
+	// ROM paths are relative to the manifest's directory
+	char m_base[4096];
+	const char *m_slash = strrchr(m_manifest, '/');
+
+	snprintf(m_base, sizeof(m_base), "%.*s", (m_slash != NULL) ? (int) (m_slash - m_manifest) : 0, m_manifest);
+
+	// Lines are kept as read for -update
+	char **m_lines = NULL;
+	size_t m_linecount = 0;
+	char m_text[1024];
+	bool m_ok = true;
+
+	while (m_ok && (fgets(m_text, sizeof(m_text), m_file) != NULL))
+	{
+		char m_scratch[1024];
+
+		strcpy(m_scratch, m_text);
+
+		m_ok = m_golden_grow((void **) &m_lines, m_linecount, sizeof(char *)) && ((m_lines[m_linecount] = m_golden_copy(m_text)) != NULL);
+		m_linecount += m_ok ? 1 : 0;
+		m_ok = m_ok && m_golden_parse(&m_job.m_tests, &m_job.m_count, m_scratch, m_linecount, m_base);
+	}
+
+	fclose(m_file);
+
+	size_t m_checks = 0;
+	uint64_t m_frames = 0;
+
+	for (size_t t = 0; t < m_job.m_count; t++)
+	{
+		m_checks += m_job.m_tests[t].m_checkcount;
+		m_frames += (m_job.m_tests[t].m_checkcount != 0) ? m_job.m_tests[t].m_checks[m_job.m_tests[t].m_checkcount - 1].m_frame : 0;
+	}
+
+	if (m_ok && (m_checks == 0))
+	{
+		printf("%s checks no frames\n", m_manifest);
+		m_ok = false;
+	}
+
+	if (m_ok == false)
+	{
+		m_golden_free(m_job.m_tests, m_job.m_count);
+
+		for (size_t i = 0; i < m_linecount; i++)
+		{
+			free(m_lines[i]);
+		}
+
+		free(m_lines);
+		return EXIT_FAILURE;
+	}
+
+	double m_start = m_golden_now();
+	m_corpus_for(m_job.m_count * m_job.m_backendcount, m_threads, m_golden_run, &m_job);
+	double m_seconds = m_golden_now() - m_start;
+
+	size_t m_records = 0;
+	uint8_t *m_store = m_golden_load_store(m_storename, &m_records);
+	enum m_golden_backend m_reference = m_job.m_backends[0];
+	size_t m_passed = 0;
+	size_t m_failed = 0;
+	size_t m_new = 0;
+	bool m_broken = false;
+
+	for (size_t t = 0; t < m_job.m_count; t++)
+	{
+		const m_golden_test *m_test = &m_job.m_tests[t];
+		bool m_ran = true;
+
+		for (size_t b = 0; b < m_job.m_backendcount; b++)
+		{
+			if (m_test->m_error[m_job.m_backends[b]][0] != '\0')
+			{
+				printf("ERROR    %s (Line %zu) on %s: %s\n", m_test->m_rom, m_test->m_line, m_golden_names[m_job.m_backends[b]], m_test->m_error[m_job.m_backends[b]]);
+				m_ran = false;
+			}
+		}
+
+		if (m_ran == false)
+		{
+			m_failed += m_test->m_checkcount;
+			m_broken = true;
+			continue;
+		}
+
+		for (size_t c = 0; c < m_test->m_checkcount; c++)
+		{
+			const m_golden_check *m_check = &m_test->m_checks[c];
+			uint64_t m_actual = m_check->m_actual[m_reference];
+			char m_filename[4096];
+			bool m_pass = true;
+
+			// A backend that disagrees with the reference is a bug whatever the golden says
+			for (size_t b = 1; b < m_job.m_backendcount; b++)
+			{
+				enum m_golden_backend m_backend = m_job.m_backends[b];
+
+				if (m_check->m_actual[m_backend] != m_actual)
+				{
+					m_golden_diff_name(m_filename, sizeof(m_filename), m_directory, m_test, m_check);
+					printf("DIVERGED %s (Line %zu) frame %u: %s drew %016llx, %s %016llx (%s)\n", m_test->m_rom, m_check->m_line,
+						m_check->m_frame, m_golden_names[m_reference], (unsigned long long) m_actual, m_golden_names[m_backend],
+						(unsigned long long) m_check->m_actual[m_backend], m_filename);
+					m_golden_diff(m_filename, m_check->m_rows[m_reference], m_check->m_rows[m_backend], m_scale);
+					m_pass = false;
+					m_broken = true;
+				}
+			}
+
+			if (m_check->m_known == false)
+			{
+				printf("NEW      %s (Line %zu) frame %u: %016llx\n", m_test->m_rom, m_check->m_line, m_check->m_frame, (unsigned long long) m_actual);
+				m_new++;
+				continue;
+			}
+
+			if ((m_check->m_expected != m_actual) && (m_update == true))
+			{
+				printf("UPDATED  %s (Line %zu) frame %u: %016llx, was %016llx\n", m_test->m_rom, m_check->m_line, m_check->m_frame,
+					(unsigned long long) m_actual, (unsigned long long) m_check->m_expected);
+				continue;
+			}
+
+			if (m_check->m_expected != m_actual)
+			{
+				uint64_t m_rows[CCHIP8_HEIGHT];
+				bool m_stored = m_golden_lookup(m_store, m_records, m_check->m_expected, m_rows);
+
+				m_golden_diff_name(m_filename, sizeof(m_filename), m_directory, m_test, m_check);
+				printf("MISMATCH %s (Line %zu) frame %u: expected %016llx, got %016llx (%s%s)\n", m_test->m_rom, m_check->m_line,
+					m_check->m_frame, (unsigned long long) m_check->m_expected, (unsigned long long) m_actual, m_filename,
+					m_stored ? "" : ", the expected picture isn't in the frame store");
+				m_golden_diff(m_filename, m_stored ? m_rows : NULL, m_check->m_rows[m_reference], m_scale);
+				m_pass = false;
+			}
+
+			m_passed += m_pass ? 1 : 0;
+			m_failed += m_pass ? 0 : 1;
+		}
+	}
+
+	printf("%zu tests, %zu checks on %zu backends: %zu passed, %zu failed, %zu new (%.2f s, %.0f frames/s)\n", m_job.m_count, m_checks,
+		m_job.m_backendcount, m_passed, m_failed, m_new, m_seconds, ((double) m_frames * m_job.m_backendcount) / m_seconds);
+
+	bool m_success = (m_failed == 0);
+
+	// Backends that disagree or tests that didn't run have no single answer to record
+	if (m_update == true)
+	{
+		if (m_broken == true)
+		{
+			printf("Not updating %s, fix the errors and divergences first\n", m_manifest);
+		} else {
+			m_success = m_golden_update(m_manifest, m_lines, m_linecount, &m_job, m_storename);
+
+			if (m_success)
+			{
+				printf("Updated %s and %s\n", m_manifest, m_storename);
+			}
+		}
+	} else if (m_new != 0)
+	{
+		printf("Run with -update to record the new hashes\n");
+	}
+
+	free(m_store);
+	m_golden_free(m_job.m_tests, m_job.m_count);
+
+	for (size_t i = 0; i < m_linecount; i++)
+	{
+		free(m_lines[i]);
+	}
+
+	free(m_lines);
+
+	return m_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
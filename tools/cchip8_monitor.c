@@ -0,0 +1,146 @@
+// clock_gettime() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/libcchip8.h"
+
+/*
+	CCHIP8 monitor:
+	Watches an emulator started with -shm from another process. It sleeps on the export's frame
+	counter (No polling), copies every publication it wakes up for and prints once a second how
+	many it saw, how many went by between two wake-ups (Missed) and where the machine is. Only
+	uses the public API, so it doubles as the example of an external consumer.
+*/
+
+// Wall clock in nanoseconds
+static uint64_t m_monitor_clock(void)
+{
+	struct timespec m_now;
+
+	clock_gettime(CLOCK_MONOTONIC, &m_now);
+
+	return ((uint64_t) m_now.tv_sec * 1000000000ull) + (uint64_t) m_now.tv_nsec;
+}
+
+// The display as text, two pixels per character so it fits a terminal
+static void m_monitor_print_screen(const cchip8_snapshot *m_snapshot)
+{
+	for (int m_row = 0; m_row < CCHIP8_HEIGHT; m_row += 2)
+	{
+		char m_line[CCHIP8_WIDTH + 1];
+
+		for (int m_column = 0; m_column < CCHIP8_WIDTH; m_column++)
+		{
+			bool m_top = (m_snapshot->m_display[m_row] >> m_column) & 1;
+			bool m_bottom = (m_snapshot->m_display[m_row + 1] >> m_column) & 1;
+
+			m_line[m_column] = m_top ? (m_bottom ? '#' : '"') : (m_bottom ? '.' : ' ');
+		}
+
+		m_line[CCHIP8_WIDTH] = '\0';
+		printf("|%s|\n", m_line);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const char *m_name = "/cchip8";
+	bool m_screen = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-screen") == 0)
+		{
+			m_screen = true;
+		} else if (argv[i][0] == '/')
+		{
+			m_name = argv[i];
+		} else {
+			printf("Usage: ./cchip8-monitor [name] [-screen]\n");
+			printf("name     Shared memory segment the emulator exports to (-shm, default /cchip8)\n");
+			printf("-screen  Print the display along with the statistics\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	cchip8_monitor *m_monitor = cchip8_monitor_open(m_name);
+
+	if (m_monitor == NULL)
+	{
+		printf("Nothing exported to %s (Start the emulator with -shm %s)\n", m_name, m_name);
+		return EXIT_FAILURE;
+	}
+
+	cchip8_snapshot *m_snapshot = calloc(1, sizeof(cchip8_snapshot));
+
+	if (m_snapshot == NULL)
+	{
+		cchip8_monitor_close(m_monitor);
+		return EXIT_FAILURE;
+	}
+
+	uint32_t m_counter = 0;
+	uint64_t m_lastframe = 0;
+	uint64_t m_seen = 0;
+	uint64_t m_missed = 0;
+	uint64_t m_report = m_monitor_clock() + 1000000000ull;
+	bool m_open = true;
+
+	printf("Watching %s\n", m_name);
+
+	while (m_open)
+	{
+		m_counter = cchip8_monitor_wait(m_monitor, m_counter, 250);
+
+		if (cchip8_monitor_read(m_monitor, m_snapshot))
+		{
+			// Publications count up by one, any gap went by while we were asleep or busy
+			if (m_snapshot->m_frame != m_lastframe)
+			{
+				if ((m_lastframe != 0) && (m_snapshot->m_frame > (m_lastframe + 1)))
+				{
+					m_missed += m_snapshot->m_frame - (m_lastframe + 1);
+				}
+
+				m_lastframe = m_snapshot->m_frame;
+				m_seen++;
+			}
+		} else {
+			// The emulator quit (Or never published, which only lasts until its first frame)
+			m_open = (m_lastframe == 0);
+		}
+
+		uint64_t m_now = m_monitor_clock();
+
+		if ((m_now < m_report) && m_open)
+		{
+			continue;
+		}
+
+		m_report = m_now + 1000000000ull;
+
+		if (m_screen && (m_lastframe != 0))
+		{
+			m_monitor_print_screen(m_snapshot);
+		}
+
+		printf("%llu publications seen, %llu missed | frame %llu, PC 0x%03X, I 0x%03X, %llu instructions%s\n",
+			(unsigned long long) m_seen, (unsigned long long) m_missed, (unsigned long long) m_lastframe,
+			m_snapshot->m_programcounter, m_snapshot->m_index, (unsigned long long) m_snapshot->m_cycles,
+			(m_snapshot->m_fault != CCHIP8_FAULT_NONE) ? " (Faulted)" : "");
+
+		m_seen = 0;
+		m_missed = 0;
+	}
+
+	printf("The export went away\n");
+
+	free(m_snapshot);
+	cchip8_monitor_close(m_monitor);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#include "../include/cchip8.h"
+#include "../include/cchip8_loader.h"
+
+/*
+	CCHIP8 ROM archiver:
+	Packs a corpus of ROMs into a single archive (Format described in include/cchip8_loader.h) that
+	batch jobs map once through cchip8_archive_open, or lists the contents of an existing one.
+*/
+
+static int m_pack_list(const char *m_filename)
+{
+	cchip8_archive *m_archive = cchip8_archive_open(m_filename);
+
+	if (m_archive == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+
+	for (size_t i = 0; i < cchip8_archive_count(m_archive); i++)
+	{
+		size_t m_size = 0;
+		cchip8_archive_rom(m_archive, i, &m_size);
+
+		printf("%6zu %6zu bytes  %s\n", i, m_size, cchip8_archive_name(m_archive, i));
+	}
+
+	printf("%zu ROMs\n", cchip8_archive_count(m_archive));
+
+	cchip8_archive_close(m_archive);
+
+	return EXIT_SUCCESS;
+}
+
+// Write the header, entry table, names and ROM images of an archive
+static bool m_pack_write(const char *m_filename, char **m_inputs, const m_rom *m_roms, size_t m_count)
+{
+	uint64_t m_tablesize = M_ARCHIVE_HEADER_SIZE + (uint64_t) m_count * M_ARCHIVE_ENTRY_SIZE;
+	uint64_t m_namesize = 0;
+	uint64_t m_datasize = 0;
+
+	for (size_t i = 0; i < m_count; i++)
+	{
+		m_namesize += strlen(m_inputs[i]) + 1;
+		m_datasize += m_roms[i].m_size;
+	}
+
+	if ((m_tablesize + m_namesize + m_datasize) > UINT32_MAX)
+	{
+		printf("The corpus is too big for a single archive\n");
+		return false;
+	}
+
+	uint8_t *m_table = calloc(1, m_tablesize);
+
+	if (m_table == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		return false;
+	}
+
+	memcpy(m_table, M_ARCHIVE_MAGIC, 4);
+	m_write_le32(&m_table[4], M_ARCHIVE_VERSION);
+	m_write_le32(&m_table[8], (uint32_t) m_count);
+
+	// Names follow the table, ROM images follow the names
+	uint32_t m_nameoffset = (uint32_t) m_tablesize;
+	uint32_t m_dataoffset = (uint32_t) (m_tablesize + m_namesize);
+
+	for (size_t i = 0; i < m_count; i++)
+	{
+		uint8_t *m_entry = &m_table[M_ARCHIVE_HEADER_SIZE + i * M_ARCHIVE_ENTRY_SIZE];
+
+		m_write_le32(&m_entry[0], m_dataoffset);
+		m_write_le32(&m_entry[4], (uint32_t) m_roms[i].m_size);
+		m_write_le32(&m_entry[8], m_nameoffset);
+
+		m_nameoffset += (uint32_t) strlen(m_inputs[i]) + 1;
+		m_dataoffset += (uint32_t) m_roms[i].m_size;
+	}
+
+	FILE *m_out = fopen(m_filename, "wb");
+
+	if (m_out == NULL)
+	{
+		printf("Could not create %s\n", m_filename);
+		free(m_table);
+		return false;
+	}
+
+	bool m_written = (fwrite(m_table, 1, m_tablesize, m_out) == m_tablesize);
+
+	for (size_t i = 0; m_written && (i < m_count); i++)
+	{
+		size_t m_length = strlen(m_inputs[i]) + 1;
+		m_written = (fwrite(m_inputs[i], 1, m_length, m_out) == m_length);
+	}
+
+	for (size_t i = 0; m_written && (i < m_count); i++)
+	{
+		m_written = (fwrite(m_roms[i].m_data, 1, m_roms[i].m_size, m_out) == m_roms[i].m_size);
+	}
+
+	m_written = (fclose(m_out) == 0) && m_written;
+	free(m_table);
+
+	if (m_written == false)
+	{
+		printf("Could not write %s\n", m_filename);
+		return false;
+	}
+
+	printf("Packed %zu ROMs (%llu bytes of ROM data) into %s\n", m_count, (unsigned long long) m_datasize, m_filename);
+
+	return true;
+}
+
+static int m_pack_create(const char *m_filename, char **m_inputs, size_t m_count)
+{
+	m_rom *m_roms = calloc(m_count, sizeof(m_rom));
+
+	if (m_roms == NULL)
+	{
+		printf("Couldn't allocate memory\n");
+		return EXIT_FAILURE;
+	}
+
+	// Map every input up front, oversized ROMs would never load so they're refused here already
+	size_t m_mapped = 0;
+	bool m_valid = true;
+
+	while (m_valid && (m_mapped < m_count))
+	{
+		m_valid = m_rom_map(&m_roms[m_mapped], m_inputs[m_mapped]);
+
+		if (m_valid == false)
+		{
+			break;
+		}
+
+		if (m_roms[m_mapped].m_size > CCHIP8_MAX_ROM_SIZE)
+		{
+			printf("%s doesn't fit in memory (%zu bytes, at most %d)\n", m_inputs[m_mapped], m_roms[m_mapped].m_size, CCHIP8_MAX_ROM_SIZE);
+			m_valid = false;
+		}
+
+		m_mapped++;
+	}
+
+	if (m_valid == true)
+	{
+		m_valid = m_pack_write(m_filename, m_inputs, m_roms, m_count);
+	}
+
+	for (size_t i = 0; i < m_mapped; i++)
+	{
+		m_rom_unmap(&m_roms[i]);
+	}
+
+	free(m_roms);
+
+	return m_valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
+{
+	if ((argc == 3) && (strcmp(argv[1], "-l") == 0))
+	{
+		return m_pack_list(argv[2]);
+	}
+
+	if (argc < 3)
+	{
+		printf("Usage: ./cchip8-pack [archive] [roms...]\n");
+		printf("       ./cchip8-pack -l [archive]\n");
+		return EXIT_FAILURE;
+	}
+
+	return m_pack_create(argv[1], &argv[2], (size_t) (argc - 2));
+}
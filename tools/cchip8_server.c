@@ -0,0 +1,131 @@
+// sigaction() is POSIX, -std=c2x hides it otherwise
+#define _POSIX_C_SOURCE 200809L
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/libcchip8.h"
+
+/*
+	CCHIP8 headless server:
+	One machine without a window, driven entirely through its control socket (Load a ROM, press keys,
+	run frames, save and restore states, read memory and observe). It never runs on its own, time
+	only passes when a client asks for frames, so automation gets the same results on every run.
+*/
+
+// Set by SIGINT/SIGTERM, the socket file gets removed on the way out
+static volatile sig_atomic_t m_server_stop = 0;
+
+static void m_server_signal(int m_signal)
+{
+	(void) m_signal;
+	m_server_stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *m_path = "/tmp/cchip8.sock";
+	const char *m_filename = NULL;
+	const char *m_capturename = NULL;
+	cchip8_options m_options;
+
+	cchip8_default_options(&m_options);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "-socket") == 0) && ((i + 1) < argc))
+		{
+			m_path = argv[++i];
+		} else if ((strcmp(argv[i], "-quirks") == 0) && ((i + 1) < argc))
+		{
+			m_options.m_profile = argv[++i];
+		} else if ((strcmp(argv[i], "-seed") == 0) && ((i + 1) < argc))
+		{
+			m_options.m_seed = (uint32_t) strtoul(argv[++i], NULL, 0);
+		} else if ((strcmp(argv[i], "-capture") == 0) && ((i + 1) < argc))
+		{
+			m_capturename = argv[++i];
+		} else if ((argv[i][0] != '-') && (m_filename == NULL))
+		{
+			m_filename = argv[i];
+		} else {
+			printf("Usage: ./cchip8-server [-socket path] [-quirks profile|auto] [-seed n] [-capture file.c8v] [rom.ch8]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	cchip8 *m_vm = cchip8_create(&m_options);
+
+	if (m_vm == NULL)
+	{
+		printf("Could not create the interpreter (Unknown quirk profile?)\n");
+		return EXIT_FAILURE;
+	}
+
+	// Without a ROM the machine waits for CCHIP8_CONTROL_LOAD_ROM
+	if ((m_filename != NULL) && (cchip8_load_rom_from_file(m_vm, m_filename) == false))
+	{
+		printf("Could not load %s\n", m_filename);
+		cchip8_destroy(m_vm);
+		return EXIT_FAILURE;
+	}
+
+	cchip8_control *m_control = cchip8_control_create(m_vm, m_path);
+
+	if (m_control == NULL)
+	{
+		cchip8_destroy(m_vm);
+		return EXIT_FAILURE;
+	}
+
+	// Everything the clients make the machine draw, for reviewing an automated run afterwards
+	cchip8_capture *m_capture = NULL;
+
+	if (m_capturename != NULL)
+	{
+		m_capture = cchip8_capture_create(m_capturename);
+
+		if (m_capture == NULL)
+		{
+			cchip8_control_destroy(m_control);
+			cchip8_destroy(m_vm);
+			return EXIT_FAILURE;
+		}
+
+		cchip8_attach_capture(m_vm, m_capture);
+	}
+
+	// No SA_RESTART, the signal has to interrupt the poll() we're sleeping in
+	struct sigaction m_action;
+	memset(&m_action, 0, sizeof(m_action));
+	m_action.sa_handler = m_server_signal;
+	sigaction(SIGINT, &m_action, NULL);
+	sigaction(SIGTERM, &m_action, NULL);
+
+	printf("Serving %s on %s\n", (m_filename != NULL) ? m_filename : "nothing yet", m_path);
+
+	uint64_t m_requests = 0;
+
+	while (m_server_stop == 0)
+	{
+		int m_ran = cchip8_control_serve(m_control, -1);
+
+		if (m_ran < 0)
+		{
+			printf("The control socket failed\n");
+			break;
+		}
+
+		m_requests += (uint64_t) m_ran;
+	}
+
+	printf("Served %llu requests\n", (unsigned long long) m_requests);
+
+	cchip8_control_destroy(m_control);
+	cchip8_destroy(m_vm);
+	cchip8_capture_destroy(m_capture, NULL);
+
+	return EXIT_SUCCESS;
+}